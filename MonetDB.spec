@@ -554,6 +554,7 @@ embedded library (%{name}-embedded).
 %{_libdir}/monetdb5*/lib_capi.so
 %endif
 %{_libdir}/monetdb5*/lib_csv.so
+%{_libdir}/monetdb5*/lib_parquet.so
 %{_libdir}/monetdb5*/lib_generator.so
 
 %package server
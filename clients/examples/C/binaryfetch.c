@@ -0,0 +1,244 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+/* Fetch the same result set with the text and the binary protocol and
+ * check that the rows are the same.  With a small cache limit, the rows
+ * after the first block are fetched with Xexportbin, and the server
+ * prefetches the block after that.  A result set that is closed while a
+ * block is prefetched, and two result sets that are read in turns, must
+ * still give the right rows.  The blocks are fetched with every
+ * compression method that was built in as well. */
+
+#include "monetdb_config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <mapi.h>
+
+#define die(dbh,hdl)	do {						\
+				if (hdl)				\
+					mapi_explain_result(hdl,stderr); \
+				else if (dbh)				\
+					mapi_explain(dbh,stderr);	\
+				else					\
+					fprintf(stderr,"command failed\n"); \
+				exit(-1);				\
+			} while (0)
+
+#define NROWS	2500
+#define BLOCK	100
+
+static const char *create =
+	"create table bf(i int, b bigint, t tinyint, sm smallint, s varchar(20),"
+	" d double, r real, m decimal(10,2), n decimal(4,1), dt date, tm time(3),"
+	" ts timestamp, bl boolean, u uuid)";
+
+/* every column has NULLs, at different rows */
+static const char *insert =
+	"insert into bf select value,"
+	" case when value % 11 = 0 then null else value * 1000000007 end,"
+	" case when value % 13 = 0 then null else value % 100 - 50 end,"
+	" case when value % 17 = 0 then null else value * 7 % 30000 - 15000 end,"
+	" case when value % 5 = 0 then null"
+	"      when value % 5 = 1 then 'a\"b\\\\c' || value"
+	"      when value % 5 = 2 then ''"
+	"      when value % 5 = 3 then 'tab\tnl\n' || value"
+	"      else '\xc3\xa9t\xc3\xa9' || value end,"
+	" case when value % 19 = 0 then null else value / 3.0e0 end,"
+	" case when value % 23 = 0 then null else cast(value / 7.0e0 as real) end,"
+	" case when value % 29 = 0 then null else value * 13 / 7.00 - 3000 end,"
+	" case when value % 31 = 0 then null else value % 900 / 10.0 end,"
+	" case when value % 37 = 0 then null else date '1999-12-25' + value * interval '1' day end,"
+	" case when value % 41 = 0 then null else time '00:00:00.125' + value * interval '37' second end,"
+	" case when value % 43 = 0 then null else timestamp '1970-01-01 12:34:56.789' + value * interval '12345' second end,"
+	" case when value % 47 = 0 then null else value % 2 = 0 end,"
+	" case when value % 53 = 0 then null else cast('6c49869d-45dc-4b00-ae55-5bd363c0' || lpad(cast(value as varchar(4)), 4, '0') as uuid) end"
+	" from generate_series(0, 2500)";
+
+static const char *query = "select * from bf order by i";
+
+static char ***
+fetch_rows(Mapi dbh, MapiHdl hdl, int64_t nrows, int *nfields)
+{
+	char ***rows = malloc(nrows * sizeof(*rows));
+	int64_t r = 0;
+
+	if (rows == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	*nfields = mapi_get_field_count(hdl);
+	while (r < nrows && mapi_fetch_row(hdl)) {
+		rows[r] = malloc(*nfields * sizeof(**rows));
+		if (rows[r] == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(-1);
+		}
+		for (int f = 0; f < *nfields; f++) {
+			char *v = mapi_fetch_field(hdl, f);
+			rows[r][f] = v ? strdup(v) : NULL;
+		}
+		r++;
+	}
+	if (mapi_error(dbh))
+		die(dbh, hdl);
+	if (r != nrows)
+		fprintf(stderr, "rows received %" PRId64 " instead of %" PRId64 "\n", r, nrows);
+	return rows;
+}
+
+/* compare the next row of hdl with row r of the expected rows */
+static void
+check_row(Mapi dbh, MapiHdl hdl, const char *what, char ***exp, int nfields, int64_t r)
+{
+	if (!mapi_fetch_row(hdl)) {
+		if (mapi_error(dbh))
+			die(dbh, hdl);
+		fprintf(stderr, "%s: row %" PRId64 " missing\n", what, r);
+		return;
+	}
+	for (int f = 0; f < nfields; f++) {
+		char *v = mapi_fetch_field(hdl, f);
+		if (v == NULL ? exp[r][f] != NULL : exp[r][f] == NULL || strcmp(v, exp[r][f]) != 0)
+			fprintf(stderr, "%s: row %" PRId64 " column %d: got %s instead of %s\n",
+				what, r, f, v ? v : "NULL", exp[r][f] ? exp[r][f] : "NULL");
+	}
+}
+
+static void
+check_all(Mapi dbh, const char *what, char ***exp, int nfields)
+{
+	MapiHdl hdl;
+
+	if ((hdl = mapi_query(dbh, query)) == NULL || mapi_error(dbh))
+		die(dbh, hdl);
+	for (int64_t r = 0; r < NROWS; r++)
+		check_row(dbh, hdl, what, exp, nfields, r);
+	if (mapi_fetch_row(hdl))
+		fprintf(stderr, "%s: too many rows\n", what);
+	if (mapi_close_handle(hdl) != MOK)
+		die(dbh, hdl);
+}
+
+int
+main(int argc, char **argv)
+{
+	Mapi dbh;
+	MapiHdl hdl = NULL, hdl2 = NULL;
+	char ***exp;
+	int nfields;
+
+	if (argc != 4) {
+		fprintf(stderr, "usage:%s <host> <port> <language>\n", argv[0]);
+		exit(-1);
+	}
+	if (strcmp(argv[3], "sql") != 0) {
+		fprintf(stderr, "%s: unknown language, only sql supported\n", argv[0]);
+		exit(1);
+	}
+
+	dbh = mapi_connect(argv[1], atoi(argv[2]), "monetdb", "monetdb", argv[3], NULL);
+	if (dbh == NULL || mapi_error(dbh))
+		die(dbh, hdl);
+
+	mapi_cache_limit(dbh, BLOCK);
+	/* mapi_log(dbh, "/tmp/mapilog"); */
+	if (mapi_setAutocommit(dbh, false) != MOK || mapi_error(dbh))
+		die(dbh, NULL);
+	/* the decimal and time columns are only fetched in binary when
+	 * their sizes are known */
+	if (mapi_set_size_header(dbh, true) != MOK)
+		die(dbh, NULL);
+	if ((hdl = mapi_query(dbh, create)) == NULL || mapi_error(dbh))
+		die(dbh, hdl);
+	if (mapi_close_handle(hdl) != MOK)
+		die(dbh, hdl);
+	if ((hdl = mapi_query(dbh, insert)) == NULL || mapi_error(dbh))
+		die(dbh, hdl);
+	if (mapi_close_handle(hdl) != MOK)
+		die(dbh, hdl);
+
+	/* the expected rows, with the text protocol */
+	if (mapi_set_binary_protocol(dbh, false) != MOK)
+		die(dbh, NULL);
+	if ((hdl = mapi_query(dbh, query)) == NULL || mapi_error(dbh))
+		die(dbh, hdl);
+	exp = fetch_rows(dbh, hdl, NROWS, &nfields);
+	if (mapi_close_handle(hdl) != MOK)
+		die(dbh, hdl);
+
+	if (mapi_set_binary_protocol(dbh, true) != MOK)
+		die(dbh, NULL);
+	if (!mapi_get_binary_protocol(dbh))
+		fprintf(stderr, "binary protocol not switched on\n");
+	check_all(dbh, "binary", exp, nfields);
+#ifdef HAVE_LIBZ
+	if (mapi_set_binary_compression(dbh, "gz") != MOK)
+		die(dbh, NULL);
+	check_all(dbh, "binary gz", exp, nfields);
+#endif
+#ifdef HAVE_LIBLZ4
+	if (mapi_set_binary_compression(dbh, "lz4") != MOK)
+		die(dbh, NULL);
+	check_all(dbh, "binary lz4", exp, nfields);
+#endif
+	if (mapi_set_binary_compression(dbh, NULL) != MOK)
+		die(dbh, NULL);
+
+	/* close the result set while the server prefetches the block
+	 * after the one that was read */
+	if ((hdl = mapi_query(dbh, query)) == NULL || mapi_error(dbh))
+		die(dbh, hdl);
+	for (int64_t r = 0; r < BLOCK + BLOCK / 2; r++)
+		check_row(dbh, hdl, "closed early", exp, nfields, r);
+	if (mapi_close_handle(hdl) != MOK)
+		die(dbh, hdl);
+	if ((hdl = mapi_query(dbh, "select count(*) from bf")) == NULL || mapi_error(dbh))
+		die(dbh, hdl);
+	if (!mapi_fetch_row(hdl) || strcmp(mapi_fetch_field(hdl, 0), "2500") != 0)
+		fprintf(stderr, "after close: unexpected count\n");
+	if (mapi_close_handle(hdl) != MOK)
+		die(dbh, hdl);
+	check_all(dbh, "after close", exp, nfields);
+
+	/* two result sets read in turns: each request is for the other
+	 * result set than the one prefetched */
+	if ((hdl = mapi_query(dbh, query)) == NULL || mapi_error(dbh))
+		die(dbh, hdl);
+	if ((hdl2 = mapi_query(dbh, query)) == NULL || mapi_error(dbh))
+		die(dbh, hdl2);
+	for (int64_t r = 0; r < NROWS; r += BLOCK / 2) {
+		for (int64_t i = r; i < r + BLOCK / 2 && i < NROWS; i++)
+			check_row(dbh, hdl, "in turns", exp, nfields, i);
+		for (int64_t i = r; i < r + BLOCK / 2 && i < NROWS; i++)
+			check_row(dbh, hdl2, "in turns", exp, nfields, i);
+	}
+	if (mapi_close_handle(hdl2) != MOK)
+		die(dbh, hdl2);
+	if (mapi_close_handle(hdl) != MOK)
+		die(dbh, hdl);
+
+	for (int64_t r = 0; r < NROWS; r++) {
+		for (int f = 0; f < nfields; f++)
+			free(exp[r][f]);
+		free(exp[r]);
+	}
+	free(exp);
+	if ((hdl = mapi_query(dbh, "rollback")) == NULL || mapi_error(dbh))
+		die(dbh, hdl);
+	if (mapi_close_handle(hdl) != MOK)
+		die(dbh, hdl);
+	mapi_destroy(dbh);
+
+	return 0;
+}
@@ -1489,7 +1489,8 @@ describe_table(Mapi mid, const char *schema, const char *tname,
 				"sys._tables AS t, "
 				"(VALUES (0, 'INDEX'), "
 					"(4, 'IMPRINTS INDEX'), "
-					"(5, 'ORDERED INDEX')) AS it (id, idx) "
+					"(5, 'ORDERED INDEX'), "
+					"(6, 'CLUSTERED INDEX')) AS it (id, idx) "
 			  "WHERE i.table_id = t.id "
 			    "AND i.id = kc.id "
 			    "AND t.id = c.table_id "
@@ -1498,7 +1499,7 @@ describe_table(Mapi mid, const char *schema, const char *tname,
 			    "AND t.schema_id = s.id "
 			    "AND s.name = '%s' "
 			    "AND t.name = '%s' "
-			    "AND i.type in (0, 4, 5) "
+			    "AND i.type in (0, 4, 5, 6) "
 			    "AND i.type = it.id "
 			  "ORDER BY i.name, kc.nr", s, t);
 		if ((hdl = mapi_query(mid, query)) == NULL || mapi_error(mid))
@@ -563,9 +563,10 @@ mapi_handshake(Mapi mid)
 		}
 	}
 
-	/* skip the binary option */
 	char *binary = strtok_r(NULL, ":", &strtok_state);
-	(void)binary;
+	mid->binary_level = 0;
+	if (binary && strncmp(binary, "BINARY=", 7) == 0)
+		mid->binary_level = atoi(binary + 7);
 
 	char *oobintr = strtok_r(NULL, ":", &strtok_state);
 	if (oobintr) {
@@ -891,6 +892,13 @@ mapi_handshake(Mapi mid)
 	if (mid->handshake_options <= MAPI_HANDSHAKE_TIME_ZONE) {
 		mapi_set_time_zone(mid, msetting_long(mid->settings, MP_TIMEZONE));
 	}
+	if (mid->binary_protocol && mid->binary_compression && mid->binary_level >= 2) {
+		/* not fatal: the server then sends uncompressed blocks */
+		if (mapi_Xcommand(mid, "binary_compression", mid->binary_compression) != MOK)
+			return mid->error;
+		if (mid->error == MSERVER)
+			mapi_clrError(mid);
+	}
 
 	if (mid->error == MOK)
 		send_all_clientinfo(mid);
@@ -696,6 +696,8 @@
 #include "matomic.h"
 #include "mstring.h"
 #include "mutils.h"
+#include "copybinary.h"
+#include <math.h>		/* isnan */
 
 #include "mapi_intern.h"
 
@@ -1184,6 +1186,13 @@ mapi_get_columnar_protocol(Mapi mid)
 	return mid->columnar_protocol;
 }
 
+bool
+mapi_get_binary_protocol(Mapi mid)
+{
+	mapi_check0(mid);
+	return mid->binary_protocol;
+}
+
 int
 mapi_get_time_zone(Mapi mid)
 {
@@ -2022,6 +2031,7 @@ mapi_destroy(Mapi mid)
 	if (mid->errorstr && mid->errorstr != mapi_nomem)
 		free(mid->errorstr);
 	free(mid->clientprefix);
+	free(mid->binary_compression);
 
 	msettings_destroy(mid->settings);
 
@@ -2845,6 +2855,42 @@ mapi_set_size_header(Mapi mid, bool value)
 		return mapi_Xcommand(mid, "sizeheader", "0");
 }
 
+/* Fetch the blocks of result sets after the first one in the binary
+ * protocol (Xexportbin) if the server supports it.  The values are
+ * converted to the same text the server would have sent, so this is
+ * transparent for mapi_fetch_field and friends, but the lines returned
+ * by mapi_fetch_line don't contain the values.  Decimal, time and
+ * timestamp columns also need the size header (mapi_set_size_header),
+ * otherwise the text protocol is used for their result sets. */
+MapiMsg
+mapi_set_binary_protocol(Mapi mid, bool value)
+{
+	if (!msettings_lang_is_sql(mid->settings)) {
+		mapi_setError(mid, "binary protocol only supported in SQL", __func__, MERROR);
+		return MERROR;
+	}
+	mid->binary_protocol = value;
+	if (!mid->connected || !value || mid->binary_compression == NULL || mid->binary_level < 2)
+		return MOK;
+	return mapi_Xcommand(mid, "binary_compression", mid->binary_compression);
+}
+
+/* Ask the server to compress the blocks of the binary protocol with
+ * method ("lz4" or "gz"), or not ("none" or NULL). */
+MapiMsg
+mapi_set_binary_compression(Mapi mid, const char *method)
+{
+	if (method != NULL && strcmp(method, "none") == 0)
+		method = NULL;
+	free(mid->binary_compression);
+	mid->binary_compression = NULL;
+	if (method != NULL && (mid->binary_compression = strdup(method)) == NULL)
+		return mapi_setError(mid, "Memory allocation failure", __func__, MERROR);
+	if (!mid->connected || !mid->binary_protocol || mid->binary_level < 2)
+		return MOK;
+	return mapi_Xcommand(mid, "binary_compression", method ? method : "none");
+}
+
 MapiMsg
 mapi_release_id(Mapi mid, int id)
 {
@@ -3881,6 +3927,633 @@ mapi_fetch_line_internal(MapiHdl hdl)
 	return reply;
 }
 
+/*
+ * The binary protocol.  Instead of the text of the rows, the server
+ * sends the columns of a block of rows in the format of COPY BINARY
+ * (Xexportbin), possibly compressed.  It is only used when all columns
+ * have a type for which we produce exactly the text the server would
+ * have sent, so the rest of the library can't tell the difference.
+ */
+enum binary_kind {
+	BIN_NONE = 0,		/* use the text protocol */
+	BIN_BOOL,
+	BIN_INT8,
+	BIN_INT16,
+	BIN_INT32,
+	BIN_INT64,
+#ifdef HAVE_HGE
+	BIN_INT128,
+#endif
+	BIN_FLOAT,
+	BIN_DOUBLE,
+	BIN_STR,
+	BIN_BLOB,
+	BIN_UUID,
+	BIN_DATE,
+	BIN_TIME,
+	BIN_TIMESTAMP,
+};
+
+struct binary_column {
+	enum binary_kind kind;
+	int scale;		/* of decimals, or the fraction digits of times */
+	const char *data;	/* next value */
+	const char *end;
+};
+
+/* storage type of decimals, as chosen by the server */
+static enum binary_kind
+binary_decimal_kind(int digits)
+{
+	if (digits <= 0)
+		return BIN_NONE;	/* no typesizes header */
+	if (digits <= 2)
+		return BIN_INT8;
+	if (digits <= 4)
+		return BIN_INT16;
+	if (digits <= 9)
+		return BIN_INT32;
+	if (digits <= 18)
+		return BIN_INT64;
+#ifdef HAVE_HGE
+	return BIN_INT128;
+#else
+	return BIN_NONE;
+#endif
+}
+
+static enum binary_kind
+binary_column_kind(const struct MapiColumn *f, int *scale)
+{
+	const char *t = f->columntype;
+
+	*scale = 0;
+	if (t == NULL)
+		return BIN_NONE;
+	if (strcmp(t, "boolean") == 0)
+		return BIN_BOOL;
+	if (strcmp(t, "tinyint") == 0)
+		return BIN_INT8;
+	if (strcmp(t, "smallint") == 0)
+		return BIN_INT16;
+	if (strcmp(t, "int") == 0 || strcmp(t, "month_interval") == 0)
+		return BIN_INT32;
+	if (strcmp(t, "bigint") == 0)
+		return BIN_INT64;
+#ifdef HAVE_HGE
+	if (strcmp(t, "hugeint") == 0)
+		return BIN_INT128;
+#endif
+	if (strcmp(t, "decimal") == 0) {
+		*scale = f->scale;
+		return binary_decimal_kind(f->digits);
+	}
+	if (strcmp(t, "sec_interval") == 0 || strcmp(t, "day_interval") == 0) {
+		/* milliseconds, shown as seconds */
+		*scale = 3;
+		return BIN_INT64;
+	}
+	if (strcmp(t, "real") == 0)
+		return BIN_FLOAT;
+	if (strcmp(t, "double") == 0)
+		return BIN_DOUBLE;
+	if (strcmp(t, "char") == 0 || strcmp(t, "varchar") == 0 ||
+	    strcmp(t, "clob") == 0 || strcmp(t, "json") == 0 ||
+	    strcmp(t, "url") == 0)
+		return BIN_STR;
+	if (strcmp(t, "blob") == 0)
+		return BIN_BLOB;
+	if (strcmp(t, "uuid") == 0)
+		return BIN_UUID;
+	if (strcmp(t, "date") == 0)
+		return BIN_DATE;
+	/* the number of fractional digits shown comes from the
+	 * typesizes header; the variants with time zone are converted to
+	 * the time zone of the session by the server, so they are left to
+	 * the text protocol */
+	if (f->digits <= 0)
+		return BIN_NONE;
+	*scale = f->digits - 1;
+	if (strcmp(t, "time") == 0)
+		return BIN_TIME;
+	if (strcmp(t, "timestamp") == 0)
+		return BIN_TIMESTAMP;
+	return BIN_NONE;
+}
+
+#ifdef HAVE_HGE
+typedef hge bin_int;
+typedef uhge bin_uint;
+#else
+typedef int64_t bin_int;
+typedef uint64_t bin_uint;
+#endif
+
+/* like the server's dec_tostr; buf must hold at least 48 bytes */
+static int
+binary_format_decimal(char *buf, bin_int v, int scale)
+{
+	char tmp[48];
+	int cur = (int) sizeof(tmp);
+	bin_uint u = v < 0 ? (bin_uint) 0 - (bin_uint) v : (bin_uint) v;
+
+	if (scale > 0) {
+		for (int i = 0; i < scale; i++) {
+			tmp[--cur] = (char) ('0' + u % 10);
+			u /= 10;
+		}
+		tmp[--cur] = '.';
+	}
+	if (u == 0)
+		tmp[--cur] = '0';
+	while (u != 0) {
+		tmp[--cur] = (char) ('0' + u % 10);
+		u /= 10;
+	}
+	if (v < 0)
+		tmp[--cur] = '-';
+	memcpy(buf, tmp + cur, sizeof(tmp) - cur);
+	buf[sizeof(tmp) - cur] = 0;
+	return (int) sizeof(tmp) - cur;
+}
+
+/* like the server's daytime_precision_tostr */
+static int
+binary_format_time(char *buf, size_t len, const copy_binary_time *t, int precision)
+{
+	int usec = (int) t->ms;
+
+	if (precision <= 0)
+		return snprintf(buf, len, "%02d:%02d:%02d", t->hours, t->minutes, t->seconds);
+	if (precision > 6)
+		precision = 6;
+	for (int i = 6; i > precision; i--)
+		usec /= 10;
+	return snprintf(buf, len, "%02d:%02d:%02d.%0*d", t->hours, t->minutes, t->seconds, precision, usec);
+}
+
+/* Like the server's fltToStr and dblToStr: the shortest %g with at
+ * least 4 digits that reads back as the same value.  If some number of
+ * digits reads back correctly, so does any larger number, so a binary
+ * search finds the same answer as the server's linear one. */
+static int
+binary_format_real(char *buf, size_t len, double v, bool isflt)
+{
+	int lo = 4, hi = isflt ? 9 : 17;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		snprintf(buf, len, "%.*g", mid, v);
+		if (isflt ? strtof(buf, NULL) == (float) v : strtod(buf, NULL) == v)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return snprintf(buf, len, "%.*g", lo, v);
+}
+
+/* Convert the next value of the column to the text the server would
+ * have sent; *valp is set to NULL for a NULL value.  Returns false if
+ * the data is malformed or memory runs out. */
+static bool
+binary_next_value(struct binary_column *col, char **valp, size_t *lenp)
+{
+	char buf[128];
+	int len = -1;		/* NULL */
+	const char *p = col->data;
+	size_t avail = (size_t) (col->end - p);
+
+#define BIN_FETCH(v)							\
+	do {								\
+		if (avail < sizeof(v))					\
+			return false;					\
+		memcpy(&(v), p, sizeof(v));				\
+		col->data += sizeof(v);					\
+	} while (0)
+
+	*valp = NULL;
+	*lenp = 0;
+	switch (col->kind) {
+	case BIN_BOOL: {
+		int8_t v;
+		BIN_FETCH(v);
+		if (v != INT8_MIN)
+			len = snprintf(buf, sizeof(buf), "%s", v ? "true" : "false");
+		break;
+	}
+	case BIN_INT8: {
+		int8_t v;
+		BIN_FETCH(v);
+		if (v != INT8_MIN)
+			len = binary_format_decimal(buf, v, col->scale);
+		break;
+	}
+	case BIN_INT16: {
+		int16_t v;
+		BIN_FETCH(v);
+		if (v != INT16_MIN)
+			len = binary_format_decimal(buf, v, col->scale);
+		break;
+	}
+	case BIN_INT32: {
+		int32_t v;
+		BIN_FETCH(v);
+		if (v != INT32_MIN)
+			len = binary_format_decimal(buf, v, col->scale);
+		break;
+	}
+	case BIN_INT64: {
+		int64_t v;
+		BIN_FETCH(v);
+		if (v != INT64_MIN)
+			len = binary_format_decimal(buf, v, col->scale);
+		break;
+	}
+#ifdef HAVE_HGE
+	case BIN_INT128: {
+		hge v;
+		BIN_FETCH(v);
+		if (v != (hge) ((uhge) 1 << 127))
+			len = binary_format_decimal(buf, v, col->scale);
+		break;
+	}
+#endif
+	case BIN_FLOAT: {
+		float v;
+		BIN_FETCH(v);
+		if (!isnan(v))
+			len = binary_format_real(buf, sizeof(buf), v, true);
+		break;
+	}
+	case BIN_DOUBLE: {
+		double v;
+		BIN_FETCH(v);
+		if (!isnan(v))
+			len = binary_format_real(buf, sizeof(buf), v, false);
+		break;
+	}
+	case BIN_STR: {
+		const char *e = memchr(p, 0, avail);
+		if (e == NULL)
+			return false;
+		col->data = e + 1;
+		if (strcmp(p, "\200") == 0)
+			return true;
+		*lenp = (size_t) (e - p);
+		return (*valp = strdup(p)) != NULL;
+	}
+	case BIN_BLOB: {
+		static const char hexit[] = "0123456789ABCDEF";
+		uint64_t n;
+		BIN_FETCH(n);
+		if (n == ~(uint64_t) 0)
+			return true;
+		p += sizeof(n);
+		if (avail - sizeof(n) < n)
+			return false;
+		col->data += n;
+		char *v = malloc(2 * n + 1);
+		if (v == NULL)
+			return false;
+		for (uint64_t i = 0; i < n; i++) {
+			v[2 * i] = hexit[(unsigned char) p[i] >> 4];
+			v[2 * i + 1] = hexit[(unsigned char) p[i] & 0xF];
+		}
+		v[2 * n] = 0;
+		*valp = v;
+		*lenp = 2 * n;
+		return true;
+	}
+	case BIN_UUID: {
+		unsigned char u[16];
+		static const unsigned char nil[16];
+		BIN_FETCH(u);
+		if (memcmp(u, nil, sizeof(u)) != 0)
+			len = snprintf(buf, sizeof(buf),
+				       "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+				       u[0], u[1], u[2], u[3], u[4], u[5], u[6], u[7],
+				       u[8], u[9], u[10], u[11], u[12], u[13], u[14], u[15]);
+		break;
+	}
+	case BIN_DATE: {
+		copy_binary_date d;
+		BIN_FETCH(d);
+		if (d.day != 0xFF)
+			len = snprintf(buf, sizeof(buf), "%d-%02d-%02d", d.year, d.month, d.day);
+		break;
+	}
+	case BIN_TIME: {
+		copy_binary_time t;
+		BIN_FETCH(t);
+		if (t.ms != 0xFFFFFFFF)
+			len = binary_format_time(buf, sizeof(buf), &t, col->scale);
+		break;
+	}
+	case BIN_TIMESTAMP: {
+		copy_binary_timestamp ts;
+		BIN_FETCH(ts);
+		if (ts.date.day != 0xFF) {
+			len = snprintf(buf, sizeof(buf), "%d-%02d-%02d ", ts.date.year, ts.date.month, ts.date.day);
+			len += binary_format_time(buf + len, sizeof(buf) - len, &ts.time, col->scale);
+		}
+		break;
+	}
+	default:
+		return false;
+	}
+#undef BIN_FETCH
+	if (len < 0)
+		return true;
+	*lenp = (size_t) len;
+	return (*valp = strdup(buf)) != NULL;
+}
+
+/* Whether the remaining rows of the result set can be fetched in
+ * binary.  If so, the kinds of the columns are filled in. */
+static bool
+binary_fetch_possible(MapiHdl hdl, struct MapiResultSet *result, struct binary_column *cols)
+{
+	Mapi mid = hdl->mid;
+
+	if (!mid->binary_protocol || mid->binary_level < 1 ||
+	    mnstr_get_swapbytes(mid->from) ||
+	    result->fieldcnt <= 0 || result->fields == NULL)
+		return false;
+	for (int i = 0; i < result->fieldcnt; i++) {
+		cols[i] = (struct binary_column) {0};
+		cols[i].kind = binary_column_kind(&result->fields[i], &cols[i].scale);
+		if (cols[i].kind == BIN_NONE)
+			return false;
+	}
+	return true;
+}
+
+/* Read the rest of the current server message into a buffer. */
+static char *
+read_message(Mapi mid, size_t *lenp)
+{
+	size_t size = BLOCK, len = 0;
+	char *buf = malloc(size);
+
+	if (buf == NULL) {
+		mapi_setError(mid, "Memory allocation failure", __func__, MERROR);
+		return NULL;
+	}
+	/* whatever is left in the line buffer comes first */
+	if (mid->blk.end > mid->blk.nxt) {
+		size_t n = (size_t) (mid->blk.end - mid->blk.nxt);
+		if (n > BLOCK) {
+			char *nbuf = realloc(buf, size = n + BLOCK);
+			if (nbuf == NULL) {
+				free(buf);
+				mapi_setError(mid, "Memory allocation failure", __func__, MERROR);
+				return NULL;
+			}
+			buf = nbuf;
+		}
+		memcpy(buf + len, mid->blk.buf + mid->blk.nxt, n);
+		len += n;
+	}
+	mid->blk.nxt = mid->blk.end = 0;
+	mid->blk.buf[0] = 0;
+	for (;;) {
+		if (size - len < BLOCK) {
+			char *nbuf = realloc(buf, size *= 2);
+			if (nbuf == NULL) {
+				free(buf);
+				mapi_setError(mid, "Memory allocation failure", __func__, MERROR);
+				return NULL;
+			}
+			buf = nbuf;
+		}
+		ssize_t n = mnstr_read(mid->from, buf + len, 1, size - len);
+		if (n < 0 || (n == 0 && mnstr_eof(mid->from))) {
+			free(buf);
+			check_stream(mid, mid->from, -1, "Connection terminated during read", NULL);
+		}
+		mapi_log_data(mid, "RECV", buf + len, n);
+		if (n == 0)
+			break;
+		len += (size_t) n;
+	}
+	*lenp = len;
+	return buf;
+}
+
+/* Decompress the payload of a compressed block, returning a buffer
+ * with the header line, followed by the payload. */
+static char *
+binary_decompress(Mapi mid, const char *method, char *msg, size_t hdrlen, size_t *lenp)
+{
+	buffer in;
+	stream *inner, *s;
+	size_t size = 2 * *lenp + BLOCK, len = hdrlen;
+	char *buf = malloc(size);
+
+	if (buf == NULL) {
+		mapi_setError(mid, "Memory allocation failure", __func__, MERROR);
+		return NULL;
+	}
+	memcpy(buf, msg, hdrlen);
+	buffer_init(&in, msg + hdrlen, *lenp - hdrlen);
+	if ((inner = buffer_rastream(&in, "exportbin")) == NULL) {
+		free(buf);
+		mapi_setError(mid, "Memory allocation failure", __func__, MERROR);
+		return NULL;
+	}
+	if (strcmp(method, "lz4") == 0)
+		s = lz4_stream(inner, 0);
+	else if (strcmp(method, "gz") == 0)
+		s = gz_stream(inner, 0);
+	else
+		s = NULL;
+	if (s == NULL) {
+		mnstr_destroy(inner);
+		free(buf);
+		mapi_printError(mid, __func__, MERROR, "cannot decompress %s result block", method);
+		return NULL;
+	}
+	for (;;) {
+		if (size - len < BLOCK) {
+			char *nbuf = realloc(buf, size *= 2);
+			if (nbuf == NULL) {
+				mnstr_destroy(s);
+				free(buf);
+				mapi_setError(mid, "Memory allocation failure", __func__, MERROR);
+				return NULL;
+			}
+			buf = nbuf;
+		}
+		ssize_t n = mnstr_read(s, buf + len, 1, size - len);
+		if (n < 0) {
+			mapi_printError(mid, __func__, MERROR, "cannot decompress %s result block: %s", method, mnstr_peek_error(s));
+			mnstr_destroy(s);
+			free(buf);
+			return NULL;
+		}
+		if (n == 0)
+			break;
+		len += (size_t) n;
+	}
+	mnstr_destroy(s);
+	*lenp = len;
+	return buf;
+}
+
+/* Read the reply to an Xexportbin command and add its rows to the
+ * cache as if they were received as text. */
+static MapiMsg
+read_binary_into_cache(MapiHdl hdl, struct MapiResultSet *result, struct binary_column *cols, bool cacheall)
+{
+	Mapi mid = hdl->mid;
+	size_t len;
+	char *msg = read_message(mid, &len);
+	char header[128], method[8] = "", *nl;
+	int id, ncols, hdrlen;
+	int64_t nrows, offset, toc;
+
+	if (msg == NULL)
+		return mid->error;
+	if (len == 0) {
+		/* the result set is gone */
+		free(msg);
+		mid->active = NULL;
+		hdl->active = NULL;
+		return mapi_setError(mid, "Result set not available", __func__, MERROR);
+	}
+	if (msg[0] != '&') {
+		/* not a block (an error): hand it to the text protocol code,
+		 * with the prompt that ends the message */
+		if ((int) len + 3 > mid->blk.lim) {
+			char *nbuf = realloc(mid->blk.buf, len + 4);
+			if (nbuf == NULL) {
+				free(msg);
+				return mapi_setError(mid, "Memory allocation failure", __func__, MERROR);
+			}
+			mid->blk.buf = nbuf;
+			mid->blk.lim = (int) len + 3;
+		}
+		memcpy(mid->blk.buf, msg, len);
+		free(msg);
+		mid->blk.buf[len] = '\n';
+		mid->blk.buf[len + 1] = PROMPTBEG;
+		mid->blk.buf[len + 2] = '\n';
+		mid->blk.buf[len + 3] = 0;
+		mid->blk.nxt = 0;
+		mid->blk.end = (int) len + 3;
+		return read_into_cache(hdl, 0);
+	}
+	mid->active = NULL;
+	hdl->active = NULL;
+	if ((nl = memchr(msg, '\n', len)) == NULL ||
+	    (hdrlen = (int) (nl - msg) + 1) >= (int) sizeof(header)) {
+		free(msg);
+		return mapi_setError(mid, "Malformed binary result block", __func__, MERROR);
+	}
+	memcpy(header, msg, hdrlen - 1);
+	header[hdrlen - 1] = 0;
+	switch (sscanf(header, "&6 %d %d %" SCNd64 " %" SCNd64 " %7s", &id, &ncols, &nrows, &offset, method)) {
+	case 5: {
+		/* compressed payload */
+		char *plain = binary_decompress(mid, method, msg, (size_t) hdrlen, &len);
+		free(msg);
+		if ((msg = plain) == NULL)
+			return mid->error;
+		break;
+	}
+	case 4:
+		break;
+	default:
+		free(msg);
+		return mapi_setError(mid, "Malformed binary result block", __func__, MERROR);
+	}
+	if (id != result->tableid || ncols != result->fieldcnt || nrows < 0 ||
+	    offset != result->cache.first + result->cache.tuplecount ||
+	    len < (size_t) hdrlen + sizeof(toc)) {
+		free(msg);
+		return mapi_setError(mid, "Unexpected binary result block", __func__, MERROR);
+	}
+	/* the table of contents: offsets and lengths of the columns */
+	memcpy(&toc, msg + len - sizeof(toc), sizeof(toc));
+	if (toc < hdrlen || (uint64_t) toc + 16 * (uint64_t) ncols + sizeof(toc) != len) {
+		free(msg);
+		return mapi_setError(mid, "Malformed binary result block", __func__, MERROR);
+	}
+	for (int i = 0; i < ncols; i++) {
+		int64_t start, length;
+		memcpy(&start, msg + toc + 16 * i, sizeof(start));
+		memcpy(&length, msg + toc + 16 * i + 8, sizeof(length));
+		if (start < hdrlen || length < 0 || start + length > toc) {
+			free(msg);
+			return mapi_setError(mid, "Malformed binary result block", __func__, MERROR);
+		}
+		cols[i].data = msg + start;
+		cols[i].end = msg + start + length;
+	}
+
+	for (int64_t r = 0; r < nrows; r++) {
+		char *line = strdup("[");
+		char **anchors = malloc(ncols * sizeof(*anchors));
+		size_t *lens = malloc(ncols * sizeof(*lens));
+		int i = 0;
+
+		if (line != NULL && anchors != NULL && lens != NULL) {
+			for (i = 0; i < ncols; i++) {
+				if (!binary_next_value(&cols[i], &anchors[i], &lens[i]))
+					break;
+			}
+		}
+		if (i < ncols || line == NULL) {
+			while (i > 0)
+				free(anchors[--i]);
+			free(anchors);
+			free(lens);
+			free(line);
+			free(msg);
+			return mapi_setError(mid, "Malformed binary result block", __func__, MERROR);
+		}
+		add_cache(result, line, cacheall);
+		result->cache.line[result->cache.writer - 1].anchors = anchors;
+		result->cache.line[result->cache.writer - 1].lens = lens;
+		result->cache.line[result->cache.writer - 1].fldcnt = ncols;
+	}
+	free(msg);
+	return MOK;
+}
+
+/* Ask for the next block of rows of the result set in binary if
+ * possible.  Returns 0 if the text protocol is to be used instead, 1
+ * if the rows were added to the cache, and -1 on error. */
+static int
+fetch_binary_block(MapiHdl hdl, struct MapiResultSet *result, bool cacheall)
+{
+	Mapi mid = hdl->mid;
+	struct binary_column *cols;
+	long replysize = msetting_long(mid->settings, MP_REPLYSIZE);
+	int64_t offset = result->cache.first + result->cache.tuplecount;
+	int e;
+
+	if ((cols = malloc(result->fieldcnt * sizeof(*cols))) == NULL)
+		return 0;
+	if (!binary_fetch_possible(hdl, result, cols)) {
+		free(cols);
+		return 0;
+	}
+	if (replysize <= 0 || replysize > INT_MAX)
+		replysize = -1;
+	mapi_log_record(mid, "SEND", "X" "exportbin %d %" PRId64 " %ld\n",
+			result->tableid, offset, replysize);
+	if ((e = mnstr_printf(mid->to, "X" "exportbin %d %" PRId64 " %ld\n",
+			      result->tableid, offset, replysize)) < 0 ||
+	    (e = mnstr_flush(mid->to, MNSTR_FLUSH_DATA)) < 0) {
+		free(cols);
+		check_stream(mid, mid->to, e, "sending export command", -1);
+	}
+	e = read_binary_into_cache(hdl, result, cols, cacheall) == MOK ? 1 : -1;
+	free(cols);
+	return e;
+}
+
 /*
  * The routine mapi_fetch_line forms the basic interaction with the server.
  * It simply retrieves the next line and stores it in the row cache.
@@ -3908,6 +4581,12 @@ mapi_fetch_line(MapiHdl hdl)
 			read_into_cache(hdl->mid->active, 0);
 		hdl->mid->active = hdl;
 		hdl->active = result;
+		switch (fetch_binary_block(hdl, result, false)) {
+		case 1:
+			return mapi_fetch_line_internal(hdl);
+		case -1:
+			return NULL;
+		}
 		mapi_log_record(hdl->mid, "W", "X" "export %d %" PRId64 "\n",
 				     result->tableid,
 				     result->cache.first + result->cache.tuplecount);
@@ -4432,6 +5111,11 @@ mapi_fetch_all_rows(MapiHdl hdl)
 		    result->cache.first + result->cache.tuplecount < result->row_count) {
 			mid->active = hdl;
 			hdl->active = result;
+			int r = fetch_binary_block(hdl, result, true);
+			if (r < 0)
+				break;
+			if (r > 0)
+				continue;
 			mapi_log_record(mid, "SEND", "X" "export %d %" PRId64 "\n",
 					     result->tableid, result->cache.first + result->cache.tuplecount);
 			int e;
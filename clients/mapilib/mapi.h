@@ -134,6 +134,8 @@ mapi_export bool mapi_get_autocommit(Mapi mid)
 	__attribute__((__nonnull__(1)));
 mapi_export bool mapi_get_columnar_protocol(Mapi mid)
 	__attribute__((__nonnull__(1)));
+mapi_export bool mapi_get_binary_protocol(Mapi mid)
+	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_log(Mapi mid, const char *nme)
 	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_set_time_zone(Mapi mid, int seconds_east_of_utc)
@@ -144,6 +146,10 @@ mapi_export MapiMsg mapi_set_columnar_protocol(Mapi mid, bool columnar_protocol)
 	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_set_size_header(Mapi mid, bool value)
 	__attribute__((__nonnull__(1)));
+mapi_export MapiMsg mapi_set_binary_protocol(Mapi mid, bool value)
+	__attribute__((__nonnull__(1)));
+mapi_export MapiMsg mapi_set_binary_compression(Mapi mid, const char *method)
+	__attribute__((__nonnull__(1)));
 mapi_export MapiMsg mapi_release_id(Mapi mid, int id)
 	__attribute__((__nonnull__(1)));
 mapi_export const char *mapi_result_error(MapiHdl hdl);
@@ -248,6 +248,9 @@ struct MapiStruct {
 	bool sizeheader;
 	bool oobintr;
 	bool clientinfo_supported;
+	int binary_level;	/* level of the binary protocol the server supports */
+	bool binary_protocol;	/* fetch further blocks of result sets in binary */
+	char *binary_compression;	/* compression of the binary blocks, if any */
 	MapiHdl first;		/* start of doubly-linked list */
 	MapiHdl active;		/* set when not all rows have been received */
 
@@ -456,6 +456,8 @@ MNDBConnectSettings(ODBCDbc *dbc, const char *dsn, msettings *settings)
 		settings = NULL; // will be free'd as part of 'mid' now
 		mapi_setclientprefix(mid, "ODBC " MONETDB_VERSION);
 		mapi_set_size_header(mid, true);
+		/* fetch the blocks after the first one in binary, if allowed */
+		mapi_set_binary_protocol(mid, msettings_connect_binary(clone) > 0);
 		mapi_reconnect(mid);
 	}
 	if (mid == NULL || mapi_error(mid)) {
@@ -57,6 +57,7 @@ function(monetdb_configure_defines)
   check_symbol_exists("getaddrinfo" "ws2tcpip.h" WIN_GETADDRINFO)
   #check_symbol_exists("WSADATA" "winsock2.h" HAVE_WINSOCK_H)
   check_symbol_exists("fdatasync" "unistd.h" HAVE_FDATASYNC)
+  check_symbol_exists("syncfs" "unistd.h" HAVE_SYNCFS)
   # Some libc versions on Linux distributions don't have it
   check_symbol_exists("accept4"
     "sys/types.h;sys/socket.h" HAVE_ACCEPT4)
@@ -112,6 +113,7 @@ function(monetdb_configure_defines)
     set(CMAKE_REQUIRED_LIBRARIES "${CMAKE_THREAD_LIBS_INIT}")
     check_function_exists("pthread_kill" HAVE_PTHREAD_KILL)
     check_function_exists("pthread_mutex_timedlock" HAVE_PTHREAD_MUTEX_TIMEDLOCK)
+    check_function_exists("pthread_setaffinity_np" HAVE_PTHREAD_SETAFFINITY_NP)
     check_function_exists("pthread_setname_np" HAVE_PTHREAD_SETNAME_NP)
     check_function_exists("pthread_sigmask" HAVE_PTHREAD_SIGMASK)
   cmake_pop_check_state()
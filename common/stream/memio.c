@@ -195,8 +195,8 @@ buffer_rastream(buffer *restrict b, const char *restrict name)
 	return s;
 }
 
-stream *
-buffer_wastream(buffer *restrict b, const char *restrict name)
+static stream *
+buffer_wstream_internal(buffer *restrict b, const char *restrict name, bool binary)
 {
 	stream *s;
 
@@ -205,12 +205,12 @@ buffer_wastream(buffer *restrict b, const char *restrict name)
 		return NULL;
 	}
 #ifdef STREAM_DEBUG
-	fprintf(stderr, "buffer_wastream %s\n", name);
+	fprintf(stderr, "buffer_w%sstream %s\n", binary ? "" : "a", name);
 #endif
 	if ((s = create_stream(name)) == NULL)
 		return NULL;
 	s->readonly = false;
-	s->binary = false;
+	s->binary = binary;
 	s->read = buffer_read;
 	s->write = buffer_write;
 	s->close = buffer_close;
@@ -226,3 +226,16 @@ buffer_wastream(buffer *restrict b, const char *restrict name)
 	s->stream_data.p = (void *) b;
 	return s;
 }
+
+stream *
+buffer_wastream(buffer *restrict b, const char *restrict name)
+{
+	return buffer_wstream_internal(b, name, false);
+}
+
+/* binary variant, e.g. as the inner stream of a compressor */
+stream *
+buffer_wstream(buffer *restrict b, const char *restrict name)
+{
+	return buffer_wstream_internal(b, name, true);
+}
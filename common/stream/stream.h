@@ -204,6 +204,7 @@ stream_export void buffer_destroy(buffer *b);
 
 stream_export stream *buffer_rastream(buffer *restrict b, const char *restrict name); // used in many places
 stream_export stream *buffer_wastream(buffer *restrict b, const char *restrict name); // sql_gencode.c
+stream_export stream *buffer_wstream(buffer *restrict b, const char *restrict name); // sql_result.c/mapi binary export
 stream_export buffer *mnstr_get_buffer(stream *s);
 
 /* note, the size is fixed to 8K, you cannot simply change it to any
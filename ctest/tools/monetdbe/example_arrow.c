@@ -0,0 +1,85 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+#include "monetdbe.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define error(msg) {fprintf(stderr, "Failure: %s\n", msg); return -1;}
+
+static int
+is_valid(const struct ArrowArray *a, int64_t i)
+{
+	const uint8_t *v = a->buffers[0];
+	return v == NULL || (v[i >> 3] >> (i & 7)) & 1;
+}
+
+int
+main(void)
+{
+	char* err = NULL;
+	monetdbe_database mdbe = NULL;
+	monetdbe_result* result = NULL;
+	struct ArrowSchema schema;
+	struct ArrowArray array;
+
+	// second argument is a string for the db directory or NULL for in-memory mode
+	if (monetdbe_open(&mdbe, NULL, NULL ))
+		error("Failed to open database")
+	if ((err = monetdbe_query(mdbe, "CREATE TABLE test (i int, s string, d decimal(5,2), dt date)", NULL, NULL)) != NULL)
+		error(err)
+	if ((err = monetdbe_query(mdbe, "INSERT INTO test VALUES (1, 'one', 1.25, '1970-01-11'), (NULL, NULL, -2.5, NULL), (3, 'three', NULL, '1969-12-31')", NULL, NULL)) != NULL)
+		error(err)
+	if ((err = monetdbe_query(mdbe, "SELECT i, s, d, dt FROM test; ", &result, NULL)) != NULL)
+		error(err)
+	if ((err = monetdbe_result_fetch_arrow(result, &schema, &array)) != NULL)
+		error(err)
+
+	if (strcmp(schema.format, "+s") != 0 || schema.n_children != 4 || array.length != 3 || array.n_children != 4)
+		error("Wrong struct array")
+	if (strcmp(schema.children[0]->format, "i") != 0 || strcmp(schema.children[1]->format, "u") != 0 ||
+		strcmp(schema.children[2]->format, "d:5,2") != 0 || strcmp(schema.children[3]->format, "tdD") != 0)
+		error("Wrong column formats")
+	if (strcmp(schema.children[1]->name, "s") != 0)
+		error("Wrong column name")
+
+	const struct ArrowArray *i = array.children[0], *s = array.children[1], *d = array.children[2], *dt = array.children[3];
+	const int32_t *ivals = i->buffers[1], *soffs = s->buffers[1], *dtvals = dt->buffers[1];
+	const char *sdata = s->buffers[2];
+	const int64_t *dvals = d->buffers[1];
+
+	if (i->null_count != 1 || is_valid(i, 1) || ivals[0] != 1 || ivals[2] != 3)
+		error("Wrong int column")
+	if (s->null_count != 1 || is_valid(s, 1) || soffs[1] - soffs[0] != 3 ||
+		strncmp(sdata + soffs[2], "three", soffs[3] - soffs[2]) != 0)
+		error("Wrong string column")
+	/* little endian 128 bit decimals */
+	if (d->null_count != 1 || is_valid(d, 2) || dvals[0] != 125 || dvals[2] != -250 || dvals[3] != -1)
+		error("Wrong decimal column")
+	if (dt->null_count != 1 || dtvals[0] != 10 || dtvals[2] != -1)
+		error("Wrong date column")
+
+	/* the arrays stay valid after the result is gone */
+	if ((err = monetdbe_cleanup_result(mdbe, result)) != NULL)
+		error(err)
+	if (ivals[2] != 3)
+		error("Wrong int column after cleanup")
+	array.release(&array);
+	schema.release(&schema);
+	if (array.release || schema.release)
+		error("Arrays not released")
+	if (monetdbe_close(mdbe))
+		error("Failed to close database")
+	return 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+/* Export a table with NULLs, strings and decimals of every width as
+ * Arrow arrays, check the schema, load the rows back from nothing but
+ * the Arrow buffers and let the database compare both tables. */
+
+#include "monetdb_config.h"
+#include "monetdbe.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define error(msg) {fprintf(stderr, "Failure: %s\n", msg); return -1;}
+
+#define NROWS 301
+#define STR(x) #x
+#define XSTR(x) STR(x)
+
+#ifdef HAVE_HGE
+#define HGE_COL ", h decimal(38,5)"
+#define HGE_VAL ", case when value % 17 = 0 then null else (value - 150) * 123456789012345678901234567.891 end"
+#define NCOLS 8
+typedef __int128 dec_t;
+#else
+#define HGE_COL
+#define HGE_VAL
+#define NCOLS 7
+typedef int64_t dec_t;
+#endif
+
+static const char *create =
+	"CREATE TABLE src (i int, s varchar(40), e string, d1 decimal(2,1), d2 decimal(4,1),"
+	" d4 decimal(9,2), d8 decimal(18,3)" HGE_COL ")";
+
+/* every column has NULLs, at different rows, and negative decimals */
+static const char *insert =
+	"INSERT INTO src SELECT"
+	" case when value % 7 = 0 then null else value - 150 end,"
+	" case when value % 5 = 0 then null"
+	"      when value % 5 = 1 then ''"
+	"      when value % 5 = 2 then 'it''s ' || value || ''''"
+	"      when value % 5 = 3 then '\xc3\xa9t\xc3\xa9 \xe2\x82\xac' || value"
+	"      else repeat('x', value % 40) end,"
+	" case when value % 2 = 0 then null else 'odd' end,"
+	" case when value % 3 = 0 then null else (value % 199 - 99) / 10.0 end,"
+	" case when value % 4 = 0 then null else (value - 150) * 6.6 end,"
+	" case when value % 6 = 0 then null else (value - 150) * 65432.1 end,"
+	" case when value % 11 = 0 then null else (value - 150) * 4567890123456.789 end"
+	HGE_VAL
+	" FROM nums WHERE value < " XSTR(NROWS);
+
+static const char *formats[NCOLS] = {
+	"i", "u", "u", "d:2,1", "d:4,1", "d:9,2", "d:18,3",
+#ifdef HAVE_HGE
+	"d:38,5",
+#endif
+};
+static const char *names[NCOLS] = {
+	"i", "s", "e", "d1", "d2", "d4", "d8",
+#ifdef HAVE_HGE
+	"h",
+#endif
+};
+static const int64_t nulls[NCOLS] = {
+	(NROWS + 6) / 7, (NROWS + 4) / 5, (NROWS + 1) / 2, (NROWS + 2) / 3, (NROWS + 3) / 4,
+	(NROWS + 5) / 6, (NROWS + 10) / 11,
+#ifdef HAVE_HGE
+	(NROWS + 16) / 17,
+#endif
+};
+
+static int
+is_valid(const struct ArrowArray *a, int64_t i)
+{
+	const uint8_t *v = a->buffers[0];
+	return v == NULL || (v[i >> 3] >> (i & 7)) & 1;
+}
+
+static char *
+append(char *buf, size_t *len, size_t *size, const char *s, size_t n)
+{
+	if (*len + n + 1 > *size) {
+		char *nbuf;
+		*size = (*len + n + 1) * 2;
+		if ((nbuf = realloc(buf, *size)) == NULL) {
+			free(buf);
+			return NULL;
+		}
+		buf = nbuf;
+	}
+	memcpy(buf + *len, s, n);
+	*len += n;
+	buf[*len] = 0;
+	return buf;
+}
+
+/* the SQL literal of an unscaled decimal128 */
+static int
+decimal_literal(char *out, const int64_t *w, int scale)
+{
+	/* little endian words, the high one carries the sign */
+	uint64_t lo = (uint64_t) w[0];
+	int64_t hi = w[1];
+	dec_t v;
+	char digits[48];
+	int n = 0, neg;
+
+#ifdef HAVE_HGE
+	v = (dec_t) ((unsigned __int128) (uint64_t) hi << 64 | lo);
+#else
+	if (hi != ((int64_t) lo < 0 ? -1 : 0))
+		return -1;
+	v = (dec_t) lo;
+#endif
+	neg = v < 0;
+	do {
+		int d = (int) (v % 10);
+		digits[n++] = (char) ('0' + (d < 0 ? -d : d));
+		v /= 10;
+	} while (v != 0 || n <= scale);
+	if (neg)
+		*out++ = '-';
+	while (n > 0) {
+		if (n == scale)
+			*out++ = '.';
+		*out++ = digits[--n];
+	}
+	*out = 0;
+	return 0;
+}
+
+/* one row of the Arrow arrays as a VALUES tuple */
+static char *
+append_row(char *buf, size_t *len, size_t *size, const struct ArrowSchema *schema, const struct ArrowArray *array, int64_t r)
+{
+	buf = append(buf, len, size, r ? ",(" : "(", r ? 2 : 1);
+	for (int64_t c = 0; buf && c < array->n_children; c++) {
+		const struct ArrowArray *a = array->children[c];
+		const char *f = schema->children[c]->format;
+		char val[64];
+
+		if (c > 0 && (buf = append(buf, len, size, ",", 1)) == NULL)
+			break;
+		if (!is_valid(a, r)) {
+			buf = append(buf, len, size, "NULL", 4);
+		} else if (strcmp(f, "i") == 0) {
+			snprintf(val, sizeof(val), "%" PRId32, ((const int32_t *) a->buffers[1])[r]);
+			buf = append(buf, len, size, val, strlen(val));
+		} else if (strcmp(f, "u") == 0) {
+			const int32_t *offs = a->buffers[1];
+			const char *s = (const char *) a->buffers[2] + offs[r];
+
+			buf = append(buf, len, size, "'", 1);
+			for (int32_t i = 0; buf && i < offs[r + 1] - offs[r]; i++)
+				buf = s[i] == '\'' ? append(buf, len, size, "''", 2) : append(buf, len, size, s + i, 1);
+			if (buf)
+				buf = append(buf, len, size, "'", 1);
+		} else if (strncmp(f, "d:", 2) == 0) {
+			if (decimal_literal(val, (const int64_t *) a->buffers[1] + 2 * r, atoi(strchr(f, ',') + 1)) < 0) {
+				free(buf);
+				return NULL;
+			}
+			buf = append(buf, len, size, val, strlen(val));
+		} else {
+			free(buf);
+			return NULL;
+		}
+	}
+	return buf ? append(buf, len, size, ")", 1) : NULL;
+}
+
+int
+main(void)
+{
+	char* err = NULL;
+	monetdbe_database mdbe = NULL;
+	monetdbe_result* result = NULL;
+	monetdbe_column* rcol;
+	struct ArrowSchema schema;
+	struct ArrowArray array;
+	char *sql = NULL;
+	size_t len = 0, size = 0;
+
+	// second argument is a string for the db directory or NULL for in-memory mode
+	if (monetdbe_open(&mdbe, NULL, NULL ))
+		error("Failed to open database")
+	if ((err = monetdbe_query(mdbe, (char *) create, NULL, NULL)) != NULL)
+		error(err)
+	/* the numbers 0..511, by doubling the table */
+	if ((err = monetdbe_query(mdbe, "CREATE TABLE nums AS SELECT CAST(0 AS int) AS value WITH DATA", NULL, NULL)) != NULL)
+		error(err)
+	for (int i = 0; i < 9; i++)
+		if ((err = monetdbe_query(mdbe, "INSERT INTO nums SELECT value + (SELECT count(*) FROM nums) FROM nums", NULL, NULL)) != NULL)
+			error(err)
+	if ((err = monetdbe_query(mdbe, (char *) insert, NULL, NULL)) != NULL)
+		error(err)
+	if ((err = monetdbe_query(mdbe, "SELECT * FROM src; ", &result, NULL)) != NULL)
+		error(err)
+	if ((err = monetdbe_result_fetch_arrow(result, &schema, &array)) != NULL)
+		error(err)
+	if ((err = monetdbe_cleanup_result(mdbe, result)) != NULL)
+		error(err)
+
+	/* the schema */
+	if (strcmp(schema.format, "+s") != 0 || schema.n_children != NCOLS ||
+		array.length != NROWS || array.n_children != NCOLS || array.null_count != 0)
+		error("Wrong struct array")
+	for (int c = 0; c < NCOLS; c++) {
+		const struct ArrowSchema *cs = schema.children[c];
+		const struct ArrowArray *ca = array.children[c];
+
+		if (strcmp(cs->format, formats[c]) != 0 || strcmp(cs->name, names[c]) != 0 ||
+			!(cs->flags & ARROW_FLAG_NULLABLE) || cs->n_children != 0)
+			error("Wrong column schema")
+		if (ca->length != NROWS || ca->null_count != nulls[c] ||
+			ca->n_buffers != (cs->format[0] == 'u' ? 3 : 2) || ca->buffers[0] == NULL)
+			error("Wrong column array")
+	}
+
+	/* the data, read back from the Arrow buffers only */
+	if ((err = monetdbe_query(mdbe, "CREATE TABLE dst AS SELECT * FROM src WITH NO DATA", NULL, NULL)) != NULL)
+		error(err)
+	sql = append(sql, &len, &size, "INSERT INTO dst VALUES ", 23);
+	for (int64_t r = 0; sql && r < array.length; r++)
+		sql = append_row(sql, &len, &size, &schema, &array, r);
+	if (sql == NULL)
+		error("Cannot read the Arrow arrays")
+	array.release(&array);
+	schema.release(&schema);
+	if (array.release || schema.release)
+		error("Arrays not released")
+	if ((err = monetdbe_query(mdbe, sql, NULL, NULL)) != NULL)
+		error(err)
+	free(sql);
+
+	if ((err = monetdbe_query(mdbe,
+			"SELECT CAST((SELECT count(*) FROM (SELECT * FROM src EXCEPT ALL SELECT * FROM dst) AS x)"
+			" + (SELECT count(*) FROM (SELECT * FROM dst EXCEPT ALL SELECT * FROM src) AS y)"
+			" + (SELECT abs(count(*) - " XSTR(NROWS) ") FROM dst) AS BIGINT); ", &result, NULL)) != NULL)
+		error(err)
+	if ((err = monetdbe_result_fetch(result, &rcol, 0)) != NULL)
+		error(err)
+	if (((monetdbe_column_int64_t *) rcol)->data[0] != 0)
+		error("Rows differ after the round trip")
+	if ((err = monetdbe_cleanup_result(mdbe, result)) != NULL)
+		error(err)
+	if (monetdbe_close(mdbe))
+		error("Failed to close database")
+	return 0;
+}
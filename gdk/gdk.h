@@ -1908,6 +1908,7 @@ gdk_export gdk_return BATrtree(BAT *wkb, BAT* mbr);
 /* inMBR is really a struct mbr * from geom module, but that is not
  * available here */
 gdk_export BUN* RTREEsearch(BAT *b, const void *inMBR, int result_limit);
+gdk_export BUN* RTREEknn(BAT *b, const void *inMBR, int k, dbl (*dist)(void *ctx, BUN p), void *ctx);
 #endif
 
 gdk_export void RTREEdestroy(BAT *b);
@@ -3991,6 +3991,136 @@ BBPcheckBBPdir(void)
 	}
 }
 
+/* BBPsync handles the bats in chunks of SYNC_CHUNK: first the old
+ * heaps of all bats in the chunk are backed up, then the new heaps
+ * are written (by several threads at the same time), and finally the
+ * entries for BBP.dir are written in order.  Since the heaps of
+ * different bats are independent files, writing and syncing them in
+ * parallel shortens a checkpoint considerably.  Where syncfs is
+ * available, the heaps are not synced one by one, instead the whole
+ * file system is synced once after all heaps have been written. */
+#define SYNC_CHUNK	1024
+
+struct syncbat {
+	bat bid;
+	BUN size;
+	BAT *b;
+	BATiter bi;
+	bool persistent;	/* bi is valid */
+	bool save;		/* BBPSAVING was set, needs saving */
+};
+
+struct syncsaver {
+	struct syncbat *sbs;
+	int nsb;
+	bool dosync;		/* sync each heap after writing it */
+	ATOMIC_TYPE next;
+	ATOMIC_TYPE failed;
+	MT_Lock lock;		/* protects errbuf */
+	char errbuf[GDKMAXERRLEN];	/* errors of the saver threads */
+};
+
+static void
+BBPsaver(void *arg)
+{
+	struct syncsaver *ss = arg;
+	ulng k;
+
+	while (!ATOMIC_GET(&ss->failed) &&
+	       (k = ATOMIC_INC(&ss->next) - 1) < (ulng) ss->nsb) {
+		struct syncbat *sb = &ss->sbs[k];
+		if (sb->save &&
+		    BATsave_iter(sb->b, &sb->bi, sb->size, ss->dosync) != GDK_SUCCEED)
+			ATOMIC_SET(&ss->failed, 1);
+	}
+}
+
+/* the saver threads collect their errors so that they can be passed on
+ * to the thread that called BBPsync */
+static void
+BBPsaverthread(void *arg)
+{
+	struct syncsaver *ss = arg;
+	char errbuf[GDKMAXERRLEN];
+
+	GDKsetbuf(errbuf);
+	BBPsaver(ss);
+	if (errbuf[0]) {
+		MT_lock_set(&ss->lock);
+		size_t n = strlen(ss->errbuf);
+		strcpy_len(ss->errbuf + n, errbuf, sizeof(ss->errbuf) - n);
+		MT_lock_unset(&ss->lock);
+	}
+	GDKsetbuf(NULL);
+}
+
+static gdk_return
+BBPsave_parallel(struct syncbat *sbs, int nsb, int nsave, bool dosync)
+{
+	struct syncsaver ss = {
+		.sbs = sbs,
+		.nsb = nsb,
+		.dosync = dosync,
+		.next = ATOMIC_VAR_INIT(0),
+		.failed = ATOMIC_VAR_INIT(0),
+	};
+	MT_Id tids[16];
+	int nw = MIN(MIN(GDKnr_threads, nsave), (int) (sizeof(tids) / sizeof(tids[0]))) - 1;
+
+	MT_lock_init(&ss.lock, "BBPsaver");
+	for (int w = 0; w < nw; w++) {
+		char name[MT_NAME_LEN];
+		snprintf(name, sizeof(name), "BBPsaver%d", w);
+		if (MT_create_thread(&tids[w], BBPsaverthread, &ss,
+				     MT_THR_JOINABLE, name) < 0) {
+			nw = w;
+			break;
+		}
+	}
+	/* this thread does its share of the work */
+	BBPsaver(&ss);
+	for (int w = 0; w < nw; w++)
+		MT_join_thread(tids[w]);
+	MT_lock_destroy(&ss.lock);
+	if (ss.errbuf[0]) {
+		char *buf = GDKerrbuf;
+		if (buf) {
+			size_t n = strlen(buf);
+			strcpy_len(buf + n, ss.errbuf, GDKMAXERRLEN - n);
+		}
+	}
+	TRC_DEBUG(PERF, "saved %d bats using %d threads\n", nsave, nw + 1);
+	return ATOMIC_GET(&ss.failed) ? GDK_FAIL : GDK_SUCCEED;
+}
+
+/* Make everything that was written to the persistent farms durable at
+ * once.  The heaps of a bat can be in any of the persistent farms, and
+ * these can be on different file systems, so each is synced. */
+static gdk_return
+BBPsyncfs(void)
+{
+#ifdef HAVE_SYNCFS
+	for (int i = 0; i < MAXFARMS; i++) {
+		const char *dir = BBPfarms[i].dirname;
+		int fd;
+
+		if (dir == NULL || (BBPfarms[i].roles & (1U << PERSISTENT)) == 0)
+			continue;
+		if ((fd = open(dir, O_RDONLY | O_CLOEXEC)) < 0) {
+			GDKsyserror("cannot open %s\n", dir);
+			return GDK_FAIL;
+		}
+		if (syncfs(fd) < 0) {
+			GDKsyserror("syncfs of %s failed\n", dir);
+			close(fd);
+			return GDK_FAIL;
+		}
+		close(fd);
+	}
+#endif
+	return GDK_SUCCEED;
+}
+
 /*
  * @+ Atomic Write
  * The atomic BBPsync() function first safeguards the old images of
@@ -4031,78 +4161,101 @@ BBPsync(int cnt, bat *restrict subcommit, BUN *restrict sizes, lng logno)
 		ret = BBPdir_first(subcommit != NULL, logno, &obbpf, &nbbpf);
 	}
 
-	for (int idx = 1; ret == GDK_SUCCEED && idx < cnt; idx++) {
-		bat i = subcommit ? subcommit[idx] : idx;
-		BUN size = sizes ? sizes[idx] : BUN_NONE;
-		BATiter bi, *bip;
+	/* with syncfs, the heaps are synced together at the end */
+#ifdef HAVE_SYNCFS
+	const bool batchsync = !(ATOMIC_GET(&GDKdebug) & NOSYNCMASK);
+#else
+	const bool batchsync = false;
+#endif
+	struct syncbat *sbs = NULL;
+	if (ret == GDK_SUCCEED &&
+	    (sbs = GDKmalloc(MIN(cnt, SYNC_CHUNK) * sizeof(struct syncbat))) == NULL)
+		ret = GDK_FAIL;
 
-		const bat bid = i;
-		if (lock)
-			MT_lock_set(&GDKswapLock(bid));
-		/* set flag that we're syncing, i.e. that we'll
-		 * be between moving heap to backup dir and
-		 * saving the new version, in other words, the
-		 * heap may not exist in the usual location */
-		BBP_status_on(bid, BBPSYNCING);
-		/* wait until unloading is finished before
-		 * attempting to make a backup */
-		while (BBP_status(bid) & BBPUNLOADING) {
-			if (lock)
-				MT_lock_unset(&GDKswapLock(bid));
-			BBPspin(bid, __func__, BBPUNLOADING);
+	for (int idx0 = 1; ret == GDK_SUCCEED && idx0 < cnt; idx0 += SYNC_CHUNK) {
+		int nsb = 0, nsave = 0;
+
+		/* first pass: back up the old heaps and decide what
+		 * needs saving */
+		for (int idx = idx0; ret == GDK_SUCCEED && idx < cnt && idx < idx0 + SYNC_CHUNK; idx++) {
+			bat i = subcommit ? subcommit[idx] : idx;
+			BUN size = sizes ? sizes[idx] : BUN_NONE;
+			BATiter bi;
+
+			const bat bid = i;
 			if (lock)
 				MT_lock_set(&GDKswapLock(bid));
-		}
-		BAT *b = BBP_desc(bid);
-		if (subcommit && b->ttype != TYPE_void) {
-			/* move any tail/theap files we find for this bat that
-			 * are in the BACKUP directory to the SUBCOMMIT
-			 * directory */
-			assert(b->ttype > 0); /* no unknown types allowed */
-			char fname[16];	/* plenty big enough */
-			if (snprintf(fname, sizeof(fname), "%o", (unsigned) bid) < 16) {
-				/* the snprintf never fails, any of the
-				 * below may fail */
-				uint8_t stpe = ATOMstorage(b->ttype);
-				if ((b->ttype != TYPE_str || b->twidth >= 8) &&
-				    GDKmove(0, BAKDIR, fname, "tail", SUBDIR, fname, "tail", false) == GDK_SUCCEED)
-					TRC_DEBUG(IO_, "moved %s.tail from %s to %s\n",
-						  fname, BAKDIR, SUBDIR);
-				if (stpe == TYPE_str &&
-				    GDKmove(0, BAKDIR, fname, "tail1", SUBDIR, fname, "tail1", false) == GDK_SUCCEED)
-					TRC_DEBUG(IO_, "moved %s.tail1 from %s to %s\n",
-						  fname, BAKDIR, SUBDIR);
-				if (stpe == TYPE_str && b->twidth >= 2 &&
-				    GDKmove(0, BAKDIR, fname, "tail2", SUBDIR, fname, "tail2", false) == GDK_SUCCEED)
-					TRC_DEBUG(IO_, "moved %s.tail2 from %s to %s\n",
-						  fname, BAKDIR, SUBDIR);
+			/* set flag that we're syncing, i.e. that we'll
+			 * be between moving heap to backup dir and
+			 * saving the new version, in other words, the
+			 * heap may not exist in the usual location */
+			BBP_status_on(bid, BBPSYNCING);
+			/* wait until unloading is finished before
+			 * attempting to make a backup */
+			while (BBP_status(bid) & BBPUNLOADING) {
+				if (lock)
+					MT_lock_unset(&GDKswapLock(bid));
+				BBPspin(bid, __func__, BBPUNLOADING);
+				if (lock)
+					MT_lock_set(&GDKswapLock(bid));
+			}
+			BAT *b = BBP_desc(bid);
+			if (subcommit && b->ttype != TYPE_void) {
+				/* move any tail/theap files we find for this bat that
+				 * are in the BACKUP directory to the SUBCOMMIT
+				 * directory */
+				assert(b->ttype > 0); /* no unknown types allowed */
+				char fname[16];	/* plenty big enough */
+				if (snprintf(fname, sizeof(fname), "%o", (unsigned) bid) < 16) {
+					/* the snprintf never fails, any of the
+					 * below may fail */
+					uint8_t stpe = ATOMstorage(b->ttype);
+					if ((b->ttype != TYPE_str || b->twidth >= 8) &&
+					    GDKmove(0, BAKDIR, fname, "tail", SUBDIR, fname, "tail", false) == GDK_SUCCEED)
+						TRC_DEBUG(IO_, "moved %s.tail from %s to %s\n",
+							  fname, BAKDIR, SUBDIR);
+					if (stpe == TYPE_str &&
+					    GDKmove(0, BAKDIR, fname, "tail1", SUBDIR, fname, "tail1", false) == GDK_SUCCEED)
+						TRC_DEBUG(IO_, "moved %s.tail1 from %s to %s\n",
+							  fname, BAKDIR, SUBDIR);
+					if (stpe == TYPE_str && b->twidth >= 2 &&
+					    GDKmove(0, BAKDIR, fname, "tail2", SUBDIR, fname, "tail2", false) == GDK_SUCCEED)
+						TRC_DEBUG(IO_, "moved %s.tail2 from %s to %s\n",
+							  fname, BAKDIR, SUBDIR);
 #if SIZEOF_VAR_T == 8
-				if (stpe == TYPE_str && b->twidth >= 4 &&
-				    GDKmove(0, BAKDIR, fname, "tail4", SUBDIR, fname, "tail4", false) == GDK_SUCCEED)
-					TRC_DEBUG(IO_, "moved %s.tail4 from %s to %s\n",
-						  fname, BAKDIR, SUBDIR);
+					if (stpe == TYPE_str && b->twidth >= 4 &&
+					    GDKmove(0, BAKDIR, fname, "tail4", SUBDIR, fname, "tail4", false) == GDK_SUCCEED)
+						TRC_DEBUG(IO_, "moved %s.tail4 from %s to %s\n",
+							  fname, BAKDIR, SUBDIR);
 #endif
-				if (ATOMvarsized(b->ttype) &&
-				    GDKmove(0, BAKDIR, fname, "theap", SUBDIR, fname, "theap", false) == GDK_SUCCEED)
-					TRC_DEBUG(IO_, "moved %s.theap from %s to %s\n",
-						  fname, BAKDIR, SUBDIR);
+					if (ATOMvarsized(b->ttype) &&
+					    GDKmove(0, BAKDIR, fname, "theap", SUBDIR, fname, "theap", false) == GDK_SUCCEED)
+						TRC_DEBUG(IO_, "moved %s.theap from %s to %s\n",
+							  fname, BAKDIR, SUBDIR);
+				}
 			}
-		}
-		b = dirty_bat(&i, subcommit != NULL);
-		if (i <= 0)
-			ret = GDK_FAIL;
-		else if (BBP_status(bid) & BBPEXISTING &&
-			 b != NULL &&
-			 b->batInserted > 0)
-			ret = BBPbackup(b, subcommit != NULL);
+			b = dirty_bat(&i, subcommit != NULL);
+			if (i <= 0)
+				ret = GDK_FAIL;
+			else if (BBP_status(bid) & BBPEXISTING &&
+				 b != NULL &&
+				 b->batInserted > 0)
+				ret = BBPbackup(b, subcommit != NULL);
 
-		if (lock)
-			MT_lock_unset(&GDKswapLock(bid));
+			if (lock)
+				MT_lock_unset(&GDKswapLock(bid));
 
-		if (ret != GDK_SUCCEED)
-			break;
+			if (ret != GDK_SUCCEED)
+				break;
 
-		if (BBP_status(i) & BBPPERSISTENT) {
+			struct syncbat *sb = &sbs[nsb++];
+			*sb = (struct syncbat) {
+				.bid = i,
+				.b = b,
+				.persistent = (BBP_status(i) & BBPPERSISTENT) != 0,
+			};
+			if (!sb->persistent)
+				continue;
 			MT_lock_set(&BBP_desc(i)->theaplock);
 			bi = bat_iterator_nolock(BBP_desc(i));
 			bat_iterator_incref(&bi);
@@ -4124,6 +4277,8 @@ BBPsync(int cnt, bat *restrict subcommit, BUN *restrict sizes, lng logno)
 				}
 			}
 			MT_lock_unset(&bi.b->theaplock);
+			sb->bi = bi;
+			sb->size = size;
 			if (ret == GDK_SUCCEED && b && size != 0) {
 				/* wait for BBPSAVING so that we
 				 * can set it, wait for
@@ -4141,22 +4296,36 @@ BBPsync(int cnt, bat *restrict subcommit, BUN *restrict sizes, lng logno)
 				BBP_status_on(i, BBPSAVING);
 				if (lock)
 					MT_lock_unset(&GDKswapLock(i));
-				ret = BATsave_iter(b, &bi, size);
-				BBP_status_off(i, BBPSAVING);
+				sb->save = true;
+				nsave++;
 			}
-			bip = &bi;
-		} else {
-			bip = NULL;
 		}
-		if (ret == GDK_SUCCEED) {
-			n = BBPdir_step(i, size, n, buf, sizeof(buf), &obbpf, nbbpf, bip);
-			if (n < -1)
-				ret = GDK_FAIL;
+
+		/* second pass: save the heaps, using multiple
+		 * threads if there are several */
+		if (ret == GDK_SUCCEED && nsave > 0)
+			ret = BBPsave_parallel(sbs, nsb, nsave, !batchsync);
+
+		/* third pass: write BBP.dir entries (in order) and
+		 * clean up */
+		for (int k = 0; k < nsb; k++) {
+			struct syncbat *sb = &sbs[k];
+			if (sb->save)
+				BBP_status_off(sb->bid, BBPSAVING);
+			if (ret == GDK_SUCCEED) {
+				n = BBPdir_step(sb->bid, sb->size, n, buf, sizeof(buf), &obbpf, nbbpf, sb->persistent ? &sb->bi : NULL);
+				if (n < -1)
+					ret = GDK_FAIL;
+			}
+			if (sb->persistent)
+				bat_iterator_end(&sb->bi);
+			/* we once again have a saved heap */
 		}
-		if (bip)
-			bat_iterator_end(bip);
-		/* we once again have a saved heap */
 	}
+	GDKfree(sbs);
+
+	if (ret == GDK_SUCCEED && batchsync)
+		ret = BBPsyncfs();
 
 	TRC_DEBUG(PERF, "write time "LLFMT" usec\n", (t0 = GDKusec()) - t1);
 
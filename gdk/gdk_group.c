@@ -653,9 +653,223 @@ ctz(oid x)
 			      GOTO_LABEL_TIMEOUT_HANDLER(error, qry_ctx)); \
 	} while (0)
 
+static gdk_return group_internal(BAT **groups, BAT **extents, BAT **histo,
+				 BAT *b, BAT *s, BAT *g, BAT *e, BAT *h,
+				 bool subsorted, bool spill);
+
+/* Group b (with candidates ci and optional pre-existing grouping g
+ * which is aligned with ci) one hash partition at a time (see
+ * gdk_spill.c).  Since all (sub)group members end up in the same
+ * partition, the groups of the partitions are disjoint.  Afterwards,
+ * the groups are renumbered in order of their first member, so the
+ * result is the same as if we had grouped the whole input at once. */
+static gdk_return
+spillgroup(BAT **groups, BAT **extents, BAT **histo,
+	   BAT *b, struct canditer *ci, BAT *g, oid hseqb, BUN nparts,
+	   lng t0)
+{
+	struct spill *sp;
+	BAT *gn = NULL, *en = NULL, *hn = NULL;
+	BAT *ext = NULL, *cnt = NULL, *sorted = NULL, *order = NULL;
+	oid *restrict ngrps;
+	oid *map = NULL;
+	BUN p, i, ngrp = 0;
+	bool issorted = true;
+	/* if the candidates are dense, we can calculate the position
+	 * of a candidate from its value, so we don't need to keep
+	 * the positions separately */
+	bool withpos = ci->tpe != cand_dense;
+
+	MT_thread_setalgorithm("spill group");
+	if ((sp = BATspillpartition(b, ci, g, nparts, false, withpos)) == NULL)
+		return GDK_FAIL;
+	gn = COLnew(hseqb, TYPE_oid, ci->ncand, TRANSIENT);
+	ext = COLnew(0, TYPE_oid, 0, TRANSIENT);
+	if (gn == NULL || ext == NULL)
+		goto error;
+	if (histo && (cnt = COLnew(0, TYPE_lng, 0, TRANSIENT)) == NULL)
+		goto error;
+	ngrps = (oid *) Tloc(gn, 0);
+	for (p = 0; p < nparts; p++) {
+		BAT *pc, *pp = NULL, *pb, *pg = NULL;
+		BAT *pgn = NULL, *pen = NULL, *phn = NULL;
+		BUN n = SPILLcount(sp, p);
+		const oid *cs, *ps;
+		oid off = withpos ? 0 : ci->seq;
+
+		if (n == 0)
+			continue;
+		if (SPILLget(sp, p, &pc, withpos ? &pp : NULL) != GDK_SUCCEED)
+			goto error;
+		cs = (const oid *) Tloc(pc, 0);
+		ps = (const oid *) Tloc(withpos ? pp : pc, 0);
+		/* copy the values of the partition into a compact
+		 * bat so that the hash table we build only needs to
+		 * be as large as the partition */
+		if ((pb = BATproject(pc, b)) == NULL) {
+			BBPreclaim(pc);
+			BBPreclaim(pp);
+			goto error;
+		}
+		if (g) {
+			const oid *grps = (const oid *) Tloc(g, 0);
+			oid *pgrps;
+			if ((pg = COLnew(0, TYPE_oid, n, TRANSIENT)) == NULL) {
+				BBPreclaim(pc);
+				BBPreclaim(pp);
+				BBPreclaim(pb);
+				goto error;
+			}
+			pgrps = (oid *) Tloc(pg, 0);
+			for (i = 0; i < n; i++)
+				pgrps[i] = grps[ps[i] - off];
+			BATsetcount(pg, n);
+			pg->tsorted = pg->trevsorted = false;
+			pg->tkey = false;
+			pg->tnonil = true;
+			pg->tnil = false;
+		}
+		if (group_internal(&pgn, &pen, histo ? &phn : NULL, pb,
+				   NULL, pg, NULL, NULL, false,
+				   false) != GDK_SUCCEED) {
+			BBPreclaim(pc);
+			BBPreclaim(pp);
+			BBPreclaim(pb);
+			BBPreclaim(pg);
+			goto error;
+		}
+		BBPreclaim(pb);
+		BBPreclaim(pg);
+		for (i = 0; i < n; i++)
+			ngrps[ps[i] - off] = ngrp + BUNtoid(pgn, i);
+		BBPreclaim(pgn);
+		BBPreclaim(pp);
+		/* the extents refer to positions in the partition,
+		 * translate them back to oids in b */
+		BUN m = BATcount(pen);
+		if (BATcapacity(ext) < ngrp + m &&
+		    BATextend(ext, ngrp + m) != GDK_SUCCEED) {
+			BBPreclaim(pc);
+			BBPreclaim(pen);
+			BBPreclaim(phn);
+			goto error;
+		}
+		for (i = 0; i < m; i++)
+			((oid *) Tloc(ext, 0))[ngrp + i] = cs[BUNtoid(pen, i)];
+		BATsetcount(ext, ngrp + m);
+		BBPreclaim(pc);
+		BBPreclaim(pen);
+		if (phn && BATappend(cnt, phn, NULL, false) != GDK_SUCCEED) {
+			BBPreclaim(phn);
+			goto error;
+		}
+		BBPreclaim(phn);
+		ngrp += m;
+	}
+	SPILLdestroy(sp);
+	sp = NULL;
+	BATsetcount(gn, ci->ncand);
+	ext->tsorted = ngrp <= 1;
+	ext->trevsorted = ngrp <= 1;
+	ext->tkey = true;
+	ext->tnonil = true;
+	ext->tnil = false;
+	ext->tseqbase = oid_nil;
+
+	if (ngrp == ci->ncand) {
+		/* every candidate turned out to be a group of its own */
+		BBPreclaim(gn);
+		BBPreclaim(ext);
+		BBPreclaim(cnt);
+		ext = cnt = NULL;
+		if ((gn = BATdense(hseqb, 0, ngrp)) == NULL ||
+		    (extents && (en = canditer_slice(ci, 0, ngrp)) == NULL) ||
+		    (histo && (hn = BATconstant(0, TYPE_lng, &(lng){1}, ngrp, TRANSIENT)) == NULL)) {
+			BBPreclaim(en);
+			goto error;
+		}
+		goto done;
+	}
+
+	/* renumber the groups in order of their first member */
+	if (BATsort(&sorted, &order, NULL, ext, NULL, NULL, false, false, false) != GDK_SUCCEED)
+		goto error;
+	if ((map = GDKmalloc(ngrp * sizeof(oid))) == NULL)
+		goto error;
+	for (i = 0; i < ngrp; i++)
+		map[BUNtoid(order, i)] = (oid) i;
+	for (i = 0; i < ci->ncand; i++) {
+		ngrps[i] = map[ngrps[i]];
+		if (i > 0 && ngrps[i] < ngrps[i - 1])
+			issorted = false;
+	}
+	GDKfree(map);
+	map = NULL;
+	if (histo) {
+		hn = BATproject(order, cnt);
+		if (hn == NULL)
+			goto error;
+	}
+	BBPreclaim(order);
+	BBPreclaim(ext);
+	BBPreclaim(cnt);
+	order = ext = cnt = NULL;
+	if (extents) {
+		en = virtualize(sorted);
+		sorted = NULL;
+	} else {
+		BBPreclaim(sorted);
+		sorted = NULL;
+	}
+
+	gn->tsorted = issorted;
+	gn->tkey = false;
+	gn->trevsorted = ngrp == 1 || BATcount(gn) <= 1;
+	gn->tnonil = true;
+	gn->tnil = false;
+	gn->tmaxpos = BUN_NONE;
+	gn->tunique_est = (double) ngrp;
+	gn->tseqbase = oid_nil;
+  done:
+	*groups = gn;
+	if (extents)
+		*extents = en;
+	if (histo)
+		*histo = hn;
+	TRC_DEBUG(ALGO, "b=" ALGOBATFMT ",s=" ALGOOPTBATFMT
+		  ",g=" ALGOOPTBATFMT ",nparts=" BUNFMT " -> groups="
+		  ALGOOPTBATFMT ",extents=" ALGOOPTBATFMT
+		  ",histo=" ALGOOPTBATFMT " (spill group -- "
+		  LLFMT " usec)\n",
+		  ALGOBATPAR(b), ALGOOPTBATPAR(ci->s), ALGOOPTBATPAR(g),
+		  nparts, ALGOOPTBATPAR(gn), ALGOOPTBATPAR(en),
+		  ALGOOPTBATPAR(hn), GDKusec() - t0);
+	return GDK_SUCCEED;
+
+  error:
+	SPILLdestroy(sp);
+	GDKfree(map);
+	BBPreclaim(gn);
+	BBPreclaim(ext);
+	BBPreclaim(cnt);
+	BBPreclaim(sorted);
+	BBPreclaim(order);
+	BBPreclaim(hn);
+	return GDK_FAIL;
+}
+
 gdk_return
 BATgroup_internal(BAT **groups, BAT **extents, BAT **histo,
 		  BAT *b, BAT *s, BAT *g, BAT *e, BAT *h, bool subsorted)
+{
+	return group_internal(groups, extents, histo, b, s, g, e, h,
+			      subsorted, true);
+}
+
+static gdk_return
+group_internal(BAT **groups, BAT **extents, BAT **histo,
+	       BAT *b, BAT *s, BAT *g, BAT *e, BAT *h, bool subsorted,
+	       bool spill)
 {
 	BAT *gn = NULL, *en = NULL, *hn = NULL;
 	int t;
@@ -842,6 +1056,20 @@ BATgroup_internal(BAT **groups, BAT **extents, BAT **histo,
 		}
 	}
 	assert(g == NULL || !BATtdense(g)); /* i.e. g->ttype == TYPE_oid */
+	if (spill && !subsorted && !bi.sorted && !bi.revsorted &&
+	    (g != NULL || bi.transient) &&
+	    ATOMbasetype(bi.type) != TYPE_bte &&
+	    ATOMbasetype(bi.type) != TYPE_sht &&
+	    !BATcheckhash(b)) {
+		/* we're going to build a new hash table, check
+		 * whether it fits in the memory budget */
+		BUN nparts = GDKspillparts(ci.ncand, 2 * SIZEOF_BUN + SIZEOF_OID + bi.width, SIZEOF_OID);
+		if (nparts > 1) {
+			bat_iterator_end(&bi);
+			return spillgroup(groups, extents, histo, b, &ci, g,
+					  hseqb, nparts, t0);
+		}
+	}
 	cmp = ATOMcompare(bi.type);
 	gn = COLnew(hseqb, TYPE_oid, ci.ncand, TRANSIENT);
 	if (gn == NULL)
@@ -3331,6 +3331,86 @@ hashjoin(BAT **r1p, BAT **r2p, BAT **r3p, BAT *l, BAT *r,
 	return GDK_FAIL;
 }
 
+/* Implementation of join for when the hash table on the right column
+ * would not fit in the memory budget: both inputs are partitioned on
+ * the hash value of the join column and written to disk (see
+ * gdk_spill.c), and then each pair of partitions is joined using a
+ * hash that is specific for the right partition.  The results of the
+ * partitions are concatenated, so the result is not ordered on the
+ * left (or right) input. */
+static gdk_return
+spilljoin(BAT **r1p, BAT **r2p, BAT *l, BAT *r,
+	  struct canditer *restrict lci, struct canditer *restrict rci,
+	  bool nil_matches, BUN nparts, lng t0, bool swapped)
+{
+	struct spill *lsp, *rsp = NULL;
+	BAT *r1 = NULL, *r2 = NULL;
+	BUN p;
+
+	MT_thread_setalgorithm(swapped ? "spilljoin (swapped)" : "spilljoin");
+	if ((lsp = BATspillpartition(l, lci, NULL, nparts, !nil_matches, false)) == NULL ||
+	    (rsp = BATspillpartition(r, rci, NULL, nparts, !nil_matches, false)) == NULL)
+		goto bailout;
+	r1 = COLnew(0, TYPE_oid, 0, TRANSIENT);
+	r2 = COLnew(0, TYPE_oid, 0, TRANSIENT);
+	if (r1 == NULL || r2 == NULL)
+		goto bailout;
+	for (p = 0; p < nparts; p++) {
+		struct canditer plci, prci;
+		BAT *lp, *rp, *p1, *p2;
+		gdk_return rc;
+
+		if (SPILLcount(lsp, p) == 0 || SPILLcount(rsp, p) == 0)
+			continue;
+		if (SPILLget(lsp, p, &lp, NULL) != GDK_SUCCEED)
+			goto bailout;
+		if (SPILLget(rsp, p, &rp, NULL) != GDK_SUCCEED) {
+			BBPreclaim(lp);
+			goto bailout;
+		}
+		canditer_init(&plci, l, lp);
+		canditer_init(&prci, r, rp);
+		rc = hashjoin(&p1, &p2, NULL, l, r, &plci, &prci,
+			      nil_matches, false, false, false, false,
+			      false, false, BUN_NONE, t0, swapped,
+			      false, false, true, __func__);
+		BBPreclaim(lp);
+		BBPreclaim(rp);
+		if (rc != GDK_SUCCEED)
+			goto bailout;
+		if (BATappend(r1, p1, NULL, false) != GDK_SUCCEED ||
+		    BATappend(r2, p2, NULL, false) != GDK_SUCCEED) {
+			BBPreclaim(p1);
+			BBPreclaim(p2);
+			goto bailout;
+		}
+		BBPreclaim(p1);
+		BBPreclaim(p2);
+	}
+	SPILLdestroy(lsp);
+	SPILLdestroy(rsp);
+	*r1p = r1;
+	*r2p = r2;
+	TRC_DEBUG(ALGO, "l=" ALGOBATFMT "," "r=" ALGOBATFMT
+		  ",sl=" ALGOOPTBATFMT "," "sr=" ALGOOPTBATFMT ","
+		  "nil_matches=%s,nparts=" BUNFMT ";%s -> " ALGOBATFMT "," ALGOBATFMT
+		  " (" LLFMT "usec)\n",
+		  ALGOBATPAR(l), ALGOBATPAR(r),
+		  ALGOOPTBATPAR(lci->s), ALGOOPTBATPAR(rci->s),
+		  nil_matches ? "true" : "false", nparts,
+		  swapped ? " swapped" : "",
+		  ALGOBATPAR(r1), ALGOBATPAR(r2),
+		  GDKusec() - t0);
+	return GDK_SUCCEED;
+
+  bailout:
+	SPILLdestroy(lsp);
+	SPILLdestroy(rsp);
+	BBPreclaim(r1);
+	BBPreclaim(r2);
+	return GDK_FAIL;
+}
+
 /* Count the number of unique values for the first half and the complete
  * set (the sample s of b) and return the two values in *cnt1 and
  * *cnt2. In case of error, both values are 0. */
@@ -4463,6 +4543,7 @@ BATjoin(BAT **r1p, BAT **r2p, BAT *l, BAT *r, BAT *sl, BAT *sr, bool nil_matches
 	double lcost = 0;
 	gdk_return rc;
 	lng t0 = 0;
+	BUN nparts;
 	BAT *r2 = NULL;
 	BAT *lp = NULL;
 	BAT *rp = NULL;
@@ -4607,6 +4688,25 @@ BATjoin(BAT **r1p, BAT **r2p, BAT *l, BAT *r, BAT *sl, BAT *sr, bool nil_matches
 			       estimate, t0, true, __func__);
 		if (rc == GDK_SUCCEED && r2p == NULL)
 			BBPunfix(r2->batCacheid);
+	} else if (!BATtvoid(l) && !BATtvoid(r) &&
+		   (swap ? !lhash && !plhash : !rhash && !prhash) &&
+		   (nparts = swap ?
+		    GDKspillparts(lci.ncand, 2 * SIZEOF_BUN + l->twidth, 0) :
+		    GDKspillparts(rci.ncand, 2 * SIZEOF_BUN + r->twidth, 0)) > 1) {
+		/* the hash table we would need to build does not fit
+		 * in the memory budget: join partition by partition */
+		if (swap)
+			rc = spilljoin(&r2, r1p, r, l, &rci, &lci,
+				       nil_matches, nparts, t0, true);
+		else
+			rc = spilljoin(r1p, &r2, l, r, &lci, &rci,
+				       nil_matches, nparts, t0, false);
+		if (rc == GDK_SUCCEED) {
+			if (r2p)
+				*r2p = r2;
+			else
+				BBPunfix(r2->batCacheid);
+		}
 	} else if (swap) {
 		rc = hashjoin(r2p ? r2p : &r2, r1p, NULL, r, l, &rci, &lci,
 			      nil_matches, false, false, false, false, false, false,
@@ -716,87 +716,88 @@ la_bat_update_count(logger *lg, log_id id, lng cnt, int tid)
 	return GDK_FAIL;
 }
 
+/* apply the changes of la to the bat bid; this only touches that
+ * bat, so changes to different bats can be applied concurrently */
 static gdk_return
-la_bat_updates(logger *lg, logaction *la, int tid)
+la_bat_apply(logger *lg, logaction *la, log_bid bid)
 {
-	log_bid bid = internal_find_bat(lg, la->cid, tid);
-	BAT *b = NULL;
+	BAT *b;
 
-	if (bid < 0)
-		return GDK_FAIL;
-	if (!bid) {
-		/* object already gone, nothing needed */
+	if (lg->flushing)
 		return GDK_SUCCEED;
-	}
-
-	if (!lg->flushing) {
-		b = BATdescriptor(bid);
-		if (b == NULL)
-			return GDK_FAIL;
-	}
-	BUN cnt = 0;
+	b = BATdescriptor(bid);
+	if (b == NULL)
+		return GDK_FAIL;
 	if (la->type == LOG_UPDATE_BULK) {
-		if (!lg->flushing) {
-			cnt = BATcount(b);
-			int is_msk = (b->ttype == TYPE_msk);
-			/* handle offset 0 ie clear */
-			if ( /* DISABLES CODE */ (0) && la->offset == 0 && cnt)
-				BATclear(b, true);
-			/* handle offset */
-			if (cnt <= (BUN) la->offset) {
-				msk t = 1;
-				if (cnt < (BUN) la->offset) {	/* insert nils */
-					const void *tv = (is_msk) ? &t : ATOMnilptr(b->ttype);
-					lng i, d = la->offset - BATcount(b);
-					for (i = 0; i < d; i++) {
-						if (BUNappend(b, tv, true) != GDK_SUCCEED) {
-							logbat_destroy(b);
-							return GDK_FAIL;
-						}
+		BUN cnt = BATcount(b);
+		int is_msk = (b->ttype == TYPE_msk);
+		/* handle offset 0 ie clear */
+		if ( /* DISABLES CODE */ (0) && la->offset == 0 && cnt)
+			BATclear(b, true);
+		/* handle offset */
+		if (cnt <= (BUN) la->offset) {
+			msk t = 1;
+			if (cnt < (BUN) la->offset) {	/* insert nils */
+				const void *tv = (is_msk) ? &t : ATOMnilptr(b->ttype);
+				lng i, d = la->offset - BATcount(b);
+				for (i = 0; i < d; i++) {
+					if (BUNappend(b, tv, true) != GDK_SUCCEED) {
+						logbat_destroy(b);
+						return GDK_FAIL;
 					}
 				}
-				if (BATcount(b) == (BUN) la->offset && BATappend(b, la->b, NULL, true) != GDK_SUCCEED) {
-					logbat_destroy(b);
-					return GDK_FAIL;
-				}
-			} else {
-				BATiter vi = bat_iterator(la->b);
-				BUN p, q;
+			}
+			if (BATcount(b) == (BUN) la->offset && BATappend(b, la->b, NULL, true) != GDK_SUCCEED) {
+				logbat_destroy(b);
+				return GDK_FAIL;
+			}
+		} else {
+			BATiter vi = bat_iterator(la->b);
+			BUN p, q;
 
-				for (p = 0, q = (BUN) la->offset; p < (BUN) la->nr; p++, q++) {
-					const void *t = BUNtail(vi, p);
+			for (p = 0, q = (BUN) la->offset; p < (BUN) la->nr; p++, q++) {
+				const void *t = BUNtail(vi, p);
 
-					if (q < cnt) {
-						if (BUNreplace(b, q, t, true) != GDK_SUCCEED) {
-							logbat_destroy(b);
-							bat_iterator_end(&vi);
-							return GDK_FAIL;
-						}
-					} else {
-						if (BUNappend(b, t, true) != GDK_SUCCEED) {
-							logbat_destroy(b);
-							bat_iterator_end(&vi);
-							return GDK_FAIL;
-						}
+				if (q < cnt) {
+					if (BUNreplace(b, q, t, true) != GDK_SUCCEED) {
+						logbat_destroy(b);
+						bat_iterator_end(&vi);
+						return GDK_FAIL;
+					}
+				} else {
+					if (BUNappend(b, t, true) != GDK_SUCCEED) {
+						logbat_destroy(b);
+						bat_iterator_end(&vi);
+						return GDK_FAIL;
 					}
 				}
-				bat_iterator_end(&vi);
 			}
+			bat_iterator_end(&vi);
 		}
 	} else if (la->type == LOG_UPDATE) {
-		if (!lg->flushing && BATupdate(b, la->uid, la->b, true) != GDK_SUCCEED) {
+		if (BATupdate(b, la->uid, la->b, true) != GDK_SUCCEED) {
+			logbat_destroy(b);
 			return GDK_FAIL;
 		}
 	}
-	cnt = (BUN) (la->offset + la->nr);
-	if (la_bat_update_count(lg, la->cid, cnt, tid) != GDK_SUCCEED) {
-		if (b)
-			logbat_destroy(b);
+	logbat_destroy(b);
+	return GDK_SUCCEED;
+}
+
+static gdk_return
+la_bat_updates(logger *lg, logaction *la, int tid)
+{
+	log_bid bid = internal_find_bat(lg, la->cid, tid);
+
+	if (bid < 0)
 		return GDK_FAIL;
+	if (!bid) {
+		/* object already gone, nothing needed */
+		return GDK_SUCCEED;
 	}
-	if (b)
-		logbat_destroy(b);
-	return GDK_SUCCEED;
+	if (la_bat_apply(lg, la, bid) != GDK_SUCCEED)
+		return GDK_FAIL;
+	return la_bat_update_count(lg, la->cid, (lng) (la->offset + la->nr), tid);
 }
 
 static log_return
@@ -1012,14 +1013,151 @@ tr_abort(logger *lg, trans *tr)
 	return tr_abort_(lg, tr, 0);
 }
 
+/* During recovery, a run of consecutive updates within a transaction
+ * is applied using multiple threads if there is enough work.  The
+ * updates are grouped per bat (the updates to a single bat must be
+ * applied in order), and the groups are divided over the threads.
+ * Looking up the bats and updating the counts in the catalog is done
+ * sequentially. */
+#define REPLAY_PARALLEL_MIN	((lng) 1 << 17) /* minimum rows in a run */
+
+struct replay {
+	logger *lg;
+	logaction *changes;
+	const log_bid *bids;	/* bat for each change (0: gone) */
+	const lng *order;	/* change indexes sorted on bat */
+	const int *groups;	/* start of each group in order */
+	int ngroups;
+	ATOMIC_TYPE next;	/* next group to be handled */
+	ATOMIC_TYPE failed;
+};
+
+static void
+replay_worker(void *arg)
+{
+	struct replay *rp = arg;
+	ulng g;
+
+	while (!ATOMIC_GET(&rp->failed) &&
+	       (g = ATOMIC_INC(&rp->next) - 1) < (ulng) rp->ngroups) {
+		for (int k = rp->groups[g]; k < rp->groups[g + 1]; k++) {
+			int i = (int) (rp->order[k] & 0xFFFFFFFF);
+			if (la_bat_apply(rp->lg, &rp->changes[i], rp->bids[i]) != GDK_SUCCEED) {
+				ATOMIC_SET(&rp->failed, 1);
+				break;
+			}
+		}
+	}
+}
+
+/* apply changes [s,e) which are all of type LOG_UPDATE or
+ * LOG_UPDATE_BULK */
+static gdk_return
+la_apply_parallel(logger *lg, trans *tr, int s, int e)
+{
+	int n = e - s;
+	log_bid *bids = GDKmalloc(tr->nr * sizeof(log_bid));
+	lng *order = GDKmalloc(n * sizeof(lng));
+	int *groups = GDKmalloc((n + 1) * sizeof(int));
+	MT_Id *tids = NULL;
+	int nw = 0, m = 0;
+	gdk_return rc = GDK_FAIL;
+
+	if (bids == NULL || order == NULL || groups == NULL)
+		goto bailout;
+	for (int i = s; i < e; i++) {
+		bids[i] = internal_find_bat(lg, tr->changes[i].cid, tr->tid);
+		if (bids[i] < 0)
+			goto bailout;
+		/* sort key: bat id, then position within the transaction */
+		if (bids[i] > 0)
+			order[m++] = (lng) bids[i] << 32 | i;
+	}
+	GDKqsort(order, NULL, NULL, m, sizeof(lng), 0, TYPE_lng, false, false);
+	int ngroups = 0;
+	for (int k = 0; k < m; k++) {
+		if (k == 0 || order[k] >> 32 != order[k - 1] >> 32)
+			groups[ngroups++] = k;
+	}
+	groups[ngroups] = m;
+
+	struct replay rp = {
+		.lg = lg,
+		.changes = tr->changes,
+		.bids = bids,
+		.order = order,
+		.groups = groups,
+		.ngroups = ngroups,
+		.next = ATOMIC_VAR_INIT(0),
+		.failed = ATOMIC_VAR_INIT(0),
+	};
+	nw = MIN(GDKnr_threads, ngroups) - 1;
+	if (nw > 0 && (tids = GDKmalloc(nw * sizeof(MT_Id))) == NULL)
+		nw = 0;
+	for (int w = 0; w < nw; w++) {
+		char name[MT_NAME_LEN];
+		snprintf(name, sizeof(name), "logreplay%d", w);
+		if (MT_create_thread(&tids[w], replay_worker, &rp,
+				     MT_THR_JOINABLE, name) < 0) {
+			nw = w;
+			break;
+		}
+	}
+	/* this thread does its share of the work */
+	replay_worker(&rp);
+	for (int w = 0; w < nw; w++)
+		MT_join_thread(tids[w]);
+	TRC_DEBUG(WAL, "applied %d changes to %d bats using %d threads\n",
+		  n, ngroups, nw + 1);
+	if (ATOMIC_GET(&rp.failed))
+		goto bailout;
+	for (int i = s; i < e; i++) {
+		logaction *la = &tr->changes[i];
+		if (bids[i] > 0 &&
+		    la_bat_update_count(lg, la->cid, (lng) (la->offset + la->nr), tr->tid) != GDK_SUCCEED)
+			goto bailout;
+	}
+	rc = GDK_SUCCEED;
+  bailout:
+	GDKfree(bids);
+	GDKfree(order);
+	GDKfree(groups);
+	GDKfree(tids);
+	return rc;
+}
+
 static trans *
 tr_commit(logger *lg, trans *tr)
 {
-	int i;
+	int i, run_end = 0;
 
 	TRC_DEBUG(WAL, "commit");
 
 	for (i = 0; i < tr->nr; i++) {
+		if (i >= run_end && !lg->flushing && GDKnr_threads > 1 &&
+		    (tr->changes[i].type == LOG_UPDATE ||
+		     tr->changes[i].type == LOG_UPDATE_BULK)) {
+			int e;
+			lng nrows = 0;
+			for (e = i; e < tr->nr &&
+				     (tr->changes[e].type == LOG_UPDATE ||
+				      tr->changes[e].type == LOG_UPDATE_BULK); e++)
+				nrows += tr->changes[e].nr;
+			run_end = e;
+			if (e - i > 1 && nrows >= REPLAY_PARALLEL_MIN) {
+				if (la_apply_parallel(lg, tr, i, e) != GDK_SUCCEED) {
+					TRC_CRITICAL(GDK, "aborting transaction\n");
+					do {
+						tr = tr_abort_(lg, tr, i);
+					} while (tr != NULL);
+					return (trans *) -1;
+				}
+				for (int k = i; k < e; k++)
+					la_destroy(&tr->changes[k]);
+				i = e - 1;
+				continue;
+			}
+		}
 		if (la_apply(lg, &tr->changes[i], tr->tid) != GDK_SUCCEED) {
 			TRC_CRITICAL(GDK, "aborting transaction\n");
 			do {
@@ -1161,6 +1299,7 @@ log_open_output(logger *lg)
 	ATOMIC_INIT(&new_range->last_ts, 0);
 	ATOMIC_INIT(&new_range->flushed_ts, 0);
 	ATOMIC_INIT(&new_range->drops, 0);
+	new_range->grouped = 0;
 	new_range->id = lg->id;
 	new_range->next = NULL;
 	logged_range *current = lg->current;
@@ -2334,6 +2473,7 @@ log_new(int debug, const char *fn, const char *logdir, int version, preversionfi
 
 	lng max_dropped = GDKgetenv_int("wal_max_dropped", 100000);
 	lng max_file_age = GDKgetenv_int("wal_max_file_age", 600);
+	lng commit_delay = GDKgetenv_int("wal_commit_delay", 0);
 	lng max_file_size = 0;
 
 	if (GDKdebug & FORCEMITOMASK) {
@@ -2371,10 +2511,13 @@ log_new(int debug, const char *fn, const char *logdir, int version, preversionfi
 		.file_age = 0,
 		.max_file_age = max_file_age >= 0 ? max_file_age * 1000000 : 600000000,
 		.max_file_size = max_file_size >= 0 ? max_file_size : 2147483648,
+		.commit_delay = commit_delay >= 0 ? commit_delay : 0,
 
 		.id = 0,
 		.saved_id = getBBPlogno(),	/* get saved log numer from bbp */
 		.nr_flushers = ATOMIC_VAR_INIT(0),
+		.nr_commits = ATOMIC_VAR_INIT(0),
+		.nr_syncs = ATOMIC_VAR_INIT(0),
 		.fn = GDKstrdup(fn),
 		.dir = GDKstrdup(filename),
 		.rbufsize = 64 * 1024,
@@ -2402,6 +2545,7 @@ log_new(int debug, const char *fn, const char *logdir, int version, preversionfi
 	MT_lock_init(&lg->rotation_lock, "rotation_lock");
 	MT_lock_init(&lg->flush_lock, "flush_lock");
 	MT_cond_init(&lg->excl_flush_cv);
+	MT_cond_init(&lg->flush_cv);
 
 	if (log_load(fn, lg, filename) == GDK_SUCCEED) {
 		return lg;
@@ -2483,6 +2627,7 @@ log_destroy(logger *lg)
 	MT_lock_destroy(&lg->lock);
 	MT_lock_destroy(&lg->rotation_lock);
 	MT_lock_destroy(&lg->flush_lock);
+	MT_cond_destroy(&lg->flush_cv);
 	GDKfree(lg->fn);
 	GDKfree(lg->dir);
 	GDKfree(lg->rbuf);
@@ -3203,19 +3348,71 @@ log_tend(logger *lg)
 #define flush_unlock(lg)	MT_lock_unset(&(lg)->flush_lock)
 
 static inline gdk_return
-do_flush(logged_range *range)
+do_flush(logged_range *range, ulng ts, ulng batch)
 {
-	/* assumes flush lock */
+	/* only called by the flush leader */
 	stream *output_log = range->output_log;
-	ulng ts = ATOMIC_GET(&range->last_ts);
 
 	if (mnstr_flush(output_log, MNSTR_FLUSH_DATA) ||
 	    (!(ATOMIC_GET(&GDKdebug) & NOSYNCMASK) && mnstr_fsync(output_log)))
 		return GDK_FAIL;
-	ATOMIC_SET(&range->flushed_ts, ts);
+	TRC_DEBUG(WAL, "synced log up to " ULLFMT " for %" PRIu64 " transactions\n", ts, (uint64_t) batch);
 	return GDK_SUCCEED;
 }
 
+/* Make the log of range durable up to at least commit_ts.  Group
+ * commit: the first committer to get here becomes the leader.  It
+ * waits commit_delay usec for other committers to join its group, then
+ * syncs the log once for all of them.  The others wait until the
+ * leader is done, and only sync themselves if that sync did not cover
+ * their commit. */
+static gdk_return
+log_sync(logger *lg, logged_range *range, ulng commit_ts)
+{
+	gdk_return res = GDK_SUCCEED;
+
+	flush_lock(lg);
+	while ((ulng) ATOMIC_GET(&range->flushed_ts) < commit_ts) {
+		if (lg->flush_leader) {
+			MT_cond_wait(&lg->flush_cv, &lg->flush_lock);
+			continue;
+		}
+		lg->flush_leader = true;
+		if (lg->commit_delay > 0) {
+			/* flush_lock is released while waiting, so that
+			 * others can join */
+			lng t0 = GDKusec(), left;
+			while ((left = lg->commit_delay - (GDKusec() - t0)) > 0)
+				(void) MT_cond_timedwait(&lg->flush_cv, &lg->flush_lock, left);
+		}
+		flush_unlock(lg);
+
+		/* the group consists of the committers whose commit
+		 * timestamps are covered by ts */
+		rotation_lock(lg);
+		ulng ts = (ulng) ATOMIC_GET(&range->last_ts);
+		ulng batch = range->grouped;
+		range->grouped = 0;
+		rotation_unlock(lg);
+
+		res = do_flush(range, ts, batch);
+
+		flush_lock(lg);
+		if (res == GDK_SUCCEED) {
+			ATOMIC_SET(&range->flushed_ts, ts);
+			ATOMIC_INC(&lg->nr_syncs);
+			if (batch > lg->max_batch)
+				lg->max_batch = batch;
+		}
+		lg->flush_leader = false;
+		MT_cond_broadcast(&lg->flush_cv);
+		if (res != GDK_SUCCEED)
+			break;
+	}
+	flush_unlock(lg);
+	return res;
+}
+
 static inline void
 log_tdone(logger *lg, logged_range *range, ulng commit_ts)
 {
@@ -3259,18 +3456,21 @@ log_tflush(logger *lg, ulng file_id, ulng commit_ts)
 	}
 
 	log_tdone(lg, frange, commit_ts);
+	frange->grouped++;
+	/* we hold a reference to frange, so its output log stays open
+	 * while we don't hold the rotation lock; release it so that
+	 * other committers can add themselves to the group that is
+	 * made durable by a single sync */
+	rotation_unlock(lg);
 
-	if ((ulng) ATOMIC_GET(&frange->flushed_ts) < commit_ts) {
-		/* delay needed ? */
-
-		flush_lock(lg);
-		/* check it one more time */
-		if ((ulng) ATOMIC_GET(&frange->flushed_ts) < commit_ts)
-			do_flush(frange);
-		flush_unlock(lg);
-	}
+	gdk_return res = GDK_SUCCEED;
+	if ((ulng) ATOMIC_GET(&frange->flushed_ts) < commit_ts)
+		res = log_sync(lg, frange, commit_ts);
 	/* else somebody else has flushed our log file */
+	if (res == GDK_SUCCEED)
+		ATOMIC_INC(&lg->nr_commits);
 
+	rotation_lock(lg);
 	if (ATOMIC_DEC(&frange->refcount) == 1 && !LOG_DISABLED(lg)) {
 		if (frange != lg->current && frange->output_log) {
 			close_stream(frange->output_log);
@@ -3287,7 +3487,7 @@ log_tflush(logger *lg, ulng file_id, ulng commit_ts)
 	}
 	rotation_unlock(lg);
 
-	return GDK_SUCCEED;
+	return res;
 }
 
 static gdk_return
@@ -3513,6 +3713,10 @@ log_printinfo(logger *lg)
 	printf("current transaction id %d, saved transaction id %d\n",
 	       lg->tid, lg->saved_tid);
 	printf("number of flushers: %d\n", (int) ATOMIC_GET(&lg->nr_flushers));
+	printf("group commit: %"PRIu64" transactions in %"PRIu64" log syncs, largest group %"PRIu64"\n",
+	       (uint64_t) ATOMIC_GET(&lg->nr_commits),
+	       (uint64_t) ATOMIC_GET(&lg->nr_syncs),
+	       (uint64_t) lg->max_batch);
 	printf("number of catalog entries "BUNFMT", of which "BUNFMT" deleted\n",
 	       lg->catalog_bid->batCount, lg->dcatalog->batCount);
 	for (logged_range *p = lg->pending; p; p = p->next) {
@@ -21,6 +21,7 @@ typedef struct logged_range_t {
 	ATOMIC_TYPE last_ts;	/* last stored timestamp */
 	ATOMIC_TYPE flushed_ts;
 	ATOMIC_TYPE refcount;
+	ulng grouped;			/* committers waiting for a sync (rotation_lock) */
 	struct logged_range_t *next;
 	stream *output_log;
 	BUN cnt;
@@ -68,6 +69,13 @@ struct logger {
 
 	// atomic
 	ATOMIC_TYPE nr_flushers;
+	ATOMIC_TYPE nr_commits;	/* number of transactions made durable */
+	ATOMIC_TYPE nr_syncs;	/* number of log syncs */
+
+	// group commit, synchronized by flush_lock
+	lng commit_delay;	/* usec the syncing committer waits for others */
+	ulng max_batch;		/* largest group */
+	bool flush_leader;	/* a committer is gathering a group or syncing */
 
 	// synchronized by store->flush
 	bool flushnow;
@@ -91,6 +99,7 @@ struct logger {
 	MT_Lock lock;
 	MT_Lock flush_lock; /* so only one transaction can flush to disk at any given time */
 	MT_Cond excl_flush_cv;
+	MT_Cond flush_cv;	/* signalled when flush_leader is done */
 };
 
 gdk_return log_create_types_file(logger *lg, const char *filename);
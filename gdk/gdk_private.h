@@ -40,6 +40,9 @@ enum heaptype {
 	dataheap
 };
 
+/* partitions of a spilled hash operator, see gdk_spill.c */
+struct spill;
+
 enum range_comp_t {
 	range_before,		/* search range fully before bat range */
 	range_after,		/* search range fully after bat range */
@@ -78,6 +81,9 @@ gdk_return BATgroup_internal(BAT **groups, BAT **extents, BAT **histo, BAT *b, B
 	__attribute__((__visibility__("hidden")));
 Hash *BAThash_impl(BAT *restrict b, struct canditer *restrict ci, const char *restrict ext)
 	__attribute__((__visibility__("hidden")));
+struct spill *BATspillpartition(BAT *b, struct canditer *ci, BAT *g, BUN nparts, bool skipnils, bool withpos)
+	__attribute__((__warn_unused_result__))
+	__attribute__((__visibility__("hidden")));
 void BAThashsave(BAT *b, bool dosync)
 	__attribute__((__visibility__("hidden")));
 bool BATiscand(BAT *b)
@@ -87,7 +93,7 @@ BAT *BATload_intern(bat bid, bool lock)
 gdk_return BATmaterialize(BAT *b, BUN cap)
 	__attribute__((__warn_unused_result__))
 	__attribute__((__visibility__("hidden")));
-gdk_return BATsave_iter(BAT *bd, BATiter *bi, BUN size)
+gdk_return BATsave_iter(BAT *bd, BATiter *bi, BUN size, bool dosync)
 	__attribute__((__visibility__("hidden")));
 void BATsetdims(BAT *b, uint16_t width)
 	__attribute__((__visibility__("hidden")));
@@ -163,6 +169,8 @@ gdk_return GDKremovedir(int farmid, const char *nme)
 gdk_return GDKsave(int farmid, const char *nme, const char *ext, void *buf, size_t size, storage_t mode, bool dosync)
 	__attribute__((__warn_unused_result__))
 	__attribute__((__visibility__("hidden")));
+BUN GDKspillparts(BUN cnt, size_t width, size_t outwidth)
+	__attribute__((__visibility__("hidden")));
 gdk_return GDKssort_rev(void *restrict h, void *restrict t, const void *restrict base, size_t n, int hs, int ts, int tpe)
 	__attribute__((__warn_unused_result__))
 	__attribute__((__visibility__("hidden")));
@@ -234,6 +242,13 @@ void IMPSprint(BAT *b)		/* never called: for debugging only */
 #endif
 double joincost(BAT *r, BUN lcount, struct canditer *rci, bool *hash, bool *phash, bool *cand)
 	__attribute__((__visibility__("hidden")));
+BUN SPILLcount(const struct spill *sp, BUN p)
+	__attribute__((__visibility__("hidden")));
+void SPILLdestroy(struct spill *sp)
+	__attribute__((__visibility__("hidden")));
+gdk_return SPILLget(struct spill *sp, BUN p, BAT **cand, BAT **pos)
+	__attribute__((__warn_unused_result__))
+	__attribute__((__visibility__("hidden")));
 void STRMPincref(Strimps *strimps)
 	__attribute__((__visibility__("hidden")));
 void STRMPdecref(Strimps *strimps, bool remove)
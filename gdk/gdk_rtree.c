@@ -206,13 +206,97 @@ RTREEexists_bid(bat bid)
 	return ret;
 }
 
+/* The rtree is built by inserting the rectangles in
+ * Sort-Tile-Recursive (STR) order: the rectangles are sorted on the x
+ * coordinate of their centre and cut into vertical slices, and each
+ * slice is sorted on the y coordinate of the centre.  Consecutive
+ * rectangles are then close together, so that they end up in the same
+ * nodes of the tree, which gives a much better packed tree (with less
+ * overlap between nodes) than inserting in BAT order.  The slices are
+ * sorted in parallel. */
+#define STR_NODECAP	32	/* assumed number of entries per node */
+
+struct strslices {
+	const mbr *mbrs;
+	flt *keys;
+	BUN *ids;
+	BUN n;
+	BUN slicesize;
+	BUN nslices;
+	ATOMIC_TYPE next;
+};
+
+static void
+STRsortslices(void *arg)
+{
+	struct strslices *ss = arg;
+	ulng s;
+
+	while ((s = ATOMIC_INC(&ss->next) - 1) < (ulng) ss->nslices) {
+		BUN lo = s * ss->slicesize;
+		BUN hi = MIN(lo + ss->slicesize, ss->n);
+		for (BUN i = lo; i < hi; i++) {
+			const mbr *m = &ss->mbrs[ss->ids[i]];
+			ss->keys[i] = is_flt_nil(m->ymin) ? flt_nil : (m->ymin + m->ymax) / 2;
+		}
+		GDKqsort(ss->keys + lo, ss->ids + lo, NULL, hi - lo,
+			 sizeof(flt), sizeof(BUN), TYPE_flt, false, true);
+	}
+}
+
+/* fill ids with the positions in mbrs in STR order */
+static gdk_return
+STRorder(const mbr *mbrs, BUN n, BUN *ids)
+{
+	flt *keys = GDKmalloc(n * sizeof(flt));
+	if (keys == NULL)
+		return GDK_FAIL;
+	for (BUN i = 0; i < n; i++) {
+		ids[i] = i;
+		keys[i] = is_flt_nil(mbrs[i].xmin) ? flt_nil : (mbrs[i].xmin + mbrs[i].xmax) / 2;
+	}
+	GDKqsort(keys, ids, NULL, n, sizeof(flt), sizeof(BUN), TYPE_flt, false, true);
+
+	BUN nleaves = (n + STR_NODECAP - 1) / STR_NODECAP;
+	BUN nslices = (BUN) ceil(sqrt((dbl) nleaves));
+	if (nslices == 0)
+		nslices = 1;
+	struct strslices ss = {
+		.mbrs = mbrs,
+		.keys = keys,
+		.ids = ids,
+		.n = n,
+		.slicesize = (n + nslices - 1) / nslices,
+		.nslices = nslices,
+		.next = ATOMIC_VAR_INIT(0),
+	};
+	MT_Id tids[16];
+	int nw = (int) MIN(MIN((BUN) GDKnr_threads, nslices), (BUN) (sizeof(tids) / sizeof(tids[0]))) - 1;
+	if (n < 65536)
+		nw = 0;		/* not worth it */
+	for (int w = 0; w < nw; w++) {
+		char name[MT_NAME_LEN];
+		snprintf(name, sizeof(name), "STRsort%d", w);
+		if (MT_create_thread(&tids[w], STRsortslices, &ss,
+				     MT_THR_JOINABLE, name) < 0) {
+			nw = w;
+			break;
+		}
+	}
+	STRsortslices(&ss);
+	for (int w = 0; w < nw; w++)
+		MT_join_thread(tids[w]);
+	GDKfree(keys);
+	return GDK_SUCCEED;
+}
+
 gdk_return
 BATrtree(BAT *wkb, BAT *mbrb)
 {
 	BAT *pb;
 	BATiter bi;
 	rtree_t *rtree = NULL;
-	struct canditer ci;
+	BUN *ids;
 
 	//Check for a parent BAT of wkb, load if exists
 	if (VIEWtparent(wkb)) {
@@ -235,17 +319,26 @@ BATrtree(BAT *wkb, BAT *mbrb)
 		//First arg are dimensions: we only allow x, y
 		//Second arg are flags: split strategy and nodes-per-page
 		if ((rtree = rtree_new(2, RTREE_DEFAULT)) == NULL) {
+			MT_lock_unset(&pb->batIdxLock);
 			GDKerror("rtree_new failed\n");
 			return GDK_FAIL;
 		}
 		bi = bat_iterator(mbrb);
-		canditer_init(&ci, mbrb,NULL);
+		const mbr *mbrs = (const mbr *) bi.base;
+		if ((ids = GDKmalloc(bi.count * sizeof(BUN))) == NULL ||
+		    STRorder(mbrs, bi.count, ids) != GDK_SUCCEED) {
+			bat_iterator_end(&bi);
+			GDKfree(ids);
+			rtree_destroy(rtree);
+			MT_lock_unset(&pb->batIdxLock);
+			return GDK_FAIL;
+		}
 
-		for (BUN i = 0; i < ci.ncand; i++) {
-			oid p = canditer_next(&ci) - mbrb->hseqbase;
-			const mbr *inMBR = (const mbr *)BUNtail(bi, p);
+		for (BUN i = 0; i < bi.count; i++) {
+			const mbr *inMBR = &mbrs[ids[i]];
 
-			rtree_id_t rtree_id = i;
+			//The id is the position of the rectangle in the BAT
+			rtree_id_t rtree_id = ids[i];
 			rtree_coord_t rect[4];
 			rect[0] = inMBR->xmin;
 			rect[1] = inMBR->ymin;
@@ -254,6 +347,7 @@ BATrtree(BAT *wkb, BAT *mbrb)
 			rtree_add_rect(rtree,rtree_id,rect);
 		}
 		bat_iterator_end(&bi);
+		GDKfree(ids);
 		pb->trtree = GDKmalloc(sizeof(struct RTree));
 		*pb->trtree = (struct RTree) {
 			.rtree = rtree,
@@ -386,6 +480,139 @@ RTREEsearch(BAT *b, const void *inMBRptr, int result_limit)
 	} else
 		return NULL;
 }
+
+struct knn_window {
+	BUN *ids;
+	BUN n;
+	BUN size;
+	bool failed;
+};
+
+static int
+knn_collect(rtree_id_t id, void *context)
+{
+	struct knn_window *w = (struct knn_window *) context;
+	if (w->n == w->size) {
+		BUN *ids = GDKrealloc(w->ids, (w->size *= 2) * SIZEOF_BUN);
+		if (ids == NULL) {
+			w->failed = true;
+			return 1;
+		}
+		w->ids = ids;
+	}
+	w->ids[w->n++] = (BUN) id;
+	return 0;
+}
+
+//Find the k nearest neighbours of inMBR according to the distance
+//function dist, which is called with ctx and the position of an entry
+//in the BAT.  The distance must not be smaller than the gap between
+//inMBR and the rectangle of the entry (which holds for the geometric
+//distance), and is dbl_nil for entries that should be skipped.
+//The search is done with windows around inMBR of increasing size
+//until the window contains k entries whose distance is at most the
+//size of the window.
+//Returns an array of at most k positions ordered on distance and
+//terminated by BUN_NONE.
+BUN*
+RTREEknn(BAT *b, const void *inMBRptr, int k, dbl (*dist)(void *ctx, BUN p), void *ctx)
+{
+	BAT *pb;
+	const mbr *inMBR = inMBRptr;
+	if (VIEWtparent(b)) {
+		pb = BBP_desc(VIEWtparent(b));
+	} else {
+		pb = b;
+	}
+
+	if (k < 0)
+		return NULL;
+	//Take the reference while holding the lock, so that the RTree
+	//cannot be destroyed before we are done with it
+	MT_lock_set(&pb->batIdxLock);
+	if (pb->trtree == NULL && BATcheckrtree(pb) != GDK_SUCCEED) {
+		MT_lock_unset(&pb->batIdxLock);
+		return NULL;
+	}
+	rtree_t *rtree = pb->trtree ? pb->trtree->rtree : NULL;
+	if (rtree == NULL) {
+		MT_lock_unset(&pb->batIdxLock);
+		return NULL;
+	}
+	RTREEincref(pb);
+	MT_lock_unset(&pb->batIdxLock);
+
+	BUN total = BATcount(pb);
+	BUN *best = GDKmalloc((k + 1) * SIZEOF_BUN);
+	dbl *bestd = GDKmalloc((k + 1) * sizeof(dbl));
+	struct knn_window w = {
+		.ids = GDKmalloc(1024 * SIZEOF_BUN),
+		.size = 1024,
+	};
+	if (best == NULL || bestd == NULL || w.ids == NULL) {
+		RTREEdecref(pb);
+		GDKfree(best);
+		GDKfree(bestd);
+		GDKfree(w.ids);
+		return NULL;
+	}
+
+	//Initial size of the window: the size of the query rectangle,
+	//or, for a point, a small fraction of the magnitude of the
+	//coordinates
+	dbl r = MAX(inMBR->xmax - inMBR->xmin, inMBR->ymax - inMBR->ymin);
+	if (r <= 0)
+		r = MAX(MAX(fabs(inMBR->xmin), fabs(inMBR->ymin)), 1.0) / 65536;
+
+	int nbest = 0;
+	for (;;) {
+		rtree_coord_t rect[4];
+		rect[0] = (rtree_coord_t) (inMBR->xmin - r);
+		rect[1] = (rtree_coord_t) (inMBR->ymin - r);
+		rect[2] = (rtree_coord_t) (inMBR->xmax + r);
+		rect[3] = (rtree_coord_t) (inMBR->ymax + r);
+
+		w.n = 0;
+		if (rtree_search(rtree, (const rtree_coord_t*) rect, knn_collect, &w) != 0 || w.failed) {
+			GDKerror("rtree_search failed\n");
+			nbest = -1;
+			break;
+		}
+		//Keep the k nearest entries of the window, sorted on distance
+		nbest = 0;
+		for (BUN i = 0; i < w.n; i++) {
+			dbl d = (*dist)(ctx, w.ids[i]);
+			if (is_dbl_nil(d) || (nbest == k && d >= bestd[k - 1]))
+				continue;
+			int j = nbest < k ? nbest++ : k - 1;
+			while (j > 0 && bestd[j - 1] > d) {
+				bestd[j] = bestd[j - 1];
+				best[j] = best[j - 1];
+				j--;
+			}
+			bestd[j] = d;
+			best[j] = w.ids[i];
+		}
+		//Everything that is closer than the k-th entry is inside the
+		//window if that distance is at most r
+		if ((nbest == k && (k == 0 || bestd[k - 1] <= r)) ||
+		    w.n >= total || r >= FLT_MAX)
+			break;
+		if (nbest == k)
+			r = bestd[k - 1];
+		else
+			r = MIN(r * 4, FLT_MAX);
+	}
+	RTREEdecref(pb);
+	GDKfree(w.ids);
+	GDKfree(bestd);
+	if (nbest < 0) {
+		GDKfree(best);
+		return NULL;
+	}
+	best[nbest] = BUN_NONE;
+	return best;
+}
 #else
 void
 RTREEdestroy(BAT *b)
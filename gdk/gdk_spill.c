@@ -0,0 +1,355 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+/*
+ * Partitioned ("grace hash") processing of hash based operators.
+ *
+ * When the hash table that BATjoin or BATgroup would need to build
+ * does not fit in the memory budget of the query, we don't want to
+ * rely on the OS pager to page the randomly accessed hash heaps in and
+ * out.  Instead, the input is split on the (high bits of the) hash
+ * value into a number of partitions in a single sequential pass.  The
+ * partitions (lists of candidate oids) are written sequentially to
+ * files in the TEMP_DATA directory of the transient farm, and read
+ * back one at a time, so that only the data and the hash table of a
+ * single partition need to be in memory at any one time.
+ *
+ * The TEMP_DATA directory is removed when the server starts, so files
+ * that are left behind after a crash are cleaned up.
+ */
+
+#include "monetdb_config.h"
+#include "gdk.h"
+#include "gdk_private.h"
+#include "gdk_cand.h"
+#include "mutils.h"
+
+/* don't bother partitioning inputs smaller than this */
+#define SPILL_MINSIZE	((BUN) 1 << 16)
+/* never create more than this many partitions (each is an open file
+ * while partitioning) */
+#define SPILL_MAXPARTS	((BUN) 1 << 8)
+/* number of oids in the write buffer of each partition */
+#define SPILL_BUFCNT	((size_t) 1 << 11)
+
+struct spill {
+	int farmid;
+	BUN nparts;
+	bool withpos;
+	char name[32];
+	BUN *cnts;
+};
+
+static ATOMIC_TYPE spillctr = ATOMIC_VAR_INIT(0);
+
+/* Return the number of partitions (a power of two) into which an
+ * operator on cnt rows which needs about width bytes of working
+ * memory per row should be split in order to stay within the memory
+ * budget.  Of that, outwidth bytes per row are needed for the result
+ * and are therefore needed whether or not we partition.  The budget
+ * is the smaller of the memory that is still available to the server
+ * and the memory that is left of the query's own limit (if any).  A
+ * return value of 1 means no partitioning is needed (or possible). */
+BUN
+GDKspillparts(BUN cnt, size_t width, size_t outwidth)
+{
+	if (cnt < SPILL_MINSIZE || GDKinmemory(0))
+		return 1;
+
+	size_t need = (size_t) cnt * width;
+	size_t cur = GDKmem_cursize();
+	size_t budget = GDK_mem_maxsize > cur ? GDK_mem_maxsize - cur : 0;
+	QryCtx *qc = MT_thread_get_qry_ctx();
+	if (qc && qc->maxmem > 0) {
+		ATOMIC_BASE_TYPE used = ATOMIC_GET(&qc->datasize);
+		size_t avail = qc->maxmem > used ? (size_t) (qc->maxmem - used) : 0;
+		if (avail < budget)
+			budget = avail;
+	}
+	/* other operators in the same query (and other queries) also
+	 * need memory, so only claim part of what is left */
+	budget /= 2;
+	if (need <= budget)
+		return 1;
+	/* the result doesn't get smaller by partitioning */
+	size_t out = (size_t) cnt * outwidth;
+	budget = budget > out ? budget - out : 0;
+	need = need > out ? need - out : 0;
+
+	BUN nparts = 2;
+	while (nparts < SPILL_MAXPARTS && need / nparts > budget)
+		nparts <<= 1;
+	/* partitions that are too small aren't worth the overhead */
+	while (nparts > 2 && cnt / nparts < SPILL_MINSIZE / 16)
+		nparts >>= 1;
+	TRC_DEBUG(ALGO, "cnt=" BUNFMT ",width=%zu,budget=%zu -> " BUNFMT " partitions\n", cnt, width, budget, nparts);
+	return nparts;
+}
+
+static char *
+spillpath(const struct spill *sp, BUN p)
+{
+	char name[64];
+
+	if (snprintf(name, sizeof(name), "%s_" BUNFMT, sp->name, p) >= (int) sizeof(name)) {
+		GDKerror("spill file name too long\n");
+		return NULL;
+	}
+	return GDKfilepath(sp->farmid, TEMPDIR, name, "spill");
+}
+
+/* Split the candidates ci of b into nparts (a power of two)
+ * partitions based on the hash value of the tail value of b, and write
+ * them to disk.  If g is not NULL, it is aligned with ci and contains
+ * group ids which are included in the hash, so that all values of one
+ * (sub)group end up in the same partition.  If skipnils is set, nil
+ * values are not placed in any partition.  If withpos is set, the
+ * zero-based positions within ci of the candidates are saved as well.
+ * The partitions can be retrieved with SPILLget. */
+struct spill *
+BATspillpartition(BAT *b, struct canditer *ci, BAT *g, BUN nparts,
+		  bool skipnils, bool withpos)
+{
+	lng t0 = 0;
+	BATiter bi;
+	struct spill *sp;
+	FILE **fps;
+	oid *bufs;
+	size_t *bufcnts;
+	int bits = 0;
+	int tpe = ATOMbasetype(b->ttype);
+	const void *nil = ATOMnilptr(b->ttype);
+	int (*cmp)(const void *, const void *) = ATOMcompare(b->ttype);
+	const oid *grps = NULL;
+	BUN p;
+
+	TRC_DEBUG_IF(ALGO) t0 = GDKusec();
+
+	assert(nparts > 1 && (nparts & (nparts - 1)) == 0);
+	assert(b->ttype != TYPE_void);
+	assert(g == NULL || BATcount(g) == ci->ncand);
+	while (((BUN) 1 << bits) < nparts)
+		bits++;
+
+	sp = GDKmalloc(sizeof(struct spill));
+	fps = GDKzalloc(nparts * (sizeof(FILE *) + sizeof(size_t)));
+	bufs = GDKmalloc(nparts * SPILL_BUFCNT * sizeof(oid));
+	if (sp == NULL || fps == NULL || bufs == NULL) {
+		GDKfree(sp);
+		GDKfree(fps);
+		GDKfree(bufs);
+		return NULL;
+	}
+	bufcnts = (size_t *) (fps + nparts);
+	*sp = (struct spill) {
+		.farmid = BBPselectfarm(TRANSIENT, TYPE_oid, offheap),
+		.nparts = nparts,
+		.withpos = withpos,
+		.cnts = GDKzalloc(nparts * sizeof(BUN)),
+	};
+	if (sp->cnts == NULL) {
+		GDKfree(sp);
+		GDKfree(fps);
+		GDKfree(bufs);
+		return NULL;
+	}
+	snprintf(sp->name, sizeof(sp->name), "spill%x_%x",
+		 (unsigned) MT_getpid(),
+		 (unsigned) ATOMIC_INC(&spillctr));
+	for (p = 0; p < nparts; p++) {
+		char *path = spillpath(sp, p);
+		if (path == NULL)
+			goto bailout;
+		if (p == 0 && GDKcreatedir(path) != GDK_SUCCEED) {
+			GDKfree(path);
+			goto bailout;
+		}
+		fps[p] = MT_fopen(path, "wb");
+		if (fps[p] == NULL) {
+			GDKsyserror("cannot create spill file %s\n", path);
+			GDKfree(path);
+			goto bailout;
+		}
+		GDKfree(path);
+		/* we do our own buffering */
+		setvbuf(fps[p], NULL, _IONBF, 0);
+	}
+
+	QryCtx *qry_ctx = MT_thread_get_qry_ctx();
+
+	if (g)
+		grps = (const oid *) Tloc(g, 0);
+	bi = bat_iterator(b);
+	canditer_reset(ci);
+	TIMEOUT_LOOP_IDX_DECL(i, ci->ncand, qry_ctx) {
+		oid o = canditer_next(ci);
+		const void *v = BUNtail(bi, o - b->hseqbase);
+		if (skipnils && (*cmp)(v, nil) == 0)
+			continue;
+		ulng h = (ulng) ATOMhash(tpe, v);
+		if (grps)
+			h ^= (ulng) grps[i] * UINT64_C(0xC2B2AE3D27D4EB4F);
+		/* use the high bits of a multiplicative hash so that
+		 * the partition number is independent of the bucket
+		 * number that is used within the partition */
+		p = (BUN) ((h * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - bits));
+		oid *buf = bufs + p * SPILL_BUFCNT;
+		if (bufcnts[p] + 2 > SPILL_BUFCNT) {
+			if (fwrite(buf, sizeof(oid), bufcnts[p], fps[p]) != bufcnts[p]) {
+				GDKsyserror("writing spill file failed\n");
+				bat_iterator_end(&bi);
+				goto bailout;
+			}
+			bufcnts[p] = 0;
+		}
+		buf[bufcnts[p]++] = o;
+		if (withpos)
+			buf[bufcnts[p]++] = (oid) i;
+		sp->cnts[p]++;
+	}
+	bat_iterator_end(&bi);
+	TIMEOUT_CHECK(qry_ctx, GOTO_LABEL_TIMEOUT_HANDLER(bailout, qry_ctx));
+
+	for (p = 0; p < nparts; p++) {
+		bool ok = fwrite(bufs + p * SPILL_BUFCNT, sizeof(oid), bufcnts[p], fps[p]) == bufcnts[p];
+		if (fclose(fps[p]) != 0)
+			ok = false;
+		fps[p] = NULL;
+		if (!ok) {
+			GDKsyserror("writing spill file failed\n");
+			goto bailout;
+		}
+	}
+	GDKfree(fps);
+	GDKfree(bufs);
+	TRC_DEBUG(ALGO, "b=" ALGOBATFMT ",s=" ALGOOPTBATFMT
+		  ",g=" ALGOOPTBATFMT ",nparts=" BUNFMT ",name=%s"
+		  " (" LLFMT " usec)\n",
+		  ALGOBATPAR(b), ALGOOPTBATPAR(ci->s), ALGOOPTBATPAR(g),
+		  nparts, sp->name, GDKusec() - t0);
+	return sp;
+
+  bailout:
+	for (p = 0; p < nparts; p++) {
+		if (fps[p])
+			fclose(fps[p]);
+	}
+	GDKfree(fps);
+	GDKfree(bufs);
+	SPILLdestroy(sp);
+	return NULL;
+}
+
+/* Return the number of candidates in partition p. */
+BUN
+SPILLcount(const struct spill *sp, BUN p)
+{
+	assert(p < sp->nparts);
+	return sp->cnts[p];
+}
+
+/* Read partition p back from disk and remove its file.  The
+ * candidates are returned in *cand and, if the partitioning was done
+ * with positions, the positions in *pos. */
+gdk_return
+SPILLget(struct spill *sp, BUN p, BAT **cand, BAT **pos)
+{
+	BAT *bn = NULL, *pn = NULL;
+	BUN n = sp->cnts[p];
+	char *path;
+	FILE *fp;
+
+	assert(p < sp->nparts);
+	assert(pos == NULL || sp->withpos);
+	if ((path = spillpath(sp, p)) == NULL)
+		return GDK_FAIL;
+	bn = COLnew(0, TYPE_oid, n, TRANSIENT);
+	if (bn == NULL ||
+	    (pos && (pn = COLnew(0, TYPE_oid, n, TRANSIENT)) == NULL)) {
+		BBPreclaim(bn);
+		GDKfree(path);
+		return GDK_FAIL;
+	}
+	if ((fp = MT_fopen(path, "rb")) == NULL) {
+		GDKsyserror("cannot open spill file %s\n", path);
+		goto bailout;
+	}
+	if (sp->withpos) {
+		oid *o = (oid *) Tloc(bn, 0);
+		oid *q = pn ? (oid *) Tloc(pn, 0) : NULL;
+		oid buf[2 * 1024];
+		BUN i = 0;
+		while (i < n) {
+			size_t k = MIN(n - i, 1024);
+			if (fread(buf, 2 * sizeof(oid), k, fp) != k) {
+				GDKsyserror("reading spill file %s failed\n", path);
+				fclose(fp);
+				goto bailout;
+			}
+			for (size_t j = 0; j < k; j++, i++) {
+				o[i] = buf[2 * j];
+				if (q)
+					q[i] = buf[2 * j + 1];
+			}
+		}
+	} else if (fread(Tloc(bn, 0), sizeof(oid), n, fp) != n) {
+		GDKsyserror("reading spill file %s failed\n", path);
+		fclose(fp);
+		goto bailout;
+	}
+	fclose(fp);
+	(void) MT_remove(path);
+	GDKfree(path);
+
+	BATsetcount(bn, n);
+	bn->tsorted = true;
+	bn->trevsorted = n <= 1;
+	bn->tkey = true;
+	bn->tnonil = true;
+	bn->tnil = false;
+	bn->tseqbase = n == 0 ? 0 : oid_nil;
+	*cand = bn;
+	if (pos) {
+		BATsetcount(pn, n);
+		pn->tsorted = true;
+		pn->trevsorted = n <= 1;
+		pn->tkey = true;
+		pn->tnonil = true;
+		pn->tnil = false;
+		pn->tseqbase = n == 0 ? 0 : oid_nil;
+		*pos = pn;
+	}
+	return GDK_SUCCEED;
+
+  bailout:
+	GDKfree(path);
+	BBPreclaim(bn);
+	BBPreclaim(pn);
+	return GDK_FAIL;
+}
+
+/* Remove any remaining partition files and free the administration. */
+void
+SPILLdestroy(struct spill *sp)
+{
+	if (sp == NULL)
+		return;
+	for (BUN p = 0; p < sp->nparts; p++) {
+		char *path = spillpath(sp, p);
+		if (path) {
+			(void) MT_remove(path);
+			GDKfree(path);
+		}
+	}
+	GDKfree(sp->cnts);
+	GDKfree(sp);
+}
@@ -667,10 +667,9 @@ DESCload(int i)
 }
 
 gdk_return
-BATsave_iter(BAT *b, BATiter *bi, BUN size)
+BATsave_iter(BAT *b, BATiter *bi, BUN size, bool dosync)
 {
 	gdk_return err = GDK_SUCCEED;
-	bool dosync;
 	bool locked = false;
 
 	BATcheck(b, GDK_FAIL);
@@ -678,7 +677,7 @@ BATsave_iter(BAT *b, BATiter *bi, BUN size)
 	if (MT_rwlock_rdtry(&b->thashlock))
 		locked = true;
 
-	dosync = (BBP_status(b->batCacheid) & BBPPERSISTENT) != 0;
+	dosync &= (BBP_status(b->batCacheid) & BBPPERSISTENT) != 0;
 	assert(!GDKinmemory(bi->h->farmid));
 	/* views cannot be saved, but make an exception for
 	 * force-remapped views */
@@ -787,7 +786,7 @@ BATsave(BAT *b)
 	gdk_return rc;
 
 	BATiter bi = bat_iterator(b);
-	rc = BATsave_iter(b, &bi, bi.count);
+	rc = BATsave_iter(b, &bi, bi.count, true);
 	bat_iterator_end(&bi);
 	return rc;
 }
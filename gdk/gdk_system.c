@@ -1205,6 +1205,90 @@ MT_check_nr_cores(void)
 	return ncpus;
 }
 
+#if defined(__linux__) && defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_SETAFFINITY_NP)
+#define MT_MAX_NUMA_NODES 64
+static cpu_set_t numa_cpus[MT_MAX_NUMA_NODES];
+static int numa_nodes = -1;
+static MT_Lock numa_lock = MT_LOCK_INITIALIZER(numa_lock);
+
+/* parse a sysfs cpu list (e.g. "0-7,16-23") into a cpu set */
+static bool
+parse_cpulist(const char *p, cpu_set_t *set)
+{
+	CPU_ZERO(set);
+	for (;;) {
+		char *q;
+		unsigned fst = strtoul(p, &q, 10), lst;
+		if (q == p)
+			return false;
+		lst = fst;
+		if (*q == '-') {
+			p = q + 1;
+			lst = strtoul(p, &q, 10);
+			if (q == p || lst < fst)
+				return false;
+		}
+		for (; fst <= lst && fst < CPU_SETSIZE; fst++)
+			CPU_SET(fst, set);
+		if (*q == '\n' || *q == 0)
+			return CPU_COUNT(set) > 0;
+		if (*q != ',')
+			return false;
+		p = q + 1;
+	}
+}
+#endif
+
+/* Return the number of NUMA nodes that have CPUs, or 1 if this cannot
+ * be determined. */
+int
+MT_numa_nodes(void)
+{
+#if defined(__linux__) && defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_SETAFFINITY_NP)
+	MT_lock_set(&numa_lock);
+	if (numa_nodes < 0) {
+		numa_nodes = 0;
+		for (int n = 0; n < MT_MAX_NUMA_NODES; n++) {
+			char path[64], buf[1024];
+			snprintf(path, sizeof(path),
+					 "/sys/devices/system/node/node%d/cpulist", n);
+			FILE *f = fopen(path, "r");
+			if (f == NULL)
+				break;
+			char *p = fgets(buf, sizeof(buf), f);
+			fclose(f);
+			/* nodes without CPUs (memory only) are skipped */
+			if (p != NULL && parse_cpulist(p, &numa_cpus[numa_nodes]))
+				numa_nodes++;
+		}
+	}
+	int n = numa_nodes;
+	MT_lock_unset(&numa_lock);
+	return n > 0 ? n : 1;
+#else
+	return 1;
+#endif
+}
+
+/* Restrict the calling thread to the CPUs of the given NUMA node (as
+ * counted by MT_numa_nodes).  Memory the thread touches first is then
+ * allocated on that node by the kernel. */
+int
+MT_thread_bind_node(int node)
+{
+#if defined(__linux__) && defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_SETAFFINITY_NP)
+	if (node < 0 || node >= MT_numa_nodes())
+		return -1;
+	if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+							   &numa_cpus[node]) != 0)
+		return -1;
+	return 0;
+#else
+	(void) node;
+	return -1;
+#endif
+}
+
 
 void
 MT_cond_init(MT_Cond *cond)
@@ -1239,6 +1323,38 @@ MT_cond_wait(MT_Cond *cond, MT_Lock *lock)
 	MT_thread_setcondwait(NULL);
 }
 
+/* Like MT_cond_wait, but wait at most usec microseconds.  Returns
+ * false if the time ran out before the condition was signalled. */
+bool
+MT_cond_timedwait(MT_Cond *cond, MT_Lock *lock, lng usec)
+{
+	bool signalled;
+
+	MT_thread_setcondwait(cond);
+#if !defined(HAVE_PTHREAD_H) && defined(WIN32)
+	signalled = SleepConditionVariableCS(&cond->cv, &lock->lock, (DWORD) ((usec + 999) / 1000));
+#else
+	struct timespec ts;
+#ifdef HAVE_CLOCK_GETTIME
+	clock_gettime(CLOCK_REALTIME, &ts);
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	ts.tv_sec = tv.tv_sec;
+	ts.tv_nsec = tv.tv_usec * 1000;
+#endif
+	ts.tv_sec += (time_t) (usec / 1000000);
+	ts.tv_nsec += (long) (usec % 1000000) * 1000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	signalled = pthread_cond_timedwait(&cond->cv, &lock->lock, &ts) == 0;
+#endif
+	MT_thread_setcondwait(NULL);
+	return signalled;
+}
+
 void
 MT_cond_signal(MT_Cond *cond)
 {
@@ -816,6 +816,8 @@ hide_exp(gdk_ex,port) void MT_thread_del_mylock(MT_Lock *lock);
 #endif
 
 gdk_export int MT_check_nr_cores(void);
+gdk_export int MT_numa_nodes(void);
+gdk_export int MT_thread_bind_node(int node);
 
 /*
  * @ Condition Variable API
@@ -839,6 +841,7 @@ typedef struct MT_Cond {
 gdk_export void MT_cond_init(MT_Cond *cond);
 gdk_export void MT_cond_destroy(MT_Cond *cond);
 gdk_export void MT_cond_wait(MT_Cond *cond, MT_Lock *lock);
+gdk_export bool MT_cond_timedwait(MT_Cond *cond, MT_Lock *lock, lng usec);
 gdk_export void MT_cond_signal(MT_Cond *cond);
 gdk_export void MT_cond_broadcast(MT_Cond *cond);
 
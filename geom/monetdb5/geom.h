@@ -230,6 +230,8 @@ geom_export str wkbDWithinSelectRTree(bat* outid, const bat *bid , const bat *si
 
 geom_export str wkbDWithinJoinNoIndex(bat *lres_id, bat *rres_id, const bat *l_id, const bat *r_id, const bat *ls_id, const bat *rs_id, double *distance, bit *nil_matches, lng *estimate, bit *anti);
 geom_export str wkbDWithinSelectNoIndex(bat* outid, const bat *bid , const bat *sid, wkb **wkb_const, double *distance, bit *anti);
+geom_export str wkbKNN(bat *outid, const bat *bid, wkb **wkb_const, int *k);
+geom_export str wkbKNNSelect(bat *outid, const bat *bid, const bat *sid, wkb **wkb_const, lng *k, bit *nils);
 
 geom_export str mbrIntersects(bit* out, mbr** mbr1, mbr** mbr2);
 
@@ -261,6 +261,240 @@ wkbDWithinSelectNoIndex(bat* outid, const bat *bid , const bat *sid, wkb **wkb_c
 	return filterSelectNoIndex(outid,bid,sid,*wkb_const,*distance,*anti,GEOSDistanceWithin_r,"geom.wkbIntersectsSelectNoIndex");
 }
 
+/* k nearest neighbours */
+struct knnctx {
+	BATiter bi;
+	GEOSGeom q;
+	bool srid_mismatch;
+	bool failed;
+};
+
+//Distance between the constant geometry and the geometry at position p
+static dbl
+knnDistance(void *ctx, BUN p)
+{
+	struct knnctx *kc = ctx;
+	const wkb *w = BUNtvar(kc->bi, p);
+	GEOSGeom g;
+	double d;
+
+	if (is_wkb_nil(w) || (g = wkb2geos(w)) == NULL)
+		return dbl_nil;
+	if (GEOSGetSRID_r(geoshandle, g) != GEOSGetSRID_r(geoshandle, kc->q)) {
+		kc->srid_mismatch = true;
+		d = dbl_nil;
+	} else if (!GEOSDistance_r(geoshandle, g, kc->q, &d)) {
+		kc->failed = true;
+		d = dbl_nil;
+	}
+	GEOSGeom_destroy_r(geoshandle, g);
+	return d;
+}
+
+//Without an index: calculate the distances of all candidates and keep
+//the k smallest
+static BUN *
+knnNoIndex(struct knnctx *kc, struct canditer *ci, oid hseqbase, int k)
+{
+	BUN *best = GDKmalloc((k + 1) * SIZEOF_BUN);
+	dbl *bestd = GDKmalloc((k + 1) * sizeof(dbl));
+	int nbest = 0;
+
+	if (best == NULL || bestd == NULL) {
+		GDKfree(best);
+		GDKfree(bestd);
+		return NULL;
+	}
+	for (BUN i = 0; i < ci->ncand && !kc->srid_mismatch && !kc->failed; i++) {
+		BUN p = canditer_next(ci) - hseqbase;
+		dbl d = knnDistance(kc, p);
+		if (is_dbl_nil(d) || k == 0 || (nbest == k && d >= bestd[k - 1]))
+			continue;
+		int j = nbest < k ? nbest++ : k - 1;
+		while (j > 0 && bestd[j - 1] > d) {
+			bestd[j] = bestd[j - 1];
+			best[j] = best[j - 1];
+			j--;
+		}
+		bestd[j] = d;
+		best[j] = p;
+	}
+	best[nbest] = BUN_NONE;
+	GDKfree(bestd);
+	return best;
+}
+
+//Find the (at most) k candidates of b that are nearest to the constant
+//geometry.  The result are positions in b ordered on distance and
+//terminated by BUN_NONE.  The RTree doesn't know about candidates, so
+//it can only be used if all of b is a candidate.
+static str
+knnSearch(BUN **res, BAT *b, BAT *s, wkb *wkb_const, int k, const char *name)
+{
+	struct knnctx kc = { .q = NULL };
+	struct canditer ci;
+	str msg = MAL_SUCCEED;
+
+	*res = NULL;
+	if (is_int_nil(k) || k < 0)
+		throw(MAL, name, SQLSTATE(42000) "Number of neighbours must be a non-negative integer");
+	if (is_wkb_nil(wkb_const) || (kc.q = wkb2geos(wkb_const)) == NULL) {
+		if ((*res = GDKmalloc(SIZEOF_BUN)) == NULL)
+			throw(MAL, name, SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		(*res)[0] = BUN_NONE;
+		return MAL_SUCCEED;
+	}
+	kc.bi = bat_iterator(b);
+	canditer_init(&ci, b, s);
+#ifdef HAVE_RTREE
+	if (ci.ncand == kc.bi.count && RTREEexists(b)) {
+		mbr *const_mbr = NULL;
+		if ((msg = wkbMBR(&const_mbr, &wkb_const)) == MAL_SUCCEED) {
+			*res = RTREEknn(b, const_mbr, k, knnDistance, &kc);
+			GDKfree(const_mbr);
+		}
+	} else
+#endif
+		*res = knnNoIndex(&kc, &ci, b->hseqbase, k);
+	bat_iterator_end(&kc.bi);
+	GEOSGeom_destroy_r(geoshandle, kc.q);
+	if (msg == MAL_SUCCEED) {
+		if (kc.srid_mismatch)
+			msg = createException(MAL, name, SQLSTATE(38000) "Geometries of different SRID");
+		else if (kc.failed)
+			msg = createException(MAL, name, SQLSTATE(38000) "Geos operation GEOSDistance failed");
+		else if (*res == NULL)
+			msg = createException(MAL, name, GDK_EXCEPTION);
+	}
+	if (msg != MAL_SUCCEED) {
+		GDKfree(*res);
+		*res = NULL;
+	}
+	return msg;
+}
+
+//Returns the oids of the k geometries of b that are nearest to the
+//constant geometry, ordered on distance.  If b has an RTree, it is
+//used to only look at the geometries close to the constant.
+str
+wkbKNN(bat *outid, const bat *bid, wkb **wkb_const, int *k)
+{
+	BAT *b, *out;
+	BUN *res;
+	str msg;
+
+	if ((b = BATdescriptor(*bid)) == NULL)
+		throw(MAL, "rtree.knn", SQLSTATE(HY002) RUNTIME_OBJECT_MISSING);
+	if ((msg = knnSearch(&res, b, NULL, *wkb_const, *k, "rtree.knn")) != MAL_SUCCEED) {
+		BBPunfix(b->batCacheid);
+		return msg;
+	}
+
+	BUN n = 0;
+	while (res[n] != BUN_NONE)
+		n++;
+	if ((out = COLnew(0, TYPE_oid, n, TRANSIENT)) == NULL) {
+		GDKfree(res);
+		BBPunfix(b->batCacheid);
+		throw(MAL, "rtree.knn", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	}
+	oid *o = (oid *) Tloc(out, 0);
+	for (BUN i = 0; i < n; i++)
+		o[i] = b->hseqbase + res[i];
+	BATsetcount(out, n);
+	out->tsorted = n <= 1;
+	out->trevsorted = n <= 1;
+	out->tkey = true;
+	out->tnonil = true;
+	out->tnil = false;
+	GDKfree(res);
+	BBPunfix(b->batCacheid);
+	*outid = out->batCacheid;
+	BBPkeepref(out);
+	return MAL_SUCCEED;
+}
+
+//Select the k candidates of b that are nearest to the constant geometry,
+//and with nils, or when fewer than k are found, also the candidates whose
+//distance is NULL.  It gives the rows that ORDER BY ST_Distance(b, c)
+//LIMIT k needs to look at: the distances are NULL for all rows if c is
+//NULL, and NULLs sort first unless NULLS LAST is asked for.  The result
+//is a candidate list, i.e. sorted on oid.
+str
+wkbKNNSelect(bat *outid, const bat *bid, const bat *sid, wkb **wkb_const, lng *k, bit *nils)
+{
+	BAT *b, *s = NULL, *out;
+	struct canditer ci;
+	BUN *res;
+	str msg;
+
+	if ((b = BATdescriptor(*bid)) == NULL)
+		throw(MAL, "rtree.knnselect", SQLSTATE(HY002) RUNTIME_OBJECT_MISSING);
+	if (sid && !is_bat_nil(*sid) && (s = BATdescriptor(*sid)) == NULL) {
+		BBPunfix(b->batCacheid);
+		throw(MAL, "rtree.knnselect", SQLSTATE(HY002) RUNTIME_OBJECT_MISSING);
+	}
+	canditer_init(&ci, b, s);
+	if (is_lng_nil(*k) || *k < 0) {
+		BBPunfix(b->batCacheid);
+		BBPreclaim(s);
+		throw(MAL, "rtree.knnselect", SQLSTATE(42000) "Number of neighbours must be a non-negative integer");
+	}
+	if ((ulng) *k >= ci.ncand || *k > INT_MAX || is_wkb_nil(*wkb_const)) {
+		//all candidates qualify, all distances are NULL for a NULL geometry
+		out = s ? s : BATdense(0, b->hseqbase, BATcount(b));
+		BBPunfix(b->batCacheid);
+		if (out == NULL)
+			throw(MAL, "rtree.knnselect", GDK_EXCEPTION);
+		*outid = out->batCacheid;
+		BBPkeepref(out);
+		return MAL_SUCCEED;
+	}
+	if ((msg = knnSearch(&res, b, s, *wkb_const, (int) *k, "rtree.knnselect")) != MAL_SUCCEED) {
+		BBPunfix(b->batCacheid);
+		BBPreclaim(s);
+		return msg;
+	}
+
+	BUN n = 0;
+	while (res[n] != BUN_NONE)
+		n++;
+	if ((out = COLnew(0, TYPE_oid, n, TRANSIENT)) == NULL) {
+		GDKfree(res);
+		BBPunfix(b->batCacheid);
+		BBPreclaim(s);
+		throw(MAL, "rtree.knnselect", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	}
+	oid *o = (oid *) Tloc(out, 0);
+	for (BUN i = 0; i < n; i++)
+		o[i] = b->hseqbase + res[i];
+	GDKfree(res);
+	GDKqsort(o, NULL, NULL, n, sizeof(oid), 0, TYPE_oid, false, false);
+	BATsetcount(out, n);
+	out->tsorted = true;
+	out->trevsorted = n <= 1;
+	out->tkey = true;
+	out->tnonil = true;
+	out->tnil = false;
+	//the NULL distances also come after the nearest when there are fewer than k
+	if (*nils || n < (BUN) *k) {
+		BAT *nb = BATselect(b, s, ATOMnilptr(b->ttype), NULL, true, true, false, false);
+		BAT *r = nb ? BATmergecand(out, nb) : NULL;
+		BBPreclaim(nb);
+		BBPreclaim(out);
+		if ((out = r) == NULL) {
+			BBPunfix(b->batCacheid);
+			BBPreclaim(s);
+			throw(MAL, "rtree.knnselect", GDK_EXCEPTION);
+		}
+	}
+	BBPunfix(b->batCacheid);
+	BBPreclaim(s);
+	*outid = out->batCacheid;
+	BBPkeepref(out);
+	return MAL_SUCCEED;
+}
+
 static str
 filterJoinNoIndex(bat *lres_id, bat *rres_id, const bat *l_id, const bat *r_id, double double_flag, const bat *ls_id, const bat *rs_id, bit nil_matches, lng estimate, bit anti, char (*func) (GEOSContextHandle_t handle, const GEOSGeometry *, const GEOSGeometry *, double), const char *name)
 {
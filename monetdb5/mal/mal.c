@@ -38,6 +38,7 @@ lng MALdebug;
 #include "mal_internal.h"
 #include "mal_runtime.h"
 #include "mal_resource.h"
+#include "mal_recycle.h"
 #include "mal_atom.h"
 #include "mutils.h"
 
@@ -93,6 +94,7 @@ mal_init(char *modules[], bool embedded, const char *initpasswd,
 	if (!MCinit())
 		return -1;
 	initNamespace();
+	RECYCLEinit();
 
 	err = malBootstrap(modules, embedded, initpasswd);
 	if (err != MAL_SUCCEED) {
@@ -139,6 +141,7 @@ mal_reset(void)
 	mal_dataflow_reset();
 	mal_client_reset();
 	mal_linker_reset();
+	RECYCLEreset();
 	mal_resource_reset();
 	mal_runtime_reset();
 	mal_module_reset();
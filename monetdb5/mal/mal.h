@@ -151,7 +151,8 @@ typedef struct INSTR {
 		inlineProp:1,			/* inline property */
 		unsafeProp:1,			/* unsafe property */
 		gc:1,					/* garbage control flags */
-		typeresolved:1;			/* true if type is resolved */
+		typeresolved:1,			/* true if type is resolved */
+		recycle:1;				/* results may be kept by the recycler */
 	int jump;					/* controlflow program counter */
 	int pc;						/* location in MAL plan for profiler */
 	MALfcn fcn;					/* resolved function address */
@@ -177,7 +178,8 @@ typedef struct MALBLK {
 	InstrPtr *stmt;				/* Instruction location */
 
 	bool inlineProp:1,			/* inline property */
-	 unsafeProp:1;				/* unsafe property */
+	 unsafeProp:1,				/* unsafe property */
+	 recycleProp:1;				/* recycle flags of the instructions are set */
 
 	str errors;					/* left over errors */
 	int maxarg;					/* keep track on the maximal arguments used */
@@ -188,6 +190,8 @@ typedef struct MALBLK {
 	lng runtime;				/* average execution time of block in ticks */
 	int calls;					/* number of calls */
 	lng optimize;				/* total optimizer time */
+	int pieces;					/* partitions made by mitosis, 0 if not considered */
+	BUN rowcnt;					/* size of the table partitioned by mitosis */
 } *MalBlkPtr, MalBlkRecord;
 
 #define STACKINCR   128
@@ -202,7 +206,8 @@ typedef struct MALSTK {
 	int stkdepth;				/* to protect against runtime stack overflow */
 	int calldepth;				/* to protect against runtime stack overflow */
 	bool keepAlive:1,			/* do not garbage collect when set */
-	 keepTmps:1;				/* also do not garbage collect tmps (needed for interactive debugging only) */
+	 keepTmps:1,				/* also do not garbage collect tmps (needed for interactive debugging only) */
+	 nofastpath:1;				/* always use the general interpreter loop (mdb.benchmark) */
 	/*
 	 * Parallel processing is mostly driven by dataflow, but within this context
 	 * there may be different schemes to take instructions into execution.
@@ -220,6 +225,9 @@ typedef struct MALSTK {
 	int pcup;					/* saved pc upon a recursive all */
 	oid tag;					/* unique invocation call tag */
 	lng memory;					/* Actual memory claims for highwater mark */
+	lng datasize;				/* accounted memory of the client at the start */
+	ATOMIC_TYPE peak;			/* largest growth of that memory during the run */
+	ATOMIC_TYPE busy;			/* usec spent in instructions during the run */
 
 	struct MALSTK *up;			/* stack trace list */
 	struct MALBLK *blk;			/* associated definition */
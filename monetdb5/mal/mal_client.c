@@ -95,6 +95,7 @@ MCinit(void)
 		ATOMIC_INIT(&mal_clients[i].lastprint, 0);
 		ATOMIC_INIT(&mal_clients[i].workers, 1);
 		ATOMIC_INIT(&mal_clients[i].qryctx.datasize, 0);
+		ATOMIC_INIT(&mal_clients[i].accounted, 0);
 		mal_clients[i].idx = -1;	/* indicate it's available */
 	}
 	return true;
@@ -447,6 +448,7 @@ MCcloseClient(Client c)
 	c->handshake_options = NULL;
 	MT_thread_set_qry_ctx(NULL);
 	assert(c->qryctx.datasize == 0);
+	MALadmission_exit(c);
 	MT_sema_destroy(&c->s);
 	MT_lock_set(&mal_contextLock);
 	c->idle = c->login = c->lastcmd = 0;
@@ -104,6 +104,7 @@ typedef struct CLIENT {
 
 	ATOMIC_TYPE lastprint;		/* when we last printed the query, to be deprecated */
 	ATOMIC_TYPE workers;		/* number of threads working for this context */
+	ATOMIC_TYPE accounted;		/* qryctx.datasize as added to the server total */
 	/*
 	 * Communication channels for the interconnect are stored here.
 	 * It is perfectly legal to have a client without input stream.
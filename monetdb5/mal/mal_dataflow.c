@@ -48,16 +48,18 @@ typedef struct FLOWEVENT {
 	int pc;						/* pc in underlying malblock */
 	int blocks;					/* awaiting for variables */
 	sht state;					/* of execution */
-	lng clk;
+	lng clk;					/* usec the instruction took */
 	sht cost;
 	lng hotclaim;				/* memory foot print of result variables */
 	lng argclaim;				/* memory foot print of arguments */
 	lng maxclaim;				/* memory foot print of largest argument, could be used to indicate result size */
+	int node;					/* preferred NUMA node, -1 if any */
 	struct FLOWEVENT *next;		/* linked list for queues */
 } *FlowEvent, FlowEventRec;
 
 typedef struct queue {
 	int exitcount;				/* how many threads should exit */
+	int length;					/* number of elements in the queue */
 	FlowEvent first, last;		/* first and last element of the queue */
 	MT_Lock l;					/* it's a shared resource, ie we need locks */
 	MT_Sema s;					/* threads wait on empty queues */
@@ -86,6 +88,7 @@ struct worker {
 	MT_Id id;
 	enum { WAITING, RUNNING, FREE, EXITED, FINISHING } flag;
 	ATOMIC_PTR_TYPE cntxt;		/* client we do work for (NULL -> any) */
+	int node;					/* NUMA node we are bound to, -1 if none */
 	MT_Sema s;
 	struct worker *next;
 	char errbuf[GDKMAXERRLEN];	/* GDKerrbuf so that we can allocate before fork */
@@ -100,9 +103,25 @@ static int free_max = 0;		/* max number of spare free threads */
 
 static Queue *todo = 0;			/* pending instructions */
 
+/* With dataflow_numa set on a machine with more than one NUMA node, the
+ * generic workers are bound to the nodes round robin, and the
+ * partitions created by mitosis are assigned to the nodes in the same
+ * way.  Workers prefer instructions of their own node. */
+static int numa_nodes = 0;		/* 0: NUMA mode disabled */
+static const char *sqlname, *bindname, *bindidxname, *tidname;
+#define DFLOW_NUMA_SCAN 64		/* how far to look for a local instruction */
+
 static ATOMIC_TYPE exiting = ATOMIC_VAR_INIT(0);
 static MT_Lock dataflowLock = MT_LOCK_INITIALIZER(dataflowLock);
 
+/* scheduler statistics, see DFLOWstatistics() */
+static ATOMIC_TYPE dfl_executed = ATOMIC_VAR_INIT(0);	/* instructions run */
+static ATOMIC_TYPE dfl_continued = ATOMIC_VAR_INIT(0);	/* hot potato hand-offs */
+static ATOMIC_TYPE dfl_queued = ATOMIC_VAR_INIT(0);	/* put on the todo queue */
+static ATOMIC_TYPE dfl_batches = ATOMIC_VAR_INIT(0);	/* todo queue insertions */
+static ATOMIC_TYPE dfl_requeued = ATOMIC_VAR_INIT(0);	/* admission failures */
+static ATOMIC_TYPE dfl_maxqueue = ATOMIC_VAR_INIT(0);	/* longest todo queue */
+
 /*
  * Calculate the size of the dataflow dependency graph.
  */
@@ -160,10 +179,41 @@ q_enqueue(Queue *q, FlowEvent d)
 		q->last = d;
 	}
 	d->next = NULL;
+	q->length++;
 	MT_lock_unset(&q->l);
 	MT_sema_up(&q->s);
 }
 
+/* append a list of n events (linked through their next field) in one
+ * go, so that a finishing instruction that enables several others only
+ * takes the queue lock once */
+static void
+q_enqueue_list(Queue *q, FlowEvent first, FlowEvent last, int n)
+{
+	assert(q);
+	assert(first && last && n > 0);
+	last->next = NULL;
+	MT_lock_set(&q->l);
+	if (q->first == NULL) {
+		assert(q->last == NULL);
+		q->first = first;
+	} else {
+		assert(q->last != NULL);
+		q->last->next = first;
+	}
+	q->last = last;
+	q->length += n;
+	ATOMIC_BASE_TYPE len = (ATOMIC_BASE_TYPE) q->length;
+	MT_lock_unset(&q->l);
+	ATOMIC_BASE_TYPE max = ATOMIC_GET(&dfl_maxqueue);
+	while (len > max && !ATOMIC_CAS(&dfl_maxqueue, &max, len))
+		;
+	ATOMIC_ADD(&dfl_queued, (ATOMIC_BASE_TYPE) n);
+	ATOMIC_INC(&dfl_batches);
+	while (n-- > 0)
+		MT_sema_up(&q->s);
+}
+
 /*
  * A priority queue over the hot claims of memory may
  * be more effective. It priorizes those instructions
@@ -185,12 +235,13 @@ q_requeue(Queue *q, FlowEvent d)
 		d->next = q->first;
 		q->first = d;
 	}
+	q->length++;
 	MT_lock_unset(&q->l);
 	MT_sema_up(&q->s);
 }
 
 static FlowEvent
-q_dequeue(Queue *q, Client cntxt)
+q_dequeue(Queue *q, Client cntxt, int node)
 {
 	assert(q);
 	MT_sema_down(&q->s);
@@ -213,6 +264,19 @@ q_dequeue(Queue *q, Client cntxt)
 			pd = *dp;
 			dp = &pd->next;
 		}
+	} else if (node >= 0) {
+		/* prefer an instruction for our own node (or one without a
+		 * preference) among the first few, otherwise take the first */
+		FlowEvent *ndp = dp, npd = NULL;
+		for (int i = 0; *ndp && i < DFLOW_NUMA_SCAN; i++) {
+			if ((*ndp)->node < 0 || (*ndp)->node == node) {
+				dp = ndp;
+				pd = npd;
+				break;
+			}
+			npd = *ndp;
+			ndp = &npd->next;
+		}
 	}
 	FlowEvent d = *dp;
 	if (d) {
@@ -220,6 +284,7 @@ q_dequeue(Queue *q, Client cntxt)
 		d->next = NULL;
 		if (*dp == NULL)
 			q->last = pd;
+		q->length--;
 	}
 	MT_lock_unset(&q->l);
 	return d;
@@ -243,6 +308,57 @@ q_dequeue(Queue *q, Client cntxt)
  * with this property. Nor do we maintain such properties.
  */
 
+/*
+ * When an instruction is finished we have to reduce the blocked counter
+ * for all dependent instructions.  The worker that finished it does so
+ * itself, so that eligible instructions become available to the other
+ * workers without a round trip through the thread running
+ * DFLOWscheduler.  If hot is set, the eligible instruction with the
+ * largest memory claim is returned to the caller to be executed right
+ * away (the hot potato), all others are appended to the todo queue at
+ * once.
+ */
+static FlowEvent
+DFLOWrelease(DataFlow flow, FlowEvent fe, bool hot)
+{
+	FlowEvent first = NULL, last = NULL, nxt = NULL;
+	int n = 0, i, l;
+
+	MT_lock_set(&flow->flowlock);
+	for (l = fe->pc - flow->start;
+		 l >= 0 && (i = flow->nodes[l]) > 0; l = flow->edges[l]) {
+		FlowEvent f = flow->status + i;
+		if (f->state != DFLOWpending)
+			continue;
+		f->argclaim += fe->hotclaim;
+		if (--f->blocks > 0)
+			continue;
+		f->state = DFLOWrunning;
+		if (hot && (nxt == NULL || f->argclaim > nxt->argclaim)) {
+			FlowEvent t = nxt;
+			nxt = f;
+			f = t;
+			if (f == NULL)
+				continue;
+		}
+		if (first == NULL)
+			first = f;
+		else
+			last->next = f;
+		last = f;
+		n++;
+	}
+	if (nxt) {
+		nxt->hotclaim = fe->hotclaim;
+		if (nxt->maxclaim < fe->maxclaim)
+			nxt->maxclaim = fe->maxclaim;
+	}
+	MT_lock_unset(&flow->flowlock);
+	if (n > 0)
+		q_enqueue_list(todo, first, last, n);
+	return nxt;
+}
+
 static void
 DFLOWworker(void *T)
 {
@@ -253,6 +369,8 @@ DFLOWworker(void *T)
 #endif
 	GDKsetbuf(t->errbuf);		/* where to leave errors */
 	snprintf(t->s.name, sizeof(t->s.name), "DFLOWsema%04zu", MT_getpid());
+	if (t->node >= 0 && MT_thread_bind_node(t->node) < 0)
+		t->node = -1;
 
 	for (;;) {
 		DataFlow flow;
@@ -280,7 +398,7 @@ DFLOWworker(void *T)
 			if (fnxt == 0) {
 				MT_thread_setworking("waiting for work");
 				cntxt = ATOMIC_PTR_GET(&t->cntxt);
-				fe = q_dequeue(todo, cntxt);
+				fe = q_dequeue(todo, cntxt, t->node);
 				if (fe == NULL) {
 					if (cntxt) {
 						/* we're not done yet with work for the current
@@ -311,6 +429,7 @@ DFLOWworker(void *T)
 
 			/* whenever we have a (concurrent) error, skip it */
 			if (ATOMIC_PTR_GET(&flow->error)) {
+				DFLOWrelease(flow, fe, false);
 				q_enqueue(flow->done, fe);
 				continue;
 			}
@@ -326,6 +445,7 @@ DFLOWworker(void *T)
 				MT_lock_unset(&todo->l);
 				if (last == NULL)
 					MT_sleep_ms(DELAYUNIT);
+				ATOMIC_INC(&dfl_requeued);
 				q_requeue(todo, fe);
 				continue;
 			}
@@ -335,9 +455,12 @@ DFLOWworker(void *T)
 				if (ATOMIC_CAS(&flow->mb->workers, &mwrks, wrks))
 					break;
 			}
+			fe->clk = GDKusec();
 			error = runMALsequence(flow->cntxt, flow->mb, fe->pc, fe->pc + 1,
 								   flow->stk, 0, 0);
+			fe->clk = GDKusec() - fe->clk;
 			ATOMIC_DEC(&flow->cntxt->workers);
+			ATOMIC_INC(&dfl_executed);
 			/* release the memory claim */
 			MALadmission_release(flow->cntxt, flow->mb, flow->stk, p, claim);
 
@@ -350,6 +473,7 @@ DFLOWworker(void *T)
 				if (!ATOMIC_PTR_CAS(&flow->error, &null, error))
 					freeException(error);
 				/* after an error we skip the rest of the block */
+				DFLOWrelease(flow, fe, false);
 				q_enqueue(flow->done, fe);
 				continue;
 			}
@@ -376,37 +500,9 @@ DFLOWworker(void *T)
 
 /* Try to get rid of the hot potato or locate an alternative to proceed.
  */
-#define HOTPOTATO
-#ifdef HOTPOTATO
-			/* HOT potato choice */
-			int last = 0, nxt = -1;
-			lng nxtclaim = -1;
-
-			MT_lock_set(&flow->flowlock);
-			for (last = fe->pc - flow->start;
-				 last >= 0 && (i = flow->nodes[last]) > 0;
-				 last = flow->edges[last]) {
-				if (flow->status[i].state == DFLOWpending
-					&& flow->status[i].blocks == 1) {
-					/* find the one with the largest footprint */
-					if (nxt == -1 || flow->status[i].argclaim > nxtclaim) {
-						nxt = i;
-						nxtclaim = flow->status[i].argclaim;
-					}
-				}
-			}
-			/* hot potato can not be removed, use alternative to proceed */
-			if (nxt >= 0) {
-				flow->status[nxt].state = DFLOWrunning;
-				flow->status[nxt].blocks = 0;
-				flow->status[nxt].hotclaim = fe->hotclaim;
-				flow->status[nxt].argclaim += fe->hotclaim;
-				if (flow->status[nxt].maxclaim < fe->maxclaim)
-					flow->status[nxt].maxclaim = fe->maxclaim;
-				fnxt = flow->status + nxt;
-			}
-			MT_lock_unset(&flow->flowlock);
-#endif
+			fnxt = DFLOWrelease(flow, fe, true);
+			if (fnxt)
+				ATOMIC_INC(&dfl_continued);
 
 			q_enqueue(flow->done, fe);
 			if (fnxt == 0 && profilerStatus) {
@@ -473,6 +569,15 @@ DFLOWinitialize(void)
 	}
 	free_max = GDKgetenv_int("dataflow_max_free",
 							 GDKnr_threads < 4 ? 4 : GDKnr_threads);
+	if (GDKgetenv_int("dataflow_numa", 0) && (numa_nodes = MT_numa_nodes()) > 1) {
+		sqlname = putName("sql");
+		bindname = putName("bind");
+		bindidxname = putName("bindidx");
+		tidname = putName("tid");
+		TRC_INFO(MAL_SERVER, "binding dataflow workers to %d NUMA nodes\n",
+				 numa_nodes);
+	} else
+		numa_nodes = 0;
 	todo = q_create("todo");
 	if (todo == NULL) {
 		MT_lock_unset(&dataflowLock);
@@ -490,6 +595,7 @@ DFLOWinitialize(void)
 		*t = (struct worker) {
 			.flag = RUNNING,
 			.cntxt = ATOMIC_PTR_VAR_INIT(NULL),
+			.node = numa_nodes > 0 ? created % numa_nodes : -1,
 		};
 		MT_sema_init(&t->s, 0, "DFLOWsema"); /* placeholder name */
 		if (MT_create_thread(&t->id, DFLOWworker, t,
@@ -516,6 +622,33 @@ DFLOWinitialize(void)
 	return 0;
 }
 
+/*
+ * Return the partition number of a bind or tid instruction that was
+ * split by the mitosis optimizer (it appended the partition number and
+ * the number of partitions as constant arguments), or -1.
+ */
+static int
+DFLOWpartition(MalBlkPtr mb, InstrPtr p)
+{
+	int nargs;
+
+	if (getModuleId(p) != sqlname)
+		return -1;
+	if (getFunctionId(p) == tidname)
+		nargs = 5;
+	else if (getFunctionId(p) == bindname || getFunctionId(p) == bindidxname)
+		nargs = 7;
+	else
+		return -1;
+	if (p->argc - p->retc != nargs)
+		return -1;
+	for (int j = p->argc - 2; j < p->argc; j++)
+		if (!isVarConstant(mb, getArg(p, j))
+			|| getArgType(mb, p, j) != TYPE_int)
+			return -1;
+	return getVarConstant(mb, getArg(p, p->argc - 2)).val.ival;
+}
+
 /*
  * The dataflow administration is based on administration of
  * how many variables are still missing before it can be executed.
@@ -550,8 +683,32 @@ DFLOWinitBlk(DataFlow flow, MalBlkPtr mb, int size)
 		flow->status[n].pc = pc;
 		flow->status[n].state = DFLOWpending;
 		flow->status[n].cost = -1;
+		flow->status[n].node = -1;
 		ATOMIC_PTR_SET(&flow->status[n].flow->error, NULL);
 
+		/* a partition is assigned to a node, the instructions working
+		 * on it inherit the node as long as all their inputs agree */
+		if (numa_nodes > 0) {
+			int part = DFLOWpartition(mb, p), node = -1;
+			if (part >= 0) {
+				node = part % numa_nodes;
+			} else {
+				for (j = p->retc; j < p->argc; j++) {
+					if (isVarConstant(mb, getArg(p, j))
+						|| (k = assign[getArg(p, j)]) == 0
+						|| flow->status[k - flow->start].node < 0)
+						continue;
+					if (node < 0) {
+						node = flow->status[k - flow->start].node;
+					} else if (node != flow->status[k - flow->start].node) {
+						node = -1;
+						break;
+					}
+				}
+			}
+			flow->status[n].node = node;
+		}
+
 		/* administer flow dependencies */
 		for (j = p->retc; j < p->argc; j++) {
 			/* list of instructions that wake n-th instruction up */
@@ -666,13 +823,13 @@ DFLOWinitBlk(DataFlow flow, MalBlkPtr mb, int size)
 static str
 DFLOWscheduler(DataFlow flow, struct worker *w)
 {
-	int last;
 	int i;
 	int j;
 	InstrPtr p;
-	int tasks = 0, actions = 0;
+	int tasks = 0, actions = 0, n = 0;
+	lng busy = 0;
 	str ret = MAL_SUCCEED;
-	FlowEvent fe, f = 0;
+	FlowEvent fe, f = 0, first = NULL, last = NULL;
 
 	if (flow == NULL)
 		throw(MAL, "dataflow", "DFLOWscheduler(): Called with flow == NULL");
@@ -698,13 +855,20 @@ DFLOWscheduler(DataFlow flow, struct worker *w)
 				fe[i].argclaim += getMemoryClaim(fe[0].flow->mb,
 												 fe[0].flow->stk, p, j, FALSE);
 			flow->status[i].state = DFLOWrunning;
-			q_enqueue(todo, flow->status + i);
+			if (first == NULL)
+				first = flow->status + i;
+			else
+				last->next = flow->status + i;
+			last = flow->status + i;
+			n++;
 		}
 	MT_lock_unset(&flow->flowlock);
+	if (n > 0)
+		q_enqueue_list(todo, first, last, n);
 	MT_sema_up(&w->s);
 
 	while (actions != tasks) {
-		f = q_dequeue(flow->done, NULL);
+		f = q_dequeue(flow->done, NULL, -1);
 		if (ATOMIC_GET(&exiting))
 			break;
 		if (f == NULL) {
@@ -713,28 +877,15 @@ DFLOWscheduler(DataFlow flow, struct worker *w)
 				  "DFLOWscheduler(): q_dequeue(flow->done) returned NULL");
 		}
 
-		/*
-		 * When an instruction is finished we have to reduce the blocked
-		 * counter for all dependent instructions.  for those where it
-		 * drops to zero we can scheduler it we do it here instead of the scheduler
-		 */
-
-		MT_lock_set(&flow->flowlock);
+		/* the worker has already released the instructions that
+		 * depend on this one (see DFLOWrelease), all that is left is
+		 * to count it, and the time it took */
 		tasks++;
-		for (last = f->pc - flow->start;
-			 last >= 0 && (i = flow->nodes[last]) > 0; last = flow->edges[last])
-			if (flow->status[i].state == DFLOWpending) {
-				flow->status[i].argclaim += f->hotclaim;
-				if (flow->status[i].blocks == 1) {
-					flow->status[i].blocks--;
-					flow->status[i].state = DFLOWrunning;
-					q_enqueue(todo, flow->status + i);
-				} else {
-					flow->status[i].blocks--;
-				}
-			}
-		MT_lock_unset(&flow->flowlock);
+		busy += f->clk;
 	}
+	/* the work of the block, for the mitosis feedback */
+	if (flow->stk->up == NULL)
+		ATOMIC_ADD(&flow->stk->busy, busy);
 	/* release the worker from its specific task (turn it into a
 	 * generic worker) */
 	ATOMIC_PTR_SET(&w->cntxt, NULL);
@@ -831,6 +982,7 @@ runMALdataflow(Client cntxt, MalBlkPtr mb, int startpc, int stoppc,
 			*t = (struct worker) {
 				.flag = WAITING,
 				.cntxt = ATOMIC_PTR_VAR_INIT(cntxt),
+				.node = -1,
 			};
 			MT_sema_init(&t->s, 0, "DFLOWsema"); /* placeholder name */
 			if (MT_create_thread(&t->id, DFLOWworker, t,
@@ -979,3 +1131,22 @@ mal_dataflow_reset(void)
 	todo = 0;					/* pending instructions */
 	ATOMIC_SET(&exiting, 0);
 }
+
+/* Report the scheduler statistics gathered since server start.  names
+ * and vals should both have room for DFLOW_NSTATS entries. */
+void
+DFLOWstatistics(const char **names, lng *vals)
+{
+	names[0] = "executed";
+	vals[0] = (lng) ATOMIC_GET(&dfl_executed);
+	names[1] = "continued";
+	vals[1] = (lng) ATOMIC_GET(&dfl_continued);
+	names[2] = "queued";
+	vals[2] = (lng) ATOMIC_GET(&dfl_queued);
+	names[3] = "queue_batches";
+	vals[3] = (lng) ATOMIC_GET(&dfl_batches);
+	names[4] = "requeued";
+	vals[4] = (lng) ATOMIC_GET(&dfl_requeued);
+	names[5] = "max_queue_length";
+	vals[5] = (lng) ATOMIC_GET(&dfl_maxqueue);
+}
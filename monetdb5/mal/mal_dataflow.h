@@ -25,4 +25,7 @@ extern str runMALdataflow(Client cntxt, MalBlkPtr mb, int startpc, int stoppc,
 extern str deblockdataflow(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 						   InstrPtr pci);
 
+#define DFLOW_NSTATS 6
+extern void DFLOWstatistics(const char **names, lng *vals);
+
 #endif /*  _MAL_DATAFLOW_H */
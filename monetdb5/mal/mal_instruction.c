@@ -229,6 +229,7 @@ resetMalBlk(MalBlkPtr mb)
 	}
 	/* Reuse the initial function statement */
 	mb->stop = 1;
+	mb->recycleProp = 0;
 
 	for (i = 0; i < mb->vtop; i++) {
 		if (mb->var[i].name)
@@ -352,9 +353,12 @@ copyMalBlk(MalBlkPtr old)
 	mb->runtime = old->runtime;
 	mb->calls = old->calls;
 	mb->optimize = old->optimize;
+	mb->pieces = old->pieces;
+	mb->rowcnt = old->rowcnt;
 	mb->maxarg = old->maxarg;
 	mb->inlineProp = old->inlineProp;
 	mb->unsafeProp = old->unsafeProp;
+	mb->recycleProp = old->recycleProp;
 	return mb;
 
   bailout:
@@ -18,6 +18,8 @@
 
 void setqptimeout(lng usecs)
 		__attribute__((__visibility__("hidden")));
+lng straightlineRuns(void)
+		__attribute__((__visibility__("hidden")));
 
 extern size_t qsize;
 
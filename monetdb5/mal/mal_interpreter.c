@@ -18,6 +18,7 @@
 #include "mal_runtime.h"
 #include "mal_interpreter.h"
 #include "mal_resource.h"
+#include "mal_recycle.h"
 #include "mal_listing.h"
 #include "mal_type.h"
 #include "mal_private.h"
@@ -42,6 +43,37 @@ getArgReference(MalStkPtr stk, InstrPtr pci, int k)
 	return (ptr) &stk->stk[pci->argv[k]].val;
 }
 
+/* return the n names and values of a statistics function in the two
+ * result BATs of pci, as for sysmon.dataflow and sql.plancache */
+str
+statisticsResult(MalStkPtr stk, InstrPtr pci, const char *fcn,
+				 const char *const *names, const lng *vals, int n)
+{
+	bat *nb = getArgReference_bat(stk, pci, 0);
+	bat *vb = getArgReference_bat(stk, pci, 1);
+	BAT *name, *value;
+
+	name = COLnew(0, TYPE_str, n, TRANSIENT);
+	value = COLnew(0, TYPE_lng, n, TRANSIENT);
+	if (name == NULL || value == NULL)
+		goto bailout;
+	for (int i = 0; i < n; i++) {
+		if (BUNappend(name, names[i], false) != GDK_SUCCEED ||
+			BUNappend(value, &vals[i], false) != GDK_SUCCEED)
+			goto bailout;
+	}
+	*nb = name->batCacheid;
+	BBPkeepref(name);
+	*vb = value->batCacheid;
+	BBPkeepref(value);
+	return MAL_SUCCEED;
+
+  bailout:
+	BBPreclaim(name);
+	BBPreclaim(value);
+	throw(MAL, fcn, SQLSTATE(HY013) MAL_MALLOC_FAIL);
+}
+
 static str
 malCommandCall(MalStkPtr stk, InstrPtr pci)
 {
@@ -365,6 +397,8 @@ runMAL(Client cntxt, MalBlkPtr mb, MalBlkPtr mbcaller, MalStkPtr env)
 		 * been observed due the small size of the function).
 		 */
 	}
+	if (recycleBudget && !mb->recycleProp)
+		RECYCLEprepare(mb);
 	ret = runMALsequence(cntxt, mb, 1, 0, stk, env, 0);
 
 	if (!stk->keepAlive && garbageControl(getInstrPtr(mb, 0)))
@@ -480,6 +514,223 @@ callMAL(Client cntxt, MalBlkPtr mb, MalStkPtr *env, ValPtr argv[])
 	return ret;
 }
 
+/*
+ * Most plans, and certainly those of point queries, are straight-line
+ * code: no loops, no exception handling and at most the blocks
+ * introduced by the dataflow optimizer and a return.  When in addition
+ * nobody is profiling, most of the per instruction bookkeeping of the
+ * general interpreter loop, such as taking the time twice per
+ * instruction, is not needed.  Such plans are executed by
+ * runMALstraight, which only retains the garbage collection, the error
+ * handling and the checks for interrupts and timeouts.
+ */
+
+#define FASTRETC 16				/* size of the backup array */
+#define FASTCHECK 63			/* test the timeout every 64 instructions */
+
+static ATOMIC_TYPE straightruns = ATOMIC_VAR_INIT(0);	/* plans run by runMALstraight */
+
+lng
+straightlineRuns(void)
+{
+	return (lng) ATOMIC_GET(&straightruns);
+}
+
+static bool
+isStraightLine(MalBlkPtr mb)
+{
+	for (int i = 1; i < mb->stop; i++) {
+		InstrPtr p = getInstrPtr(mb, i);
+
+		switch (p->token) {
+		case ASSIGNsymbol:
+		case CMDcall:
+		case PATcall:
+		case REMsymbol:
+		case ENDsymbol:
+			break;
+		default:
+			if (p->token >= 0)
+				return false;
+		}
+		switch (p->barrier) {
+		case 0:
+		case EXITsymbol:
+			break;
+		case BARRIERsymbol:
+			if (getVarType(mb, getDestVar(p)) != TYPE_bit)
+				return false;
+			break;
+		case RETURNsymbol:
+			/* without a caller this only ends the plan */
+			break;
+		default:
+			return false;
+		}
+		if (p->retc > FASTRETC)
+			return false;
+	}
+	return true;
+}
+
+static str
+runMALstraight(Client cntxt, MalBlkPtr mb, MalStkPtr stk, int *garbage)
+{
+	str ret = MAL_SUCCEED, localGDKerrbuf = GDKerrbuf;
+	ValRecord backup[FASTRETC];
+	ValPtr lhs, rhs;
+	int stkpc = 1;
+	unsigned int ninstr = 0;
+
+	while (stkpc < mb->stop) {
+		InstrPtr pci = getInstrPtr(mb, stkpc);
+
+		MT_thread_setalgorithm(NULL);
+		if (cntxt->mode == FINISHCLIENT)
+			return createException(MAL, "mal.interpreter",
+								   "prematurely stopped client");
+		if (stk->status) {
+			/* pause procedure from SYSMON */
+			while (stk->status == 'p')
+				MT_sleep_ms(50);
+			/* stop procedure from SYSMON */
+			if (stk->status == 'q')
+				return createException(MAL, "mal.interpreter",
+									   "Query with tag " OIDFMT
+									   " received stop signal", mb->tag);
+		}
+		if ((++ninstr & FASTCHECK) == 0 && cntxt->fdin
+			&& TIMEOUT_TEST(&cntxt->qryctx)) {
+			switch (cntxt->qryctx.endtime) {
+			case QRY_TIMEOUT:
+				return createException(MAL, "mal.interpreter",
+									   SQLSTATE(HYT00) RUNTIME_QRY_TIMEOUT);
+			case QRY_INTERRUPT:
+				return createException(MAL, "mal.interpreter",
+									   SQLSTATE(HYT00) RUNTIME_QRY_INTERRUPT);
+			default:
+				cntxt->mode = FINISHCLIENT;
+				return createException(MAL, "mal.interpreter",
+									   SQLSTATE(HYT00) "Client disconnected");
+			}
+		}
+
+		for (int i = 0; i < pci->retc; i++)
+			backup[i] = stk->stk[getArg(pci, i)];
+		if (garbageControl(pci)) {
+			for (int i = 0; i < pci->argc; i++) {
+				int a = getArg(pci, i);
+
+				if (stk->stk[a].bat && getEndScope(mb, a) == stkpc
+					&& isNotUsedIn(pci, i + 1, a))
+					garbage[i] = a;
+				else
+					garbage[i] = -1;
+			}
+		}
+
+		switch (pci->token) {
+		case ASSIGNsymbol:
+			for (int k = 0, i = pci->retc; k < pci->retc && i < pci->argc;
+				 i++, k++) {
+				lhs = &stk->stk[pci->argv[k]];
+				rhs = &stk->stk[pci->argv[i]];
+				if (VALcopy(lhs, rhs) == NULL) {
+					ret = createException(MAL, "mal.interpreter",
+										  SQLSTATE(HY013) MAL_MALLOC_FAIL);
+					break;
+				} else if (lhs->bat && !is_bat_nil(lhs->val.bval))
+					BBPretain(lhs->val.bval);
+			}
+			break;
+		case PATcall:
+			if (pci->fcn == NULL)
+				ret = createException(MAL, "mal.interpreter",
+									  "address of pattern %s.%s missing",
+									  pci->modname, pci->fcnname);
+			else
+				ret = (*(str (*) (Client, MalBlkPtr, MalStkPtr, InstrPtr)) pci->
+					   fcn) (cntxt, mb, stk, pci);
+			break;
+		case CMDcall:
+			ret = malCommandCall(stk, pci);
+			break;
+		case ENDsymbol:
+			stkpc = mb->stop;
+			continue;
+		default:
+			/* REMsymbol and temporary NOOP instructions */
+			stkpc++;
+			continue;
+		}
+		/* see runMALsequence */
+		if (mb->stop <= 1)
+			break;
+
+		if (ret == MAL_SUCCEED) {
+			for (int i = 0; i < pci->retc; i++) {
+				lhs = &backup[i];
+				if (lhs->bat) {
+					BBPrelease(lhs->val.bval);
+				} else if (ATOMextern(lhs->vtype) &&
+						   lhs->val.pval &&
+						   lhs->val.pval != ATOMnilptr(lhs->vtype) &&
+						   lhs->val.pval != stk->stk[getArg(pci, i)].val.pval)
+					GDKfree(lhs->val.pval);
+			}
+			if (garbageControl(pci)) {
+				for (int i = 0; i < pci->argc; i++) {
+					if (garbage[i] >= 0
+						&& isaBatType(getArgType(mb, pci, i))) {
+						bat bid = stk->stk[garbage[i]].val.bval;
+						if (!is_bat_nil(bid)) {
+							stk->stk[garbage[i]].val.bval = bat_nil;
+							BBPcold(bid);
+							BBPrelease(bid);
+						}
+					}
+				}
+			}
+		}
+
+		if (localGDKerrbuf && localGDKerrbuf[0]) {
+			if (ret == MAL_SUCCEED)
+				ret = createException(MAL, "mal.interpreter", GDK_EXCEPTION);
+			localGDKerrbuf[0] = 0;
+		}
+		if (ret != MAL_SUCCEED) {
+			if (strstr(ret, "!skip-to-end")) {
+				freeException(ret);
+				ret = MAL_SUCCEED;
+			}
+			break;
+		}
+
+		if (pci->barrier == BARRIERsymbol) {
+			bit v = stk->stk[getDestVar(pci)].val.btval;
+			if (v == FALSE || is_bit_nil(v))
+				stkpc = pci->jump;
+		} else if (pci->barrier == RETURNsymbol) {
+			break;
+		}
+		stkpc++;
+		if (cntxt->qryctx.endtime == QRY_TIMEOUT
+			|| cntxt->qryctx.endtime == QRY_INTERRUPT)
+			break;
+	}
+
+	if (cntxt->qryctx.endtime == QRY_TIMEOUT) {
+		freeException(ret);	/* overrule exception */
+		ret = createException(MAL, "mal.interpreter",
+							  SQLSTATE(HYT00) RUNTIME_QRY_TIMEOUT);
+	} else if (cntxt->qryctx.endtime == QRY_INTERRUPT) {
+		freeException(ret);	/* overrule exception */
+		ret = createException(MAL, "mal.interpreter",
+							  SQLSTATE(HYT00) RUNTIME_QRY_INTERRUPT);
+	}
+	return ret;
+}
+
 /*
  * The core of the interpreter is presented next. It takes the context
  * information and starts the interpretation at the designated
@@ -504,6 +755,7 @@ runMALsequence(Client cntxt, MalBlkPtr mb, int startpc,
 	bool startedProfileQueue = false;
 #define CHECKINTERVAL 1000		/* how often do we check for client disconnect */
 	runtimeProfile.ticks = runtimeProfileFunction.ticks = 0;
+	runtimeProfile.busy = runtimeProfileFunction.busy = 0;
 
 	if (stk == NULL)
 		throw(MAL, "mal.interpreter", MAL_STACK_FAIL);
@@ -542,6 +794,15 @@ runMALsequence(Client cntxt, MalBlkPtr mb, int startpc,
 	if (startpc == 1 && startpc < mb->stop) {
 		startedProfileQueue = true;
 		runtimeProfileInit(cntxt, mb, stk);
+		if (stk->up == NULL
+			&& (ret = MALadmission_query(cntxt, mb, stk)) != MAL_SUCCEED) {
+			runtimeProfileFinish(cntxt, mb, stk);
+			if (backup != backups)
+				GDKfree(backup);
+			if (garbage != garbages)
+				GDKfree(garbage);
+			return ret;
+		}
 		runtimeProfileBegin(cntxt, mb, stk, getInstrPtr(mb, 0),
 							&runtimeProfileFunction);
 		if (cntxt->sessiontimeout
@@ -555,6 +816,23 @@ runMALsequence(Client cntxt, MalBlkPtr mb, int startpc,
 			throw(MAL, "mal.interpreter",
 				  SQLSTATE(HYT00) RUNTIME_SESSION_TIMEOUT);
 		}
+		if ((stoppc == 0 || stoppc >= mb->stop) && pcicaller == NULL
+			&& !stk->nofastpath && qptimeout == 0 && profilerStatus == 0
+			&& recycleBudget == 0
+			&& !cntxt->sqlprofiler
+			&& (ATOMIC_GET(&GDKdebug) & CHECKMASK) == 0
+			&& isStraightLine(mb)) {
+			ATOMIC_INC(&straightruns);
+			ret = runMALstraight(cntxt, mb, stk, garbage);
+			/* a single thread was busy all the time */
+			ATOMIC_SET(&stk->busy, GDKusec() - runtimeProfileFunction.ticks);
+			runtimeProfileFinish(cntxt, mb, stk);
+			if (backup != backups)
+				GDKfree(backup);
+			if (garbage != garbages)
+				GDKfree(garbage);
+			return ret;
+		}
 	}
 	stkpc = startpc;
 	exceptionVar = -1;
@@ -699,12 +977,16 @@ runMALsequence(Client cntxt, MalBlkPtr mb, int startpc,
 				ret = createException(MAL, "mal.interpreter",
 									  "address of pattern %s.%s missing",
 									  pci->modname, pci->fcnname);
+			} else if (recycleBudget && pci->recycle && RECYCLEentry(cntxt, mb, stk, pci)) {
+				/* the results were kept by the recycler */
 			} else {
 				TRC_DEBUG(ALGO, "calling %s.%s\n",
 						  pci->modname ? pci->modname : "<null>",
 						  pci->fcnname ? pci->fcnname : "<null>");
 				ret = (*(str (*) (Client, MalBlkPtr, MalStkPtr, InstrPtr)) pci->
 					   fcn) (cntxt, mb, stk, pci);
+				if (ret == MAL_SUCCEED && recycleBudget && pci->recycle)
+					RECYCLEexit(cntxt, mb, stk, pci, runtimeProfile.ticks);
 #ifndef NDEBUG
 				if (ret == MAL_SUCCEED) {
 					/* check that the types of actual results match
@@ -731,10 +1013,14 @@ runMALsequence(Client cntxt, MalBlkPtr mb, int startpc,
 			}
 			break;
 		case CMDcall:
+			if (recycleBudget && pci->recycle && RECYCLEentry(cntxt, mb, stk, pci))
+				break;
 			TRC_DEBUG(ALGO, "calling %s.%s\n",
 					  pci->modname ? pci->modname : "<null>",
 					  pci->fcnname ? pci->fcnname : "<null>");
 			ret = malCommandCall(stk, pci);
+			if (ret == MAL_SUCCEED && recycleBudget && pci->recycle)
+				RECYCLEexit(cntxt, mb, stk, pci, runtimeProfile.ticks);
 #ifndef NDEBUG
 			if (ret == MAL_SUCCEED) {
 				/* check that the types of actual results match
@@ -1270,8 +1556,13 @@ runMALsequence(Client cntxt, MalBlkPtr mb, int startpc,
 			ret = createException(MAL, nme, "Exception not caught");
 		}
 	}
-	if (startedProfileQueue)
+	if (startedProfileQueue) {
+		/* the instructions of dataflow blocks were added by the
+		 * scheduler, those of a called function by the call */
+		if (stk->up == NULL)
+			ATOMIC_ADD(&stk->busy, runtimeProfile.busy);
 		runtimeProfileFinish(cntxt, mb, stk);
+	}
 	if (backup != backups)
 		GDKfree(backup);
 	if (garbage != garbages)
@@ -41,6 +41,9 @@ mal_export void garbageCollector(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 								 int flag);
 
 mal_export ptr getArgReference(MalStkPtr stk, InstrPtr pci, int k);
+mal_export str statisticsResult(MalStkPtr stk, InstrPtr pci, const char *fcn,
+							 const char *const *names, const lng *vals,
+							 int n);
 #if !defined(NDEBUG) && defined(__GNUC__)
 /* for ease of programming and debugging (assert reporting a useful
  * location), we use a GNU C extension to check the type of arguments,
@@ -30,6 +30,8 @@ bool MCshutdowninprogress(void)
 	__attribute__((__visibility__("hidden")));
 str defaultScenario(Client c)	/* used in src/mal/mal_session.c */
 	__attribute__((__visibility__("hidden")));
+void MALadmission_exit(Client cntxt)
+	__attribute__((__visibility__("hidden")));
 #endif
 
 str malAtomDefinition(const char *name,int tpe)
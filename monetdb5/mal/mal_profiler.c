@@ -609,6 +609,8 @@ getCPULoad(char cpuload[BUFSIZ])
 	return 0;
 }
 
+static void profilerDrain(void);
+
 void
 profilerHeartbeatEvent(char *alter)
 {
@@ -619,6 +621,11 @@ profilerHeartbeatEvent(char *alter)
 
 	if (ATOMIC_GET(&hbdelay) == 0 || maleventstream == 0)
 		return;
+	if (profilerMode == 2) {
+		/* binary events carry no heartbeat, only flush the buffers */
+		profilerDrain();
+		return;
+	}
 	usec = GDKusec();
 	microseconds = (uint64_t) startup_time.tv_sec * 1000000 +
 		(uint64_t) startup_time.tv_usec + (uint64_t) usec;
@@ -676,6 +683,344 @@ profilerHeartbeatEvent(char *alter)
 	logdel(&logbuf);
 }
 
+/*
+ * Binary event stream
+ * Rendering every event as JSON under the global profiler lock is too
+ * expensive to keep the profiler running on a production server.  In
+ * binary mode (profiler.openstream(8)) each event is encoded as a record
+ * with a fixed little-endian layout, holding the fields of the minimal
+ * JSON events, after the stream has been started with PROFMAGIC.
+ *
+ *	offset	size	field
+ *	0	4	size of the record, including the strings
+ *	4	1	kind, PROFREC_MAL or PROFREC_PHASE
+ *	5	1	phase
+ *	6	1	state, 1 for an error
+ *	7	1	flags, PROFREC_TSTART, PROFREC_TEND and PROFREC_TAG
+ *	8	2	barrier
+ *	10	2	token
+ *	12	4	sessionid
+ *	16	4	pc
+ *	20	2	length of the module name
+ *	22	2	length of the function name
+ *	24	2	length of the algorithm
+ *	26	2	unused
+ *	28	4	length of the query text
+ *	32	8	thread
+ *	40	8	tag
+ *	48	8	clk
+ *	56	8	usec
+ *	64	8	tstart
+ *	72	8	tend
+ *	80		module, function, algorithm and query, not 0-terminated
+ *
+ * The records are collected in PROFSLOTS buffers without taking the
+ * mal_profileLock.  A thread claims the slot selected by its thread id
+ * with an atomic test-and-set, and only moves on to the next slot when
+ * another thread happens to hold it.  A slot is written to the stream when
+ * it is full, and all slots are written at the end of each query and on
+ * every heartbeat.  Slots are tagged with the generation of the stream, so
+ * that records of a closed stream are never sent to the next one.
+ *
+ * Sampling is done per query: with profiler.setsample(n) only the MAL
+ * events of every n-th query are recorded, based on the query tag, so
+ * that the trace of a sampled query is always complete.
+ *
+ * profilerBinaryToJSON turns such a stream back into the JSON events.
+ */
+#define PROFMAGIC		"MDBPROF1"
+#define PROFREC_MAL		1
+#define PROFREC_PHASE	2
+#define PROFREC_TSTART	1
+#define PROFREC_TEND	2
+#define PROFREC_TAG		4
+#define PROFREC_HDR		80
+#define PROFNAMELEN		255
+#define PROFQUERYLEN	8192
+#define PROFSLOTS		64
+#define PROFSLOTSIZE	(64 * 1024)
+
+static struct profslot {
+	ATOMIC_FLAG busy;
+	ATOMIC_BASE_TYPE gen;
+	size_t len;
+	char *buf;
+} profslots[PROFSLOTS];
+
+static ATOMIC_TYPE profgen = ATOMIC_VAR_INIT(0);
+static ATOMIC_TYPE profsample = ATOMIC_VAR_INIT(1);
+
+static inline void
+profput(char *p, uint64_t v, int n)
+{
+	for (int i = 0; i < n; i++)
+		p[i] = (char) (v >> (8 * i));
+}
+
+static inline uint64_t
+profget(const unsigned char *p, int n)
+{
+	uint64_t v = 0;
+	for (int i = n - 1; i >= 0; i--)
+		v = v << 8 | p[i];
+	return v;
+}
+
+static inline size_t
+profputstr(char *rec, size_t off, const char *s, size_t max, int lenoff,
+		   int lensize)
+{
+	size_t l = s ? strlen(s) : 0;
+	if (l > max)
+		l = max;
+	profput(rec + lenoff, l, lensize);
+	if (l > 0)
+		memcpy(rec + off, s, l);
+	return off + l;
+}
+
+/* write the contents of a claimed slot to the stream */
+static void
+profslotflush(struct profslot *s)
+{
+	if (s->len == 0)
+		return;
+	MT_lock_set(&mal_profileLock);
+	if (maleventstream && s->gen == ATOMIC_GET(&profgen)) {
+		(void) mnstr_write(maleventstream, s->buf, 1, s->len);
+		(void) mnstr_flush(maleventstream, MNSTR_FLUSH_DATA);
+	}
+	MT_lock_unset(&mal_profileLock);
+	s->len = 0;
+}
+
+/* write all slots to the stream, must be called without mal_profileLock */
+static void
+profilerDrain(void)
+{
+	for (int i = 0; i < PROFSLOTS; i++) {
+		struct profslot *s = &profslots[i];
+		if (s->buf == NULL)
+			continue;
+		while (ATOMIC_TAS(&s->busy))
+			MT_sleep_ms(0);
+		profslotflush(s);
+		ATOMIC_CLEAR(&s->busy);
+	}
+}
+
+static void
+profilerBinaryEvent(MalEvent *me, NonMalEvent *nme)
+{
+	char rec[PROFREC_HDR + 3 * PROFNAMELEN + PROFQUERYLEN];
+	size_t len = PROFREC_HDR;
+	int flags = 0;
+	uint64_t clk;
+	bool drain = false;
+
+	memset(rec, 0, PROFREC_HDR);
+	if (me) {
+		InstrPtr pci = me->pci;
+		int pc = me->mb ? getPC(me->mb, pci) : 0;
+		int sample = (int) ATOMIC_GET(&profsample);
+
+		if (me->stk == NULL || pci == NULL)
+			return;
+		if (profilerUser != MAL_ADMIN && profilerUser != me->cntxt->user)
+			return;
+		if (sample > 1 && me->stk->tag % sample != 0)
+			return;
+		clk = (uint64_t) me->clk;
+		rec[4] = PROFREC_MAL;
+		rec[5] = MAL_ENGINE;
+		profput(rec + 8, (uint64_t) pci->barrier, 2);
+		profput(rec + 10, (uint64_t) pci->token, 2);
+		profput(rec + 12, (uint64_t) me->cntxt->idx, 4);
+		profput(rec + 16, (uint64_t) pc, 4);
+		profput(rec + 40, me->stk->tag, 8);
+		profput(rec + 56, (uint64_t) me->duration, 8);
+		len = profputstr(rec, len, pci->modname, PROFNAMELEN, 20, 2);
+		len = profputstr(rec, len, pci->fcnname, PROFNAMELEN, 22, 2);
+		len = profputstr(rec, len, MT_thread_getalgorithm(), PROFNAMELEN, 24, 2);
+		/* the function itself is reported when the query ends */
+		drain = pc == 0;
+	} else {
+		Client cntxt = nme->cntxt;
+
+		if (nme->phase == MAL_ENGINE)
+			return;
+		clk = nme->clk;
+		rec[4] = PROFREC_PHASE;
+		rec[5] = (char) nme->phase;
+		rec[6] = nme->state != 0;
+		profput(rec + 12, (uint64_t) cntxt->idx, 4);
+		if (cntxt->curprg) {
+			flags |= PROFREC_TAG;
+			profput(rec + 40, cntxt->curprg->def->tag, 8);
+		}
+		if (nme->tid) {
+			flags |= PROFREC_TSTART;
+			profput(rec + 64, *nme->tid, 8);
+		}
+		if (nme->ts) {
+			flags |= PROFREC_TEND;
+			profput(rec + 72, *nme->ts, 8);
+		}
+		profput(rec + 56, nme->duration, 8);
+		if (nme->phase == TEXT_TO_SQL)
+			len = profputstr(rec, len, cntxt->query, PROFQUERYLEN, 28, 4);
+	}
+	rec[7] = (char) flags;
+	profput(rec, len, 4);
+	profput(rec + 32, (uint64_t) MT_getpid(), 8);
+	profput(rec + 48, clk - ((uint64_t) startup_time.tv_sec * 1000000 -
+							 (uint64_t) startup_time.tv_usec), 8);
+
+	size_t i = MT_getpid() % PROFSLOTS;
+	while (ATOMIC_TAS(&profslots[i].busy)) {
+		if (++i == PROFSLOTS)
+			i = 0;
+	}
+	struct profslot *s = &profslots[i];
+	ATOMIC_BASE_TYPE gen = ATOMIC_GET(&profgen);
+	if (s->gen != gen) {
+		s->gen = gen;
+		s->len = 0;
+	}
+	if (s->buf == NULL && (s->buf = GDKmalloc(PROFSLOTSIZE)) == NULL) {
+		ATOMIC_CLEAR(&s->busy);
+		return;
+	}
+	if (s->len + len > PROFSLOTSIZE)
+		profslotflush(s);
+	memcpy(s->buf + s->len, rec, len);
+	s->len += len;
+	ATOMIC_CLEAR(&s->busy);
+	if (drain)
+		profilerDrain();
+}
+
+/* Convert the binary events in buf into the JSON events, one per line */
+str
+profilerBinaryToJSON(const void *buf, size_t len, str *json)
+{
+	const unsigned char *p = buf, *end = p + len;
+	buffer *b;
+	stream *s;
+	str msg = MAL_SUCCEED;
+
+	if (len < strlen(PROFMAGIC) || memcmp(p, PROFMAGIC, strlen(PROFMAGIC)) != 0)
+		throw(MAL, "profiler.tojson", "Not a binary profiler stream");
+	p += strlen(PROFMAGIC);
+	if ((b = buffer_create(BUFSIZ)) == NULL)
+		throw(MAL, "profiler.tojson", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	if ((s = buffer_wastream(b, "profiler.tojson")) == NULL) {
+		buffer_destroy(b);
+		throw(MAL, "profiler.tojson", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	}
+	while (p < end) {
+		size_t rlen, mlen, flen, alen, qlen;
+		int kind, phase, flags, barrier, token;
+		uint64_t tag;
+
+		if (end - p < PROFREC_HDR
+			|| (rlen = (size_t) profget(p, 4)) < PROFREC_HDR
+			|| rlen > (size_t) (end - p)) {
+			msg = createException(MAL, "profiler.tojson",
+								  "Truncated binary profiler event");
+			break;
+		}
+		kind = p[4];
+		phase = p[5];
+		flags = p[7];
+		barrier = (int) (short) profget(p + 8, 2);
+		token = (int) (short) profget(p + 10, 2);
+		mlen = (size_t) profget(p + 20, 2);
+		flen = (size_t) profget(p + 22, 2);
+		alen = (size_t) profget(p + 24, 2);
+		qlen = (size_t) profget(p + 28, 4);
+		tag = profget(p + 40, 8);
+		if (PROFREC_HDR + mlen + flen + alen + qlen != rlen
+			|| phase > CONFLICT
+			|| (kind != PROFREC_MAL && kind != PROFREC_PHASE)) {
+			msg = createException(MAL, "profiler.tojson",
+								  "Corrupt binary profiler event");
+			break;
+		}
+		const char *mod = (const char *) p + PROFREC_HDR;
+		const char *fcn = mod + mlen;
+		const char *algo = fcn + flen;
+		const char *query = algo + alen;
+
+		if (kind == PROFREC_MAL) {
+			mnstr_printf(s, "{\"sessionid\":\"%d\",\"clk\":%" PRIu64
+						 ",\"thread\":%zu,\"phase\":\"%s\",\"pc\":%d,\"tag\":"
+						 OIDFMT, (int) profget(p + 12, 4), profget(p + 48, 8),
+						 (size_t) profget(p + 32, 8), phase_descriptions[MAL_ENGINE],
+						 (int) profget(p + 16, 4), (oid) tag);
+			if (mlen)
+				mnstr_printf(s, ",\"module\":\"%.*s\"", (int) mlen, mod);
+			if (flen)
+				mnstr_printf(s, ",\"function\":\"%.*s\"", (int) flen, fcn);
+			if (barrier)
+				mnstr_printf(s, ",\"barrier\":\"%s\"", operatorName(barrier));
+			if (token < FCNcall || token > PATcall)
+				mnstr_printf(s, ",\"operator\":\"%s\"", operatorName(token));
+			mnstr_printf(s, ",\"usec\":" LLFMT, (lng) profget(p + 56, 8));
+			if (alen)
+				mnstr_printf(s, ",\"algorithm\":\"%.*s\"", (int) alen, algo);
+			mnstr_printf(s, "}\n");
+		} else {
+			mnstr_printf(s, "{\"sessionid\":\"%d\", \"clk\":" ULLFMT
+						 ", \"thread\":%zu, \"phase\":\"%s\"",
+						 (int) profget(p + 12, 4), (ulng) profget(p + 48, 8),
+						 (size_t) profget(p + 32, 8), phase_descriptions[phase]);
+			if (flags & PROFREC_TSTART)
+				mnstr_printf(s, ", \"tstart\":" ULLFMT, (ulng) profget(p + 64, 8));
+			if (flags & PROFREC_TEND)
+				mnstr_printf(s, ", \"tend\":" ULLFMT, (ulng) profget(p + 72, 8));
+			if (flags & PROFREC_TAG)
+				mnstr_printf(s, ", \"tag\":" OIDFMT, (oid) tag);
+			if (qlen) {
+				str q = mal_quote(query, qlen);
+				if (q == NULL) {
+					msg = createException(MAL, "profiler.tojson",
+										  SQLSTATE(HY013) MAL_MALLOC_FAIL);
+					break;
+				}
+				mnstr_printf(s, ", \"query\":\"%s\"", q);
+				GDKfree(q);
+			}
+			if (p[6])
+				mnstr_printf(s, ", \"state\":\"error\"");
+			mnstr_printf(s, ", \"usec\":" ULLFMT "}\n", (ulng) profget(p + 56, 8));
+		}
+		p += rlen;
+	}
+	if (msg == MAL_SUCCEED) {
+		char *res = buffer_get_buf(b);
+		if (res == NULL || (*json = GDKstrdup(res)) == NULL)
+			msg = createException(MAL, "profiler.tojson",
+								  SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		free(res);
+	}
+	close_stream(s);
+	buffer_destroy(b);
+	return msg;
+}
+
+void
+setprofilersample(int n)
+{
+	ATOMIC_SET(&profsample, n < 1 ? 1 : n);
+}
+
+int
+getprofilersample(void)
+{
+	return (int) ATOMIC_GET(&profsample);
+}
+
 void
 profilerEvent(MalEvent *me, NonMalEvent *nme)
 {
@@ -685,6 +1030,11 @@ profilerEvent(MalEvent *me, NonMalEvent *nme)
 	if (me != NULL && me->cntxt != NULL && getModuleId(me->pci) == myname)
 		return;
 
+	if (profilerMode == 2) {
+		if (maleventstream)
+			profilerBinaryEvent(me, nme);
+		return;
+	}
 	MT_lock_set(&mal_profileLock);
 	if (maleventstream) {
 		if (me != NULL && me->mb != NULL && nme == NULL) {
@@ -712,6 +1062,16 @@ profilerEvent(MalEvent *me, NonMalEvent *nme)
 
 /* The first scheme dumps the events on a stream (and in the pool)
  */
+static void
+resetProfilerStream(void)
+{
+	ATOMIC_INC(&profgen);
+	maleventstream = NULL;
+	profilerStatus = 0;
+	profilerMode = 0;
+	profilerUser = 0;
+}
+
 str
 openProfilerStream(Client cntxt, int m)
 {
@@ -722,12 +1082,13 @@ openProfilerStream(Client cntxt, int m)
 	MT_lock_set(&mal_profileLock);
 	if (myname == 0) {
 		myname = putName("profiler");
-		logjsonInternal(monet_characteristics, true);
+		if (m != 8)
+			logjsonInternal(monet_characteristics, true);
 	}
 	if (maleventstream) {
 		/* The DBA can always grab the stream, others have to wait */
 		if (cntxt->user == MAL_ADMIN) {
-			closeProfilerStream(cntxt);
+			resetProfilerStream();
 		} else {
 			MT_lock_unset(&mal_profileLock);
 			throw(MAL, "profiler.start",
@@ -736,6 +1097,7 @@ openProfilerStream(Client cntxt, int m)
 	}
 	/* 4 activates profiler in minimal mode. 1 and 3 were used in prev MonetDB versions */
 	/* 0 activates profiler in detailed mode */
+	/* 8 activates the binary event stream */
 	switch (m) {
 	case 0:
 		profilerStatus = -1;
@@ -744,12 +1106,21 @@ openProfilerStream(Client cntxt, int m)
 		profilerStatus = -1;
 		profilerMode = 1;
 		break;
+	case 8:
+		profilerStatus = -1;
+		profilerMode = 2;
+		break;
 	default:
 		MT_lock_unset(&mal_profileLock);
 		throw(MAL, "profiler.openstream", "Undefined profiler mode option");
 	}
+	ATOMIC_INC(&profgen);
 	maleventstream = cntxt->fdout;
 	profilerUser = cntxt->user;
+	if (profilerMode == 2) {
+		(void) mnstr_write(maleventstream, PROFMAGIC, 1, strlen(PROFMAGIC));
+		(void) mnstr_flush(maleventstream, MNSTR_FLUSH_DATA);
+	}
 
 	MT_lock_unset(&mal_profileLock);
 	return MAL_SUCCEED;
@@ -759,10 +1130,11 @@ str
 closeProfilerStream(Client cntxt)
 {
 	(void) cntxt;
-	maleventstream = NULL;
-	profilerStatus = 0;
-	profilerMode = 0;
-	profilerUser = 0;
+	if (profilerMode == 2)
+		profilerDrain();
+	MT_lock_set(&mal_profileLock);
+	resetProfilerStream();
+	MT_lock_unset(&mal_profileLock);
 	return MAL_SUCCEED;
 }
 
@@ -816,12 +1188,14 @@ stopTrace(Client cntxt)
 str
 stopProfiler(Client cntxt)
 {
+	if (cntxt && profilerMode == 2)
+		profilerDrain();
 	MT_lock_set(&mal_profileLock);
 	if (profilerStatus)
 		profilerStatus = 0;
 	setHeartbeat(0);			// stop heartbeat
 	if (cntxt)
-		closeProfilerStream(cntxt);
+		resetProfilerStream();
 	MT_lock_unset(&mal_profileLock);
 	return MAL_SUCCEED;
 }
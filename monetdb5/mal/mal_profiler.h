@@ -72,6 +72,9 @@ extern void initHeartbeat(void);
 extern void profilerHeartbeatEvent(char *alter);
 extern int getprofilerlimit(void);
 extern void setprofilerlimit(int limit);
+extern int getprofilersample(void);
+extern void setprofilersample(int n);
+extern str profilerBinaryToJSON(const void *buf, size_t len, str *json);
 
 extern void MPresetProfiler(stream *fdout);
 
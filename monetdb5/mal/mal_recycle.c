@@ -0,0 +1,650 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+/*
+ * The recycler keeps the results of expensive selections, joins,
+ * projections and groupings for reuse by later queries of any session.
+ * It is enabled by setting the recycle_memory server option to the
+ * number of MiB it may use.
+ *
+ * An instruction is identified by its implementation and its arguments.
+ * Scalar arguments are compared by value.  A BAT argument is recyclable
+ * if it is (a view of) a persistent BAT, a dense candidate list, or a
+ * BAT kept by the recycler itself.  Views of persistent BATs, such as
+ * returned by sql.bind, are identified by their parent, offset and count,
+ * so that the new views of every query still match.  Persistent BATs are
+ * only changed in place when a transaction commits, at which point the
+ * storage layer calls back RECYCLEdrop, as registered by the SQL backend.
+ * Kept results that are input to other entries are evicted together with
+ * these.
+ *
+ * Results are kept if the instruction took at least RECYCLE_MINCOST usec
+ * and they use at most a quarter of the budget.  The least recently used
+ * entries are evicted to stay within the budget.  Kept BATs are made read
+ * only, and instructions whose results are changed in place elsewhere in
+ * the plan are never recycled.  Which instructions qualify is determined
+ * once per plan by RECYCLEprepare.
+ */
+#include "monetdb_config.h"
+#include "mal_recycle.h"
+#include "mal_instruction.h"
+#include "mal_namespace.h"
+#include "mal_private.h"
+
+#define RECYCLE_MAXARGS 16
+
+enum {
+	RARG_VAL,					/* scalar value */
+	RARG_NIL,					/* nil BAT, e.g. no candidates */
+	RARG_DENSE,					/* dense candidate list */
+	RARG_VIEW,					/* (view of) persistent BAT */
+	RARG_RESULT,				/* BAT kept by the recycler */
+};
+
+typedef struct {
+	int kind;
+	int type;
+	bat bid;					/* persistent parent or kept result */
+	oid hseq, tseq;
+	BUN off, cnt;
+	ValRecord val;
+} recycle_arg;
+
+typedef struct recycle_result {
+	bat bid;
+	struct recycle_result *next;	/* result index chain */
+} recycle_result;
+
+typedef struct recycle_entry {
+	struct recycle_entry *next;	/* hash chain */
+	MALfcn fcn;
+	int retc, nargs;
+	size_t hash;
+	size_t size;				/* bytes of the results */
+	lng stamp;					/* last use, for eviction */
+	bool kept;					/* references to results and parents held */
+	recycle_result *res;
+	recycle_arg *args;
+} recycle_entry;
+
+size_t recycleBudget = 0;
+
+static MT_Lock recycleLock = MT_LOCK_INITIALIZER(recycleLock);
+static recycle_entry *recycle_buckets[RECYCLE_HASH];
+static recycle_result *recycle_results[RECYCLE_HASH];
+static size_t recycle_used;
+static lng recycle_stamp;
+static bat *recycle_zombies;	/* released results still in use */
+static int recycle_nzombies, recycle_maxzombies;
+static lng recycle_entries, recycle_hits, recycle_misses, recycle_admitted,
+	recycle_rejected, recycle_evicted, recycle_invalidated;
+
+static const char *algebraName, *groupName, *batName, *sqlName;
+static const char *algebraFcns[10], *groupFcns[4], *updateFcns[7], *sqlFcns[5];
+
+void
+RECYCLEinit(void)
+{
+	int mib = GDKgetenv_int("recycle_memory", 0);
+
+	algebraName = putName("algebra");
+	groupName = putName("group");
+	batName = putName("bat");
+	algebraFcns[0] = putName("select");
+	algebraFcns[1] = putName("thetaselect");
+	algebraFcns[2] = putName("join");
+	algebraFcns[3] = putName("leftjoin");
+	algebraFcns[4] = putName("semijoin");
+	algebraFcns[5] = putName("thetajoin");
+	algebraFcns[6] = putName("difference");
+	algebraFcns[7] = putName("intersect");
+	algebraFcns[8] = putName("projection");
+	algebraFcns[9] = putName("projectionpath");
+	groupFcns[0] = putName("group");
+	groupFcns[1] = putName("subgroup");
+	groupFcns[2] = putName("groupdone");
+	groupFcns[3] = putName("subgroupdone");
+	updateFcns[0] = putName("append");
+	updateFcns[1] = putName("delete");
+	updateFcns[2] = putName("replace");
+	updateFcns[3] = putName("setAccess");
+	updateFcns[4] = putName("setName");
+	updateFcns[5] = putName("setPersistent");
+	updateFcns[6] = putName("setTransient");
+	sqlName = putName("sql");
+	sqlFcns[0] = putName("append");
+	sqlFcns[1] = putName("update");
+	sqlFcns[2] = putName("delete");
+	sqlFcns[3] = putName("claim");
+	sqlFcns[4] = putName("clear_table");
+	recycleBudget = mib > 0 ? (size_t) mib << 20 : 0;
+}
+
+static bool
+recycle_interest(MalBlkPtr mb, InstrPtr p)
+{
+	bool found = false;
+
+	if (p->modname == algebraName) {
+		for (int i = 0; i < (int) (sizeof(algebraFcns) / sizeof(algebraFcns[0])) && !found; i++)
+			found = p->fcnname == algebraFcns[i];
+	} else if (p->modname == groupName) {
+		for (int i = 0; i < (int) (sizeof(groupFcns) / sizeof(groupFcns[0])) && !found; i++)
+			found = p->fcnname == groupFcns[i];
+	}
+	if (!found || p->fcn == NULL || p->argc - p->retc > RECYCLE_MAXARGS)
+		return false;
+	for (int i = 0; i < p->retc; i++)
+		if (!isaBatType(getArgType(mb, p, i)))
+			return false;
+	return true;
+}
+
+/* Mark the instructions whose results may be kept, once per plan.
+ * Results that are changed in place elsewhere in the plan can not be
+ * shared.  Plans that modify SQL tables are not considered at all: their
+ * intermediates end up in the storage layer and are seldom repeated. */
+void
+RECYCLEprepare(MalBlkPtr mb)
+{
+	bool *inplace = GDKzalloc(mb->vtop * sizeof(bool));
+	bool ok = inplace != NULL;
+
+	for (int pc = 1; pc < mb->stop && ok; pc++) {
+		InstrPtr q = getInstrPtr(mb, pc);
+
+		if (q->modname == sqlName) {
+			for (int i = 0; i < (int) (sizeof(sqlFcns) / sizeof(sqlFcns[0])) && ok; i++)
+				ok = q->fcnname != sqlFcns[i];
+			continue;
+		}
+		if (q->modname != batName || q->argc <= q->retc)
+			continue;
+		for (int i = 0; i < (int) (sizeof(updateFcns) / sizeof(updateFcns[0])); i++)
+			if (q->fcnname == updateFcns[i])
+				inplace[getArg(q, q->retc)] = true;
+	}
+	for (int pc = 0; pc < mb->stop; pc++) {
+		InstrPtr p = getInstrPtr(mb, pc);
+
+		p->recycle = ok && recycle_interest(mb, p) && p->retc <= RECYCLE_MAXARGS;
+		for (int i = 0; i < p->retc && p->recycle; i++)
+			p->recycle = !inplace[getArg(p, i)];
+	}
+	GDKfree(inplace);
+	mb->recycleProp = true;
+}
+
+/* Describe the arguments of p, RARG_RESULT are candidates that still
+ * need to be looked up in the result index. */
+static bool
+recycle_classify(MalBlkPtr mb, MalStkPtr stk, InstrPtr p, recycle_arg *args)
+{
+	for (int i = p->retc; i < p->argc; i++) {
+		recycle_arg *a = &args[i - p->retc];
+		ValPtr v = &stk->stk[getArg(p, i)];
+		BAT *b;
+
+		*a = (recycle_arg) { .kind = RARG_VAL, .type = v->vtype, };
+		if (!isaBatType(getArgType(mb, p, i))) {
+			a->val = *v;
+			continue;
+		}
+		if (is_bat_nil(v->val.bval)) {
+			a->kind = RARG_NIL;
+			continue;
+		}
+		if ((b = BATdescriptor(v->val.bval)) == NULL)
+			return false;
+		a->type = b->ttype;
+		a->hseq = b->hseqbase;
+		a->cnt = BATcount(b);
+		if (b->ttype == TYPE_void) {
+			a->kind = RARG_DENSE;
+			a->tseq = b->tseqbase;
+		} else {
+			bat root = VIEWtparent(b), vroot = VIEWvtparent(b);
+
+			if (root == 0)
+				root = b->batCacheid;
+			if ((vroot && vroot != root) ||
+				(BBP_desc(root)->batTransient && root != b->batCacheid)) {
+				BBPunfix(b->batCacheid);
+				return false;
+			}
+			a->kind = BBP_desc(root)->batTransient ? RARG_RESULT : RARG_VIEW;
+			a->bid = root;
+			a->off = b->tbaseoff;
+		}
+		BBPunfix(b->batCacheid);
+	}
+	return true;
+}
+
+static size_t
+recycle_hash(InstrPtr p, const recycle_arg *args)
+{
+	size_t h = (size_t) (uintptr_t) p->fcn;
+
+	for (int i = 0; i < p->argc - p->retc; i++) {
+		const recycle_arg *a = &args[i];
+
+		h = h * 31 + (size_t) a->kind;
+		h = h * 31 + (size_t) a->type;
+		if (a->kind != RARG_VAL) {
+			h = h * 31 + (size_t) a->bid;
+			h = h * 31 + (size_t) a->off;
+			h = h * 31 + (size_t) a->cnt;
+		} else if (a->type == TYPE_str) {
+			if (a->val.val.sval)
+				h = h * 31 + (size_t) strHash(a->val.val.sval);
+		} else if (!ATOMextern(a->type)) {
+			const unsigned char *s = VALptr(&a->val);
+			for (int j = 0; j < ATOMsize(a->type); j++)
+				h = h * 31 + s[j];
+		}
+	}
+	return h;
+}
+
+static bool
+recycle_kept(bat bid)
+{
+	for (recycle_result *r = recycle_results[bid % RECYCLE_HASH]; r; r = r->next)
+		if (r->bid == bid)
+			return true;
+	return false;
+}
+
+/* all candidate results must still be kept, called with the lock held */
+static bool
+recycle_resolve(const recycle_arg *args, int nargs)
+{
+	for (int i = 0; i < nargs; i++)
+		if (args[i].kind == RARG_RESULT && !recycle_kept(args[i].bid))
+			return false;
+	return true;
+}
+
+static bool
+recycle_match(const recycle_entry *e, InstrPtr p, const recycle_arg *args)
+{
+	if (e->fcn != p->fcn || e->retc != p->retc || e->nargs != p->argc - p->retc)
+		return false;
+	for (int i = 0; i < e->nargs; i++) {
+		const recycle_arg *a = &e->args[i], *b = &args[i];
+
+		if (a->kind != b->kind || a->type != b->type)
+			return false;
+		if (a->kind == RARG_VAL) {
+			if (VALcmp(&a->val, &b->val) != 0)
+				return false;
+		} else if (a->bid != b->bid || a->hseq != b->hseq ||
+				   a->tseq != b->tseq || a->off != b->off || a->cnt != b->cnt) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* kept results no longer count as memory of the query that made them */
+static void
+recycle_unaccount(bat bid)
+{
+	QryCtx *qc = MT_thread_get_qry_ctx();
+	BAT *b;
+
+	if (qc == NULL || (b = BATdescriptor(bid)) == NULL)
+		return;
+	MT_lock_set(&b->theaplock);
+	Heap *hs[2] = { b->theap, b->tvheap };
+	for (int i = 0; i < 2; i++) {
+		Heap *h = hs[i];
+		if (h && h->base && h->parentid == bid && h->farmid == 1 &&
+			(h->storage == STORE_MEM || h->storage == STORE_MMAP || h->storage == STORE_PRIV))
+			ATOMIC_SUB(&qc->datasize, h->size);
+	}
+	MT_lock_unset(&b->theaplock);
+	BBPunfix(bid);
+}
+
+/* A kept result that is still in use by a query is only released after
+ * that query is done with it, so that its memory is never subtracted
+ * from a query that did not account for it.  Called with the lock held. */
+static void
+recycle_release(bat bid, bool force)
+{
+	QryCtx *qc = MT_thread_get_qry_ctx();
+
+	if (!force && (BBP_lrefs(bid) > 1 || BBP_refs(bid) > 0)) {
+		if (recycle_nzombies == recycle_maxzombies) {
+			int n = recycle_maxzombies ? 2 * recycle_maxzombies : 64;
+			bat *z = GDKrealloc(recycle_zombies, n * sizeof(bat));
+			if (z) {
+				recycle_zombies = z;
+				recycle_maxzombies = n;
+			}
+		}
+		if (recycle_nzombies < recycle_maxzombies) {
+			recycle_zombies[recycle_nzombies++] = bid;
+			return;
+		}
+	}
+	MT_thread_set_qry_ctx(NULL);
+	BBPrelease(bid);
+	MT_thread_set_qry_ctx(qc);
+}
+
+static void
+recycle_reap(void)
+{
+	for (int i = 0; i < recycle_nzombies; ) {
+		bat bid = recycle_zombies[i];
+
+		if (BBP_lrefs(bid) > 1 || BBP_refs(bid) > 0) {
+			i++;
+		} else {
+			recycle_zombies[i] = recycle_zombies[--recycle_nzombies];
+			recycle_release(bid, true);
+		}
+	}
+}
+
+static void
+recycle_free(recycle_entry *e, bool force)
+{
+	for (int i = 0; i < e->retc && e->kept; i++)
+		recycle_release(e->res[i].bid, force);
+	for (int i = 0; i < e->nargs; i++) {
+		if (e->args[i].kind == RARG_VIEW && e->kept)
+			BBPrelease(e->args[i].bid);
+		else if (e->args[i].kind == RARG_VAL)
+			VALclear(&e->args[i].val);
+	}
+	GDKfree(e->res);
+	GDKfree(e->args);
+	GDKfree(e);
+}
+
+static bool
+recycle_depends(const recycle_entry *d, const recycle_entry *e)
+{
+	for (int i = 0; i < d->nargs; i++) {
+		if (d->args[i].kind != RARG_RESULT)
+			continue;
+		for (int j = 0; j < e->retc; j++)
+			if (d->args[i].bid == e->res[j].bid)
+				return true;
+	}
+	return false;
+}
+
+/* remove e and the entries computed from its results, called with the
+ * lock held */
+static void
+recycle_remove(recycle_entry *e)
+{
+	recycle_entry **ep;
+
+	for (ep = &recycle_buckets[e->hash % RECYCLE_HASH]; *ep != e; ep = &(*ep)->next)
+		;
+	*ep = e->next;
+	for (int i = 0; i < e->retc; i++) {
+		recycle_result **rp;
+
+		for (rp = &recycle_results[e->res[i].bid % RECYCLE_HASH]; *rp != &e->res[i]; rp = &(*rp)->next)
+			;
+		*rp = e->res[i].next;
+	}
+	recycle_used -= e->size;
+	recycle_entries--;
+	for (int h = 0; h < RECYCLE_HASH; h++) {
+		for (recycle_entry *d = recycle_buckets[h]; d; ) {
+			if (recycle_depends(d, e)) {
+				recycle_remove(d);
+				d = recycle_buckets[h];
+			} else {
+				d = d->next;
+			}
+		}
+	}
+	recycle_free(e, false);
+}
+
+static void
+recycle_evict(size_t size)
+{
+	while (recycle_used + size > recycleBudget && recycle_entries > 0) {
+		recycle_entry *victim = NULL;
+
+		for (int h = 0; h < RECYCLE_HASH; h++)
+			for (recycle_entry *e = recycle_buckets[h]; e; e = e->next)
+				if (victim == NULL || e->stamp < victim->stamp)
+					victim = e;
+		recycle_remove(victim);
+		recycle_evicted++;
+	}
+}
+
+/* Set the results of p from the recycler, if they were kept before. */
+bool
+RECYCLEentry(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr p)
+{
+	recycle_arg args[RECYCLE_MAXARGS];
+	bat res[RECYCLE_MAXARGS];
+	recycle_entry *e = NULL;
+	size_t h;
+
+	(void) cntxt;
+	if (!mb->recycleProp || !p->recycle || !recycle_classify(mb, stk, p, args))
+		return false;
+	h = recycle_hash(p, args);
+
+	MT_lock_set(&recycleLock);
+	if (recycle_resolve(args, p->argc - p->retc)) {
+		for (e = recycle_buckets[h % RECYCLE_HASH]; e; e = e->next)
+			if (e->hash == h && recycle_match(e, p, args))
+				break;
+	}
+	if (e) {
+		for (int i = 0; i < p->retc; i++) {
+			res[i] = e->res[i].bid;
+			BBPretain(res[i]);
+		}
+		e->stamp = ++recycle_stamp;
+		recycle_hits++;
+	} else {
+		recycle_misses++;
+	}
+	MT_lock_unset(&recycleLock);
+
+	if (e == NULL)
+		return false;
+	for (int i = 0; i < p->retc; i++)
+		*getArgReference_bat(stk, p, i) = res[i];
+	return true;
+}
+
+/* Offer the results of p, which was started at the given time. */
+void
+RECYCLEexit(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr p, lng started)
+{
+	recycle_arg args[RECYCLE_MAXARGS];
+	recycle_entry *e;
+	int nargs = p->argc - p->retc;
+	size_t size = 0;
+
+	(void) cntxt;
+	if (GDKusec() - started < RECYCLE_MINCOST || !mb->recycleProp ||
+		!p->recycle || !recycle_classify(mb, stk, p, args))
+		return;
+	for (int i = 0; i < p->retc; i++) {
+		bat bid = *getArgReference_bat(stk, p, i);
+		BAT *b;
+
+		if (is_bat_nil(bid) || (b = BATdescriptor(bid)) == NULL)
+			return;
+		/* views would keep their parent heaps shared */
+		bool ok = !isVIEW(b) && b->batTransient;
+		for (int j = 0; j < nargs && ok; j++)
+			ok = args[j].kind == RARG_VAL || args[j].bid != bid;
+		MT_lock_set(&b->theaplock);
+		size += b->theap ? b->theap->free : 0;
+		size += b->tvheap ? b->tvheap->free : 0;
+		MT_lock_unset(&b->theaplock);
+		BBPunfix(bid);
+		if (!ok)
+			return;
+	}
+	if (size > recycleBudget / RECYCLE_MAXSHARE) {
+		MT_lock_set(&recycleLock);
+		recycle_rejected++;
+		MT_lock_unset(&recycleLock);
+		return;
+	}
+
+	if ((e = GDKzalloc(sizeof(recycle_entry))) == NULL)
+		return;
+	e->res = GDKzalloc(p->retc * sizeof(recycle_result));
+	e->args = GDKmalloc(nargs * sizeof(recycle_arg));
+	if (e->res == NULL || e->args == NULL) {
+		GDKfree(e->res);
+		GDKfree(e->args);
+		GDKfree(e);
+		return;
+	}
+	e->fcn = p->fcn;
+	e->retc = p->retc;
+	e->hash = recycle_hash(p, args);
+	e->size = size;
+	for (int i = 0; i < nargs; i++) {
+		e->args[i] = args[i];
+		if (args[i].kind == RARG_VAL) {
+			e->args[i].val = (ValRecord) { .vtype = TYPE_void, };
+			if (VALcopy(&e->args[i].val, &args[i].val) == NULL) {
+				e->nargs = i;
+				recycle_free(e, false);
+				return;
+			}
+		}
+		e->nargs = i + 1;
+	}
+	for (int i = 0; i < p->retc; i++) {
+		BAT *b = BATdescriptor(*getArgReference_bat(stk, p, i));
+
+		if (b == NULL || (b = BATsetaccess(b, BAT_READ)) == NULL) {
+			recycle_free(e, false);
+			return;
+		}
+		e->res[i].bid = b->batCacheid;
+		BBPunfix(b->batCacheid);
+	}
+
+	MT_lock_set(&recycleLock);
+	recycle_reap();
+	recycle_evict(size);
+	/* the entries we depend on may have been evicted meanwhile */
+	bool ok = recycle_resolve(e->args, nargs);
+	for (recycle_entry *o = recycle_buckets[e->hash % RECYCLE_HASH]; o && ok; o = o->next)
+		ok = !(o->hash == e->hash && recycle_match(o, p, args));
+	if (!ok) {
+		MT_lock_unset(&recycleLock);
+		recycle_free(e, false);
+		return;
+	}
+	for (int i = 0; i < p->retc; i++) {
+		BBPretain(e->res[i].bid);
+		recycle_unaccount(e->res[i].bid);
+		e->res[i].next = recycle_results[e->res[i].bid % RECYCLE_HASH];
+		recycle_results[e->res[i].bid % RECYCLE_HASH] = &e->res[i];
+	}
+	for (int i = 0; i < nargs; i++)
+		if (e->args[i].kind == RARG_VIEW)
+			BBPretain(e->args[i].bid);
+	e->kept = true;
+	e->stamp = ++recycle_stamp;
+	e->next = recycle_buckets[e->hash % RECYCLE_HASH];
+	recycle_buckets[e->hash % RECYCLE_HASH] = e;
+	recycle_used += size;
+	recycle_entries++;
+	recycle_admitted++;
+	MT_lock_unset(&recycleLock);
+}
+
+/* The persistent BAT bid was changed, drop all that was derived from it. */
+void
+RECYCLEdrop(bat bid)
+{
+	if (recycleBudget == 0 || is_bat_nil(bid) || bid == 0)
+		return;
+	MT_lock_set(&recycleLock);
+	recycle_reap();
+	for (int h = 0; h < RECYCLE_HASH; h++) {
+		for (recycle_entry *e = recycle_buckets[h]; e; ) {
+			bool uses = false;
+
+			for (int i = 0; i < e->nargs && !uses; i++)
+				uses = e->args[i].kind == RARG_VIEW && e->args[i].bid == bid;
+			if (uses) {
+				recycle_remove(e);
+				recycle_invalidated++;
+				e = recycle_buckets[h];
+			} else {
+				e = e->next;
+			}
+		}
+	}
+	MT_lock_unset(&recycleLock);
+}
+
+void
+RECYCLEreset(void)
+{
+	MT_lock_set(&recycleLock);
+	for (int h = 0; h < RECYCLE_HASH; h++) {
+		while (recycle_buckets[h]) {
+			recycle_entry *e = recycle_buckets[h];
+
+			recycle_buckets[h] = e->next;
+			recycle_free(e, true);
+		}
+		recycle_results[h] = NULL;
+	}
+	while (recycle_nzombies > 0)
+		recycle_release(recycle_zombies[--recycle_nzombies], true);
+	recycle_used = 0;
+	recycle_entries = 0;
+	MT_lock_unset(&recycleLock);
+}
+
+void
+RECYCLEstatistics(const char **names, lng *vals)
+{
+	MT_lock_set(&recycleLock);
+	names[0] = "entries";
+	vals[0] = recycle_entries;
+	names[1] = "memory";
+	vals[1] = (lng) recycle_used;
+	names[2] = "hits";
+	vals[2] = recycle_hits;
+	names[3] = "misses";
+	vals[3] = recycle_misses;
+	names[4] = "admitted";
+	vals[4] = recycle_admitted;
+	names[5] = "rejected";
+	vals[5] = recycle_rejected;
+	names[6] = "evicted";
+	vals[6] = recycle_evicted;
+	names[7] = "invalidated";
+	vals[7] = recycle_invalidated;
+	MT_lock_unset(&recycleLock);
+}
@@ -0,0 +1,39 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+#ifndef _MAL_RECYCLE_H
+#define _MAL_RECYCLE_H
+
+#include "mal_interpreter.h"
+
+/* the SQL backend reports in place changes of persistent BATs */
+mal_export void RECYCLEdrop(bat bid);
+mal_export void RECYCLEreset(void);
+
+#ifdef LIBMONETDB5
+#define RECYCLE_HASH 1024		/* hash buckets for entries and results */
+#define RECYCLE_MINCOST 100		/* usec, cheaper instructions are not kept */
+#define RECYCLE_MAXSHARE 4		/* an entry takes at most 1/4 of the budget */
+#define RECYCLE_NSTATS 8
+
+extern size_t recycleBudget;	/* bytes, 0 disables the recycler */
+
+extern void RECYCLEinit(void);
+extern void RECYCLEprepare(MalBlkPtr mb);
+extern bool RECYCLEentry(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
+						 InstrPtr p);
+extern void RECYCLEexit(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
+						InstrPtr p, lng started);
+extern void RECYCLEstatistics(const char **names, lng *vals);
+#endif
+
+#endif /* _MAL_RECYCLE_H */
@@ -18,9 +18,10 @@
 #include "mal_private.h"
 #include "mal_internal.h"
 #include "mal_instruction.h"
+#include "mal_runtime.h"
 
-/* Memory based admission does not seem to have a major impact so far. */
-static lng memorypool = 0;		/* memory claimed by concurrent threads */
+static lng memoryclaimed = 0;	/* memory claimed by concurrent threads */
+static ATOMIC_TYPE memoryinuse = ATOMIC_VAR_INIT(0);	/* accounted in the QryCtx of all clients */
 
 static MT_Lock admissionLock = MT_LOCK_INITIALIZER(admissionLock);
 
@@ -28,7 +29,8 @@ void
 mal_resource_reset(void)
 {
 	MT_lock_set(&admissionLock);
-	memorypool = (lng) MEMORY_THRESHOLD;
+	memoryclaimed = 0;
+	ATOMIC_SET(&memoryinuse, 0);
 	MT_lock_unset(&admissionLock);
 }
 
@@ -110,16 +112,87 @@ getMemoryClaim(MalBlkPtr mb, MalStkPtr stk, InstrPtr pci, int i, int flag)
 	return total;
 }
 
+/*
+ * The heaps allocated on behalf of a query are accounted in the QryCtx of
+ * its client (see gdk_heap.c), which also enforces the hard limit of the
+ * query.  For the server wide budget those numbers are summed over all
+ * clients in memoryinuse.  Rather than walking the clients, every client
+ * adds the change of its own QryCtx since it last did so (kept in
+ * cntxt->accounted) whenever an instruction claims or releases memory or
+ * ends, so the total lags behind the heaps by at most one instruction per
+ * worker.
+ */
+static lng
+memoryInUse(Client cntxt)
+{
+	lng cur = (lng) ATOMIC_GET(&cntxt->qryctx.datasize);
+	lng old = (lng) ATOMIC_GET(&cntxt->accounted);
+
+	if (cur == old)
+		return (lng) ATOMIC_GET(&memoryinuse);
+	old = (lng) ATOMIC_XCG(&cntxt->accounted, cur);
+
+	if (cur > old)
+		return (lng) ATOMIC_ADD(&memoryinuse, cur - old) + cur - old;
+	if (cur < old)
+		return (lng) ATOMIC_SUB(&memoryinuse, old - cur) - (old - cur);
+	return (lng) ATOMIC_GET(&memoryinuse);
+}
+
+/* The user budget (max_memory) covers all sessions of the user.  It is
+ * only checked when a query starts, and only for users that have one. */
+static lng
+userMemoryInUse(Client cntxt)
+{
+	lng user = 0;
+
+	for (Client c = mal_clients; c < mal_clients + MAL_MAXCLIENTS; c++) {
+		if (c->mode != FREECLIENT && c->user == cntxt->user)
+			user += (lng) ATOMIC_GET(&c->qryctx.datasize);
+	}
+	return user;
+}
+
+/* Keep track of the largest amount of memory used by the query, in the
+ * stack of the query.  The QryCtx of a session also holds the result sets
+ * and temporaries left by earlier queries, so only the growth since the
+ * query started counts.  This is called after every instruction, but there
+ * is only work to do when the client allocated or freed memory since it
+ * was last accounted. */
+void
+MALadmission_peak(Client cntxt, MalStkPtr stk)
+{
+	lng cur = (lng) ATOMIC_GET(&cntxt->qryctx.datasize);
+
+	if (cur == (lng) ATOMIC_GET(&cntxt->accounted))
+		return;
+	(void) memoryInUse(cntxt);
+	while (stk->up)
+		stk = stk->up;
+	lng used = cur - stk->datasize;
+	ATOMIC_BASE_TYPE peak = ATOMIC_GET(&stk->peak);
+
+	while (used > 0 && used > (lng) peak
+		   && !ATOMIC_CAS(&stk->peak, &peak, used))
+		;
+}
+
 /*
  * The argclaim provides a hint on how much we actually may need to execute
+ * the instruction.  It is admitted if it fits in the memory that is not yet
+ * in use, both within the limit of the query and within the server wide
+ * budget.  Otherwise the instruction is queued until other workers release
+ * their memory, but a query always gets at least one worker.
  *
- * The client context also keeps bounds on the memory claim/client.
- * Surpassing this bound may be a reason to not admit the instruction to proceed.
+ * The claims of the instructions in flight are memory they are about to
+ * allocate, and whatever they allocated already is in the QryCtx as well.
+ * To not count those bytes twice, the larger of the two is taken.
  */
 bool
 MALadmission_claim(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci,
 				   lng argclaim)
 {
+	(void) mb;
 	(void) pci;
 
 	/* Check if we are allowed to allocate another worker thread for this client */
@@ -134,37 +207,23 @@ MALadmission_claim(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci,
 	if (argclaim == 0)
 		return true;
 
-	MT_lock_set(&admissionLock);
-	/* Determine if the total memory resource is exhausted, because it is overall limitation.  */
-	if (memorypool <= 0) {
-		// we accidently released too much memory or need to initialize
-		memorypool = (lng) MEMORY_THRESHOLD;
-	}
+	QryCtx *qc = &cntxt->qryctx;
+	lng used = (lng) ATOMIC_GET(&qc->datasize);
+	lng total = memoryInUse(cntxt);
 
-	/* the argument claim is based on the input for an instruction */
-	if (memorypool > argclaim || ATOMIC_GET(&cntxt->workers) == 0) {
-		/* If we are low on memory resources, limit the user if he exceeds his memory budget
-		 * but make sure there is at least one worker thread active */
-		if (cntxt->memorylimit) {
-			if (argclaim + stk->memory >
-				(lng) cntxt->memorylimit * LL_CONSTANT(1048576)
-				&& ATOMIC_GET(&cntxt->workers) > 0) {
-				MT_lock_unset(&admissionLock);
-				return false;
-			}
-			stk->memory += argclaim;
+	MT_lock_set(&admissionLock);
+	if (ATOMIC_GET(&cntxt->workers) > 0) {
+		if ((qc->maxmem > 0
+			 && MAX(used, stk->memory) + argclaim > (lng) qc->maxmem)
+			|| MAX(total, memoryclaimed) + argclaim > (lng) MEMORY_THRESHOLD) {
+			MT_lock_unset(&admissionLock);
+			return false;
 		}
-		memorypool -= argclaim;
-		stk->memory += argclaim;
-		MT_lock_set(&mal_delayLock);
-		if (mb->memory < stk->memory)
-			mb->memory = stk->memory;
-		MT_lock_unset(&mal_delayLock);
-		MT_lock_unset(&admissionLock);
-		return true;
 	}
+	memoryclaimed += argclaim;
+	stk->memory += argclaim;
 	MT_lock_unset(&admissionLock);
-	return false;
+	return true;
 }
 
 void
@@ -172,21 +231,95 @@ MALadmission_release(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci,
 					 lng argclaim)
 {
 	/* release memory claimed before */
-	(void) cntxt;
 	(void) mb;
 	(void) pci;
 	if (argclaim == 0)
 		return;
 
 	MT_lock_set(&admissionLock);
-	if (cntxt->memorylimit) {
-		stk->memory -= argclaim;
-	}
-	memorypool += argclaim;
-	if (memorypool > (lng) MEMORY_THRESHOLD) {
-		memorypool = (lng) MEMORY_THRESHOLD;
-	}
+	memoryclaimed -= argclaim;
+	if (memoryclaimed < 0)
+		memoryclaimed = 0;
 	stk->memory -= argclaim;
 	MT_lock_unset(&admissionLock);
-	return;
+	MALadmission_peak(cntxt, stk);
+}
+
+/*
+ * A new query is queued as long as the memory in use exceeds the server
+ * wide budget or the budget of its user, and other queries are running
+ * that will release memory.  It shows as "queued" in sys.queue and waits
+ * until a query finishes or is stopped, see MALadmission_wakeup.  It
+ * wakes up regularly to give up when the query times out or the client
+ * interrupts it.  A query that is stopped in the mean time is let through
+ * for the interpreter to deal with.
+ */
+static MT_Cond admissionCond = MT_COND_INITIALIZER(admissionCond);
+
+#define ADMISSIONPOLL	(100 * 1000)	/* usec between timeout checks of a queued query */
+
+str
+MALadmission_query(Client cntxt, MalBlkPtr mb, MalStkPtr stk)
+{
+	QryCtx *qc = &cntxt->qryctx;
+	str msg = MAL_SUCCEED;
+
+	(void) mb;
+
+	MT_lock_set(&mal_delayLock);
+	for (bool queued = false;; queued = true) {
+		bool admit = memoryInUse(cntxt) < (lng) MEMORY_THRESHOLD
+				&& (cntxt->maxmem <= 0 || userMemoryInUse(cntxt) < cntxt->maxmem);
+		size_t i, me = qsize;
+		int running = 0;
+
+		if (admit && !queued)
+			break;
+		for (i = 0; i < qsize; i++) {
+			if (QRYqueue[i].stk == stk)
+				me = i;
+			else if (QRYqueue[i].stk && QRYqueue[i].status
+					 && QRYqueue[i].status[0] == 'r')
+				running++;
+		}
+		if (queued && (GDKexiting() || TIMEOUT_TEST(qc))) {
+			msg = createException(MAL, "mal.interpreter",
+								  qc->endtime == QRY_TIMEOUT
+								  ? SQLSTATE(HYT00) RUNTIME_QRY_TIMEOUT
+								  : SQLSTATE(HYT00) RUNTIME_QRY_INTERRUPT);
+			admit = true;
+		}
+		if (admit || running == 0 || me == qsize || stk->status == 'q'
+			|| cntxt->mode == FINISHCLIENT) {
+			if (me < qsize && strcmp(QRYqueue[me].status, "queued") == 0)
+				QRYqueue[me].status = "running";
+			break;
+		}
+		if (stk->status == 0)
+			QRYqueue[me].status = "queued";
+
+		lng wait = ADMISSIONPOLL;
+		if (qc->endtime > 0 && qc->endtime - GDKusec() < wait)
+			wait = MAX(qc->endtime - GDKusec(), 1);
+		(void) MT_cond_timedwait(&admissionCond, &mal_delayLock, wait);
+	}
+	MT_lock_unset(&mal_delayLock);
+	return msg;
+}
+
+/* Let the queued queries check again, called with mal_delayLock held. */
+void
+MALadmission_wakeup(void)
+{
+	MT_cond_broadcast(&admissionCond);
+}
+
+/* The client leaves, its memory is no longer in use. */
+void
+MALadmission_exit(Client cntxt)
+{
+	(void) memoryInUse(cntxt);
+	MT_lock_set(&mal_delayLock);
+	MALadmission_wakeup();
+	MT_lock_unset(&mal_delayLock);
 }
@@ -30,6 +30,9 @@ extern bool MALadmission_claim(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 							   InstrPtr pci, lng argclaim);
 extern void MALadmission_release(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 								 InstrPtr pci, lng argclaim);
+extern str MALadmission_query(Client cntxt, MalBlkPtr mb, MalStkPtr stk);
+extern void MALadmission_peak(Client cntxt, MalStkPtr stk);
+extern void MALadmission_wakeup(void);
 
 #define FAIRNESS_THRESHOLD (MAX_DELAYS * DELAYUNIT)
 
@@ -38,6 +38,18 @@ static oid qtag = 1;			// A unique query identifier
 UserStats USRstats = NULL;
 size_t usrstatscnt = 0;
 
+/* The measured costs of the last run of recent SQL queries, for the
+ * mitosis optimizer.  Queries are hashed on their text, a newer query
+ * simply replaces an older one in its slot. */
+#define FEEDBACKSIZE 256
+static struct PLANFEEDBACK {
+	str query;
+	int pieces;					/* partitions used */
+	BUN rowcnt;					/* size of the partitioned table */
+	lng busy;					/* usec spent in instructions */
+	lng wall;					/* usec elapsed */
+} feedback[FEEDBACKSIZE];
+
 static inline void
 clearUSRstats(size_t idx)
 {
@@ -145,6 +157,76 @@ isaSQLquery(MalBlkPtr mb)
 	return NULL;
 }
 
+static void
+dropFeedback(void)
+{
+	MT_lock_set(&mal_delayLock);
+	for (int i = 0; i < FEEDBACKSIZE; i++) {
+		GDKfree(feedback[i].query);
+		feedback[i] = (struct PLANFEEDBACK) { 0 };
+	}
+	MT_lock_unset(&mal_delayLock);
+}
+
+/* called with mal_delayLock held */
+static void
+updateFeedback(MalBlkPtr mb, MalStkPtr stk, const char *query, lng wall)
+{
+	struct PLANFEEDBACK *f;
+	lng busy = (lng) ATOMIC_GET(&stk->busy);
+
+	if (query == NULL || mb->pieces == 0 || busy == 0)
+		return;
+	f = &feedback[strHash(query) % FEEDBACKSIZE];
+	if (f->query == NULL || strcmp(f->query, query) != 0) {
+		str q = GDKstrdup(query);
+		if (q == NULL)
+			return;
+		GDKfree(f->query);
+		f->query = q;
+	}
+	f->pieces = mb->pieces;
+	f->rowcnt = mb->rowcnt;
+	f->busy = busy;
+	f->wall = wall;
+}
+
+/* Look up the costs of the previous run of the SQL query of mb. */
+bool
+runtimeFeedback(MalBlkPtr mb, int *pieces, BUN *rowcnt, lng *busy, lng *wall)
+{
+	const char *query = isaSQLquery(mb);
+	bool found = false;
+
+	if (query == NULL)
+		return false;
+	MT_lock_set(&mal_delayLock);
+	struct PLANFEEDBACK *f = &feedback[strHash(query) % FEEDBACKSIZE];
+	if (f->query && strcmp(f->query, query) == 0) {
+		*pieces = f->pieces;
+		*rowcnt = f->rowcnt;
+		*busy = f->busy;
+		*wall = f->wall;
+		found = true;
+	}
+	MT_lock_unset(&mal_delayLock);
+	return found;
+}
+
+/* The number of queries currently being executed. */
+int
+runtimeRunning(void)
+{
+	int running = 0;
+
+	MT_lock_set(&mal_delayLock);
+	for (size_t i = 0; i < qsize; i++)
+		running += QRYqueue[i].stk != NULL && QRYqueue[i].status
+			&& QRYqueue[i].status[0] == 'r';
+	MT_lock_unset(&mal_delayLock);
+	return running;
+}
+
 /*
  * Manage the runtime profiling information
  * It is organized as a circular buffer, head/tail.
@@ -220,7 +302,7 @@ runtimeProfileInit(Client cntxt, MalBlkPtr mb, MalStkPtr stk)
 		}
 	}
 	for (i = 0; i < qsize; i++) {
-		paused += QRYqueue[i].status && (QRYqueue[i].status[0] == 'p' || QRYqueue[i].status[0] == 'r');	/* running, prepared or paused */
+		paused += QRYqueue[i].status && (QRYqueue[i].status[0] == 'p' || QRYqueue[i].status[0] == 'r' || QRYqueue[i].status[0] == 'q');	/* running, prepared, paused or queued */
 	}
 	if (qsize - paused < (size_t) MAL_MAXCLIENTS) {
 		qsize += MAL_MAXCLIENTS;
@@ -244,7 +326,8 @@ runtimeProfileInit(Client cntxt, MalBlkPtr mb, MalStkPtr stk)
 			qlast = 0;
 		if (QRYqueue[j].stk == NULL ||
 			QRYqueue[j].status == NULL ||
-			(QRYqueue[j].status[0] != 'r' && QRYqueue[j].status[0] != 'p')) {
+			(QRYqueue[j].status[0] != 'r' && QRYqueue[j].status[0] != 'p'
+			 && QRYqueue[j].status[0] != 'q')) {
 			QRYqueue[j].mb = mb;
 			QRYqueue[j].tag = stk->tag = mb->tag;
 			QRYqueue[j].stk = stk;	// for status pause 'p'/running '0'/ quiting 'q'
@@ -259,6 +342,9 @@ runtimeProfileInit(Client cntxt, MalBlkPtr mb, MalStkPtr stk)
 			QRYqueue[j].idx = cntxt->idx;
 			/* give the MB upperbound by addition of 1 MB */
 			QRYqueue[j].memory = 1 + (int) (stk->memory / LL_CONSTANT(1048576));	/* Convert to MB */
+			stk->datasize = (lng) ATOMIC_GET(&cntxt->qryctx.datasize);
+			ATOMIC_SET(&stk->peak, 0);
+			ATOMIC_SET(&stk->busy, 0);
 			QRYqueue[j].workers = (int) 1;	/* this is the first one */
 			QRYqueue[j].status = "running";
 			QRYqueue[j].cntxt = cntxt;
@@ -287,6 +373,7 @@ runtimeProfileFinish(Client cntxt, MalBlkPtr mb, MalStkPtr stk)
 	   how to stop/pause/resume queries doing recursive calls from multiple workers */
 	if (stk->up)
 		return;
+	MALadmission_peak(cntxt, stk);
 	MT_lock_set(&mal_delayLock);
 	for (i = 0; i < qsize; i++) {
 		if (QRYqueue[i].stk == stk) {
@@ -297,11 +384,14 @@ runtimeProfileFinish(Client cntxt, MalBlkPtr mb, MalStkPtr stk)
 			QRYqueue[i].finished = time(0);
 			QRYqueue[i].workers = (int) ATOMIC_GET(&mb->workers);
 			/* give the MB upperbound by addition of 1 MB */
-			QRYqueue[i].memory = 1 + (int) (mb->memory / LL_CONSTANT(1048576));
+			QRYqueue[i].memory = 1 + (int) ((lng) ATOMIC_GET(&stk->peak) / LL_CONSTANT(1048576));
 			QRYqueue[i].cntxt = NULL;
 			QRYqueue[i].stk = NULL;
 			QRYqueue[i].mb = NULL;
 			QRYqueue[i].ticks = GDKusec() - QRYqueue[i].ticks;
+			MALadmission_wakeup();
+			if (QRYqueue[i].status[0] == 'f')
+				updateFeedback(mb, stk, QRYqueue[i].query, QRYqueue[i].ticks);
 			updateUserStats(cntxt, mb, QRYqueue[i].ticks, QRYqueue[i].start,
 							QRYqueue[i].finished, QRYqueue[i].query);
 			// assume that the user is now idle
@@ -346,6 +436,7 @@ mal_runtime_reset(void)
 {
 	dropQRYqueue();
 	dropUSRstats();
+	dropFeedback();
 }
 
 /* At the start of each MAL stmt */
@@ -370,6 +461,10 @@ runtimeProfileExit(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci,
 {
 	lng ticks = GDKusec();
 
+	MALadmission_peak(cntxt, stk);
+	/* the work of a dataflow block is counted by its instructions */
+	if (pci != getInstrPtr(mb, 0) && pci->barrier == 0)
+		prof->busy += ticks - prof->ticks;
 	if (profilerStatus > 0)
 		profilerEvent(&(struct MalEvent) { cntxt, mb, stk, pci, ticks,
 					  ticks - prof->ticks },
@@ -27,6 +27,7 @@
 */
 typedef struct {
 	lng ticks;					/* at start of this profile interval */
+	lng busy;					/* usec spent in the instructions so far */
 } *RuntimeProfile, RuntimeProfileRecord;
 
 /* The actual running queries are assembled in a queue
@@ -67,6 +68,9 @@ extern void runtimeProfileBegin(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 								InstrPtr pci, RuntimeProfile prof);
 extern void runtimeProfileExit(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 							   InstrPtr pci, RuntimeProfile prof);
+extern bool runtimeFeedback(MalBlkPtr mb, int *pieces, BUN *rowcnt,
+							lng *busy, lng *wall);
+extern int runtimeRunning(void);
 extern lng getVolume(MalStkPtr stk, InstrPtr pci, int rd);
 extern lng getBatSpace(BAT *b);
 extern void sqlProfilerEvent(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
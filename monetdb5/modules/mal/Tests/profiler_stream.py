@@ -0,0 +1,146 @@
+import os, socket, struct, sys
+import pymonetdb
+from MonetDBtesting import malmapi
+
+# The binary profiler event stream (profiler.openstream(8)) as it is
+# sent to a client, decoded here and by profiler.tojson, and sampling
+# of the traced queries with profiler.setsample.
+
+port = int(os.getenv('MAPIPORT'))
+db = os.getenv('TSTDB')
+
+MAGIC = b'MDBPROF1'
+HDR = 80
+PROFREC_MAL = 1
+PROFREC_PHASE = 2
+
+def malconnect():
+    c = malmapi.Connection()
+    c.connect(database=db, username='monetdb', password='monetdb',
+              language='mal', hostname='localhost', port=port)
+    return c
+
+def readavailable(sock, timeout=2.0):
+    """read mapi blocks until nothing arrives for timeout seconds"""
+    data = bytearray()
+    sock.settimeout(timeout)
+    try:
+        while True:
+            hdr = b''
+            while len(hdr) < 2:
+                b = sock.recv(2 - len(hdr))
+                if not b:
+                    return bytes(data)
+                hdr += b
+            length = struct.unpack('<H', hdr)[0] >> 1
+            while length > 0:
+                b = sock.recv(length)
+                if not b:
+                    return bytes(data)
+                data += b
+                length -= len(b)
+    except socket.timeout:
+        pass
+    return bytes(data)
+
+def parse(data):
+    """split the stream into records, skipping the prompts of the
+    profiler's own session"""
+    recs = []
+    raw = bytearray()
+    pos = 0
+    while pos < len(data):
+        if data[pos] == 1:
+            # a prompt: \1\1\n or \1\2\n
+            pos += 3
+            continue
+        size, kind, phase, state, flags = struct.unpack_from('<IBBBB', data, pos)
+        if size < HDR or pos + size > len(data) or kind not in (PROFREC_MAL, PROFREC_PHASE):
+            raise ValueError(f'bad record at offset {pos}')
+        sessionid, pc, lmod, lfcn, lalg, _, lqry = struct.unpack_from('<IIHHHHI', data, pos + 12)
+        thread, tag, clk, usec = struct.unpack_from('<QQQQ', data, pos + 32)
+        off = pos + HDR
+        mod = data[off:off + lmod].decode(); off += lmod
+        fcn = data[off:off + lfcn].decode(); off += lfcn
+        off += lalg
+        qry = data[off:off + lqry].decode()
+        recs.append({'kind': kind, 'phase': phase, 'pc': pc, 'tag': tag,
+                     'module': mod, 'function': fcn, 'query': qry})
+        raw += data[pos:pos + size]
+        pos += size
+    return recs, bytes(raw)
+
+def resultsets(recs):
+    return sorted({r['tag'] for r in recs
+                   if r['kind'] == PROFREC_MAL and r['module'] == 'sql' and r['function'] == 'resultSet'})
+
+ctl = malconnect()
+prof = malconnect()
+conn = pymonetdb.connect(port=port, database=db, autocommit=True)
+cur = conn.cursor()
+
+ctl.cmd('profiler.setsample(1);\n')
+res = ctl.cmd('n:int := profiler.getsample(); io.print(n);\n')
+if '[ 1 ]' not in res:
+    sys.stderr.write(f'expected sample 1, got {res}\n')
+
+# start the binary stream, it starts with the magic
+prof._putblock('profiler.openstream(8);\n')
+data = readavailable(prof.socket)
+if not data.startswith(MAGIC):
+    sys.stderr.write(f'binary stream does not start with {MAGIC}: {data[:16]}\n')
+data = data[len(MAGIC):]
+# tracing starts with the first query after profiler.openstream
+cur.execute('select 0')
+cur.fetchall()
+readavailable(prof.socket)
+
+# every query is traced
+for i in range(6):
+    cur.execute(f'select {i} + 1')
+    if cur.fetchall() != [(i + 1,)]:
+        sys.stderr.write(f'wrong result for query {i}\n')
+data += readavailable(prof.socket)
+recs, raw = parse(data)
+tags = resultsets(recs)
+if len(tags) != 6:
+    sys.stderr.write(f'expected 6 traced queries, got tags {tags}\n')
+queries = [r['query'] for r in recs if r['kind'] == PROFREC_PHASE and r['query']]
+for i in range(6):
+    if not any(f'select {i} + 1' in q for q in queries):
+        sys.stderr.write(f'query text of query {i} missing from the stream\n')
+
+# profiler.tojson gives one JSON event per record
+res = ctl.cmd(f'b:blob := blob.blob("{(MAGIC + raw).hex()}"); s:str := profiler.tojson(b); io.printf("%s", s);\n')
+events = [l for l in res.splitlines() if l.startswith('{')]
+if len(events) != len(recs):
+    sys.stderr.write(f'profiler.tojson returned {len(events)} events for {len(recs)} records\n')
+if sum('"function":"resultSet"' in e for e in events) < 6:
+    sys.stderr.write('profiler.tojson lost the resultSet events\n')
+
+# only every third query is traced, and completely
+ctl.cmd('profiler.setsample(3);\n')
+res = ctl.cmd('n:int := profiler.getsample(); io.print(n);\n')
+if '[ 3 ]' not in res:
+    sys.stderr.write(f'expected sample 3, got {res}\n')
+for i in range(9):
+    cur.execute(f'select {i} * 2')
+    if cur.fetchall() != [(i * 2,)]:
+        sys.stderr.write(f'wrong result for sampled query {i}\n')
+recs, raw = parse(readavailable(prof.socket))
+tags = resultsets(recs)
+if len(tags) != 3 or any(t % 3 != 0 for t in tags):
+    sys.stderr.write(f'expected 3 traced queries with tags divisible by 3, got {tags}\n')
+for t in tags:
+    pcs = {r['pc'] for r in recs if r['kind'] == PROFREC_MAL and r['tag'] == t}
+    if 0 not in pcs or len(pcs) < 3:
+        sys.stderr.write(f'incomplete trace of query with tag {t}: {sorted(pcs)}\n')
+if any(r['tag'] % 3 != 0 for r in recs if r['kind'] == PROFREC_MAL):
+    sys.stderr.write('MAL events of a query that was not sampled\n')
+
+ctl.cmd('profiler.setsample(1);\n')
+ctl.cmd('profiler.stop();\n')
+cur.close()
+conn.close()
+prof.disconnect()
+ctl.disconnect()
@@ -1265,6 +1265,309 @@ CMDifthen(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 	return MAL_SUCCEED;
 }
 
+/*
+ * A fused chain of element-wise operations, created by the fuse
+ * optimizer.  The program is a semicolon separated list of operations
+ * of the form op:type:operand[,operand], where an operand is either $i,
+ * the i-th input argument (0-based, after the program), or #k, the
+ * result of the k-th operation.  The last operation produces the
+ * result.  E.g. X := batcalc.fused("*:lng:$0,$1;+:lng:#0,$2", A, B, C)
+ * computes A * B + C.
+ *
+ * The operations are executed by the normal GDK calculator functions,
+ * but on slices of FUSEDCHUNK rows, so that the intermediates stay in
+ * the CPU cache and only the final result is materialized in full.
+ */
+#define FUSEDCHUNK		(1 << 14)
+#define FUSEDMAXOPS		32
+
+enum fusedop {
+	FUSED_ADD, FUSED_SUB, FUSED_MUL, FUSED_DIV, FUSED_MOD,
+	FUSED_LT, FUSED_LE, FUSED_GT, FUSED_GE, FUSED_EQ, FUSED_NE,
+	FUSED_AND, FUSED_OR, FUSED_XOR, FUSED_CAST,
+};
+
+static const struct {
+	const char *name;
+	const char *malfunc;		/* for error messages */
+} fusednames[] = {
+	[FUSED_ADD] = {"+", "batcalc.+"},
+	[FUSED_SUB] = {"-", "batcalc.-"},
+	[FUSED_MUL] = {"*", "batcalc.*"},
+	[FUSED_DIV] = {"/", "batcalc./"},
+	[FUSED_MOD] = {"%", "batcalc.%"},
+	[FUSED_LT] = {"<", "batcalc.<"},
+	[FUSED_LE] = {"<=", "batcalc.<="},
+	[FUSED_GT] = {">", "batcalc.>"},
+	[FUSED_GE] = {">=", "batcalc.>="},
+	[FUSED_EQ] = {"==", "batcalc.=="},
+	[FUSED_NE] = {"!=", "batcalc.!="},
+	[FUSED_AND] = {"and", "batcalc.and"},
+	[FUSED_OR] = {"or", "batcalc.or"},
+	[FUSED_XOR] = {"xor", "batcalc.xor"},
+	[FUSED_CAST] = {"cast", "batcalc.convert"},
+};
+
+struct fusedstep {
+	enum fusedop op;
+	int tp;						/* result type */
+	int nargs;
+	struct {
+		bool res;				/* result of earlier step or input */
+		int idx;
+	} arg[2];
+};
+
+static str
+fused_parse(const char *prog, struct fusedstep *steps, int *nsteps, int ninputs)
+{
+	int n = 0;
+	const char *p = prog;
+
+	while (*p) {
+		char name[16];
+		const char *q;
+		size_t len;
+		int k;
+
+		if (n == FUSEDMAXOPS)
+			throw(MAL, "batcalc.fused", SQLSTATE(42000) "Program too long");
+		if ((q = strchr(p, ':')) == NULL || (len = (size_t) (q - p)) >= sizeof(name))
+			throw(MAL, "batcalc.fused", SQLSTATE(42000) "Illegal program");
+		for (k = 0; k <= FUSED_CAST; k++)
+			if (strlen(fusednames[k].name) == len
+				&& strncmp(fusednames[k].name, p, len) == 0)
+				break;
+		if (k > FUSED_CAST)
+			throw(MAL, "batcalc.fused", SQLSTATE(42000) "Illegal operation");
+		steps[n].op = (enum fusedop) k;
+		p = q + 1;
+		if ((q = strchr(p, ':')) == NULL || (len = (size_t) (q - p)) >= sizeof(name))
+			throw(MAL, "batcalc.fused", SQLSTATE(42000) "Illegal program");
+		strcpy_len(name, p, len + 1);
+		if ((steps[n].tp = ATOMindex(name)) < 0)
+			throw(MAL, "batcalc.fused", SQLSTATE(42000) "Illegal type");
+		p = q + 1;
+		steps[n].nargs = 0;
+		for (;;) {
+			char *e;
+			if (steps[n].nargs == 2 || (*p != '$' && *p != '#'))
+				throw(MAL, "batcalc.fused", SQLSTATE(42000) "Illegal operand");
+			bool res = *p++ == '#';
+			long idx = strtol(p, &e, 10);
+			if (e == p || idx < 0 || idx >= (res ? n : ninputs))
+				throw(MAL, "batcalc.fused", SQLSTATE(42000) "Illegal operand");
+			steps[n].arg[steps[n].nargs].res = res;
+			steps[n].arg[steps[n].nargs].idx = (int) idx;
+			steps[n].nargs++;
+			p = e;
+			if (*p != ',')
+				break;
+			p++;
+		}
+		if (steps[n].nargs != (steps[n].op == FUSED_CAST ? 1 : 2))
+			throw(MAL, "batcalc.fused", SQLSTATE(42000) "Illegal operand count");
+		n++;
+		if (*p == ';')
+			p++;
+		else if (*p)
+			throw(MAL, "batcalc.fused", SQLSTATE(42000) "Illegal program");
+	}
+	if (n == 0)
+		throw(MAL, "batcalc.fused", SQLSTATE(42000) "Empty program");
+	*nsteps = n;
+	return MAL_SUCCEED;
+}
+
+/* execute the program on one set of (sliced) inputs; intermediates are
+ * released as soon as they have been used */
+static BAT *
+fused_run(const struct fusedstep *steps, int nsteps, BAT **bats,
+		  const ValRecord **vals, BAT **res, const char **malfunc)
+{
+	for (int i = 0; i < nsteps; i++) {
+		const struct fusedstep *st = &steps[i];
+		BAT *b1 = NULL, *b2 = NULL, *bn = NULL;
+		const ValRecord *v1 = NULL, *v2 = NULL;
+
+		if (st->arg[0].res)
+			b1 = res[st->arg[0].idx];
+		else if ((b1 = bats[st->arg[0].idx]) == NULL)
+			v1 = vals[st->arg[0].idx];
+		if (st->nargs == 2) {
+			if (st->arg[1].res)
+				b2 = res[st->arg[1].idx];
+			else if ((b2 = bats[st->arg[1].idx]) == NULL)
+				v2 = vals[st->arg[1].idx];
+		}
+
+#define FUSEDARITH(F)													\
+		do {															\
+			if (b1 && b2)												\
+				bn = BATcalc##F(b1, b2, NULL, NULL, st->tp);			\
+			else if (b1)												\
+				bn = BATcalc##F##cst(b1, v2, NULL, st->tp);				\
+			else if (b2)												\
+				bn = BATcalccst##F(v1, b2, NULL, st->tp);				\
+		} while (0)
+#define FUSEDCMP(F)														\
+		do {															\
+			if (b1 && b2)												\
+				bn = BATcalc##F(b1, b2, NULL, NULL);					\
+			else if (b1)												\
+				bn = BATcalc##F##cst(b1, v2, NULL);						\
+			else if (b2)												\
+				bn = BATcalccst##F(v1, b2, NULL);						\
+		} while (0)
+#define FUSEDEQ(F)														\
+		do {															\
+			if (b1 && b2)												\
+				bn = BATcalc##F(b1, b2, NULL, NULL, false);				\
+			else if (b1)												\
+				bn = BATcalc##F##cst(b1, v2, NULL, false);				\
+			else if (b2)												\
+				bn = BATcalccst##F(v1, b2, NULL, false);				\
+		} while (0)
+
+		switch (st->op) {
+		case FUSED_ADD: FUSEDARITH(add); break;
+		case FUSED_SUB: FUSEDARITH(sub); break;
+		case FUSED_MUL: FUSEDARITH(mul); break;
+		case FUSED_DIV: FUSEDARITH(div); break;
+		case FUSED_MOD: FUSEDARITH(mod); break;
+		case FUSED_LT: FUSEDCMP(lt); break;
+		case FUSED_LE: FUSEDCMP(le); break;
+		case FUSED_GT: FUSEDCMP(gt); break;
+		case FUSED_GE: FUSEDCMP(ge); break;
+		case FUSED_EQ: FUSEDEQ(eq); break;
+		case FUSED_NE: FUSEDEQ(ne); break;
+		case FUSED_AND: FUSEDCMP(and); break;
+		case FUSED_OR: FUSEDCMP(or); break;
+		case FUSED_XOR: FUSEDCMP(xor); break;
+		case FUSED_CAST:
+			if (b1)
+				bn = BATconvert(b1, NULL, st->tp, 0, 0, 0);
+			break;
+		}
+		/* each intermediate is used exactly once */
+		for (int j = 0; j < st->nargs; j++)
+			if (st->arg[j].res) {
+				BBPreclaim(res[st->arg[j].idx]);
+				res[st->arg[j].idx] = NULL;
+			}
+		if (bn == NULL) {
+			*malfunc = fusednames[st->op].malfunc;
+			return NULL;
+		}
+		res[i] = bn;
+	}
+	BAT *bn = res[nsteps - 1];
+	res[nsteps - 1] = NULL;
+	return bn;
+}
+
+static str
+CMDbatFUSED(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	struct fusedstep steps[FUSEDMAXOPS];
+	BAT *res[FUSEDMAXOPS] = { 0 };
+	int nsteps, ninputs = pci->argc - 2, tp;
+	BAT **bats, **slices, *bn = NULL, *r, *first = NULL;
+	const ValRecord **vals;
+	const char *malfunc = "batcalc.fused";
+	str msg;
+	BUN cnt = 0;
+
+	(void) cntxt;
+
+	if ((msg = fused_parse(*getArgReference_str(stk, pci, 1), steps, &nsteps,
+						   ninputs)) != MAL_SUCCEED)
+		return msg;
+	tp = getBatType(getArgType(mb, pci, 0));
+	if (steps[nsteps - 1].tp != tp)
+		throw(MAL, "batcalc.fused", SQLSTATE(42000) "Result type mismatch");
+
+	bats = GDKzalloc(2 * ninputs * sizeof(BAT *));
+	vals = GDKzalloc(ninputs * sizeof(ValRecord *));
+	if (bats == NULL || vals == NULL) {
+		GDKfree(bats);
+		GDKfree(vals);
+		throw(MAL, "batcalc.fused", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	}
+	slices = bats + ninputs;
+	for (int i = 0; i < ninputs; i++) {
+		if (stk->stk[getArg(pci, i + 2)].bat) {
+			if ((bats[i] = BATdescriptor(*getArgReference_bat(stk, pci, i + 2))) == NULL) {
+				msg = createException(MAL, "batcalc.fused",
+									  SQLSTATE(HY002) RUNTIME_OBJECT_MISSING);
+				goto bailout;
+			}
+			if (first == NULL) {
+				first = bats[i];
+				cnt = BATcount(first);
+			} else if (BATcount(bats[i]) != cnt) {
+				msg = createException(MAL, "batcalc.fused",
+									  SQLSTATE(42000) "inputs not the same size");
+				goto bailout;
+			}
+		} else {
+			vals[i] = &stk->stk[getArg(pci, i + 2)];
+		}
+	}
+	if (first == NULL) {
+		msg = createException(MAL, "batcalc.fused",
+							  SQLSTATE(42000) "No BAT input");
+		goto bailout;
+	}
+
+	if (cnt <= FUSEDCHUNK) {
+		/* nothing to gain from slicing */
+		bn = fused_run(steps, nsteps, bats, vals, res, &malfunc);
+		if (bn == NULL)
+			goto bailout;
+	} else {
+		bn = COLnew(first->hseqbase, tp, cnt, TRANSIENT);
+		if (bn == NULL)
+			goto bailout;
+		for (BUN lo = 0; lo < cnt; lo += FUSEDCHUNK) {
+			BUN hi = MIN(cnt, lo + FUSEDCHUNK);
+			for (int i = 0; i < ninputs; i++) {
+				if (bats[i] && (slices[i] = BATslice(bats[i], lo, hi)) == NULL)
+					goto bailout;
+			}
+			r = fused_run(steps, nsteps, slices, vals, res, &malfunc);
+			for (int i = 0; i < ninputs; i++) {
+				BBPreclaim(slices[i]);
+				slices[i] = NULL;
+			}
+			if (r == NULL || BATappend(bn, r, NULL, false) != GDK_SUCCEED) {
+				BBPreclaim(r);
+				goto bailout;
+			}
+			BBPreclaim(r);
+		}
+	}
+	for (int i = 0; i < ninputs; i++)
+		BBPreclaim(bats[i]);
+	GDKfree(bats);
+	GDKfree(vals);
+	*getArgReference_bat(stk, pci, 0) = bn->batCacheid;
+	BBPkeepref(bn);
+	return MAL_SUCCEED;
+
+  bailout:
+	for (int i = 0; i < nsteps; i++)
+		BBPreclaim(res[i]);
+	for (int i = 0; i < 2 * ninputs; i++)
+		BBPreclaim(bats[i]);
+	GDKfree(bats);
+	GDKfree(vals);
+	BBPreclaim(bn);
+	if (msg == MAL_SUCCEED)
+		msg = mythrow(MAL, malfunc, GDK_EXCEPTION);
+	return msg;
+}
+
 #include "mel.h"
 
 static str
@@ -1955,6 +2258,8 @@ static mel_func batcalc_init_funcs[] = {
  pattern("aggr", "avg", CMDcalcavg, false, "Gives the avg of all tail values", args(1,2, arg("",dbl),batargany("b",1))),
  pattern("aggr", "avg", CMDcalcavg, false, "Gives the avg of all tail values", args(1,3, arg("",dbl),batargany("b",1),arg("scale",int))),
 
+ pattern("batcalc", "fused", CMDbatFUSED, false, "Evaluate a chain of element-wise operations fused by the fuse optimizer", args(1,3, batargany("",0),arg("prog",str),varargany("arg",0))),
+
  pattern("batcalc", "ifthenelse", CMDifthen, false, "If-then-else operation to assemble a conditional result", args(1,4, batargany("",1),arg("v",bit),batargany("b1",1),batargany("b2",1))),
  pattern("batcalc", "ifthenelse", CMDifthen, false, "If-then-else operation to assemble a conditional result", args(1,4, batargany("",1),arg("v",bit),argany("v1",1),batargany("b2",1))),
  pattern("batcalc", "ifthenelse", CMDifthen, false, "If-then-else operation to assemble a conditional result", args(1,4, batargany("",1),arg("v",bit),batargany("b1",1),argany("v2",1))),
@@ -61,7 +61,12 @@ ITRnewChunk(lng *res, bat *vid, const bat *bid, const lng *granule)
 	}
 	/*  printf("set bat chunk bound to " LLFMT " 0 - " BUNFMT "\n",
 	 *granule, MIN(BATcount(b),(BUN) *granule)); */
-	view = VIEWcreate(b->hseqbase, b, 0, (BUN) *granule);
+	/* a view cannot describe part of a candidate list with
+	 * exceptions, so those are sliced instead */
+	if (complex_cand(b))
+		view = BATslice(b, 0, (BUN) *granule);
+	else
+		view = VIEWcreate(b->hseqbase, b, 0, (BUN) *granule);
 	if (view == NULL) {
 		BBPunfix(b->batCacheid);
 		throw(MAL, "chop.newChunk", GDK_EXCEPTION);
@@ -102,11 +107,23 @@ ITRnextChunk(lng *res, bat *vid, const bat *bid, const lng *granule)
 	}
 	/* printf("set bat chunk bound to " BUNFMT " - " BUNFMT " \n",
 	   i, i+(BUN) *granule-1); */
-	VIEWbounds(b, view, i, i + (BUN) *granule);
-	MT_lock_set(&b->theaplock);
-	view->tkey = b->tkey | (*granule <= 1);
-	MT_lock_unset(&b->theaplock);
-	BAThseqbase(view, is_oid_nil(b->hseqbase) ? oid_nil : b->hseqbase + i);
+	if (complex_cand(b)) {
+		BBPunfix(view->batCacheid);
+		view = BATslice(b, i, i + (BUN) *granule);
+		if (view == NULL) {
+			BBPunfix(b->batCacheid);
+			throw(MAL, "iterator.nextChunk", GDK_EXCEPTION);
+		}
+	} else {
+		/* VIEWbounds shifts the sequence base of the view, which
+		 * still refers to the previous chunk */
+		view->tseqbase = b->tseqbase;
+		VIEWbounds(b, view, i, i + (BUN) *granule);
+		MT_lock_set(&b->theaplock);
+		view->tkey = b->tkey | (*granule <= 1);
+		MT_lock_unset(&b->theaplock);
+		BAThseqbase(view, is_oid_nil(b->hseqbase) ? oid_nil : b->hseqbase + i);
+	}
 	*vid = view->batCacheid;
 	BBPkeepref(view);
 	BBPunfix(b->batCacheid);
@@ -223,9 +223,11 @@ doChallenge(void *data)
 	}
 
 	/* Send the challenge over the block stream
-	 * We can do binary transfers, and we can interrupt queries using
-	 * out-of-band messages */
-	mnstr_printf(fdout, "%s:mserver:9:%s:%s:%s:sql=%d:BINARY=1:OOBINTR=1:CLIENTINFO:",
+	 * We can do binary transfers (level 2: Xexportbin blocks can be
+	 * compressed, see Xbinary_compression), we can interrupt queries
+	 * using out-of-band messages and we can export results as Arrow
+	 * IPC streams (Xexportarrow) */
+	mnstr_printf(fdout, "%s:mserver:9:%s:%s:%s:sql=%d:BINARY=2:OOBINTR=1:CLIENTINFO:ARROW=1:",
 				 challenge, mcrypt_getHashAlgorithms(),
 #ifdef WORDS_BIGENDIAN
 				 "BIG",
@@ -56,6 +56,7 @@
 #include "mal_namespace.h"
 #include "mal_authorize.h"
 #include "mal_function.h"
+#include "mal_internal.h"
 
 #define MDBstatus(X) \
 	if( stk->cmd && X==0 ) \
@@ -636,6 +637,98 @@ MDBvar3(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr p)
 	return NULL;
 }
 
+/*
+ * Microbenchmark of the interpreter loop: run the routine M.F n times,
+ * once with the fast loop for straight-line plans enabled and once with
+ * the general loop only, and report the MAL instructions per second.
+ * The choice of loop is made on the stack of the routine, so other
+ * users are not affected.  The scalar results of the last run with
+ * either loop must be the same, and the routine must have been run
+ * with the fast loop at all.
+ */
+static str
+MDBbenchmark(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr p)
+{
+	dbl *fast = getArgReference_dbl(stk, p, 0);
+	dbl *generic = getArgReference_dbl(stk, p, 1);
+	str modnme = *getArgReference_str(stk, p, 2);
+	str fcnnme = *getArgReference_str(stk, p, 3);
+	int n = *getArgReference_int(stk, p, 4);
+	Symbol s;
+	MalBlkPtr def;
+	InstrPtr sig;
+	MalStkPtr fstk;
+	ValRecord res[MAXARG];
+	str msg = MAL_SUCCEED;
+
+	s = findSymbol(cntxt->usermodule, putName(modnme), putName(fcnnme));
+	if (s == NULL)
+		throw(MAL, "mdb.benchmark", "Could not find %s.%s", modnme, fcnnme);
+	def = s->def;
+	sig = getInstrPtr(def, 0);
+	if (def == mb || sig->argc > sig->retc)
+		throw(MAL, "mdb.benchmark", "%s.%s should not have arguments",
+			  modnme, fcnnme);
+	if (sig->retc > MAXARG)
+		throw(MAL, "mdb.benchmark", "%s.%s has too many results",
+			  modnme, fcnnme);
+	if (is_int_nil(n) || n <= 0)
+		throw(MAL, "mdb.benchmark", ILLEGAL_ARGUMENT);
+	if ((fstk = prepareMALstack(def, def->vsize)) == NULL)
+		throw(MAL, "mdb.benchmark", MAL_STACK_FAIL);
+	fstk->blk = def;
+	/* keep the results of the routine around */
+	fstk->keepAlive = true;
+	for (int i = 0; i < sig->retc; i++)
+		res[i] = (ValRecord) {.vtype = TYPE_void,};
+
+	for (int k = 0; k < 2 && msg == MAL_SUCCEED; k++) {
+		lng t0, runs = straightlineRuns();
+
+		fstk->nofastpath = k != 0;
+		t0 = GDKusec();
+		for (int i = 0; i < n && msg == MAL_SUCCEED; i++) {
+			if (i > 0)
+				garbageCollector(cntxt, def, fstk, true);
+			msg = runMAL(cntxt, def, mb, fstk);
+		}
+		t0 = GDKusec() - t0;
+		/* other clients can only add to the count */
+		if (msg == MAL_SUCCEED && k == 0 && straightlineRuns() - runs < n)
+			msg = createException(MAL, "mdb.benchmark",
+								  "%s.%s was not run with the fast loop",
+								  modnme, fcnnme);
+		*(k == 0 ? fast : generic) = (dbl) n * (def->stop - 1) * 1000000.0 / (dbl) (t0 > 0 ? t0 : 1);
+		for (int i = 0; i < sig->retc && msg == MAL_SUCCEED; i++) {
+			const ValRecord *v = &fstk->stk[getArg(sig, i)];
+			if (v->bat)
+				continue;
+			if (k == 0) {
+				if (VALcopy(&res[i], v) == NULL)
+					msg = createException(MAL, "mdb.benchmark",
+										  SQLSTATE(HY013) MAL_MALLOC_FAIL);
+			} else if (VALcmp(&res[i], v) != 0) {
+				msg = createException(MAL, "mdb.benchmark",
+									  "%s.%s returned different results with the fast and the general loop",
+									  modnme, fcnnme);
+			}
+		}
+		garbageCollector(cntxt, def, fstk, true);
+	}
+	for (int i = 0; i < sig->retc; i++)
+		VALclear(&res[i]);
+	freeStack(fstk);
+	return msg;
+}
+
+/* the number of plans run with the straight-line interpreter loop */
+static str
+MDBfastpath(lng *ret)
+{
+	*ret = straightlineRuns();
+	return MAL_SUCCEED;
+}
+
 /*
  * It is illustrative to dump the code when you
  * have encountered an error.
@@ -767,6 +860,8 @@ mel_func mdb_init_funcs[] = {
  pattern("mdb", "List", MDBlist3Detail, false, "Dump the routine M.F on standard out.", args(1,3, arg("",void),arg("M",str),arg("F",str))),
  pattern("mdb", "var", MDBvar, false, "Dump the symboltable of current routine on standard out.", args(1,1, arg("",void))),
  pattern("mdb", "var", MDBvar3, false, "Dump the symboltable of routine M.F on standard out.", args(1,3, arg("",void),arg("M",str),arg("F",str))),
+ pattern("mdb", "benchmark", MDBbenchmark, false, "Run the routine M.F n times with the straight-line and with the general\ninterpreter loop, check that both give the same results, and return\nthe MAL instructions executed per second", args(2,5, arg("fast",dbl),arg("general",dbl),arg("M",str),arg("F",str),arg("n",int))),
+ command("mdb", "fastpath", MDBfastpath, false, "The number of plans run with the straight-line interpreter loop since\nserver start", args(1,1, arg("",lng))),
  pattern("mdb", "getStackDepth", MDBStkDepth, false, "Return the depth of the calling stack.", args(1,1, arg("",int))),
  pattern("mdb", "getStackFrame", MDBgetStackFrameN, false, "", args(2,3, batarg("",str),batarg("",str),arg("i",int))),
  pattern("mdb", "getStackFrame", MDBgetStackFrame, false, "Collect variable binding of current (n-th) stack frame.", args(2,2, batarg("",str),batarg("",str))),
@@ -162,6 +162,35 @@ CMDsetprofilerlimit(void *res, const int *lim)
 	return MAL_SUCCEED;
 }
 
+static str
+CMDgetprofilersample(int *res)
+{
+	*res = getprofilersample();
+	return MAL_SUCCEED;
+}
+
+static str
+CMDsetprofilersample(void *res, const int *n)
+{
+	(void) res;
+	if (is_int_nil(*n) || *n < 1)
+		throw(MAL, "profiler.setsample", ILLEGAL_ARGUMENT);
+	setprofilersample(*n);
+	return MAL_SUCCEED;
+}
+
+static str
+CMDbinaryToJSON(str *ret, const blob *const *b)
+{
+	if (is_blob_nil(*b)) {
+		*ret = GDKstrdup(str_nil);
+		if (*ret == NULL)
+			throw(MAL, "profiler.tojson", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		return MAL_SUCCEED;
+	}
+	return profilerBinaryToJSON((*b)->data, (*b)->nitems, ret);
+}
+
 /*
  * Tracing an active system.
  */
@@ -235,6 +264,9 @@ mel_func profiler_init_funcs[] = {
  command("profiler", "setheartbeat", CMDsetHeartbeat, true, "Set heart beat performance tracing", args(1,2, arg("",void),arg("b",int))),
  command("profiler", "getlimit", CMDgetprofilerlimit, false, "Get profiler limit", args(1,1, arg("",int))),
  command("profiler", "setlimit", CMDsetprofilerlimit, true, "Set profiler limit", args(1,2, arg("",void),arg("l",int))),
+ command("profiler", "getsample", CMDgetprofilersample, false, "Get the fraction of the queries traced in the binary event stream", args(1,1, arg("",int))),
+ command("profiler", "setsample", CMDsetprofilersample, true, "Trace only every n-th query in the binary event stream", args(1,2, arg("",void),arg("n",int))),
+ command("profiler", "tojson", CMDbinaryToJSON, false, "Convert a binary profiler event stream into the JSON events", args(1,2, arg("",str),arg("b",blob))),
  pattern("profiler", "openstream", CMDopenProfilerStream, false, "Start profiling the events, send to output stream", args(1,1, arg("",void))),
  pattern("profiler", "openstream", CMDopenProfilerStream, false, "Start profiling the events, send to output stream", args(1,2, arg("",void), arg("m",int))),
  pattern("profiler", "closestream", CMDcloseProfilerStream, false, "Stop offline proviling", args(1,1, arg("",void))),
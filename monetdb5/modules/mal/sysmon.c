@@ -19,6 +19,9 @@
 #include "gdk_time.h"
 #include "mal_exception.h"
 #include "mal_internal.h"
+#include "mal_dataflow.h"
+#include "mal_recycle.h"
+#include "mal_resource.h"
 
 /* (c) M.L. Kersten
  * The queries currently in execution are returned to the front-end for managing expensive ones.
@@ -183,6 +186,32 @@ SYSMONstatistics(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 	return msg;
 }
 
+static str
+SYSMONdataflow(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	const char *names[DFLOW_NSTATS];
+	lng vals[DFLOW_NSTATS];
+
+	(void) cntxt;
+	(void) mb;
+
+	DFLOWstatistics(names, vals);
+	return statisticsResult(stk, pci, "SYSMONdataflow", names, vals, DFLOW_NSTATS);
+}
+
+static str
+SYSMONrecycle(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	const char *names[RECYCLE_NSTATS];
+	lng vals[RECYCLE_NSTATS];
+
+	(void) cntxt;
+	(void) mb;
+
+	RECYCLEstatistics(names, vals);
+	return statisticsResult(stk, pci, "SYSMONrecycle", names, vals, RECYCLE_NSTATS);
+}
+
 static str
 SYSMONqueue(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 {
@@ -288,9 +317,13 @@ SYSMONqueue(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 				wrk = (int) ATOMIC_GET(&QRYqueue[i].mb->workers);
 			else
 				wrk = QRYqueue[i].workers;
-			if (QRYqueue[i].mb)
-				mem = (int) (1 + QRYqueue[i].mb->memory / LL_CONSTANT(1048576));
-			else
+			if (QRYqueue[i].mb) {
+				/* the memory in use now or the peak so far */
+				lng used = QRYqueue[i].cntxt ? (lng) ATOMIC_GET(&QRYqueue[i].cntxt->qryctx.datasize) - QRYqueue[i].stk->datasize : 0;
+				if (used < (lng) ATOMIC_GET(&QRYqueue[i].stk->peak))
+					used = (lng) ATOMIC_GET(&QRYqueue[i].stk->peak);
+				mem = (int) (1 + used / LL_CONSTANT(1048576));
+			} else
 				mem = QRYqueue[i].memory;
 			if (BUNappend(workers, &wrk, false) != GDK_SUCCEED ||
 				BUNappend(memory, &mem, false) != GDK_SUCCEED)
@@ -484,6 +517,7 @@ SYSMONstop(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 					|| (owner = strcmp(QRYqueue[i].username, cntxt->username)) == 0) {
 					QRYqueue[i].stk->status = 'q';
 					QRYqueue[i].status = "stopping";
+					MALadmission_wakeup();
 					paused = true;
 				}
 				/* tag found, but either not admin or user cannot
@@ -521,6 +555,8 @@ mel_func sysmon_init_funcs[] = {
 	pattern("sysmon", "queue", SYSMONqueue, false, "A queue of queries that are currently being executed or recently finished", args(9, 9, batarg("tag", lng), batarg("sessionid", int), batarg("user", str), batarg("started", timestamp), batarg("status", str), batarg("query", str), batarg("finished", timestamp), batarg("workers", int), batarg("memory", int))),
 	pattern("sysmon", "queue", SYSMONqueue, false, "Sysadmin call, to see either the global queue or user queue of queries that are currently being executed or recently finished", args(9, 10, batarg("tag", lng), batarg("sessionid", int), batarg("user", str), batarg("started", timestamp), batarg("status", str), batarg("query", str), batarg("finished", timestamp), batarg("workers", int), batarg("memory", int), arg("user", str))),
 	pattern("sysmon", "user_statistics", SYSMONstatistics, false, "", args(7, 7, batarg("user", str), batarg("querycount", lng), batarg("totalticks", lng), batarg("started", timestamp), batarg("finished", timestamp), batarg("maxticks", lng), batarg("maxquery", str))),
+	pattern("sysmon", "dataflow", SYSMONdataflow, false, "Statistics of the dataflow scheduler since server start", args(2, 2, batarg("name", str), batarg("value", lng))),
+	pattern("sysmon", "recycle", SYSMONrecycle, false, "Statistics of the intermediate result recycler since server start", args(2, 2, batarg("name", str), batarg("value", lng))),
 	{ .imp=NULL }
 };
 #include "mal_import.h"
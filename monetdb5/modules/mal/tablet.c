@@ -551,6 +551,7 @@ typedef struct {
 	int id;						/* for self reference */
 	int state;					/* row break=1 , 2 = update bat */
 	int workers;				/* how many concurrent ones */
+	int scanners;				/* how many threads may split records */
 	int error;					/* error during row break */
 	int next;
 	int limit;
@@ -1235,6 +1236,197 @@ mkdfa(const unsigned char *sep, size_t seplen)
 #endif
 #endif
 
+/*
+ * Splitting the input into records is inherently sequential: whether a
+ * record separator ends a record depends on the quote state, which
+ * depends on everything before it.  For large buffers we nevertheless
+ * scan in parallel.  The buffer is cut into chunks at arbitrary
+ * offsets, and each chunk is scanned by its own thread as if it
+ * started outside a quoted field.  Since quotes toggle the state and
+ * escapes behave the same inside and outside quotes, a chunk that
+ * actually starts inside a quoted field simply has its quote parity
+ * inverted.  Each chunk therefore records all candidate separators
+ * together with the quote parity in front of them, and the producer
+ * stitches the chunks together by keeping only those candidates whose
+ * parity matches the running parity of the preceding chunks.
+ *
+ * The scanners only deal with the common case of a single byte record
+ * separator.  Anything unusual (a NUL byte, invalid UTF-8) stops the
+ * scan of a chunk; the producer stitches up to that point and leaves
+ * the remainder to the sequential scanner, which produces the proper
+ * error messages.
+ */
+
+#define MAXSCANNERS	MAXWORKERS
+#define SCANCHUNK	(128 * 1024)	/* minimum number of bytes per scanner */
+
+typedef struct {
+	size_t off;					/* offset of separator from start of chunk */
+	lng nl;						/* newlines up to and including the separator */
+	bool odd;					/* odd number of quotes in front */
+} SCANcand;
+
+typedef struct {
+	const char *s, *end;		/* chunk to be scanned */
+	const char *stop;			/* where the scan stopped */
+	char quote, rsep;
+	bool escape;
+	bool odd;					/* quote parity of the whole chunk */
+	bool complete;				/* scanned until end in a clean state */
+	lng nl;						/* newlines in the whole chunk */
+	SCANcand *cand;
+	size_t ncand, maxcand;
+	MT_Id tid;
+} SCANtask;
+
+/* Word at a time test whether any byte of w equals zero; c * ONES
+ * broadcasts byte c into all bytes of a word. */
+#define ONES	((uint64_t) 0x0101010101010101)
+#define HIGHS	((uint64_t) 0x8080808080808080)
+#define haszero(w)	(((w) - ONES) & ~(w) & HIGHS)
+#define hasbyte(w, c)	haszero((w) ^ ((uint64_t) (unsigned char) (c) * ONES))
+
+static void
+SQLscanner(void *p)
+{
+	SCANtask *scan = p;
+	const unsigned char *s = (const unsigned char *) scan->s;
+	const unsigned char *end = (const unsigned char *) scan->end;
+	const unsigned char *e = s;
+	const char quote = scan->quote, rsep = scan->rsep;
+	const bool escape = scan->escape;
+	int nutf = 0, m = 0;
+	bool bs = false, odd = false;
+	lng nl = 0;
+
+	scan->ncand = 0;
+	while (e < end) {
+		if (nutf == 0 && !bs) {
+			/* skip over plain ASCII text without any special
+			 * characters a word at a time */
+			while (e + sizeof(uint64_t) <= end) {
+				uint64_t w;
+				memcpy(&w, e, sizeof(w));
+				if ((w & HIGHS) || haszero(w) || hasbyte(w, '\n')
+					|| hasbyte(w, rsep) || (quote && hasbyte(w, quote))
+					|| (escape && hasbyte(w, '\\')))
+					break;
+				e += sizeof(w);
+			}
+			if (e == end)
+				break;
+		}
+		if (*e == 0)
+			break;
+		/* check for correctly encoded UTF-8, see SQLproducer */
+		if (nutf > 0) {
+			if (unlikely((*e & 0xC0) != 0x80))
+				break;
+			if (unlikely(m != 0 && (*e & m) == 0))
+				break;
+			m = 0;
+			nutf--;
+		} else if ((*e & 0x80) != 0) {
+			if ((*e & 0xE0) == 0xC0) {
+				nutf = 1;
+				if (unlikely((e[0] & 0x1E) == 0))
+					break;
+			} else if ((*e & 0xF0) == 0xE0) {
+				nutf = 2;
+				if ((e[0] & 0x0F) == 0)
+					m = 0x20;
+			} else if (likely((*e & 0xF8) == 0xF0)) {
+				nutf = 3;
+				if ((e[0] & 0x07) == 0)
+					m = 0x30;
+			} else {
+				break;
+			}
+		} else if (*e == '\n')
+			nl++;
+		if (bs) {
+			bs = false;
+		} else if (escape && *e == '\\') {
+			bs = true;
+		} else if (*e == (unsigned char) quote) {
+			odd = !odd;
+		} else if (*e == (unsigned char) rsep) {
+			if (scan->ncand == scan->maxcand) {
+				size_t n = scan->maxcand ? 2 * scan->maxcand : 1024;
+				SCANcand *c = GDKrealloc(scan->cand, n * sizeof(SCANcand));
+				if (c == NULL)
+					break;
+				scan->cand = c;
+				scan->maxcand = n;
+			}
+			scan->cand[scan->ncand++] = (SCANcand) {
+				.off = (size_t) (e - s),
+				.nl = nl,
+				.odd = odd,
+			};
+		}
+		e++;
+	}
+	scan->stop = (const char *) e;
+	scan->odd = odd;
+	scan->nl = nl;
+	scan->complete = e == end && nutf == 0 && !bs;
+}
+
+/* Scan the records in [s, end) in parallel.  Returns the number of
+ * chunks scanned, or 0 if the buffer is too small to bother. */
+static int
+SQLscan(READERtask *task, SCANtask *scan, const char *s, const char *end)
+{
+	size_t len = (size_t) (end - s), chunk;
+	int i, n;
+
+	if (task->scanners <= 1 || len < 2 * SCANCHUNK)
+		return 0;
+	n = (int) (len / SCANCHUNK);
+	if (n > task->scanners)
+		n = task->scanners;
+	chunk = len / n;
+	for (i = 0; i < n; i++) {
+		const char *e = i == n - 1 ? end : s + chunk;
+		/* do not cut in the middle of a UTF-8 sequence or right
+		 * after an escape character, so that each chunk starts in
+		 * a clean state, apart from its quote state */
+		if (i < n - 1)
+			while (e < end
+				   && ((*e & 0xC0) == 0x80 || (task->escape && e[-1] == '\\')))
+				e++;
+		scan[i].s = s;
+		scan[i].end = e;
+		scan[i].quote = task->quote;
+		scan[i].rsep = task->rsep[0];
+		scan[i].escape = task->escape;
+		s = e;
+	}
+	for (i = 1; i < n; i++) {
+		char name[MT_NAME_LEN];
+		snprintf(name, sizeof(name), "scan%d", i);
+		if (MT_create_thread(&scan[i].tid, SQLscanner, &scan[i],
+							 MT_THR_JOINABLE, name) < 0)
+			scan[i].tid = 0;
+	}
+	SQLscanner(&scan[0]);
+	for (i = 1; i < n; i++) {
+		if (scan[i].tid)
+			MT_join_thread(scan[i].tid);
+		else
+			SQLscanner(&scan[i]);
+	}
+	return n;
+}
+
+static void
+SQLscanfree(SCANtask *scan)
+{
+	for (int i = 0; i < MAXSCANNERS; i++)
+		GDKfree(scan[i].cand);
+}
+
 static void
 SQLproducer(void *p)
 {
@@ -1249,6 +1441,8 @@ SQLproducer(void *p)
 	size_t rseplen = strlen(rsep), partial = 0;
 	char quote = task->quote;
 	dfa_t rdfa;
+	SCANtask scan[MAXSCANNERS] = { 0 };
+	int nscan;
 	lng rowno = 0;
 	lng lineno = 1;
 	lng startlineno = 1;
@@ -1344,6 +1538,41 @@ SQLproducer(void *p)
 			ateof[cur] = true;
 			goto reportlackofinput;
 		}
+		if (rseplen == 1 && task->skip == 0 && cnt < task->maxrow
+			&& (unsigned char) rsep[0] < 0x80 && (unsigned char) quote < 0x80
+			&& rsep[0] != quote && rsep[0] != '\\'
+			&& (nscan = SQLscan(task, scan, s, end)) > 0) {
+			/* stitch the records found by the parallel scanners, the
+			 * sequential loop below takes care of the remainder */
+			lng chunklineno = lineno;
+			bool odd = false;
+			e = s;
+			for (int k = 0; k < nscan; k++) {
+				for (size_t j = 0; j < scan[k].ncand; j++) {
+					if (scan[k].cand[j].odd != odd)
+						continue;	/* separator inside a quoted field */
+					e = (char *) scan[k].s + scan[k].cand[j].off;
+					rowno++;
+					lineno = chunklineno + scan[k].cand[j].nl;
+					task->startlineno[cur][task->top[cur]] = startlineno;
+					task->rows[cur][task->top[cur]++] = s;
+					startlineno = lineno;
+					cnt++;
+					*e = 0;
+					s = ++e;
+					task->b->pos += (size_t) (e - base);
+					base = e;
+					if (task->top[cur] == task->limit)
+						goto reportlackofinput;
+					if (cnt == task->maxrow)
+						break;
+				}
+				if (!scan[k].complete || cnt == task->maxrow)
+					break;
+				chunklineno += scan[k].nl;
+				odd ^= scan[k].odd;
+			}
+		}
 		for (e = s; *e && e < end && cnt < task->maxrow;) {
 			/* tokenize the record completely
 			 *
@@ -1458,6 +1687,7 @@ SQLproducer(void *p)
 			MT_sema_down(&task->producer);
 			if (cnt == task->maxrow) {
 				GDKfree(rdfa);
+				SQLscanfree(scan);
 				MT_thread_set_qry_ctx(NULL);
 				return;
 			}
@@ -1471,6 +1701,7 @@ SQLproducer(void *p)
 				blocked[(cur + 1) % MAXBUFFERS] = false;
 				if (task->state == ENDOFCOPY) {
 					GDKfree(rdfa);
+					SQLscanfree(scan);
 					MT_thread_set_qry_ctx(NULL);
 					return;
 				}
@@ -1494,6 +1725,7 @@ SQLproducer(void *p)
 				MT_sema_down(&task->producer);
 /*				TRC_DEBUG(MAL_SERVER, "Producer delivered all\n");*/
 				GDKfree(rdfa);
+				SQLscanfree(scan);
 				MT_thread_set_qry_ctx(NULL);
 				return;
 			}
@@ -1504,12 +1736,14 @@ SQLproducer(void *p)
 		if (task->ateof && !more) {
 /*			TRC_DEBUG(MAL_SERVER, "Producer encountered eof\n");*/
 			GDKfree(rdfa);
+			SQLscanfree(scan);
 			MT_thread_set_qry_ctx(NULL);
 			return;
 		}
 		/* consumers ask us to stop? */
 		if (task->state == ENDOFCOPY) {
 			GDKfree(rdfa);
+			SQLscanfree(scan);
 			MT_thread_set_qry_ctx(NULL);
 			return;
 		}
@@ -1526,6 +1760,7 @@ SQLproducer(void *p)
 		task->b->pos += partial;
 	}
 	GDKfree(rdfa);
+	SQLscanfree(scan);
 	MT_thread_set_qry_ctx(NULL);
 
 	return;
@@ -1650,6 +1885,8 @@ SQLload_file(Client cntxt, Tablet *as, bstream *b, stream *out,
 
 	as->error = NULL;
 
+	/* splitting records does not depend on the number of columns */
+	task.scanners = threads;
 	/* there is no point in creating more threads than we have columns */
 	if (as->nr_attrs < (BUN) threads)
 		threads = (int) as->nr_attrs;
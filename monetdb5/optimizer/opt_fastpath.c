@@ -22,6 +22,7 @@
 #include "opt_deadcode.h"
 #include "opt_dict.h"
 #include "opt_for.h"
+#include "opt_fuse.h"
 #include "opt_emptybind.h"
 #include "opt_evaluate.h"
 #include "opt_garbageCollector.h"
@@ -127,6 +128,7 @@ OPTdefaultfastImplementation(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 	optcall(true, OPTdeadcodeImplementation);
 	optcall(true, OPTreorderImplementation);
 	optcall(true, OPTmatpackImplementation);
+	optcall(true, OPTfuseImplementation);
 	optcall(true, OPTdataflowImplementation);
 	optcall(true, OPTquerylogImplementation);
 	optcall(multiplex, OPTmultiplexImplementation);
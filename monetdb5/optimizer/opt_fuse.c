@@ -0,0 +1,318 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+/*
+ * An expression like (a * b + c) / d > e is compiled into a chain of
+ * batcalc instructions, each of which materializes a full size
+ * intermediate.  This optimizer replaces such a chain, when all
+ * intermediates are used only within the chain, by a single
+ * batcalc.fused instruction that evaluates the chain in cache sized
+ * pieces and only materializes the final result.
+ *
+ * Only the element-wise arithmetic, comparison and logical operators
+ * and the plain numeric casts without candidate lists are considered.
+ */
+#include "monetdb_config.h"
+#include "opt_fuse.h"
+
+#define MAXFUSED 32				/* see FUSEDMAXOPS in batcalc.c */
+
+static bool
+fusetype(int tp, bool logical)
+{
+	if (logical)
+		return tp == TYPE_bit;
+	switch (tp) {
+	case TYPE_bte:
+	case TYPE_sht:
+	case TYPE_int:
+	case TYPE_lng:
+#ifdef HAVE_HGE
+	case TYPE_hge:
+#endif
+	case TYPE_flt:
+	case TYPE_dbl:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* return the name of the operation for the batcalc.fused program if p
+ * can take part in a fused chain */
+static const char *
+fuseop(MalBlkPtr mb, InstrPtr p)
+{
+	static const struct {
+		const char *name;
+		bool cmp, logical;
+	} ops[] = {
+		{"+", false, false},
+		{"-", false, false},
+		{"*", false, false},
+		{"/", false, false},
+		{"%", false, false},
+		{"<", true, false},
+		{"<=", true, false},
+		{">", true, false},
+		{">=", true, false},
+		{"==", true, false},
+		{"!=", true, false},
+		{"and", false, true},
+		{"or", false, true},
+		{"xor", false, true},
+	};
+	const char *fcn = getFunctionId(p), *op = NULL;
+	int tp, nops = 2, j, nbats = 0;
+	bool logical = false;
+
+	if (getModuleId(p) != batcalcRef || p->retc != 1 || p->barrier
+		|| !isaBatType(getArgType(mb, p, 0)))
+		return NULL;
+	tp = getBatType(getArgType(mb, p, 0));
+	for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+		if (strcmp(fcn, ops[i].name) == 0) {
+			op = ops[i].name;
+			logical = ops[i].logical;
+			if (ops[i].cmp || ops[i].logical ? tp != TYPE_bit : !fusetype(tp, false))
+				return NULL;
+			break;
+		}
+	}
+	if (op == NULL) {
+		if (!fusetype(tp, false) || strcmp(fcn, ATOMname(tp)) != 0)
+			return NULL;
+		op = "cast";
+		nops = 1;
+	}
+	if (p->argc - p->retc < nops)
+		return NULL;
+	for (j = p->retc; j < p->retc + nops; j++) {
+		int atp = getArgType(mb, p, j);
+		if (isaBatType(atp)) {
+			atp = getBatType(atp);
+			nbats++;
+		}
+		if (!fusetype(atp, logical))
+			return NULL;
+	}
+	if (nbats == 0)
+		return NULL;
+	/* remaining arguments may only be absent candidate lists */
+	for (; j < p->argc; j++) {
+		if (!isVarConstant(mb, getArg(p, j))
+			|| !isaBatType(getArgType(mb, p, j))
+			|| !is_bat_nil(getVarConstant(mb, getArg(p, j)).val.bval))
+			return NULL;
+	}
+	return op;
+}
+
+static int
+fusefind(int *parent, int pc)
+{
+	while (parent[pc] != pc)
+		pc = parent[pc] = parent[parent[pc]];
+	return pc;
+}
+
+struct fusestate {
+	MalBlkPtr mb;
+	InstrPtr *old;
+	int *parent, *def, root;
+	bool *absorbed;
+	int *inputs, ninputs;
+	int nsteps;
+	char *buf;
+	size_t len;
+};
+
+/* append the steps computing the result of old[pc] in post order;
+ * return the step number */
+static int
+fuseemit(struct fusestate *fs, int pc)
+{
+	InstrPtr p = fs->old[pc];
+	const char *op = fuseop(fs->mb, p);
+	int nops = strcmp(op, "cast") == 0 ? 1 : 2;
+	char args[2][16];
+
+	for (int j = 0; j < nops; j++) {
+		int a = getArg(p, p->retc + j), k = fs->def[a];
+		if (k >= 0 && fs->absorbed[k] && fusefind(fs->parent, k) == fs->root) {
+			snprintf(args[j], sizeof(args[j]), "#%d", fuseemit(fs, k));
+		} else {
+			int i;
+			for (i = 0; i < fs->ninputs; i++)
+				if (fs->inputs[i] == a)
+					break;
+			if (i == fs->ninputs)
+				fs->inputs[fs->ninputs++] = a;
+			snprintf(args[j], sizeof(args[j]), "$%d", i);
+		}
+	}
+	fs->len += snprintf(fs->buf + fs->len, 64, "%s%s:%s:%s%s%s",
+						fs->nsteps > 0 ? ";" : "", op,
+						ATOMname(getBatType(getArgType(fs->mb, p, 0))),
+						args[0], nops == 2 ? "," : "",
+						nops == 2 ? args[1] : "");
+	return fs->nsteps++;
+}
+
+str
+OPTfuseImplementation(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	int i, j, limit, slimit, actions = 0;
+	int *uses = NULL, *parent = NULL, *size = NULL, *def = NULL, *inputs = NULL;
+	bool *absorbed = NULL;
+	InstrPtr p, q, *old = NULL;
+	str msg = MAL_SUCCEED;
+	char buf[MAXFUSED * 64];
+
+	(void) stk;
+
+	/* we only deal with straight-line plans */
+	bool found = false;
+	for (i = 1; i < mb->stop; i++) {
+		p = getInstrPtr(mb, i);
+		if (p->barrier)
+			goto wrapup;
+		if (getModuleId(p) == batcalcRef)
+			found = true;
+	}
+	if (!found)
+		goto wrapup;
+
+	limit = mb->stop;
+	uses = GDKzalloc(mb->vtop * sizeof(int));
+	def = GDKmalloc(mb->vtop * sizeof(int));
+	parent = GDKmalloc(limit * sizeof(int));
+	size = GDKzalloc(limit * sizeof(int));
+	absorbed = GDKzalloc(limit * sizeof(bool));
+	inputs = GDKmalloc(2 * MAXFUSED * sizeof(int));
+	if (uses == NULL || def == NULL || parent == NULL || size == NULL
+		|| absorbed == NULL || inputs == NULL) {
+		msg = createException(MAL, "optimizer.fuse",
+							  SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		goto wrapup;
+	}
+	for (i = 0; i < mb->vtop; i++)
+		def[i] = -1;
+	for (i = 0; i < limit; i++) {
+		p = getInstrPtr(mb, i);
+		for (j = p->retc; j < p->argc; j++)
+			uses[getArg(p, j)]++;
+	}
+
+	/* grow the chains: an instruction absorbs the chain computing one
+	 * of its operands if that operand is not used anywhere else */
+	int nchains = 0;
+	for (i = 0; i < limit; i++) {
+		p = getInstrPtr(mb, i);
+		parent[i] = i;
+		if (fuseop(mb, p) == NULL)
+			continue;
+		size[i] = 1;
+		for (j = p->retc; j < p->argc; j++) {
+			int k = def[getArg(p, j)];
+			if (k < 0 || uses[getArg(p, j)] != 1 || absorbed[k])
+				continue;
+			int r = fusefind(parent, k);
+			if (r == i || size[r] + size[i] > MAXFUSED)
+				continue;
+			parent[r] = i;
+			size[i] += size[r];
+			absorbed[k] = true;
+		}
+		def[getArg(p, 0)] = i;
+		if (size[i] > 1)
+			nchains++;
+	}
+	if (nchains == 0)
+		goto wrapup;
+
+	old = mb->stmt;
+	slimit = mb->ssize;
+	if (newMalBlkStmt(mb, mb->ssize) < 0) {
+		old = NULL;
+		msg = createException(MAL, "optimizer.fuse",
+							  SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		goto wrapup;
+	}
+	for (i = 0; i < limit; i++) {
+		p = old[i];
+		if (absorbed[i])
+			continue;			/* emitted as part of its chain */
+		if (size[i] < 2 || fusefind(parent, i) != i) {
+			pushInstruction(mb, p);
+			old[i] = NULL;
+			continue;
+		}
+		struct fusestate fs = {
+			.mb = mb,
+			.old = old,
+			.parent = parent,
+			.def = def,
+			.root = i,
+			.absorbed = absorbed,
+			.inputs = inputs,
+			.buf = buf,
+		};
+		fuseemit(&fs, i);
+		q = newInstructionArgs(mb, batcalcRef, fusedRef, fs.ninputs + 2);
+		if (q == NULL) {
+			msg = createException(MAL, "optimizer.fuse",
+								  SQLSTATE(HY013) MAL_MALLOC_FAIL);
+			break;
+		}
+		getArg(q, 0) = getArg(p, 0);
+		q = pushStr(mb, q, buf);
+		for (j = 0; j < fs.ninputs; j++)
+			q = pushArgument(mb, q, inputs[j]);
+		pushInstruction(mb, q);
+		typeChecker(cntxt->usermodule, mb, q, mb->stop - 1, TRUE);
+		actions += size[i] - 1;
+	}
+	/* release the instructions that were fused, after an error just
+	 * keep them so that they get freed with the plan */
+	for (i = 0; i < limit; i++) {
+		if (old[i] == NULL)
+			continue;
+		if (msg != MAL_SUCCEED)
+			pushInstruction(mb, old[i]);
+		else
+			freeInstruction(old[i]);
+	}
+	for (; i < slimit; i++)
+		if (old[i])
+			pushInstruction(mb, old[i]);
+	GDKfree(old);
+
+	/* Defense line against incorrect plans */
+	if (msg == MAL_SUCCEED && actions > 0) {
+		msg = chkTypes(cntxt->usermodule, mb, FALSE);
+		if (!msg)
+			msg = chkFlow(mb);
+		if (!msg)
+			msg = chkDeclarations(mb);
+	}
+  wrapup:
+	GDKfree(uses);
+	GDKfree(def);
+	GDKfree(parent);
+	GDKfree(size);
+	GDKfree(absorbed);
+	GDKfree(inputs);
+	/* keep actions taken as a fake argument */
+	(void) pushInt(mb, pci, actions);
+	return msg;
+}
@@ -13,18 +13,48 @@
 /*
  * This simple module unrolls the mat.pack into an incremental sequence.
  * This could speedup parallel processing and releases resources faster.
+ *
+ * Packs whose only purpose is to ship a partitioned result to the client
+ * are not needed at all: the partitions are handed to sql.resultSetParts,
+ * which exports them one after the other.
  */
 #include "monetdb_config.h"
 #include "opt_matpack.h"
 
+/* Return the number of partitions if all columns of the result set p are
+ * packed from the same number of partitions and used nowhere else. */
+static int
+matpack_resultset(MalBlkPtr mb, InstrPtr p, InstrPtr *def, int *uses)
+{
+	int parts = 0;
+
+	if (getModuleId(p) != sqlRef || getFunctionId(p) != resultSetRef
+		|| p->retc != 1 || p->argc <= 6 || !isaBatType(getArgType(mb, p, 1)))
+		return 0;
+	for (int i = 6; i < p->argc; i++) {
+		int a = getArg(p, i);
+		InstrPtr q = def[a];
+
+		if (q == NULL || uses[a] != 1 || getModuleId(q) != matRef
+			|| getFunctionId(q) != packRef || q->retc != 1
+			|| !isaBatType(getArgType(mb, q, 1)))
+			return 0;
+		if (parts == 0)
+			parts = q->argc - q->retc;
+		else if (parts != q->argc - q->retc)
+			return 0;
+	}
+	return parts > 1 ? parts : 0;
+}
+
 str
 OPTmatpackImplementation(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 						 InstrPtr pci)
 {
-	int v, i, j, limit, slimit;
+	int v, i, j, k, limit, slimit, parts, *uses = NULL;
 	InstrPtr p, q;
 	int actions = 0;
-	InstrPtr *old = NULL;
+	InstrPtr *old = NULL, *def = NULL;
 	str msg = MAL_SUCCEED;
 
 	if (isOptimizerUsed(mb, pci, mergetableRef) <= 0) {
@@ -41,14 +71,73 @@ OPTmatpackImplementation(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 	if (i == mb->stop)
 		goto wrapup;
 
+	/* locate the packs that only feed a result set */
+	def = GDKzalloc(mb->vtop * sizeof(InstrPtr));
+	uses = GDKzalloc(mb->vtop * sizeof(int));
+	if (def == NULL || uses == NULL) {
+		GDKfree(def);
+		GDKfree(uses);
+		throw(MAL, "optimizer.matpack", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	}
+	for (i = 1; i < mb->stop; i++) {
+		p = getInstrPtr(mb, i);
+		for (j = 0; j < p->retc; j++)
+			def[getArg(p, j)] = p;
+		for (j = p->retc; j < p->argc; j++)
+			uses[getArg(p, j)]++;
+	}
+	for (i = 1; i < mb->stop; i++) {
+		p = getInstrPtr(mb, i);
+		if (matpack_resultset(mb, p, def, uses) == 0)
+			continue;
+		/* the packs are dropped, the result set takes their partitions */
+		for (j = 6; j < p->argc; j++)
+			uses[getArg(p, j)] = -1;
+	}
+
 	old = mb->stmt;
 	limit = mb->stop;
 	slimit = mb->ssize;
-	if (newMalBlkStmt(mb, mb->stop) < 0)
+	if (newMalBlkStmt(mb, mb->stop) < 0) {
+		GDKfree(def);
+		GDKfree(uses);
 		throw(MAL, "optimizer.matpack", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	}
 
 	for (i = 0; mb->errors == NULL && i < limit; i++) {
 		p = old[i];
+		if (getModuleId(p) == matRef && getFunctionId(p) == packRef
+			&& p->retc == 1 && uses[getArg(p, 0)] < 0) {
+			/* replaced by the result set below, which releases it */
+			old[i] = NULL;
+			continue;
+		}
+		if (getModuleId(p) == sqlRef && getFunctionId(p) == resultSetRef
+			&& p->argc > 6 && uses[getArg(p, 6)] < 0) {
+			parts = def[getArg(p, 6)]->argc - 1;
+			q = newInstructionArgs(mb, sqlRef, resultSetPartsRef, 7 + parts * (p->argc - 6));
+			if (q == NULL) {
+				msg = createException(MAL, "optimizer.matpack",
+									  SQLSTATE(HY013) MAL_MALLOC_FAIL);
+				break;
+			}
+			getArg(q, 0) = getArg(p, 0);
+			for (j = 1; j < 6; j++)
+				q = pushArgument(mb, q, getArg(p, j));
+			q = pushInt(mb, q, parts);
+			for (j = 6; j < p->argc; j++) {
+				InstrPtr r = def[getArg(p, j)];
+				for (k = r->retc; k < r->argc; k++)
+					q = pushArgument(mb, q, getArg(r, k));
+				freeInstruction(r);
+			}
+			pushInstruction(mb, q);
+			typeChecker(cntxt->usermodule, mb, q, mb->stop - 1, TRUE);
+			freeInstruction(p);
+			old[i] = NULL;
+			actions++;
+			continue;
+		}
 		if (getModuleId(p) == matRef && getFunctionId(p) == packRef
 			&& isaBatType(getArgType(mb, p, 1))) {
 			q = newInstruction(0, matRef, packIncrementRef);
@@ -102,6 +191,8 @@ OPTmatpackImplementation(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 		if (old[i])
 			pushInstruction(mb, old[i]);
 	GDKfree(old);
+	GDKfree(def);
+	GDKfree(uses);
 
 	/* Defense line against incorrect plans */
 	if (msg == MAL_SUCCEED && actions > 0) {
@@ -13,10 +13,13 @@
 #include "monetdb_config.h"
 #include "opt_mitosis.h"
 #include "mal_interpreter.h"
+#include "mal_runtime.h"
 #include "gdk_utils.h"
 
 #define MIN_PART_SIZE 100000	/* minimal record count per partition */
 #define MAX_PARTS2THREADS_RATIO 4	/* There should be at most this multiple more of partitions then threads */
+#define MIN_PART_WORK 2000		/* usec of measured work a partition should carry */
+#define MIN_PART_ROWS 1000		/* minimal record count per partition of expensive plans */
 
 
 str
@@ -25,9 +28,10 @@ OPTmitosisImplementation(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 {
 	int i, j, limit, slimit, estimate = 0, pieces = 1, mito_parts = 0,
 		mito_size = 0, row_size = 0, mt = -1, nr_cols = 0, nr_aggrs = 0,
-		nr_maps = 0;
+		nr_maps = 0, mempieces = 0, avail, fpieces;
 	str schema = 0, table = 0;
-	BUN r = 0, rowcnt = 0;		/* table should be sizeable to consider parallel execution */
+	BUN r = 0, rowcnt = 0, frowcnt;		/* table should be sizeable to consider parallel execution */
+	lng fbusy, fwall;
 	InstrPtr p, q, *old, target = 0;
 	size_t argsize = 6 * sizeof(lng), m = 0;
 	/*       estimate size per operator estimate:   4 args + 2 res */
@@ -164,6 +168,11 @@ OPTmitosisImplementation(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 	cntxt->idle = 0;			// this one is definitely not idle
 	MT_lock_unset(&mal_contextLock);
 
+	/* the threads are shared with the queries that are running now */
+	avail = threads / (runtimeRunning() + 1);
+	if (avail < 1)
+		avail = 1;
+
 	/* improve memory usage estimation */
 	if (nr_cols > 1 || nr_aggrs > 1 || nr_maps > 1)
 		argsize = (nr_cols + nr_aggrs + nr_maps) * sizeof(lng);
@@ -198,11 +207,37 @@ OPTmitosisImplementation(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 		pieces = ((int) ceil((double) rowcnt / (m / threads)));
 		if (pieces <= threads)
 			pieces = threads;
+		mempieces = pieces;
 	} else if (rowcnt > MIN_PART_SIZE) {
 		/* exploit parallelism, but ensure minimal partition size to
 		 * limit overhead */
 		pieces = MIN((int) ceil((double) rowcnt / MIN_PART_SIZE),
-					 MAX_PARTS2THREADS_RATIO * threads);
+					 MAX_PARTS2THREADS_RATIO * avail);
+	}
+
+	/* The row count says little about the work involved.  If the same
+	 * query ran before, size the partitions on the time its instructions
+	 * took, scaled to the current table size, such that each of them
+	 * carries MIN_PART_WORK usec: cheap plans get fewer pieces, expensive
+	 * ones more.  When that run kept fewer than half the threads busy that
+	 * it had partitions for, the pieces were skewed and smaller ones
+	 * balance better, as long as they still carry half the work.  When it
+	 * kept all threads busy, more pieces only add overhead.  The
+	 * partitioning needed to fit in memory stays the lower bound.  Set the
+	 * mito_feedback server option to 0 to size on the row count only. */
+	if (GDKgetenv_int("mito_feedback", 1)
+		&& runtimeFeedback(mb, &fpieces, &frowcnt, &fbusy, &fwall)) {
+		lng work = frowcnt > 0 ? (lng) ((dbl) fbusy * rowcnt / frowcnt) : fbusy;
+		lng want = work / MIN_PART_WORK;
+
+		if (fpieces > 1 && fwall > 0
+			&& 2 * fbusy < fwall * MIN(fpieces, avail))
+			want = MAX(want, MIN(2 * (lng) fpieces, 2 * want));
+		else if (want > fpieces && fpieces >= avail)
+			want = fpieces;
+		want = MIN(want, MAX_PARTS2THREADS_RATIO * avail);
+		want = MIN(want, (lng) (rowcnt / MIN_PART_ROWS));
+		pieces = (int) MAX(want, mempieces);
 	}
 
 	/* when testing, always aim for full parallelism, but avoid
@@ -222,6 +257,9 @@ OPTmitosisImplementation(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
 	if (mito_size > 0)
 		pieces = (int) ((rowcnt * row_size) / (mito_size * 1024));
 
+	/* remember the decision for the feedback of this run */
+	mb->pieces = pieces > 1 ? pieces : 1;
+	mb->rowcnt = rowcnt;
 	if (pieces <= 1) {
 		pieces = 0;
 		goto bailout;
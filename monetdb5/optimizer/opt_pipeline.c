@@ -0,0 +1,384 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+/*
+ * The MAL engine materializes every intermediate in full before the
+ * next instruction starts.  For a scan-filter-aggregate query over a
+ * single table this means that candidate lists and projections the
+ * size of the table are written and read again, while only a handful
+ * of aggregate values survive.
+ *
+ * This optimizer recognizes the part of the plan that hangs off a
+ * sql.tid candidate list and consists of selections, projections,
+ * element-wise batcalc operations and decomposable aggregates, and
+ * wraps it in a loop over morsels of the candidate list:
+ *
+ *	P := bat.new(:lng);
+ * barrier (h,m) := iterator.new(T, 65536:lng);
+ *	C := algebra.thetaselect(B, m, 2:int, ">");
+ *	V := algebra.projection(C, A);
+ *	...
+ *	s := aggr.sum(V);
+ *	P := bat.append(P, s);
+ *	redo (h,m) := iterator.next(T, 65536:lng);
+ * exit (h,m);
+ *	S := aggr.sum(P);
+ *
+ * Each morsel is pushed through the whole chain, so the intermediates
+ * stay cache sized, and the partial aggregates are combined after the
+ * loop.  The plan itself is the same as without the optimizer, only
+ * the granularity at which it is executed differs.
+ *
+ * The morsel size can be set with the pipeline_morsel server option.
+ */
+#include "monetdb_config.h"
+#include "opt_pipeline.h"
+
+#define MORSEL_SIZE 65536
+
+/* how a variable or instruction takes part in the pipeline */
+enum {
+	PIPE_ESCAPE = -1,			/* uses the pipeline, but cannot be moved */
+	PIPE_NONE = 0,				/* not part of the pipeline */
+	PIPE_CAND,					/* candidate list within the morsel */
+	PIPE_VAL,					/* values aligned with a PIPE_CAND */
+	PIPE_AGGR,					/* aggregate over the pipeline */
+};
+
+/* determine the role of p given the pipeline variables; for a PIPE_VAL
+ * result *a is set to the candidate list it is aligned with */
+static int
+pipeclassify(MalBlkPtr mb, InstrPtr p, const char *kind, const int *align,
+			 const bool *aggr, int *a)
+{
+	const char *fcn = getFunctionId(p);
+	bool uses = false;
+	int j;
+
+	for (j = p->retc; j < p->argc; j++)
+		if (kind[getArg(p, j)] != PIPE_NONE)
+			uses = true;
+	if (!uses)
+		return PIPE_NONE;
+	if (p->retc != 1 || p->barrier)
+		return PIPE_ESCAPE;
+	/* the partial aggregates are only known after the loop */
+	for (j = p->retc; j < p->argc; j++)
+		if (aggr[getArg(p, j)])
+			return PIPE_ESCAPE;
+
+	if (getModuleId(p) == algebraRef) {
+		if (((fcn == thetaselectRef && p->argc == 5)
+			 || (fcn == selectRef && (p->argc == 8 || p->argc == 9)))
+			&& kind[getArg(p, 1)] == PIPE_NONE
+			&& isaBatType(getArgType(mb, p, 1))
+			&& kind[getArg(p, 2)] == PIPE_CAND) {
+			for (j = 3; j < p->argc; j++)
+				if (isaBatType(getArgType(mb, p, j)))
+					return PIPE_ESCAPE;
+			return PIPE_CAND;
+		}
+		if (fcn == projectionRef && p->argc == 3
+			&& kind[getArg(p, 1)] == PIPE_CAND
+			&& kind[getArg(p, 2)] == PIPE_NONE
+			&& isaBatType(getArgType(mb, p, 2))) {
+			*a = getArg(p, 1);
+			return PIPE_VAL;
+		}
+		return PIPE_ESCAPE;
+	}
+
+	if (getModuleId(p) == batcalcRef && fcn != identityRef
+		&& isaBatType(getArgType(mb, p, 0))) {
+		*a = -1;
+		for (j = p->retc; j < p->argc; j++) {
+			int v = getArg(p, j);
+			if (kind[v] == PIPE_VAL) {
+				if (*a >= 0 && align[v] != *a)
+					return PIPE_ESCAPE;
+				*a = align[v];
+			} else if (kind[v] != PIPE_NONE) {
+				return PIPE_ESCAPE;
+			} else if (isaBatType(getArgType(mb, p, j))
+					   && (!isVarConstant(mb, v)
+						   || !is_bat_nil(getVarConstant(mb, v).val.bval))) {
+				/* only absent candidate lists */
+				return PIPE_ESCAPE;
+			}
+		}
+		return PIPE_VAL;
+	}
+
+	/* a floating point sum is exact over the whole column, the sum of
+	 * the rounded partial sums is not */
+	if (getModuleId(p) == aggrRef && fcn == sumRef
+		&& (getArgType(mb, p, 0) == TYPE_flt
+			|| getArgType(mb, p, 0) == TYPE_dbl))
+		return PIPE_ESCAPE;
+	if (getModuleId(p) == aggrRef && !isaBatType(getArgType(mb, p, 0))
+		&& (((fcn == sumRef || fcn == minRef || fcn == maxRef)
+			 && p->argc == 2 && kind[getArg(p, 1)] == PIPE_VAL)
+			|| (fcn == countRef && (p->argc == 2
+									|| (p->argc == 3 && isVarConstant(mb, getArg(p, 2))))))) {
+		return PIPE_AGGR;
+	}
+	return PIPE_ESCAPE;
+}
+
+/* emit the morsel loop for the pipeline rooted at candidate list cand
+ * produced by old[t], ending at old[last] */
+static str
+pipeemit(MalBlkPtr mb, InstrPtr *old, const char *role, int t, int last,
+		 int cand, lng morsel, int *partial, int *result, const char **fcns)
+{
+	InstrPtr p, q;
+	int j, k, n = 0, hvar, tvar;
+
+	for (j = t + 1; j <= last; j++) {
+		if (role[j] != PIPE_AGGR)
+			continue;
+		int tp = getArgType(mb, old[j], 0);
+		q = newFcnCallArgs(mb, batRef, newRef, 2);
+		if (q == NULL)
+			goto nomem;
+		setVarType(mb, getArg(q, 0), newBatType(tp));
+		q = pushType(mb, q, tp);
+		pushInstruction(mb, q);
+		partial[n++] = getArg(q, 0);
+	}
+
+	/* barrier (h,m) := iterator.new(T, morsel); */
+	q = newFcnCall(mb, iteratorRef, newRef);
+	if (q == NULL)
+		goto nomem;
+	q->barrier = BARRIERsymbol;
+	hvar = newTmpVariable(mb, TYPE_lng);
+	getArg(q, 0) = hvar;
+	tvar = newTmpVariable(mb, getVarType(mb, cand));
+	q = pushReturn(mb, q, tvar);
+	q = pushArgument(mb, q, cand);
+	q = pushLng(mb, q, morsel);
+	pushInstruction(mb, q);
+
+	n = 0;
+	for (j = t + 1; j <= last; j++) {
+		if (role[j] == PIPE_NONE)
+			continue;
+		p = old[j];
+		old[j] = NULL;
+		for (k = p->retc; k < p->argc; k++)
+			if (getArg(p, k) == cand)
+				getArg(p, k) = tvar;
+		if (role[j] != PIPE_AGGR) {
+			pushInstruction(mb, p);
+			continue;
+		}
+		result[n] = getArg(p, 0);
+		fcns[n] = getFunctionId(p);
+		getArg(p, 0) = newTmpVariable(mb, getArgType(mb, p, 0));
+		pushInstruction(mb, p);
+		q = newFcnCallArgs(mb, batRef, appendRef, 3);
+		if (q == NULL)
+			goto nomem;
+		getArg(q, 0) = partial[n];
+		q = pushArgument(mb, q, partial[n]);
+		q = pushArgument(mb, q, getArg(p, 0));
+		pushInstruction(mb, q);
+		n++;
+	}
+
+	/* redo (h,m) := iterator.next(T, morsel); */
+	q = newFcnCall(mb, iteratorRef, nextRef);
+	if (q == NULL)
+		goto nomem;
+	q->barrier = REDOsymbol;
+	getArg(q, 0) = hvar;
+	q = pushReturn(mb, q, tvar);
+	q = pushArgument(mb, q, cand);
+	q = pushLng(mb, q, morsel);
+	pushInstruction(mb, q);
+
+	q = newAssignment(mb);
+	if (q == NULL)
+		goto nomem;
+	q->barrier = EXITsymbol;
+	getArg(q, 0) = hvar;
+	q = pushReturn(mb, q, tvar);
+	pushInstruction(mb, q);
+
+	/* combine the partial aggregates, the counts by adding them up */
+	for (k = 0; k < n; k++) {
+		q = newFcnCallArgs(mb, aggrRef, fcns[k] == countRef ? sumRef : fcns[k], 2);
+		if (q == NULL)
+			goto nomem;
+		getArg(q, 0) = result[k];
+		q = pushArgument(mb, q, partial[k]);
+		pushInstruction(mb, q);
+	}
+	return MAL_SUCCEED;
+
+  nomem:
+	throw(MAL, "optimizer.pipeline", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+}
+
+str
+OPTpipelineImplementation(Client cntxt, MalBlkPtr mb, MalStkPtr stk,
+						  InstrPtr pci)
+{
+	int i, j, t, limit, slimit, actions = 0;
+	int *align = NULL, *partial = NULL, *result = NULL;
+	char *kind = NULL, *role = NULL;
+	bool *aggr = NULL;
+	const char **fcns = NULL;
+	InstrPtr p, *old;
+	str msg = MAL_SUCCEED;
+	lng morsel;
+
+	(void) stk;
+
+	/* we only deal with straight-line plans */
+	bool found = false;
+	for (i = 1; i < mb->stop; i++) {
+		p = getInstrPtr(mb, i);
+		if (p->barrier)
+			goto wrapup;
+		if (getModuleId(p) == sqlRef && getFunctionId(p) == tidRef)
+			found = true;
+	}
+	if (!found)
+		goto wrapup;
+
+	morsel = GDKgetenv_int("pipeline_morsel", MORSEL_SIZE);
+	if (morsel <= 0)
+		morsel = MORSEL_SIZE;
+
+	for (t = 1; t < mb->stop; t++) {
+		p = getInstrPtr(mb, t);
+		if (getModuleId(p) != sqlRef || getFunctionId(p) != tidRef
+			|| p->retc != 1)
+			continue;
+
+		limit = mb->stop;
+		GDKfree(kind);
+		GDKfree(align);
+		GDKfree(aggr);
+		GDKfree(role);
+		kind = GDKzalloc(mb->vtop * sizeof(char));
+		align = GDKmalloc(mb->vtop * sizeof(int));
+		aggr = GDKzalloc(mb->vtop * sizeof(bool));
+		role = GDKzalloc(limit * sizeof(char));
+		if (kind == NULL || align == NULL || aggr == NULL || role == NULL) {
+			msg = createException(MAL, "optimizer.pipeline",
+								  SQLSTATE(HY013) MAL_MALLOC_FAIL);
+			goto wrapup;
+		}
+
+		/* grow the pipeline from the candidate list */
+		int cand = getArg(p, 0), last = -1, ninner = 0, naggr = 0;
+		kind[cand] = PIPE_CAND;
+		align[cand] = cand;
+		for (i = t + 1; i < limit; i++) {
+			InstrPtr q = getInstrPtr(mb, i);
+			int a = -1, r = pipeclassify(mb, q, kind, align, aggr, &a);
+			if (r == PIPE_ESCAPE)
+				break;
+			role[i] = (char) r;
+			if (r == PIPE_NONE)
+				continue;
+			last = i;
+			if (r == PIPE_AGGR) {
+				aggr[getArg(q, 0)] = true;
+				naggr++;
+			} else {
+				kind[getArg(q, 0)] = (char) r;
+				align[getArg(q, 0)] = r == PIPE_CAND ? getArg(q, 0) : a;
+				ninner++;
+			}
+		}
+		if (i < limit || naggr == 0 || ninner == 0)
+			continue;
+		/* the loop replaces the last instruction of the pipeline, so
+		 * the aggregates may not be used before that */
+		for (i = t + 1; i < last; i++) {
+			InstrPtr q = getInstrPtr(mb, i);
+			if (role[i] != PIPE_NONE)
+				continue;
+			for (j = q->retc; j < q->argc; j++)
+				if (aggr[getArg(q, j)])
+					break;
+			if (j < q->argc)
+				break;
+		}
+		if (i < last)
+			continue;
+
+		GDKfree(partial);
+		GDKfree(result);
+		GDKfree(fcns);
+		partial = GDKmalloc(naggr * sizeof(int));
+		result = GDKmalloc(naggr * sizeof(int));
+		fcns = GDKmalloc(naggr * sizeof(const char *));
+		if (partial == NULL || result == NULL || fcns == NULL) {
+			msg = createException(MAL, "optimizer.pipeline",
+								  SQLSTATE(HY013) MAL_MALLOC_FAIL);
+			goto wrapup;
+		}
+
+		old = mb->stmt;
+		slimit = mb->ssize;
+		if (newMalBlkStmt(mb, mb->ssize) < 0) {
+			msg = createException(MAL, "optimizer.pipeline",
+								  SQLSTATE(HY013) MAL_MALLOC_FAIL);
+			goto wrapup;
+		}
+		for (i = 0; i < limit; i++) {
+			if (old[i] == NULL || (i < last && role[i] != PIPE_NONE))
+				continue;
+			if (i == last) {
+				msg = pipeemit(mb, old, role, t, last, cand, morsel,
+							   partial, result, fcns);
+				continue;
+			}
+			pushInstruction(mb, old[i]);
+			old[i] = NULL;
+		}
+		/* after an error keep the remaining instructions so that they
+		 * get freed with the plan */
+		for (i = 0; i < slimit; i++)
+			if (old[i])
+				pushInstruction(mb, old[i]);
+		GDKfree(old);
+		if (msg != MAL_SUCCEED)
+			goto wrapup;
+		actions += ninner + naggr;
+	}
+
+	/* Defense line against incorrect plans */
+	if (actions > 0) {
+		msg = chkTypes(cntxt->usermodule, mb, FALSE);
+		if (!msg)
+			msg = chkFlow(mb);
+		if (!msg)
+			msg = chkDeclarations(mb);
+	}
+  wrapup:
+	GDKfree(kind);
+	GDKfree(align);
+	GDKfree(aggr);
+	GDKfree(role);
+	GDKfree(partial);
+	GDKfree(result);
+	GDKfree(fcns);
+	/* keep actions taken as a fake argument */
+	(void) pushInt(mb, pci, actions);
+	return msg;
+}
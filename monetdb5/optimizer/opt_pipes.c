@@ -96,6 +96,7 @@ static struct pipeline {
 		 "deadcode",
 		 "matpack",
 		 "reorder",
+		 "fuse",
 		 "dataflow",
 		 "querylog",
 		 "multiplex",
@@ -146,6 +147,7 @@ static struct pipeline {
 		 "deadcode",
 		 "matpack",
 		 "reorder",
+		 "fuse",
 		 "dataflow",
 		 "querylog",
 		 "multiplex",
@@ -191,6 +193,7 @@ static struct pipeline {
 		 "deadcode",
 		 "matpack",
 		 "reorder",
+		 "fuse",
 		 "querylog",
 		 "multiplex",
 		 "generator",
@@ -207,6 +210,46 @@ static struct pipeline {
  * development.  Do not use any of these pipelines in production
  * settings!
  */
+/* The pipeline pipe replaces the partitioning by mitosis with morsel
+ * wise execution of select-project-aggregate chains.
+ */
+	{"pipeline_pipe",
+	 (char *[]) {
+		 "inline",
+		 "remap",
+		 "costModel",
+		 "coercions",
+		 "aliases",
+		 "evaluate",
+		 "emptybind",
+		 "deadcode",
+		 "pushselect",
+		 "aliases",
+		 "for",
+		 "dict",
+		 "mergetable",
+		 "aliases",
+		 "constants",
+		 "commonTerms",
+		 "projectionpath",
+		 "deadcode",
+		 "matpack",
+		 "reorder",
+		 "fuse",
+		 "pipeline",
+		 "dataflow",
+		 "querylog",
+		 "multiplex",
+		 "generator",
+		 "candidates",
+		 "deadcode",
+		 "postfix",
+		 "profiler",
+		 "garbageCollector",
+		 NULL,
+	 },
+	 true,
+	},
 /* sentinel */
 	{NULL, NULL, false,},
 };
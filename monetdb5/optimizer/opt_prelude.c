@@ -119,6 +119,7 @@ const char *findRef;
 const char *firstnRef;
 const char *first_valueRef;
 const char *forRef;
+const char *fusedRef;
 const char *generatorRef;
 const char *getRef;
 const char *getTraceRef;
@@ -141,6 +142,7 @@ const char *ioRef;
 const char *iteratorRef;
 const char *joinRef;
 const char *jsonRef;
+const char *knnselectRef;
 const char *lagRef;
 const char *languageRef;
 const char *last_valueRef;
@@ -200,6 +202,7 @@ const char *projectdeltaRef;
 const char *projectionpathRef;
 const char *projectionRef;
 const char *projectRef;
+const char *pruneRef;
 const char *putRef;
 const char *pyapi3Ref;
 const char *querylogRef;
@@ -219,6 +222,7 @@ const char *rename_userRef;
 const char *renumberRef;
 const char *replaceRef;
 const char *resultSetRef;
+const char *resultSetPartsRef;
 const char *revoke_functionRef;
 const char *revokeRef;
 const char *revoke_rolesRef;
@@ -380,6 +384,7 @@ optimizerInit(void)
 	firstnRef = putName("firstn");
 	first_valueRef = putName("first_value");
 	forRef = putName("for");
+	fusedRef = putName("fused");
 	generatorRef = putName("generator");
 	getRef = putName("get");
 	getTraceRef = putName("getTrace");
@@ -402,6 +407,7 @@ optimizerInit(void)
 	iteratorRef = putName("iterator");
 	joinRef = putName("join");
 	jsonRef = putName("json");
+	knnselectRef = putName("knnselect");
 	lagRef = putName("lag");
 	languageRef = putName("language");
 	last_valueRef = putName("last_value");
@@ -461,6 +467,7 @@ optimizerInit(void)
 	projectionpathRef = putName("projectionpath");
 	projectionRef = putName("projection");
 	projectRef = putName("project");
+	pruneRef = putName("prune");
 	putRef = putName("put");
 	pyapi3Ref = putName("pyapi3");
 	querylogRef = putName("querylog");
@@ -480,6 +487,7 @@ optimizerInit(void)
 	renumberRef = putName("renumber");
 	replaceRef = putName("replace");
 	resultSetRef = putName("resultSet");
+	resultSetPartsRef = putName("resultSetParts");
 	revoke_functionRef = putName("revoke_function");
 	revokeRef = putName("revoke");
 	revoke_rolesRef = putName("revoke_roles");
@@ -116,6 +116,7 @@ mal_export const char *findRef;
 mal_export const char *firstnRef;
 mal_export const char *first_valueRef;
 mal_export const char *forRef;
+mal_export const char *fusedRef;
 mal_export const char *generatorRef;
 mal_export const char *getRef;
 mal_export const char *getTraceRef;
@@ -138,6 +139,7 @@ mal_export const char *ioRef;
 mal_export const char *iteratorRef;
 mal_export const char *joinRef;
 mal_export const char *jsonRef;
+mal_export const char *knnselectRef;
 mal_export const char *lagRef;
 mal_export const char *languageRef;
 mal_export const char *last_valueRef;
@@ -198,6 +200,7 @@ mal_export const char *projectdeltaRef;
 mal_export const char *projectionpathRef;
 mal_export const char *projectionRef;
 mal_export const char *projectRef;
+mal_export const char *pruneRef;
 mal_export const char *putRef;
 mal_export const char *pyapi3Ref;
 mal_export const char *querylogRef;
@@ -217,6 +220,7 @@ mal_export const char *rename_userRef;
 mal_export const char *renumberRef;
 mal_export const char *replaceRef;
 mal_export const char *resultSetRef;
+mal_export const char *resultSetPartsRef;
 mal_export const char *revoke_functionRef;
 mal_export const char *revokeRef;
 mal_export const char *revoke_rolesRef;
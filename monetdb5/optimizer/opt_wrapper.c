@@ -42,9 +42,11 @@
 #include "opt_postfix.h"
 #include "opt_for.h"
 #include "opt_dict.h"
+#include "opt_fuse.h"
 #include "opt_mergetable.h"
 #include "opt_mitosis.h"
 #include "opt_multiplex.h"
+#include "opt_pipeline.h"
 #include "opt_profiler.h"
 #include "opt_pushselect.h"
 #include "opt_querylog.h"
@@ -75,6 +77,7 @@ static struct {
 	{"emptybind", &OPTemptybindImplementation, 0, 0},
 	{"evaluate", &OPTevaluateImplementation, 0, 0},
 	{"for", &OPTforImplementation, 0, 0},
+	{"fuse", &OPTfuseImplementation, 0, 0},
 	{"garbageCollector", &OPTgarbageCollectorImplementation, 0, 0},
 	{"generator", &OPTgeneratorImplementation, 0, 0},
 	{"inline", &OPTinlineImplementation, 0, 0},
@@ -83,6 +86,7 @@ static struct {
 	{"minimalfast", &OPTminimalfastImplementation, 0, 0},
 	{"mitosis", &OPTmitosisImplementation, 0, 0},
 	{"multiplex", &OPTmultiplexImplementation, 0, 0},
+	{"pipeline", &OPTpipelineImplementation, 0, 0},
 	{"postfix", &OPTpostfixImplementation, 0, 0},
 	{"profiler", &OPTprofilerImplementation, 0, 0},
 	{"projectionpath", &OPTprojectionpathImplementation, 0, 0},
@@ -128,7 +128,9 @@ static mel_func optimizer_init_funcs[] = {
 	optwrapper_pattern("postfix", "Postfix the plan,e.g. pushing projections"),
 	optwrapper_pattern("strimps", "Use strimps index if appropriate"),
 	optwrapper_pattern("for", "Push for decompress down"),
+	optwrapper_pattern("fuse", "Fuse chains of element-wise batcalc operations"),
 	optwrapper_pattern("dict", "Push dict decompress down"),
+	optwrapper_pattern("pipeline", "Execute select-project-aggregate chains per morsel"),
 	{.imp = NULL}
 };
 
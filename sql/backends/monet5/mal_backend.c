@@ -27,6 +27,8 @@ backend_reset(backend *b)
 		.rowcnt = -1,
 		.last_id = -1,
 		.subbackend = b->subbackend,
+		.bin_compression = b->bin_compression,
+		.bin_prefetch = b->bin_prefetch,
 	};
 	return b;
 }
@@ -35,6 +35,13 @@ typedef enum output_format {
 	OFMT_NONE = 3
 } ofmt;
 
+/* compression of the result set blocks of the binary protocol */
+typedef enum bin_compression {
+	BIN_COMPRESS_NONE = 0,
+	BIN_COMPRESS_LZ4 = 1,
+	BIN_COMPRESS_GZ = 2
+} bincomp;
+
 /* The cur_append variable on an insert/update/delete on a partitioned table, tracks the current MAL variable holding
  * the total number of rows affected. The first_statement_generated looks if the first of the sub-statements was
  * generated or not */
@@ -53,6 +60,8 @@ typedef struct backend {
 	int 	rowcount;	/* when multiple insert/update/delete/truncate statements are present, use an accumulator to hold the total number of rows affected */
 	int		vtop;			/* top of the variable stack before the current function */
 	int 	join_idx;	/* number of index joins (used in rel_bin) */
+	list	*sideways;	/* join key bounds passed to partition scans (used in rel_bin) */
+	struct knn_topn *knn;	/* ORDER BY ST_Distance LIMIT passed to the project computing the distance (used in rel_bin) */
 	lng 	reloptimizer;	/* timer for optimizer phase */
 
 	bool sizeheader:1,	/* print size header in result set */
@@ -63,6 +72,8 @@ typedef struct backend {
 
 	int result_id;
 	res_table *results;
+	bincomp bin_compression;
+	struct bin_prefetch *bin_prefetch;	/* next block of the binary protocol, see sql_result.c */
 	lng last_id;
 	lng rowcnt;
 	subbackend *subbackend;
@@ -2193,6 +2193,245 @@ rel2bin_sql_table(backend *be, sql_table *t, list *aliases)
 	return stmt_list(be, l);
 }
 
+/*
+ * Sideways information passing for partitioned tables. A join on the partition
+ * column builds the other side first and passes the bounds of its join key
+ * down, the scans of partitions which cannot match then get an empty
+ * candidate list.
+ */
+typedef struct sideways_bounds {
+	sql_rel *bt;		/* the partition scan */
+	sql_part *pd;		/* its range or value partition */
+	stmt *min, *max;	/* bounds of the join key of the other side */
+	bool never;			/* the partition only holds NULLs, which never join */
+} sideways_bounds;
+
+static stmt *
+sideways_keep(backend *be, sideways_bounds *sw)
+{
+	mvc *sql = be->mvc;
+	sql_part *pd = sw->pd;
+	sql_subtype *bt = sql_bind_localtype("bit"), *ct = &pd->t->part.pcol->type;
+	sql_subfunc *and = sql_bind_func(sql, "sys", "and", bt, bt, F_FUNC, true, true);
+	sql_subfunc *le = sql_bind_func(sql, "sys", "<=", ct, ct, F_FUNC, true, true);
+	stmt *keep = NULL;
+
+	if (!and || !le)
+		return NULL;
+	if (isRangePartitionTable(pd->t)) {
+		sql_subfunc *lt = sql_bind_func(sql, "sys", "<", ct, ct, F_FUNC, true, true);
+		atom *rmin = atom_general_ptr(sql->sa, ct, pd->part.range.minvalue);
+		atom *rmax = atom_general_ptr(sql->sa, ct, pd->part.range.maxvalue);
+
+		if (!lt || !rmin || !rmax)
+			return NULL;
+		if (rmin->isnull && rmax->isnull) /* either all values or just the NULLs */
+			return pd->with_nills == 1 ? stmt_bool(be, 0) : NULL;
+		if (!rmin->isnull)
+			keep = stmt_binop(be, stmt_atom(be, rmin), sw->max, NULL, le);
+		if (!rmax->isnull) { /* the upper limit is exclusive */
+			stmt *s = stmt_binop(be, sw->min, stmt_atom(be, rmax), NULL, lt);
+
+			keep = keep ? stmt_binop(be, keep, s, NULL, and) : s;
+		}
+	} else {
+		sql_subfunc *or = sql_bind_func(sql, "sys", "or", bt, bt, F_FUNC, true, true);
+
+		if (!or)
+			return NULL;
+		for (node *n = pd->part.values->h; n; n = n->next) {
+			sql_part_value *spv = n->data;
+			stmt *v = stmt_atom(be, atom_general_ptr(sql->sa, ct, spv->value));
+			stmt *s = stmt_binop(be, stmt_binop(be, sw->min, v, NULL, le), stmt_binop(be, v, sw->max, NULL, le), NULL, and);
+
+			keep = keep ? stmt_binop(be, keep, s, NULL, or) : s;
+		}
+		if (!keep) /* just the NULLs */
+			keep = stmt_bool(be, 0);
+	}
+	return keep;
+}
+
+static bool
+partition_only_nulls(sql_part *pd)
+{
+	if (isRangePartitionTable(pd->t)) {
+		int tpe = pd->t->part.pcol->type.type->localtype;
+		const void *nil = ATOMnilptr(tpe);
+
+		return pd->with_nills == 1 && ATOMcmp(tpe, pd->part.range.minvalue, nil) == 0 && ATOMcmp(tpe, pd->part.range.maxvalue, nil) == 0;
+	}
+	return list_empty(pd->part.values);
+}
+
+/* collect the partition scans below selects, projections and unions which produce partition column e */
+static void
+partition_scans(backend *be, sql_rel *rel, sql_exp *e, sql_subtype *kt, list *scans)
+{
+	sql_trans *tr = be->mvc->session->tr;
+
+	while (rel && !rel_is_ref(rel) && e && e->type == e_column) {
+		if (is_basetable(rel->op)) {
+			sql_table *t = rel->l;
+			sql_exp *ce = exps_bind_nid(rel->exps, e->nid);
+			const char *cname = ce ? ce->r : NULL;
+			sql_column *c = NULL;
+			sql_part *pd;
+
+			if (!t || !isTable(t) || !cname || cname[0] == '%' || !(c = find_sql_column(t, cname)) ||
+				!ATOMlinear(c->type.type->localtype) || subtype_cmp(kt, &c->type) != 0)
+				return;
+			for (pd = partition_find_part(tr, t, NULL); pd; pd = partition_find_part(tr, t, pd)) {
+				if (isPartitionedByColumnTable(pd->t) && (isRangePartitionTable(pd->t) || isListPartitionTable(pd->t)) &&
+					pd->t->part.pcol->colnr == c->colnr) {
+					sideways_bounds *sw = SA_NEW(be->mvc->sa, sideways_bounds);
+
+					*sw = (sideways_bounds) { .bt = rel, .pd = pd, .never = partition_only_nulls(pd) };
+					append(scans, sw);
+					return;
+				}
+			}
+			return;
+		}
+		if (is_munion(rel->op)) {
+			sql_exp *ue = exps_bind_nid(rel->exps, e->nid);
+			int i = ue ? list_position(rel->exps, ue) : -1;
+
+			if (i < 0)
+				return;
+			for (node *n = ((list*)rel->l)->h; n; n = n->next) { /* the union columns are positional */
+				sql_rel *r = n->data;
+				sql_exp *ce = list_fetch(rel_projections(be->mvc, r, NULL, 1, 1), i);
+
+				if (ce && exp_name(ce) && exp_name(ue) && strcmp(exp_name(ce), exp_name(ue)) == 0)
+					partition_scans(be, r, ce, kt, scans);
+			}
+			return;
+		}
+		if (is_simple_project(rel->op)) {
+			if (!(e = exps_bind_nid(rel->exps, e->nid)))
+				return;
+		} else if (!is_select(rel->op)) {
+			return;
+		}
+		rel = rel->l;
+	}
+}
+
+/* returns the side (1 left, 2 right) which scans partitions on their partition column */
+static int
+join_partition_side(backend *be, sql_rel *rel, list *scans, sql_exp **key)
+{
+	if ((rel->op != op_join && rel->op != op_semi) || is_single(rel) || !rel->l || !rel->r || list_empty(rel->exps))
+		return 0;
+	for (node *n = rel->exps->h; n; n = n->next) {
+		sql_exp *e = n->data;
+
+		if (e->type != e_cmp || e->flag != cmp_equal || is_anti(e) || is_semantics(e) || e->f)
+			continue;
+		for (int side = 1; side <= 2; side++) {
+			sql_rel *p = side == 1 ? rel->l : rel->r, *k = side == 1 ? rel->r : rel->l;
+			sql_exp *pe = e->l, *ke = e->r;
+
+			if (!rel_find_exp(p, pe)) {
+				pe = e->r;
+				ke = e->l;
+			}
+			if (ke->type != e_column || !rel_find_exp(k, ke))
+				continue;
+			partition_scans(be, p, pe, exp_subtype(ke), scans);
+			if (!list_empty(scans)) {
+				*key = ke;
+				return side;
+			}
+		}
+	}
+	return 0;
+}
+
+/* construct the children of a join, passing the join key bounds sideways when possible */
+static void
+join_children_bin(backend *be, sql_rel *rel, list *refs, stmt **left, stmt **right)
+{
+	mvc *sql = be->mvc;
+	list *scans = sa_list(sql->sa), *osw = be->sideways;
+	sql_exp *key = NULL;
+	int side = join_partition_side(be, rel, scans, &key);
+
+	if (side) {
+		sql_rel *kr = side == 1 ? rel->r : rel->l;
+		stmt **ks = side == 1 ? right : left, *k;
+		sql_subtype *kt = exp_subtype(key);
+		sql_subfunc *min = sql_bind_func(sql, "sys", "min", kt, NULL, F_AGGR, true, true);
+		sql_subfunc *max = sql_bind_func(sql, "sys", "max", kt, NULL, F_AGGR, true, true);
+
+		if (!(*ks = subrel_bin(be, kr, refs)) || !(*ks = subrel_project(be, *ks, refs, kr)) || !(*ks = row2cols(be, *ks)))
+			return;
+		if (min && max && (k = exp_bin(be, key, *ks, NULL, NULL, NULL, NULL, NULL, 0, 0, 0)) && k->nrcols) {
+			stmt *kmin = stmt_aggr(be, k, NULL, NULL, min, 1, 0, 1);
+			stmt *kmax = stmt_aggr(be, k, NULL, NULL, max, 1, 0, 1);
+
+			for (node *n = scans->h; n; n = n->next) {
+				sideways_bounds *sw = n->data;
+
+				sw->min = kmin;
+				sw->max = kmax;
+			}
+			be->sideways = osw ? list_merge(list_dup(osw, NULL), scans, NULL) : scans;
+		}
+	}
+	if (rel->l && !*left)
+		*left = subrel_bin(be, rel->l, refs);
+	if (rel->r && !*right)
+		*right = subrel_bin(be, rel->r, refs);
+	be->sideways = osw;
+}
+
+/* a partition scan which a constant guard or the join bounds leave empty, no code is generated for it */
+static bool
+rel_pruned_partition(backend *be, sql_rel *rel)
+{
+	while (rel && !rel_is_ref(rel)) {
+		if (rel->op == op_join || rel->op == op_semi) { /* a join pushed below the union of the partitions */
+			list *scans = sa_list(be->mvc->sa);
+			sql_exp *key = NULL;
+
+			if (!join_partition_side(be, rel, scans, &key))
+				return false;
+			for (node *n = scans->h; n; n = n->next) {
+				sideways_bounds *sw = n->data;
+
+				if (!sw->never)
+					return false;
+			}
+			return true;
+		}
+		if (is_basetable(rel->op)) {
+			if (be->sideways) {
+				for (node *n = be->sideways->h; n; n = n->next) {
+					sideways_bounds *sw = n->data;
+
+					if (sw->bt == rel && sw->never)
+						return true;
+				}
+			}
+			return false;
+		}
+		if (is_select(rel->op) && !list_empty(rel->exps)) {
+			for (node *n = rel->exps->h; n; n = n->next) {
+				sql_exp *e = n->data;
+
+				if (exp_is_false(e) || (e->type == e_atom && exp_is_null(e)))
+					return true;
+			}
+		} else if (!is_simple_project(rel->op)) {
+			return false;
+		}
+		rel = rel->l;
+	}
+	return false;
+}
+
 static stmt *
 rel2bin_basetable(backend *be, sql_rel *rel)
 {
@@ -2206,6 +2445,15 @@ rel2bin_basetable(backend *be, sql_rel *rel)
 
 	if (l == NULL || dels == NULL)
 		return NULL;
+	if (be->sideways) { /* prune the partition on the bounds passed by a join */
+		for (node *n = be->sideways->h; n; n = n->next) {
+			sideways_bounds *sw = n->data;
+			stmt *keep;
+
+			if (sw->bt == rel && (keep = sideways_keep(be, sw)) && !(dels = stmt_prune(be, dels, keep)))
+				return NULL;
+		}
+	}
 	/* add aliases */
 	assert(rel->exps);
 	for (en = rel->exps->h; en && !col; en = en->next) {
@@ -3213,10 +3461,8 @@ rel2bin_join(backend *be, sql_rel *rel, list *refs)
 	if (rel->attr && list_length(rel->attr) > 0)
 		return rel2bin_groupjoin(be, rel, refs);
 
-	if (rel->l) /* first construct the left sub relation */
-		left = subrel_bin(be, rel->l, refs);
-	if (rel->r) /* first construct the right sub relation */
-		right = subrel_bin(be, rel->r, refs);
+	/* first construct the left and right sub relations */
+	join_children_bin(be, rel, refs, &left, &right);
 	left = subrel_project(be, left, refs, rel->l);
 	right = subrel_project(be, right, refs, rel->r);
 	if (!left || !right)
@@ -3631,13 +3877,10 @@ rel2bin_semijoin(backend *be, sql_rel *rel, list *refs)
 
 	assert(rel->op != op_anti);
 
-	if (rel->l) { /* first construct the left sub relation */
-		sql_rel *l = rel->l;
-		l_is_base = is_basetable(l->op);
-		left = subrel_bin(be, l, refs);
-	}
-	if (rel->r) /* first construct the right sub relation */
-		right = subrel_bin(be, rel->r, refs);
+	if (rel->l)
+		l_is_base = is_basetable(((sql_rel*)rel->l)->op);
+	/* first construct the left and right sub relations */
+	join_children_bin(be, rel, refs, &left, &right);
 	if (!left || !right)
 		return NULL;
 	left = row2cols(be, left);
@@ -3962,11 +4205,15 @@ rel2bin_munion(backend *be, sql_rel *rel, list *refs)
 	list *l, *rstmts;
 	node *n, *m;
 	stmt *rel_stmt = NULL, *sub;
-	int i, len = 0, nr_unions = list_length((list*)rel->l);
+	int i, len = 0, nr_unions = 0;
 
 	/* convert to stmt and store the munion operands in rstmts list */
 	rstmts = sa_list(sql->sa);
 	for (n = ((list*)rel->l)->h; n; n = n->next) {
+		/* skip the pruned partitions, but keep one operand for the columns */
+		if ((n->next || !list_empty(rstmts)) && rel_pruned_partition(be, n->data))
+			continue;
+		nr_unions++;
 		rel_stmt = subrel_bin(be, n->data, refs);
 		rel_stmt = subrel_project(be, rel_stmt, refs, n->data);
 		if (!rel_stmt)
@@ -4332,6 +4579,92 @@ topn_offset(sql_rel *rel)
 	return NULL;
 }
 
+/*
+ * ORDER BY ST_Distance(col, g) LIMIT k only has to look at the k geometries of
+ * col nearest to g, and with the NULLs first also at those at a NULL distance.
+ * The project which computes the distance, the ordered one or the simple
+ * project below it, selects them before the distances are computed and sorted.
+ * rtree.knnselect uses the RTree of col when there is one.
+ */
+typedef struct knn_topn {
+	sql_rel *rel;		/* the project which computes the distance */
+	sql_exp *e;			/* the ST_Distance call */
+	stmt *limit;		/* limit plus offset */
+	bool nils;			/* the NULLs are ordered first */
+} knn_topn;
+
+static bool
+exp_is_distance(sql_exp *e)
+{
+	sql_subfunc *f = e->f;
+
+	return e->type == e_func && f && f->func->mod && f->func->imp &&
+		strcmp(f->func->mod, "geom") == 0 && strcmp(f->func->imp, "Distance") == 0 &&
+		list_length(e->l) == 2;
+}
+
+static knn_topn *
+rel_knn_topn(backend *be, sql_rel *rel, stmt *limit)
+{
+	list *oexps = rel->r;
+	sql_exp *oe = oexps->h->data, *e;
+	sql_rel *p = rel;
+	knn_topn *knn;
+
+	if (list_length(oexps) != 1 || need_distinct(rel) || !is_ascending(oe) || oe->type != e_column ||
+		exps_have_unsafe(rel->exps, true, false))
+		return NULL;
+	if (!(e = exps_bind_nid(rel->exps, oe->nid)) || e->type == e_column) {
+		/* computed by the project below, which must keep all its rows */
+		int nid = e ? e->nid : oe->nid;
+
+		p = rel->l;
+		if (!p || !is_simple_project(p->op) || rel_is_ref(p) || need_distinct(p) || p->r ||
+			exps_have_unsafe(p->exps, true, false) || !(e = exps_bind_nid(p->exps, nid)))
+			return NULL;
+	}
+	if (!exp_is_distance(e) || !(knn = SA_NEW(be->mvc->sa, knn_topn)))
+		return NULL;
+	*knn = (knn_topn) {
+		.rel = p,
+		.e = e,
+		.limit = limit,
+		.nils = !nulls_last(oe),
+	};
+	return knn;
+}
+
+static stmt *
+rel2bin_knn(backend *be, knn_topn *knn, stmt *sub)
+{
+	list *args = knn->e->l;
+	sql_exp *ce = args->h->data, *ge = args->h->next->data;
+
+	if (ce->type != e_column) {
+		sql_exp *t = ce;
+
+		ce = ge;
+		ge = t;
+	}
+	if (sub->nrcols == 0 || ce->type != e_column || exp_card(ge) > CARD_ATOM)
+		return sub;
+
+	int oldvtop = be->mb->vtop, oldstop = be->mb->stop;
+	stmt *col = exp_bin(be, ce, sub, NULL, NULL, NULL, NULL, NULL, 0, 0, 0), *g, *s;
+
+	if (!col || !(g = exp_bin(be, ge, sub, NULL, NULL, NULL, NULL, NULL, 0, 0, 0)))
+		return NULL;
+	if (col->nrcols == 0 || g->nrcols != 0) {
+		clean_mal_statements(be, oldstop, oldvtop);
+		return sub;
+	}
+	if (!(s = stmt_knnselect(be, col, g, knn->limit, knn->nils)))
+		return NULL;
+	sub = stmt_list(be, sub->op4.lval); /* protect against references */
+	sub->cand = s;
+	return subrel_project(be, sub, NULL, NULL);
+}
+
 static stmt *
 rel2bin_project(backend *be, sql_rel *rel, list *refs, sql_rel *topn)
 {
@@ -4365,6 +4698,13 @@ rel2bin_project(backend *be, sql_rel *rel, list *refs, sql_rel *topn)
 	if (!rel->exps)
 		return stmt_none(be);
 
+	knn_topn *knn = be->knn && be->knn->rel == rel ? be->knn : NULL;
+
+	be->knn = NULL;
+	if (topn && rel->r && (knn = rel_knn_topn(be, rel, l)) && knn->rel != rel) {
+		be->knn = knn; /* for the project below */
+		knn = NULL;
+	}
 	if (rel->l) { /* first construct the sub relation */
 		sql_rel *l = rel->l;
 		if (l->op == op_ddl) {
@@ -4379,6 +4719,9 @@ rel2bin_project(backend *be, sql_rel *rel, list *refs, sql_rel *topn)
 		if (!sub)
 			return NULL;
 	}
+	be->knn = NULL;
+	if (knn && sub && !(sub = rel2bin_knn(be, knn, sub)))
+		return NULL;
 
 	pl = sa_list(sql->sa);
 	if (pl == NULL)
@@ -4527,6 +4870,18 @@ rel2bin_predicate(backend *be)
 	return const_column(be, stmt_bool(be, 1));
 }
 
+/* scalar comparisons which give the same truth value when they are not reduced to a select,
+ * filter functions (eg NOT LIKE) would lose their negation */
+static bool
+exp_is_scalar_guard(sql_exp *e)
+{
+	if (exp_card(e) > CARD_ATOM)
+		return false;
+	if (e->type == e_atom)
+		return true;
+	return e->type == e_cmp && (is_theta_exp(e->flag) || ((e->flag == cmp_in || e->flag == cmp_notin) && !is_anti(e)));
+}
+
 static stmt *
 rel2bin_select(backend *be, sql_rel *rel, list *refs)
 {
@@ -4574,15 +4929,36 @@ rel2bin_select(backend *be, sql_rel *rel, list *refs)
 			}
 		}
 	}
-	for (en = rel->exps->h; en; en = en->next) {
+	list *exps = rel->exps;
+	if (sel) { /* scalar predicates (eg partition guards) keep or drop all candidates, test them first */
+		exps = sa_list(sql->sa);
+		for (en = rel->exps->h; en; en = en->next)
+			if (exp_is_scalar_guard(en->data))
+				append(exps, en->data);
+		for (en = rel->exps->h; en; en = en->next)
+			if (!exp_is_scalar_guard(en->data))
+				append(exps, en->data);
+	}
+	for (en = exps->h; en; en = en->next) {
 		sql_exp *e = en->data;
-		stmt *s = exp_bin(be, e, sub, NULL, NULL, NULL, NULL, sel, 0, 1, 0);
+		bool scalar = sel && exp_is_scalar_guard(e);
+		stmt *s = exp_bin(be, e, sub, NULL, NULL, NULL, NULL, scalar ? NULL : sel, 0, !scalar, 0);
 
 		if (!s) {
 			assert(sql->session->status == -10); /* Stack overflow errors shouldn't terminate the server */
 			return NULL;
 		}
-		if (s->nrcols == 0){
+		if (scalar) {
+			if (e->type != e_cmp) {
+				sql_subtype *bt = sql_bind_localtype("bit");
+
+				s = stmt_convert(be, s, NULL, exp_subtype(e), bt);
+			}
+			if (s->nrcols == 0)
+				sel = stmt_prune(be, sel, s);
+			else
+				sel = stmt_uselect(be, s, stmt_bool(be, 1), cmp_equal, sel, 0, 0);
+		} else if (s->nrcols == 0){
 			if (!predicate && sub && !list_empty(sub->op4.lval))
 				predicate = stmt_const(be, bin_find_smallest_column(be, sub), stmt_bool(be, 1));
 			else if (!predicate)
@@ -7570,6 +7946,8 @@ output_rel_bin(backend *be, sql_rel *rel, int top)
 	stmt *s = NULL;
 
 	be->join_idx = 0;
+	be->sideways = NULL;
+	be->knn = NULL;
 	be->rowcount = 0;
 	be->silent = !top;
 
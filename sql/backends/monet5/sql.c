@@ -1755,6 +1755,7 @@ mvc_append_column(sql_trans *t, sql_column *c, BUN offset, BAT *pos, BAT *ins)
 	int res = store->storage_api.append_col(t, c, offset, pos, ins, BATcount(ins), true, ins->ttype);
 	if (res != LOG_OK) /* the conflict case should never happen, but leave it here */
 		throw(SQL, "sql.append", SQLSTATE(42000) "Append failed %s", res == LOG_CONFLICT ? "due to conflict with another transaction" : GDKerrbuf);
+	sql_trans_append_histogram(t, c, ins);
 	return MAL_SUCCEED;
 }
 
@@ -1871,6 +1872,8 @@ mvc_append_wrap(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 	sqlstore *store = m->session->tr->store;
 	if (cname[0] != '%' && (c = mvc_bind_column(m, t, cname)) != NULL) {
 		log_res = store->storage_api.append_col(m->session->tr, c, offset, pos, ins, cnt, isbat, tpe);
+		if (log_res == LOG_OK && isbat) /* bulk loads refresh the histogram */
+			sql_trans_append_histogram(m->session->tr, c, b);
 	} else if (cname[0] == '%' && (i = mvc_bind_idx(m, s, cname + 1)) != NULL) {
 		log_res = store->storage_api.append_idx(m->session->tr, i, offset, pos, ins, cnt, isbat, tpe);
 	} else {
@@ -2441,6 +2444,27 @@ SQLtid(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 	return msg;
 }
 
+/* str SQLprune(bat *result, bat *cand, bit *keep) */
+str
+SQLprune(bat *res, const bat *cand, const bit *keep)
+{
+	BAT *c, *bn;
+
+	if (*keep == TRUE) { /* the partition may hold qualifying rows */
+		BBPretain(*res = *cand);
+		return MAL_SUCCEED;
+	}
+	if ((c = BATdescriptor(*cand)) == NULL)
+		throw(SQL, "batsql.prune", SQLSTATE(HY002) RUNTIME_OBJECT_MISSING);
+	bn = BATdense(c->hseqbase, 0, 0);
+	BBPunfix(c->batCacheid);
+	if (bn == NULL)
+		throw(SQL, "batsql.prune", GDK_EXCEPTION);
+	*res = bn->batCacheid;
+	BBPkeepref(bn);
+	return MAL_SUCCEED;
+}
+
 /* unsafe pattern resultSet(tbl:bat[:str], attr:bat[:str], tpe:bat[:str], len:bat[:int],scale:bat[:int], cols:bat[:any]...) :int */
 /* New result set rendering infrastructure */
 
@@ -2529,6 +2553,134 @@ mvc_result_set_wrap( Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 	return msg;
 }
 
+/* unsafe pattern resultSetParts(tbl:bat[:str], attr:bat[:str], tpe:bat[:str], len:bat[:int],scale:bat[:int], parts:int, cols:bat[:any]...) :int */
+/* The columns are given by their partitions, all parts of the first column
+ * followed by those of the second, etc.  When the partitions are aligned
+ * and the whole result goes to the client in one reply, it is exported
+ * from the partitions directly.  Otherwise each column is packed first. */
+static str
+mvc_result_parts_wrap( Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	int *res_id =getArgReference_int(stk,pci,0);
+	bat tblId= *getArgReference_bat(stk, pci,1);
+	bat atrId= *getArgReference_bat(stk, pci,2);
+	bat tpeId= *getArgReference_bat(stk, pci,3);
+	bat lenId= *getArgReference_bat(stk, pci,4);
+	bat scaleId= *getArgReference_bat(stk, pci,5);
+	int nparts = *getArgReference_int(stk, pci, 6);
+	int ncols, i, j, res, ok;
+	const char *tblname, *colname, *tpename;
+	str msg= MAL_SUCCEED;
+	int *digits, *scaledigits;
+	BATiter itertbl,iteratr,itertpe,iterdig,iterscl;
+	backend *be = NULL;
+	mvc *m;
+	BAT **parts = NULL, *tbl = NULL, *atr = NULL, *tpe = NULL,*len = NULL,*scale = NULL;
+	BUN nr_rows = 0;
+	bool direct = true;
+
+	if ((msg = getBackendContext(cntxt, &be)) != NULL)
+		return msg;
+	m = be->mvc;
+	if (nparts <= 0 || (pci->argc - 7) % nparts != 0)
+		throw(SQL, "sql.resultSet", SQLSTATE(42000) "Incorrect number of partitions");
+	ncols = (pci->argc - 7) / nparts;
+	if ((parts = GDKzalloc(sizeof(BAT *) * (pci->argc - 7))) == NULL)
+		throw(SQL, "sql.resultSet", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	for (i = 0; i < pci->argc - 7; i++) {
+		if ((parts[i] = BATdescriptor(*getArgReference_bat(stk, pci, i + 7))) == NULL) {
+			msg = createException(SQL, "sql.resultSet", SQLSTATE(HY002) RUNTIME_OBJECT_MISSING);
+			goto wrapup_result_set;
+		}
+		/* all columns must have the same row count in each partition */
+		if (i >= nparts && BATcount(parts[i]) != BATcount(parts[i % nparts]))
+			direct = false;
+		if (i < nparts)
+			nr_rows += BATcount(parts[i]);
+	}
+	direct &= be->output_format == OFMT_CSV && cntxt->fdout &&
+		cntxt->protocol != PROTOCOL_COLUMNAR && m->reply_size != -2 &&
+		(m->reply_size <= 0 || (BUN) m->reply_size >= nr_rows);
+
+	res = *res_id = mvc_result_table(be, mb->tag, ncols, Q_TABLE);
+	if (res < 0) {
+		msg = createException(SQL, "sql.resultSet", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		goto wrapup_result_set;
+	}
+
+	tbl = BATdescriptor(tblId);
+	atr = BATdescriptor(atrId);
+	tpe = BATdescriptor(tpeId);
+	len = BATdescriptor(lenId);
+	scale = BATdescriptor(scaleId);
+	if (tbl == NULL || atr == NULL || tpe == NULL || len == NULL || scale == NULL)
+		goto wrapup_result_set;
+	itertbl = bat_iterator(tbl);
+	iteratr = bat_iterator(atr);
+	itertpe = bat_iterator(tpe);
+	iterdig = bat_iterator(len);
+	iterscl = bat_iterator(scale);
+	digits = (int*) iterdig.base;
+	scaledigits = (int*) iterscl.base;
+
+	for (i = 0; msg == MAL_SUCCEED && i < ncols; i++) {
+		BAT **p = parts + i * nparts;
+
+		tblname = BUNtvar(itertbl,i);
+		colname = BUNtvar(iteratr,i);
+		tpename = BUNtvar(itertpe,i);
+		if (direct) {
+			if (mvc_result_column_parts(be, tblname, colname, tpename, digits[i], scaledigits[i], p, nparts))
+				msg = createException(SQL, "sql.resultSet", SQLSTATE(42000) "Cannot access column descriptor %s.%s",tblname,colname);
+			continue;
+		}
+		BAT *b = COLnew(0, p[0]->ttype, nr_rows, TRANSIENT);
+		if (b == NULL) {
+			msg = createException(SQL, "sql.resultSet", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+			break;
+		}
+		for (j = 0; j < nparts; j++) {
+			if (BATappend(b, p[j], NULL, false) != GDK_SUCCEED) {
+				msg = createException(SQL, "sql.resultSet", GDK_EXCEPTION);
+				break;
+			}
+		}
+		if (msg == MAL_SUCCEED &&
+			mvc_result_column(be, tblname, colname, tpename, digits[i], scaledigits[i], b))
+			msg = createException(SQL, "sql.resultSet", SQLSTATE(42000) "Cannot access column descriptor %s.%s",tblname,colname);
+		BBPunfix(b->batCacheid);
+	}
+	bat_iterator_end(&itertbl);
+	bat_iterator_end(&iteratr);
+	bat_iterator_end(&itertpe);
+	bat_iterator_end(&iterdig);
+	bat_iterator_end(&iterscl);
+	/* now send it to the channel cntxt->fdout */
+	if (bstream_getoob(cntxt->fdin))
+		msg = createException(SQL, "sql.resultSet", SQLSTATE(HY000) "Query aboted");
+	else if (!msg && (ok = mvc_export_result(be, cntxt->fdout, res, true, cntxt->qryctx.starttime, mb->optimize)) < 0)
+		msg = createException(SQL, "sql.resultSet", SQLSTATE(45000) "Result set construction failed: %s", mvc_export_error(be, cntxt->fdout, ok));
+	/* the partitions are not kept beyond the reply */
+	if (direct) {
+		res_table *t = res_tables_find(be->results, res);
+		if (t)
+			be->results = res_tables_remove(be->results, t);
+	}
+  wrapup_result_set:
+	cntxt->qryctx.starttime = 0;
+	cntxt->qryctx.endtime = 0;
+	mb->optimize = 0;
+	if( tbl) BBPunfix(tblId);
+	if( atr) BBPunfix(atrId);
+	if( tpe) BBPunfix(tpeId);
+	if( len) BBPunfix(lenId);
+	if( scale) BBPunfix(scaleId);
+	for (i = 0; i < pci->argc - 7 && parts[i]; i++)
+		BBPunfix(parts[i]->batCacheid);
+	GDKfree(parts);
+	return msg;
+}
+
 /* Copy the result set into a CSV file */
 str
 mvc_export_table_wrap( Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
@@ -4769,6 +4921,8 @@ SQLsession_prepared_statements(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrP
 
 	for (q = sql->qc->q; q; q = q->next) {
 		gdk_return bun_res;
+		if (q->autoparam)
+			continue;
 		if (BUNappend(sessionid, &(cntxt->idx), false) != GDK_SUCCEED) {
 			msg = createException(SQL, "sql.session_prepared_statements", GDK_EXCEPTION);
 			goto bailout;
@@ -4863,6 +5017,8 @@ SQLsession_prepared_statements_args(Client cntxt, MalBlkPtr mb, MalStkPtr stk, I
 		int arg_number = 0;
 		bte inout = ARG_OUT;
 
+		if (q->autoparam)
+			continue;
 		if (r && (is_topn(r->op) || is_sample(r->op)))
 			r = r->l;
 
@@ -5443,6 +5599,7 @@ SQLstr_stop_vacuum(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 #include "sql_subquery.h"
 #include "sql_statistics.h"
 #include "sql_transaction.h"
+#include "sql_plancache.h"
 #include "for.h"
 #include "dict.h"
 #include "mel.h"
@@ -5587,10 +5744,12 @@ static mel_func sql_init_funcs[] = {
  pattern("sql", "clear_table", mvc_clear_table_wrap, true, "Clear the table sname.tname.", args(1,4, arg("",lng),arg("sname",str),arg("tname",str),arg("restart_sequences",int))),
  pattern("sql", "tid", SQLtid, false, "Return a column with the valid tuple identifiers associated with the table sname.tname.", args(1,4, batarg("",oid),arg("mvc",int),arg("sname",str),arg("tname",str))),
  pattern("sql", "tid", SQLtid, false, "Return the tables tid column.", args(1,6, batarg("",oid),arg("mvc",int),arg("sname",str),arg("tname",str),arg("part_nr",int),arg("nr_parts",int))),
+ command("batsql", "prune", SQLprune, false, "Return the candidate list when keep is true, else an empty one.", args(1,3, batarg("",oid),batarg("cand",oid),arg("keep",bit))),
  pattern("sql", "delete", mvc_delete_wrap, true, "Delete a row from a table. Returns sequence number for order dependence.", args(1,5, arg("",int),arg("mvc",int),arg("sname",str),arg("tname",str),argany("b",0))),
  pattern("sql", "resultSet", mvc_scalar_value_wrap, true, "Prepare a table result set for the client front-end.", args(1,8, arg("",int),arg("tbl",str),arg("attr",str),arg("tpe",str),arg("len",int),arg("scale",int),arg("eclass",int),argany("val",0))),
  pattern("sql", "resultSet", mvc_row_result_wrap, true, "Prepare a table result set for the client front-end", args(1,7, arg("",int),batarg("tbl",str),batarg("attr",str),batarg("tpe",str),batarg("len",int),batarg("scale",int),varargany("cols",0))),
  pattern("sql", "resultSet", mvc_table_result_wrap, true, "Prepare a table result set for the client in default CSV format", args(1,7, arg("",int),batarg("tbl",str),batarg("attr",str),batarg("tpe",str),batarg("len",int),batarg("scale",int),batvarargany("cols",0))),
+ pattern("sql", "resultSetParts", mvc_result_parts_wrap, true, "Prepare a table result set for the client from the partitions of its columns", args(1,8, arg("",int),batarg("tbl",str),batarg("attr",str),batarg("tpe",str),batarg("len",int),batarg("scale",int),arg("parts",int),batvarargany("cols",0))),
  pattern("sql", "export_table", mvc_export_row_wrap, true, "Prepare a table result set for the COPY INTO stream", args(1,14, arg("",int),arg("fname",str),arg("fmt",str),arg("colsep",str),arg("recsep",str),arg("qout",str),arg("nullrep",str),arg("onclient",int),batarg("tbl",str),batarg("attr",str),batarg("tpe",str),batarg("len",int),batarg("scale",int),varargany("cols",0))),
  pattern("sql", "export_table", mvc_export_table_wrap, true, "Prepare a table result set for the COPY INTO stream", args(1,14, arg("",int),arg("fname",str),arg("fmt",str),arg("colsep",str),arg("recsep",str),arg("qout",str),arg("nullrep",str),arg("onclient",int),batarg("tbl",str),batarg("attr",str),batarg("tpe",str),batarg("len",int),batarg("scale",int),batvarargany("cols",0))),
  pattern("sql", "exportHead", mvc_export_head_wrap, true, "Export a result (in order) to stream s", args(1,3, arg("",void),arg("s",streams),arg("res_id",int))),
@@ -5646,6 +5805,7 @@ static mel_func sql_init_funcs[] = {
  command("sql", "querylog_disable", QLOGdisable, true, "", noargs),
  pattern("sql", "prepared_statements", SQLsession_prepared_statements, false, "Available prepared statements in the current session", args(5,5, batarg("sessionid",int),batarg("user",str),batarg("statementid",int),batarg("statement",str),batarg("created",timestamp))),
  pattern("sql", "prepared_statements_args", SQLsession_prepared_statements_args, false, "Available prepared statements' arguments in the current session", args(9,9, batarg("statementid",int),batarg("type",str),batarg("digits",int),batarg("scale",int),batarg("inout",bte),batarg("number",int),batarg("schema",str),batarg("table",str),batarg("column",str))),
+ pattern("sql", "plancache", SQLplancache_statistics, false, "Statistics of the plan cache shared by the prepared statements of all sessions", args(2,2, batarg("name",str),batarg("value",lng))),
  pattern("sql", "copy_rejects", COPYrejects, false, "", args(4,4, batarg("rowid",lng),batarg("fldid",int),batarg("msg",str),batarg("inp",str))),
  pattern("sql", "copy_rejects_clear", COPYrejects_clear, true, "", noargs),
  pattern("for", "compress", FORcompress_col, false, "compress a sql column", args(0, 3, arg("schema", str), arg("table", str), arg("column", str))),
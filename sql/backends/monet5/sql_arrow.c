@@ -0,0 +1,968 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+/*
+ * Export of result sets in the Apache Arrow columnar format, either as
+ * an Arrow IPC stream on a MAPI connection (Xexportarrow) or as Arrow C
+ * data interface arrays for embedded use (monetdbe).
+ *
+ * Fixed width columns whose layout matches the Arrow layout (integers,
+ * floating point, hugeint, times, intervals, uuids) share the BAT heap;
+ * the other types (dates, timestamps, decimals stored in less than 128
+ * bits, booleans and all variable sized types) are converted into
+ * freshly allocated Arrow buffers.  Nils become nulls in the validity
+ * bitmap, which is only built for columns that actually contain nils.
+ */
+
+#include "monetdb_config.h"
+#include "sql_arrow.h"
+#include "sql_result.h"
+#include "gdk_time.h"
+#include "bat/res_table.h"
+
+/* the Type union of the Arrow Schema.fbs */
+enum arrow_type {
+	AT_INT = 2,
+	AT_FLOAT = 3,
+	AT_BINARY = 4,
+	AT_UTF8 = 5,
+	AT_BOOL = 6,
+	AT_DECIMAL = 7,
+	AT_DATE = 8,
+	AT_TIME = 9,
+	AT_TIMESTAMP = 10,
+	AT_INTERVAL = 11,
+	AT_FIXEDBINARY = 15,
+	AT_DURATION = 18,
+	AT_LARGEBINARY = 19,
+	AT_LARGEUTF8 = 20,
+};
+
+typedef struct arrow_col {
+	const char *name;
+	char format[24];			/* C data interface format string */
+	enum arrow_type type;
+	int width;					/* bit width (Int, Time), byte width (FixedSizeBinary) */
+	bool is_signed;
+	int precision, scale;		/* Decimal; FloatingPoint uses precision */
+	int unit;					/* Date, Time, Timestamp, Duration and Interval unit */
+	const char *tz;				/* Timestamp */
+	int64_t length, null_count;
+	int nbuffers;
+	const void *buf[3];
+	size_t len[3];
+	void *own[3];				/* buffers allocated for the conversion */
+	BAT *b;						/* fixed BAT, possibly sharing its heap */
+} arrow_col;
+
+static void
+arrow_col_destroy(arrow_col *ac)
+{
+	for (int i = 0; i < 3; i++) {
+		GDKfree(ac->own[i]);
+		ac->own[i] = NULL;
+	}
+	BBPreclaim(ac->b);
+	ac->b = NULL;
+}
+
+/* a result column made of mitosis parts is packed into one BAT first */
+static BAT *
+arrow_concat(res_col *c)
+{
+	BAT *bn = NULL;
+
+	for (int i = 0; i < c->nr_parts; i++) {
+		BAT *b = BATdescriptor(c->parts[i]);
+		if (b == NULL) {
+			BBPreclaim(bn);
+			return NULL;
+		}
+		if (bn == NULL)
+			bn = COLnew(0, ATOMtype(b->ttype), BATcount(b) * c->nr_parts, TRANSIENT);
+		if (bn == NULL || BATappend(bn, b, NULL, false) != GDK_SUCCEED) {
+			BBPunfix(b->batCacheid);
+			BBPreclaim(bn);
+			return NULL;
+		}
+		BBPunfix(b->batCacheid);
+	}
+	return bn;
+}
+
+/* clear the validity bit of row i, allocating the bitmap on the first nil */
+static inline bool
+arrow_setnull(arrow_col *ac, BUN i, BUN cnt)
+{
+	uint8_t *v = ac->own[0];
+
+	if (v == NULL) {
+		if ((v = GDKmalloc((cnt + 7) / 8)) == NULL)
+			return false;
+		memset(v, 0xFF, (cnt + 7) / 8);
+		ac->own[0] = v;
+		ac->buf[0] = v;
+		ac->len[0] = (cnt + 7) / 8;
+	}
+	v[i >> 3] &= ~(1 << (i & 7));
+	ac->null_count++;
+	return true;
+}
+
+#define arrow_validity_loop(TYPE, ISNIL)							\
+	do {															\
+		const TYPE *restrict p = (const TYPE *) Tloc(b, offset);	\
+		for (BUN i = 0; i < cnt; i++)								\
+			if (ISNIL(p[i]) && !arrow_setnull(ac, i, cnt))			\
+				return -1;											\
+	} while (0)
+
+static int
+arrow_validity(arrow_col *ac, BAT *b, BUN offset, BUN cnt)
+{
+	if (b->tnonil)
+		return 0;
+	switch (ATOMstorage(b->ttype)) {
+	case TYPE_bte:
+		arrow_validity_loop(bte, is_bte_nil);
+		break;
+	case TYPE_sht:
+		arrow_validity_loop(sht, is_sht_nil);
+		break;
+	case TYPE_int:
+		arrow_validity_loop(int, is_int_nil);
+		break;
+	case TYPE_lng:
+		arrow_validity_loop(lng, is_lng_nil);
+		break;
+#ifdef HAVE_HGE
+	case TYPE_hge:
+		arrow_validity_loop(hge, is_hge_nil);
+		break;
+#endif
+	case TYPE_flt:
+		arrow_validity_loop(flt, is_flt_nil);
+		break;
+	case TYPE_dbl:
+		arrow_validity_loop(dbl, is_dbl_nil);
+		break;
+	default: {
+		const void *nil = ATOMnilptr(b->ttype);
+		int (*cmp)(const void *, const void *) = ATOMcompare(b->ttype);
+		BATiter bi = bat_iterator(b);
+		for (BUN i = 0; i < cnt; i++) {
+			if (cmp(BUNtail(bi, offset + i), nil) == 0 && !arrow_setnull(ac, i, cnt)) {
+				bat_iterator_end(&bi);
+				return -1;
+			}
+		}
+		bat_iterator_end(&bi);
+		break;
+	}
+	}
+	return 0;
+}
+
+/* the data buffer is the BAT heap itself */
+static void
+arrow_share(arrow_col *ac, BAT *b, BUN offset, BUN cnt)
+{
+	ac->buf[1] = Tloc(b, offset);
+	ac->len[1] = cnt << b->tshift;
+}
+
+static void *
+arrow_alloc(arrow_col *ac, int i, size_t len)
+{
+	/* never hand out NULL for an empty buffer */
+	if ((ac->own[i] = GDKzalloc(len ? len : 1)) == NULL)
+		return NULL;
+	ac->buf[i] = ac->own[i];
+	ac->len[i] = len;
+	return ac->own[i];
+}
+
+static int
+arrow_bool(arrow_col *ac, BAT *b, BUN offset, BUN cnt)
+{
+	const bit *restrict p = (const bit *) Tloc(b, offset);
+	uint8_t *d;
+
+	if ((d = arrow_alloc(ac, 1, (cnt + 7) / 8)) == NULL)
+		return -1;
+	for (BUN i = 0; i < cnt; i++) {
+		if (is_bit_nil(p[i])) {
+			if (!arrow_setnull(ac, i, cnt))
+				return -1;
+		} else if (p[i]) {
+			d[i >> 3] |= 1 << (i & 7);
+		}
+	}
+	return 0;
+}
+
+#define arrow_widen_loop(TYPE)										\
+	do {															\
+		const TYPE *restrict p = (const TYPE *) Tloc(b, offset);	\
+		for (BUN i = 0; i < cnt; i++) {								\
+			if (is_##TYPE##_nil(p[i])) {							\
+				if (!arrow_setnull(ac, i, cnt))						\
+					return -1;										\
+				continue;											\
+			}														\
+			d[2 * i + LO] = (int64_t) p[i];							\
+			d[2 * i + HI] = p[i] < 0 ? -1 : 0;						\
+		}															\
+	} while (0)
+
+/* decimals stored in less than 128 bits become decimal128 */
+static int
+arrow_decimal(arrow_col *ac, BAT *b, BUN offset, BUN cnt)
+{
+#ifdef WORDS_BIGENDIAN
+	enum { HI = 0, LO = 1 };
+#else
+	enum { LO = 0, HI = 1 };
+#endif
+	int64_t *d;
+
+	if ((d = arrow_alloc(ac, 1, cnt * 16)) == NULL)
+		return -1;
+	switch (ATOMstorage(b->ttype)) {
+	case TYPE_bte:
+		arrow_widen_loop(bte);
+		break;
+	case TYPE_sht:
+		arrow_widen_loop(sht);
+		break;
+	case TYPE_int:
+		arrow_widen_loop(int);
+		break;
+	case TYPE_lng:
+		arrow_widen_loop(lng);
+		break;
+	default:
+		assert(0);
+	}
+	return 0;
+}
+
+/* days since the UNIX epoch */
+static int
+arrow_date(arrow_col *ac, BAT *b, BUN offset, BUN cnt)
+{
+	const date *restrict p = (const date *) Tloc(b, offset);
+	const date epoch = date_create(1970, 1, 1);
+	int32_t *d;
+
+	if ((d = arrow_alloc(ac, 1, cnt * sizeof(int32_t))) == NULL)
+		return -1;
+	for (BUN i = 0; i < cnt; i++) {
+		if (is_date_nil(p[i])) {
+			if (!arrow_setnull(ac, i, cnt))
+				return -1;
+		} else {
+			d[i] = date_diff(p[i], epoch);
+		}
+	}
+	return 0;
+}
+
+/* microseconds since the UNIX epoch */
+static int
+arrow_timestamp(arrow_col *ac, BAT *b, BUN offset, BUN cnt)
+{
+	const timestamp *restrict p = (const timestamp *) Tloc(b, offset);
+	const timestamp epoch = unixepoch;
+	int64_t *d;
+
+	if ((d = arrow_alloc(ac, 1, cnt * sizeof(int64_t))) == NULL)
+		return -1;
+	for (BUN i = 0; i < cnt; i++) {
+		if (is_timestamp_nil(p[i])) {
+			if (!arrow_setnull(ac, i, cnt))
+				return -1;
+		} else {
+			d[i] = timestamp_diff(p[i], epoch);
+		}
+	}
+	return 0;
+}
+
+/* offsets and data buffers of the (Large)Utf8 and (Large)Binary types */
+static int
+arrow_varsized(arrow_col *ac, BAT *b, BUN offset, BUN cnt, bool isblob)
+{
+	BATiter bi = bat_iterator(b);
+	size_t total = 0;
+	bool large;
+	char *d;
+
+	for (BUN i = 0; i < cnt; i++) {
+		const void *v = BUNtvar(bi, offset + i);
+		if (isblob)
+			total += is_blob_nil((const blob *) v) ? 0 : ((const blob *) v)->nitems;
+		else
+			total += strNil(v) ? 0 : strlen(v);
+	}
+	large = total > (size_t) INT32_MAX;
+	if (isblob) {
+		ac->type = large ? AT_LARGEBINARY : AT_BINARY;
+		strcpy(ac->format, large ? "Z" : "z");
+	} else {
+		ac->type = large ? AT_LARGEUTF8 : AT_UTF8;
+		strcpy(ac->format, large ? "U" : "u");
+	}
+	ac->nbuffers = 3;
+	if (arrow_alloc(ac, 1, (cnt + 1) * (large ? sizeof(int64_t) : sizeof(int32_t))) == NULL ||
+		(d = arrow_alloc(ac, 2, total)) == NULL) {
+		bat_iterator_end(&bi);
+		return -1;
+	}
+	total = 0;
+	for (BUN i = 0; i < cnt; i++) {
+		const void *v = BUNtvar(bi, offset + i);
+		size_t l;
+		if (isblob ? is_blob_nil((const blob *) v) : strNil(v)) {
+			if (!arrow_setnull(ac, i, cnt)) {
+				bat_iterator_end(&bi);
+				return -1;
+			}
+			l = 0;
+		} else if (isblob) {
+			l = ((const blob *) v)->nitems;
+			memcpy(d + total, ((const blob *) v)->data, l);
+		} else {
+			l = strlen(v);
+			memcpy(d + total, v, l);
+		}
+		total += l;
+		if (large)
+			((int64_t *) ac->own[1])[i + 1] = (int64_t) total;
+		else
+			((int32_t *) ac->own[1])[i + 1] = (int32_t) total;
+	}
+	bat_iterator_end(&bi);
+	return 0;
+}
+
+/* describe rows offset..offset+cnt of result column c as an Arrow column */
+static int
+arrow_column(arrow_col *ac, res_col *c, BUN offset, BUN cnt)
+{
+	sql_class ec = c->type.type ? c->type.type->eclass : EC_ANY;
+	BAT *b;
+	int tt;
+
+	*ac = (arrow_col) {
+		.name = c->name,
+		.length = (int64_t) cnt,
+		.nbuffers = 2,
+		.is_signed = true,
+	};
+	b = c->nr_parts ? arrow_concat(c) : BATdescriptor(c->b);
+	if (b == NULL)
+		return -2;
+	if (b->ttype == TYPE_void) {
+		BAT *m = COLcopy(b, TYPE_oid, true, TRANSIENT);
+		BBPunfix(b->batCacheid);
+		if ((b = m) == NULL)
+			return -3;
+	}
+	ac->b = b;
+	if (BATcount(b) < offset + cnt)
+		cnt = BATcount(b) > offset ? BATcount(b) - offset : 0;
+	ac->length = (int64_t) cnt;
+	tt = b->ttype;
+
+	if (ATOMstorage(tt) == TYPE_str)
+		return arrow_varsized(ac, b, offset, cnt, false);
+	if (tt == TYPE_blob)
+		return arrow_varsized(ac, b, offset, cnt, true);
+	if (tt == TYPE_bit) {
+		ac->type = AT_BOOL;
+		strcpy(ac->format, "b");
+		return arrow_bool(ac, b, offset, cnt);
+	}
+	if (tt == TYPE_uuid) {
+		ac->type = AT_FIXEDBINARY;
+		ac->width = 16;
+		strcpy(ac->format, "w:16");
+		arrow_share(ac, b, offset, cnt);
+		return arrow_validity(ac, b, offset, cnt);
+	}
+
+	switch (ec) {
+	case EC_DEC:
+		ac->type = AT_DECIMAL;
+		ac->precision = c->type.digits;
+		ac->scale = c->type.scale;
+		snprintf(ac->format, sizeof(ac->format), "d:%d,%d", ac->precision, ac->scale);
+#ifdef HAVE_HGE
+		if (tt == TYPE_hge) {
+			arrow_share(ac, b, offset, cnt);
+			return arrow_validity(ac, b, offset, cnt);
+		}
+#endif
+		return arrow_decimal(ac, b, offset, cnt);
+	case EC_DATE:
+		ac->type = AT_DATE;
+		strcpy(ac->format, "tdD");
+		return arrow_date(ac, b, offset, cnt);
+	case EC_TIMESTAMP:
+	case EC_TIMESTAMP_TZ:
+		ac->type = AT_TIMESTAMP;
+		ac->unit = 2;			/* MICROSECOND */
+		ac->tz = ec == EC_TIMESTAMP_TZ ? "UTC" : NULL;
+		strcpy(ac->format, ec == EC_TIMESTAMP_TZ ? "tsu:UTC" : "tsu:");
+		return arrow_timestamp(ac, b, offset, cnt);
+	case EC_TIME:
+	case EC_TIME_TZ:
+		ac->type = AT_TIME;
+		ac->unit = 2;			/* MICROSECOND */
+		ac->width = 64;
+		strcpy(ac->format, "ttu");
+		break;
+	case EC_MONTH:
+		ac->type = AT_INTERVAL;
+		ac->unit = 0;			/* YEAR_MONTH */
+		strcpy(ac->format, "tiM");
+		break;
+	case EC_SEC:
+		ac->type = AT_DURATION;
+		ac->unit = 1;			/* MILLISECOND */
+		strcpy(ac->format, "tDm");
+		break;
+	default:
+		switch (tt) {
+		case TYPE_bte:
+		case TYPE_sht:
+		case TYPE_int:
+		case TYPE_lng:
+		case TYPE_oid:
+			ac->type = AT_INT;
+			ac->width = ATOMsize(tt) * 8;
+			ac->is_signed = tt != TYPE_oid;
+			snprintf(ac->format, sizeof(ac->format), "%c",
+					 tt == TYPE_oid ? (SIZEOF_OID == 8 ? 'L' : 'I') :
+					 ac->width == 8 ? 'c' : ac->width == 16 ? 's' : ac->width == 32 ? 'i' : 'l');
+			break;
+#ifdef HAVE_HGE
+		case TYPE_hge:
+			/* Arrow has no 128 bit integer, a decimal128 with
+			 * scale 0 has the same layout */
+			ac->type = AT_DECIMAL;
+			ac->precision = 38;
+			strcpy(ac->format, "d:38,0");
+			break;
+#endif
+		case TYPE_flt:
+		case TYPE_dbl:
+			ac->type = AT_FLOAT;
+			ac->precision = tt == TYPE_flt ? 1 : 2;	/* SINGLE, DOUBLE */
+			strcpy(ac->format, tt == TYPE_flt ? "f" : "g");
+			break;
+		default:
+			GDKerror("column %s: cannot export type '%s' to Arrow", c->name, ATOMname(tt));
+			return -3;
+		}
+	}
+	arrow_share(ac, b, offset, cnt);
+	return arrow_validity(ac, b, offset, cnt);
+}
+
+static void
+arrow_columns_destroy(arrow_col *cols, int ncols)
+{
+	if (cols == NULL)
+		return;
+	for (int i = 0; i < ncols; i++)
+		arrow_col_destroy(&cols[i]);
+	GDKfree(cols);
+}
+
+static int
+arrow_columns(arrow_col **colsp, res_table *t, BUN offset, BUN cnt)
+{
+	arrow_col *cols = GDKzalloc(sizeof(arrow_col) * (t->nr_cols ? t->nr_cols : 1));
+	int ret;
+
+	if (cols == NULL)
+		return -1;
+	for (int i = 0; i < t->nr_cols; i++) {
+		if ((ret = arrow_column(&cols[i], &t->cols[i], offset, cnt)) < 0) {
+			arrow_columns_destroy(cols, i + 1);
+			return ret;
+		}
+	}
+	*colsp = cols;
+	return 0;
+}
+
+/*
+ * A minimal FlatBuffers builder for the IPC message headers.  It builds
+ * front to back into a buffer that is sized up front: a table is
+ * preceded by its vtable and references to children are patched once
+ * the child is written behind it (FlatBuffers offsets only need to point
+ * forward).  All scalars are little-endian.
+ */
+typedef struct fbuilder {
+	unsigned char *buf;
+	size_t len, cap;
+} fbuilder;
+
+typedef struct fb_field {
+	int size;					/* 0 for an absent field */
+	uint64_t val;
+	size_t pos;					/* set by fb_table */
+} fb_field;
+
+#define FB_MAXFIELDS 8
+
+static size_t
+fb_alloc(fbuilder *fb, size_t n, size_t align)
+{
+	size_t pos = (fb->len + align - 1) & ~(align - 1);
+
+	assert(pos + n <= fb->cap);
+	memset(fb->buf + fb->len, 0, pos + n - fb->len);
+	fb->len = pos + n;
+	return pos;
+}
+
+static void
+fb_put(fbuilder *fb, size_t pos, uint64_t v, int size)
+{
+	for (int i = 0; i < size; i++)
+		fb->buf[pos + i] = (unsigned char) (v >> (8 * i));
+}
+
+/* make the uoffset at pos refer to target */
+static void
+fb_patch(fbuilder *fb, size_t pos, size_t target)
+{
+	assert(target > pos);
+	fb_put(fb, pos, target - pos, 4);
+}
+
+static size_t
+fb_table(fbuilder *fb, fb_field *f, int n)
+{
+	size_t off[FB_MAXFIELDS], tsize = 4, vt, t;
+
+	assert(n <= FB_MAXFIELDS);
+	/* largest fields first, so none needs padding */
+	for (int s = 8; s >= 1; s >>= 1) {
+		for (int i = 0; i < n; i++) {
+			if (f[i].size == s) {
+				tsize = (tsize + s - 1) & ~(size_t) (s - 1);
+				off[i] = tsize;
+				tsize += s;
+			}
+		}
+	}
+	vt = fb_alloc(fb, 4 + 2 * n, 2);
+	t = fb_alloc(fb, tsize, 8);
+	fb_put(fb, t, t - vt, 4);
+	fb_put(fb, vt, 4 + 2 * n, 2);
+	fb_put(fb, vt + 2, tsize, 2);
+	for (int i = 0; i < n; i++) {
+		if (f[i].size == 0)
+			continue;
+		fb_put(fb, vt + 4 + 2 * i, off[i], 2);
+		f[i].pos = t + off[i];
+		fb_put(fb, f[i].pos, f[i].val, f[i].size);
+	}
+	return t;
+}
+
+/* a vector of n elements, which start at the returned position + 4 */
+static size_t
+fb_vector(fbuilder *fb, size_t n, size_t elsize, size_t align)
+{
+	size_t pos = (fb->len + 3) & ~(size_t) 3;
+
+	while ((pos + 4) % align != 0)
+		pos += 4;
+	fb_alloc(fb, pos - fb->len, 1);
+	pos = fb_alloc(fb, 4 + n * elsize, 1);
+	fb_put(fb, pos, n, 4);
+	return pos;
+}
+
+static size_t
+fb_string(fbuilder *fb, const char *s)
+{
+	size_t l = strlen(s);
+	size_t pos = fb_alloc(fb, 4 + l + 1, 4);
+
+	fb_put(fb, pos, l, 4);
+	memcpy(fb->buf + pos + 4, s, l);
+	return pos;
+}
+
+/* the Message table, returns the position of its header field */
+static size_t
+fb_message(fbuilder *fb, int header_type, int64_t body_len)
+{
+	size_t root, t;
+	fb_field f[4] = {
+		{ .size = 2, .val = 4 },	/* version: V5 */
+		{ .size = 1, .val = (uint64_t) header_type },
+		{ .size = 4 },				/* header */
+		{ .size = 8, .val = (uint64_t) body_len },
+	};
+
+	fb->len = 0;
+	root = fb_alloc(fb, 4, 4);
+	t = fb_table(fb, f, 4);
+	fb_patch(fb, root, t);
+	return f[2].pos;
+}
+
+static size_t
+fb_arrow_type(fbuilder *fb, arrow_col *ac)
+{
+	fb_field f[3] = { 0 };
+	size_t t;
+	int n = 0;
+
+	switch (ac->type) {
+	case AT_INT:
+		f[0] = (fb_field) { .size = 4, .val = (uint64_t) ac->width };
+		f[1] = (fb_field) { .size = 1, .val = ac->is_signed };
+		n = 2;
+		break;
+	case AT_FLOAT:
+		f[0] = (fb_field) { .size = 2, .val = (uint64_t) ac->precision };
+		n = 1;
+		break;
+	case AT_DECIMAL:
+		f[0] = (fb_field) { .size = 4, .val = (uint64_t) ac->precision };
+		f[1] = (fb_field) { .size = 4, .val = (uint64_t) ac->scale };
+		f[2] = (fb_field) { .size = 4, .val = 128 };
+		n = 3;
+		break;
+	case AT_TIME:
+		f[0] = (fb_field) { .size = 2, .val = (uint64_t) ac->unit };
+		f[1] = (fb_field) { .size = 4, .val = (uint64_t) ac->width };
+		n = 2;
+		break;
+	case AT_TIMESTAMP:
+		f[0] = (fb_field) { .size = 2, .val = (uint64_t) ac->unit };
+		f[1] = (fb_field) { .size = ac->tz ? 4 : 0 };
+		n = 2;
+		break;
+	case AT_DATE:
+	case AT_INTERVAL:
+	case AT_DURATION:
+		f[0] = (fb_field) { .size = 2, .val = (uint64_t) ac->unit };
+		n = 1;
+		break;
+	case AT_FIXEDBINARY:
+		f[0] = (fb_field) { .size = 4, .val = (uint64_t) ac->width };
+		n = 1;
+		break;
+	default:					/* Bool, Utf8, Binary and their Large versions */
+		break;
+	}
+	t = fb_table(fb, f, n);
+	if (ac->type == AT_TIMESTAMP && ac->tz)
+		fb_patch(fb, f[1].pos, fb_string(fb, ac->tz));
+	return t;
+}
+
+static void
+fb_schema_message(fbuilder *fb, arrow_col *cols, int ncols)
+{
+	size_t hdr = fb_message(fb, 1, 0), st, vec;
+	fb_field sf[2] = {
+#ifdef WORDS_BIGENDIAN
+		{ .size = 2, .val = 1 },	/* endianness: Big */
+#else
+		{ .size = 2, .val = 0 },	/* endianness: Little */
+#endif
+		{ .size = 4 },				/* fields */
+	};
+
+	st = fb_table(fb, sf, 2);
+	fb_patch(fb, hdr, st);
+	vec = fb_vector(fb, ncols, 4, 4);
+	fb_patch(fb, sf[1].pos, vec);
+	for (int i = 0; i < ncols; i++) {
+		fb_field ff[6] = {
+			{ .size = 4 },			/* name */
+			{ .size = 1, .val = 1 },	/* nullable */
+			{ .size = 1, .val = cols[i].type },	/* type_type */
+			{ .size = 4 },			/* type */
+			{ 0 },					/* dictionary */
+			{ .size = 4 },			/* children */
+		};
+		size_t ft = fb_table(fb, ff, 6);
+		fb_patch(fb, vec + 4 + 4 * i, ft);
+		fb_patch(fb, ff[0].pos, fb_string(fb, cols[i].name));
+		fb_patch(fb, ff[3].pos, fb_arrow_type(fb, &cols[i]));
+		fb_patch(fb, ff[5].pos, fb_vector(fb, 0, 4, 4));
+	}
+}
+
+#define PAD8(x) (((x) + 7) & ~(size_t) 7)
+
+static int64_t
+fb_recordbatch_message(fbuilder *fb, arrow_col *cols, int ncols, int64_t nrows)
+{
+	size_t hdr, rt, nodes, bufs;
+	int nbufs = 0, k = 0;
+	int64_t body = 0;
+	fb_field rf[3] = {
+		{ .size = 8, .val = (uint64_t) nrows },	/* length */
+		{ .size = 4 },			/* nodes */
+		{ .size = 4 },			/* buffers */
+	};
+
+	for (int i = 0; i < ncols; i++) {
+		nbufs += cols[i].nbuffers;
+		for (int j = 0; j < cols[i].nbuffers; j++)
+			body += (int64_t) PAD8(cols[i].len[j]);
+	}
+	hdr = fb_message(fb, 3, body);
+	rt = fb_table(fb, rf, 3);
+	fb_patch(fb, hdr, rt);
+	nodes = fb_vector(fb, ncols, 16, 8);
+	fb_patch(fb, rf[1].pos, nodes);
+	for (int i = 0; i < ncols; i++) {
+		fb_put(fb, nodes + 4 + 16 * i, (uint64_t) cols[i].length, 8);
+		fb_put(fb, nodes + 4 + 16 * i + 8, (uint64_t) cols[i].null_count, 8);
+	}
+	bufs = fb_vector(fb, nbufs, 16, 8);
+	fb_patch(fb, rf[2].pos, bufs);
+	body = 0;
+	for (int i = 0; i < ncols; i++) {
+		for (int j = 0; j < cols[i].nbuffers; j++, k++) {
+			fb_put(fb, bufs + 4 + 16 * k, (uint64_t) body, 8);
+			fb_put(fb, bufs + 4 + 16 * k + 8, (uint64_t) cols[i].len[j], 8);
+			body += (int64_t) PAD8(cols[i].len[j]);
+		}
+	}
+	return body;
+}
+
+static const char arrow_zeros[8];
+
+static int
+arrow_write_int32(stream *s, uint32_t v)
+{
+	unsigned char b[4] = { v & 0xFF, (v >> 8) & 0xFF, (v >> 16) & 0xFF, v >> 24 };
+
+	return mnstr_write(s, b, 1, 4) == 4 ? 0 : -4;
+}
+
+/* an encapsulated message: continuation marker, metadata size, metadata */
+static int
+arrow_write_message(stream *s, fbuilder *fb)
+{
+	size_t len = PAD8(fb->len);
+
+	if (arrow_write_int32(s, 0xFFFFFFFF) < 0 ||
+		arrow_write_int32(s, (uint32_t) len) < 0 ||
+		mnstr_write(s, fb->buf, 1, fb->len) != (ssize_t) fb->len ||
+		(len > fb->len && mnstr_write(s, arrow_zeros, 1, len - fb->len) != (ssize_t) (len - fb->len)))
+		return -4;
+	return 0;
+}
+
+static int
+arrow_write_body(stream *s, arrow_col *cols, int ncols)
+{
+	for (int i = 0; i < ncols; i++) {
+		for (int j = 0; j < cols[i].nbuffers; j++) {
+			size_t len = cols[i].len[j], pad = PAD8(len) - len;
+			if (len > 0 && mnstr_write(s, cols[i].buf[j], 1, len) != (ssize_t) len)
+				return -4;
+			if (pad > 0 && mnstr_write(s, arrow_zeros, 1, pad) != (ssize_t) pad)
+				return -4;
+		}
+	}
+	return 0;
+}
+
+int
+mvc_export_arrow_chunk(backend *b, stream *s, int res_id, BUN offset, BUN nr)
+{
+	res_table *t = res_tables_find(b->results, res_id);
+	arrow_col *cols = NULL;
+	fbuilder fb = { 0 };
+	BUN cnt;
+	int ret;
+
+	if (t == NULL)
+		return 0;
+	cnt = offset < (BUN) t->nr_rows ? (BUN) t->nr_rows - offset : 0;
+	if (nr < cnt)
+		cnt = nr;
+	if ((ret = arrow_columns(&cols, t, offset, cnt)) < 0)
+		return ret;
+	if (t->nr_cols > 0)
+		cnt = (BUN) cols[0].length;
+
+	/* an upper bound for both the schema and the record batch message */
+	fb.cap = 256 + 48 * (size_t) t->nr_cols;
+	for (int i = 0; i < t->nr_cols; i++)
+		fb.cap += 144 + strlen(cols[i].name);
+	if ((fb.buf = GDKmalloc(fb.cap)) == NULL) {
+		arrow_columns_destroy(cols, t->nr_cols);
+		return -1;
+	}
+
+	// Make sure the message starts with a & and not with a !
+	if (mnstr_printf(s, "&6 %d %d " BUNFMT " " BUNFMT "\n", res_id, t->nr_cols, cnt, offset) < 0) {
+		ret = -4;
+		goto end;
+	}
+	fb_schema_message(&fb, cols, t->nr_cols);
+	if ((ret = arrow_write_message(s, &fb)) < 0)
+		goto end;
+	fb_recordbatch_message(&fb, cols, t->nr_cols, (int64_t) cnt);
+	if ((ret = arrow_write_message(s, &fb)) < 0 ||
+		(ret = arrow_write_body(s, cols, t->nr_cols)) < 0)
+		goto end;
+	/* end of stream */
+	if ((ret = arrow_write_int32(s, 0xFFFFFFFF)) < 0 ||
+		(ret = arrow_write_int32(s, 0)) < 0)
+		goto end;
+	ret = 0;
+  end:
+	GDKfree(fb.buf);
+	arrow_columns_destroy(cols, t->nr_cols);
+	return ret;
+}
+
+/*
+ * The C data interface.  Each child array owns its arrow_col, which
+ * keeps the shared BATs fixed until the consumer releases the array.
+ */
+static void
+arrow_array_release_child(struct ArrowArray *a)
+{
+	arrow_col *ac = a->private_data;
+
+	arrow_col_destroy(ac);
+	GDKfree(ac);
+	a->release = NULL;
+}
+
+static void
+arrow_array_release(struct ArrowArray *a)
+{
+	for (int64_t i = 0; i < a->n_children; i++) {
+		struct ArrowArray *c = a->children[i];
+		if (c->release)
+			c->release(c);
+	}
+	GDKfree(a->private_data);
+	a->release = NULL;
+}
+
+static void
+arrow_schema_release(struct ArrowSchema *s)
+{
+	for (int64_t i = 0; i < s->n_children; i++) {
+		struct ArrowSchema *c = s->children[i];
+		if (c->release)
+			c->release(c);
+	}
+	GDKfree(s->private_data);
+	s->release = NULL;
+}
+
+str
+mvc_export_arrow_array(res_table *t, struct ArrowSchema *schema, struct ArrowArray *array)
+{
+	arrow_col *cols = NULL;
+	size_t n = (size_t) t->nr_cols;
+	void *sp, *ap;
+	int ret;
+
+	if ((ret = arrow_columns(&cols, t, 0, (BUN) t->nr_rows)) < 0)
+		throw(SQL, "sql.export_arrow", "%s", mvc_export_error(NULL, NULL, ret));
+	/* the children pointers and structs follow each other in one block */
+	sp = GDKzalloc(n * (sizeof(struct ArrowSchema *) + sizeof(struct ArrowSchema)) + 1);
+	ap = GDKzalloc(n * (sizeof(struct ArrowArray *) + sizeof(struct ArrowArray)) + sizeof(void *));
+	if (sp == NULL || ap == NULL) {
+		GDKfree(sp);
+		GDKfree(ap);
+		arrow_columns_destroy(cols, t->nr_cols);
+		throw(SQL, "sql.export_arrow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	}
+	*schema = (struct ArrowSchema) {
+		.format = "+s",
+		.name = "",
+		.n_children = (int64_t) n,
+		.children = sp,
+		.release = arrow_schema_release,
+		.private_data = sp,
+	};
+	*array = (struct ArrowArray) {
+		.length = t->nr_cols ? cols[0].length : (int64_t) t->nr_rows,
+		.n_buffers = 1,
+		.n_children = (int64_t) n,
+		/* a single NULL validity buffer at the end of the block */
+		.buffers = (const void **) ((char *) ap + n * (sizeof(struct ArrowArray *) + sizeof(struct ArrowArray))),
+		.children = ap,
+		.release = arrow_array_release,
+		.private_data = ap,
+	};
+
+	for (size_t i = 0; i < n; i++) {
+		struct ArrowSchema *cs = (struct ArrowSchema *) ((struct ArrowSchema **) sp + n) + i;
+		struct ArrowArray *ca = (struct ArrowArray *) ((struct ArrowArray **) ap + n) + i;
+		arrow_col *ac = GDKmalloc(sizeof(arrow_col));
+		size_t fl = strlen(cols[i].format) + 1, nl = strlen(cols[i].name) + 1;
+		char *names = GDKmalloc(fl + nl);
+
+		if (ac == NULL || names == NULL) {
+			GDKfree(ac);
+			GDKfree(names);
+			for (size_t j = i; j < n; j++)
+				arrow_col_destroy(&cols[j]);
+			GDKfree(cols);
+			/* children 0..i-1 are complete and released with the parents */
+			schema->n_children = array->n_children = (int64_t) i;
+			schema->release(schema);
+			array->release(array);
+			throw(SQL, "sql.export_arrow", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		}
+		/* the BAT references move with the column */
+		*ac = cols[i];
+		memcpy(names, cols[i].format, fl);
+		memcpy(names + fl, cols[i].name, nl);
+		*cs = (struct ArrowSchema) {
+			.format = names,
+			.name = names + fl,
+			.flags = ARROW_FLAG_NULLABLE,
+			.release = arrow_schema_release,
+			.private_data = names,
+		};
+		*ca = (struct ArrowArray) {
+			.length = ac->length,
+			.null_count = ac->null_count,
+			.n_buffers = ac->nbuffers,
+			.buffers = ac->buf,
+			.release = arrow_array_release_child,
+			.private_data = ac,
+		};
+		((struct ArrowSchema **) sp)[i] = cs;
+		((struct ArrowArray **) ap)[i] = ca;
+	}
+	GDKfree(cols);
+	return MAL_SUCCEED;
+}
@@ -0,0 +1,68 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+#ifndef sql_arrow_H
+#define sql_arrow_H
+
+#include "sql.h"
+#include "sql_catalog.h"
+
+/* The Arrow C data interface, as defined (and meant to be copied) by
+ * https://arrow.apache.org/docs/format/CDataInterface.html */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+	/* Array type description */
+	const char *format;
+	const char *name;
+	const char *metadata;
+	int64_t flags;
+	int64_t n_children;
+	struct ArrowSchema **children;
+	struct ArrowSchema *dictionary;
+
+	/* Release callback */
+	void (*release)(struct ArrowSchema *);
+	/* Opaque producer-specific data */
+	void *private_data;
+};
+
+struct ArrowArray {
+	/* Array data description */
+	int64_t length;
+	int64_t null_count;
+	int64_t offset;
+	int64_t n_buffers;
+	int64_t n_children;
+	const void **buffers;
+	struct ArrowArray **children;
+	struct ArrowArray *dictionary;
+
+	/* Release callback */
+	void (*release)(struct ArrowArray *);
+	/* Opaque producer-specific data */
+	void *private_data;
+};
+
+#endif /* ARROW_C_DATA_INTERFACE */
+
+/* write rows offset..offset+nr of a result set as an Arrow IPC stream */
+extern int mvc_export_arrow_chunk(backend *b, stream *s, int res_id, BUN offset, BUN nr);
+/* hand out a result set as an Arrow struct array (a record batch) */
+sql5_export str mvc_export_arrow_array(res_table *t, struct ArrowSchema *schema, struct ArrowArray *array);
+
+#endif /* sql_arrow_H */
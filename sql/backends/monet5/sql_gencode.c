@@ -34,6 +34,7 @@
 #include "monetdb_config.h"
 #include "sql_gencode.h"
 #include "sql_optimizer.h"
+#include "sql_plancache.h"
 #include "sql_scenario.h"
 #include "sql_mvc.h"
 #include "sql_qc.h"
@@ -1152,7 +1153,26 @@ backend_dumpproc(backend *be, Client c, cq *cq, sql_rel *r)
 	if (argc < MAXARG)
 		argc = MAXARG;
 	assert(cq && strlen(cq->name) < IDLENGTH);
-	c->curprg = newFunctionArgs(sql_private_module, cq->name = putName(cq->name), FUNCTIONsymbol, argc);
+	cq->name = putName(cq->name);
+	/* another session may already have optimized the same statement */
+	if (m->emode == m_prepare && cq->f->query && !cq->autoparam) {
+		MalBlkPtr mb = SQLplancacheFind(be, cq->f->query, cq->name);
+
+		if (mb) {
+			if ((c->curprg = newSymbol(cq->name, FUNCTIONsymbol)) == NULL) {
+				freeMalBlk(mb);
+				sql_error(m, 10, SQLSTATE(HY013) MAL_MALLOC_FAIL);
+				goto bailout;
+			}
+			freeMalBlk(c->curprg->def);
+			c->curprg->def = mb;
+			SQLaddQueryToCache(c);
+			*be = bebackup;
+			c->curprg = symbackup;
+			return 0;
+		}
+	}
+	c->curprg = newFunctionArgs(sql_private_module, cq->name, FUNCTIONsymbol, argc);
 	if (c->curprg == NULL) {
 		sql_error(m, 10, SQLSTATE(HY013) MAL_MALLOC_FAIL);
 		goto bailout;
@@ -1163,6 +1183,8 @@ backend_dumpproc(backend *be, Client c, cq *cq, sql_rel *r)
 	} else if (backend_dumpproc_body(be, c, r) < 0) {
 		goto bailout;
 	}
+	if (m->emode == m_prepare && cq->f->query && !cq->autoparam)
+		SQLplancacheAdd(be, cq->f->query, r, c->curprg->def);
 	*be = bebackup;
 	c->curprg = symbackup;
 	m->sa->eb = ebsave;
@@ -0,0 +1,299 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+/*
+ * The shared plan cache keeps the optimized MAL plans of prepared
+ * statements for all sessions.  Every session still parses and binds its
+ * PREPARE statement, because the parameter types and the result meta
+ * data are needed for the reply, but the code generation and the MAL
+ * optimizers are skipped when another session already prepared the same
+ * statement text.
+ *
+ * A plan is only reused under the same catalog version, by the same user
+ * and role, with the same current schema, schema path, time zone and
+ * optimizer settings.  Any committed DDL increments the catalog version,
+ * which invalidates all plans created before it.  Statements that refer
+ * to temporary tables or session variables, or that are prepared in a
+ * transaction that changed the database, are never shared.
+ */
+#include "monetdb_config.h"
+#include "sql_plancache.h"
+#include "sql_optimizer.h"
+#include "mal_instruction.h"
+#include "opt_prelude.h"
+#include "rel_rel.h"
+
+typedef struct plancache_entry {
+	struct plancache_entry *next;
+	char *query;				/* normalized statement text */
+	char *context;				/* session settings the plan depends on */
+	ATOMIC_BASE_TYPE version;	/* catalog version the plan was made for */
+	lng stamp;					/* last use, for eviction */
+	lng hits;
+	MalBlkPtr mb;
+} plancache_entry;
+
+static MT_Lock plancache_lock = MT_LOCK_INITIALIZER(plancache_lock);
+static plancache_entry *plancache;
+static int plancache_entries;
+static lng plancache_stamp;
+static lng plancache_hits, plancache_misses, plancache_inserts, plancache_evictions, plancache_invalidations;
+
+static void
+plancache_free(plancache_entry *e)
+{
+	if (e->mb)
+		freeMalBlk(e->mb);
+	GDKfree(e->query);
+	GDKfree(e->context);
+	GDKfree(e);
+}
+
+/* Collapse white space outside of quotes.  Statements with a backslash
+ * inside a quoted string are not normalized at all, since the quotes
+ * cannot be tracked reliably without knowing the kind of string. */
+static char *
+plancache_normalize(const char *query)
+{
+	char *buf = GDKmalloc(strlen(query) + 1), *d = buf;
+	char quote = 0;
+	bool space = false;
+
+	if (buf == NULL)
+		return NULL;
+	while (*query && isspace((unsigned char) *query))
+		query++;
+	for (const char *s = query; *s; s++) {
+		if (quote) {
+			if (*s == '\\') {
+				strcpy(buf, query);
+				return buf;
+			}
+			if (*s == quote)
+				quote = 0;
+			*d++ = *s;
+		} else if (isspace((unsigned char) *s)) {
+			space = true;
+		} else {
+			if (space && d > buf)
+				*d++ = ' ';
+			space = false;
+			if (*s == '\'' || *s == '"')
+				quote = *s;
+			*d++ = *s;
+		}
+	}
+	*d = 0;
+	return buf;
+}
+
+static char *
+plancache_context(backend *be)
+{
+	mvc *m = be->mvc;
+	char buf[BUFSIZ], *p = buf, *end = buf + sizeof(buf);
+
+	p += snprintf(p, end - p, "%d,%d,%d,%d,%d,%d,%d,%s",
+				  m->user_id, m->role_id,
+				  m->session->schema ? m->session->schema->base.id : -1,
+				  m->timezone, m->sql_optimizer, m->debug, be->no_mitosis,
+				  getSQLoptimizer(m));
+	if (m->schema_path) {
+		for (node *n = m->schema_path->h; n && p < end; n = n->next)
+			p += snprintf(p, end - p, ",\"%s\"", (char *) n->data);
+	}
+	if (p >= end)
+		return NULL;
+	return GDKstrdup(buf);
+}
+
+/* plans can only be shared if they don't depend on the state of the session */
+static bool
+plancache_session_ok(backend *be)
+{
+	sql_trans *tr = be->mvc->session->tr;
+
+	return tr->parent == NULL && list_empty(tr->changes) && os_empty(tr->localtmps, tr);
+}
+
+static sql_rel *
+plancache_temp_table(visitor *v, sql_rel *rel)
+{
+	if (is_basetable(rel->op) && rel->l && isTempTable((sql_table *) rel->l))
+		v->data = rel->l;
+	return rel;
+}
+
+/* plans that use temporary tables or session variables are private */
+static bool
+plancache_plan_ok(backend *be, sql_rel *rel, MalBlkPtr mb)
+{
+	visitor v = { .sql = be->mvc };
+
+	(void) rel_visitor_topdown(&v, rel, &plancache_temp_table);
+	if (v.data)
+		return false;
+	for (int i = 1; i < mb->stop; i++) {
+		InstrPtr p = getInstrPtr(mb, i);
+
+		if (getModuleId(p) == sqlRef &&
+			(getFunctionId(p) == getVariableRef || getFunctionId(p) == setVariableRef))
+			return false;
+	}
+	return true;
+}
+
+/* drop the plans of older catalog versions, called with the lock held */
+static void
+plancache_invalidate(ATOMIC_BASE_TYPE version)
+{
+	for (plancache_entry **e = &plancache; *e; ) {
+		if ((*e)->version < version) {
+			plancache_entry *o = *e;
+			*e = o->next;
+			plancache_free(o);
+			plancache_entries--;
+			plancache_invalidations++;
+		} else {
+			e = &(*e)->next;
+		}
+	}
+}
+
+/* Return a private copy of a shared plan for the PREPARE statement,
+ * renamed to fname, or NULL if there is none. */
+MalBlkPtr
+SQLplancacheFind(backend *be, const char *query, const char *fname)
+{
+	mvc *m = be->mvc;
+	ATOMIC_BASE_TYPE version = ATOMIC_GET(&m->session->schema_version);
+	char *nquery, *context;
+	MalBlkPtr mb = NULL;
+
+	if (!plancache_session_ok(be))
+		return NULL;
+	nquery = plancache_normalize(query);
+	context = plancache_context(be);
+	if (nquery == NULL || context == NULL) {
+		GDKfree(nquery);
+		GDKfree(context);
+		return NULL;
+	}
+
+	MT_lock_set(&plancache_lock);
+	plancache_invalidate(ATOMIC_GET(&m->session->tr->cat->schema_version));
+	for (plancache_entry *e = plancache; e; e = e->next) {
+		if (e->version == version && strcmp(e->query, nquery) == 0 &&
+			strcmp(e->context, context) == 0) {
+			mb = copyMalBlk(e->mb);
+			if (mb) {
+				e->hits++;
+				e->stamp = ++plancache_stamp;
+			}
+			break;
+		}
+	}
+	if (mb)
+		plancache_hits++;
+	else
+		plancache_misses++;
+	MT_lock_unset(&plancache_lock);
+	GDKfree(nquery);
+	GDKfree(context);
+
+	if (mb) {
+		InstrPtr sig = getInstrPtr(mb, 0);
+		char *name = GDKstrdup(fname);
+
+		if (name == NULL) {
+			freeMalBlk(mb);
+			return NULL;
+		}
+		setFunctionId(sig, fname);
+		GDKfree(getVar(mb, getArg(sig, 0))->name);
+		getVar(mb, getArg(sig, 0))->name = name;
+	}
+	return mb;
+}
+
+/* Offer the optimized plan of a PREPARE statement to the other sessions. */
+void
+SQLplancacheAdd(backend *be, const char *query, sql_rel *rel, MalBlkPtr mb)
+{
+	mvc *m = be->mvc;
+	ATOMIC_BASE_TYPE version = ATOMIC_GET(&m->session->schema_version);
+	plancache_entry *e;
+
+	if (mb->errors || version < ATOMIC_GET(&m->session->tr->cat->schema_version) ||
+		!plancache_session_ok(be) || !plancache_plan_ok(be, rel, mb))
+		return;
+	if ((e = GDKzalloc(sizeof(plancache_entry))) == NULL)
+		return;
+	e->version = version;
+	e->query = plancache_normalize(query);
+	e->context = plancache_context(be);
+	e->mb = copyMalBlk(mb);
+	if (e->query == NULL || e->context == NULL || e->mb == NULL) {
+		plancache_free(e);
+		return;
+	}
+
+	MT_lock_set(&plancache_lock);
+	plancache_invalidate(ATOMIC_GET(&m->session->tr->cat->schema_version));
+	for (plancache_entry *o = plancache; o; o = o->next) {
+		if (o->version == e->version && strcmp(o->query, e->query) == 0 &&
+			strcmp(o->context, e->context) == 0) {
+			/* another session was faster */
+			MT_lock_unset(&plancache_lock);
+			plancache_free(e);
+			return;
+		}
+	}
+	if (plancache_entries >= PLANCACHE_SIZE) {
+		plancache_entry **victim = &plancache;
+		for (plancache_entry **o = &plancache; *o; o = &(*o)->next)
+			if ((*o)->stamp < (*victim)->stamp)
+				victim = o;
+		plancache_entry *v = *victim;
+		*victim = v->next;
+		plancache_free(v);
+		plancache_entries--;
+		plancache_evictions++;
+	}
+	e->stamp = ++plancache_stamp;
+	e->next = plancache;
+	plancache = e;
+	plancache_entries++;
+	plancache_inserts++;
+	MT_lock_unset(&plancache_lock);
+}
+
+str
+SQLplancache_statistics(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	const char *names[] = { "entries", "hits", "misses", "inserts", "evictions", "invalidations" };
+	lng vals[6];
+
+	(void) cntxt;
+	(void) mb;
+
+	MT_lock_set(&plancache_lock);
+	vals[0] = plancache_entries;
+	vals[1] = plancache_hits;
+	vals[2] = plancache_misses;
+	vals[3] = plancache_inserts;
+	vals[4] = plancache_evictions;
+	vals[5] = plancache_invalidations;
+	MT_lock_unset(&plancache_lock);
+
+	return statisticsResult(stk, pci, "sql.plancache", names, vals, 6);
+}
@@ -0,0 +1,24 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+#ifndef _SQL_PLANCACHE_H_
+#define _SQL_PLANCACHE_H_
+#include "sql.h"
+#include "mal_backend.h"
+
+#define PLANCACHE_SIZE 256		/* maximum number of shared plans */
+
+extern MalBlkPtr SQLplancacheFind(backend *be, const char *query, const char *fname);
+extern void SQLplancacheAdd(backend *be, const char *query, sql_rel *rel, MalBlkPtr mb);
+extern str SQLplancache_statistics(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci);
+
+#endif /* _SQL_PLANCACHE_H_ */
@@ -1239,6 +1239,45 @@ mvc_export_table_columnar(stream *s, res_table *t, bstream *in)
 	return res;
 }
 
+/* Export the rows offset..offset+nr of a result whose columns are given
+ * by their partitions.  The format is set up for the first partition. */
+static int
+export_parts(Tablet *as, res_table *t, stream *s, bstream *in, BUN offset, BUN nr)
+{
+	Column *fmt = as->format;
+	int ok = 0;
+
+	for (int j = 0; ok >= 0 && j < t->cols[0].nr_parts && nr > 0; j++) {
+		BUN cnt;
+
+		if (j > 0) {
+			for (int i = 1; i <= t->nr_cols; i++) {
+				BAT *b = BATdescriptor(t->cols[i - 1].parts[j]);
+
+				if (b == NULL)
+					return -2;
+				bat_iterator_end(&fmt[i].ci);
+				BBPunfix(fmt[i].c->batCacheid);
+				fmt[i].c = b;
+				fmt[i].ci = bat_iterator(b);
+			}
+		}
+		cnt = BATcount(fmt[1].c);
+		if (offset >= cnt) {
+			offset -= cnt;
+			continue;
+		}
+		as->offset = offset;
+		as->nr = MIN(cnt - offset, nr);
+		for (int i = 1; i <= t->nr_cols; i++)
+			fmt[i].p = offset;
+		nr -= as->nr;
+		offset = 0;
+		ok = TABLEToutput_file(as, NULL, s, in);
+	}
+	return ok;
+}
+
 static int
 mvc_export_table_(mvc *m, int output_format, stream *s, res_table *t, BUN offset, BUN nr, const char *btag, const char *sep, const char *rsep, const char *ssep, const char *ns)
 {
@@ -1274,10 +1313,10 @@ mvc_export_table_(mvc *m, int output_format, stream *s, res_table *t, BUN offset
 	for (i = 1; i <= t->nr_cols; i++) {
 		res_col *c = t->cols + (i - 1);
 
-		if (!c->b)
+		if (!c->b && !c->nr_parts)
 			break;
 
-		fmt[i].c = BATdescriptor(c->b);
+		fmt[i].c = BATdescriptor(c->nr_parts ? c->parts[0] : c->b);
 		if (fmt[i].c == NULL) {
 			while (--i >= 1) {
 				bat_iterator_end(&fmt[i].ci);
@@ -1362,8 +1401,12 @@ mvc_export_table_(mvc *m, int output_format, stream *s, res_table *t, BUN offset
 			fmt[i].extra = fmt + i;
 		}
 	}
-	if (i == t->nr_cols + 1)
-		ok = TABLEToutput_file(&as, NULL, s, m->scanner.rs);
+	if (i == t->nr_cols + 1) {
+		if (t->cols[0].nr_parts)
+			ok = export_parts(&as, t, s, m->scanner.rs, offset, nr);
+		else
+			ok = TABLEToutput_file(&as, NULL, s, m->scanner.rs);
+	}
 	for (i = 0; i <= t->nr_cols; i++) {
 		fmt[i].sep = NULL;
 		fmt[i].rsep = NULL;
@@ -1550,9 +1593,18 @@ get_print_width(int mtype, sql_class eclass, int digits, int scale, int tz, bat
 }
 
 static int
-export_length(stream *s, int mtype, sql_class eclass, int digits, int scale, int tz, bat bid, ptr p)
+export_length(stream *s, int mtype, sql_class eclass, int digits, int scale, int tz, res_col *c)
 {
-	lng length = get_print_width(mtype, eclass, digits, scale, tz, bid, p);
+	lng length = 0;
+
+	if (c->nr_parts) {
+		for (int i = 0; i < c->nr_parts && length >= 0; i++) {
+			lng l = get_print_width(mtype, eclass, digits, scale, tz, c->parts[i], NULL);
+			length = l < 0 ? l : MAX(length, l);
+		}
+	} else {
+		length = get_print_width(mtype, eclass, digits, scale, tz, c->b, c->p);
+	}
 	if (length < 0)
 		return -2;
 	if (mvc_send_lng(s, length) != 1)
@@ -1650,7 +1702,7 @@ mvc_export_head(backend *b, stream *s, int res_id, int only_header, int compute_
 
 	/* tuple count */
 	if (only_header) {
-		if (t->cols[0].b) {
+		if (t->cols[0].b || t->cols[0].nr_parts) {
 			count = t->nr_rows;
 		} else {
 			count = 1;
@@ -1743,7 +1795,7 @@ mvc_export_head(backend *b, stream *s, int res_id, int only_header, int compute_
 			int mtype = c->type.type->localtype;
 			sql_class eclass = c->type.type->eclass;
 
-			if ((res = export_length(s, mtype, eclass, c->type.digits, c->type.scale, type_has_tz(&c->type), c->b, c->p)) < 0)
+			if ((res = export_length(s, mtype, eclass, c->type.digits, c->type.scale, type_has_tz(&c->type), c)) < 0)
 				return res;
 			if (i + 1 < t->nr_cols && mnstr_write(s, ",\t", 2, 1) != 1)
 				return -4;
@@ -1774,7 +1826,7 @@ mvc_export_file(backend *b, stream *s, res_table *t)
 	int res = 0;
 	BUN count;
 
-	if (!t->cols[0].b) {
+	if (!t->cols[0].b && !t->cols[0].nr_parts) {
 		res = mvc_export_row(b, s, t, "", t->tsep, t->rsep, t->ssep, t->ns);
 	} else {
 		count = t->nr_rows;
@@ -1812,7 +1864,7 @@ mvc_export_result(backend *b, stream *s, int res_id, bool header, lng starttime,
 	if (!json && (res = mvc_export_head(b, s, res_id, TRUE, TRUE, starttime, maloptimizer)) < 0)
 		return res;
 
-	assert(t->cols[0].b);
+	assert(t->cols[0].b || t->cols[0].nr_parts);
 
 	if (b->client->protocol == PROTOCOL_COLUMNAR) {
 		if (mnstr_flush(s, MNSTR_FLUSH_DATA) < 0)
@@ -1913,6 +1965,13 @@ mvc_result_column(backend *be, const char *tn, const char *name, const char *typ
 	return res_col_create(be->mvc->session->tr, be->results, tn, name, typename, digits, scale, true, b->ttype, b, false) ? 0 : -1;
 }
 
+int
+mvc_result_column_parts(backend *be, const char *tn, const char *name, const char *typename, int digits, int scale, BAT **parts, int nr_parts)
+{
+	/* return 0 on success, non-zero on failure */
+	return res_col_create_parts(be->mvc->session->tr, be->results, tn, name, typename, digits, scale, parts, nr_parts) ? 0 : -1;
+}
+
 int
 mvc_result_value(backend *be, const char *tn, const char *name, const char *typename, int digits, int scale, ptr *p, int mtype)
 {
@@ -1965,67 +2024,147 @@ struct bindump_record {
 	int64_t length;
 };
 
-int
-mvc_export_bin_chunk(backend *b, stream *s, int res_id, BUN offset, BUN nr)
-{
-	int ret = -42;
+/* A block of rows of a result set in the binary protocol.  The BATs
+ * are fixed by bin_chunk_prepare, so the block can be dumped without
+ * looking at the result table, also by another thread. */
+struct bin_chunk {
+	int res_id;
+	int nr_cols;
+	BUN offset;		/* first row of the block */
+	BUN nr;			/* number of rows the client asked for */
+	BUN end_row;		/* one past the last row of the block */
+	BUN count;		/* number of rows in the result */
+	bincomp compression;
 	struct bindump_record *colinfo;
-	stream *countstream = NULL;
-	uint64_t byte_count = 0;
-	uint64_t toc_pos = 0;
-	BUN end_row = offset + nr;
+};
+
+/* the next block, produced while the client consumes the current one */
+struct bin_prefetch {
+	struct bin_chunk chunk;
+	MT_Id tid;
+	buffer *buf;
+	str err;
+};
+
+static void
+bin_chunk_release(struct bin_chunk *ch)
+{
+	if (ch->colinfo) {
+		for (int i = 0; i < ch->nr_cols; i++) {
+			if (ch->colinfo[i].bat)
+				BBPunfix(ch->colinfo[i].bat->batCacheid);
+		}
+		GDKfree(ch->colinfo);
+		ch->colinfo = NULL;
+	}
+}
+
+/* returns 1 if the block is ready to be dumped, 0 if the result set
+ * doesn't exist (anymore), and a negative error code otherwise */
+static int
+bin_chunk_prepare(backend *b, int res_id, BUN offset, BUN nr, struct bin_chunk *ch)
+{
+	*ch = (struct bin_chunk) {
+		.res_id = res_id,
+		.offset = offset,
+		.nr = nr,
+		.count = BUN_NONE,
+		.compression = b->bin_compression,
+	};
 
 	res_table *res = res_tables_find(b->results, res_id);
 	if (res == NULL)
 		return 0;
 
-	colinfo = GDKzalloc(res->nr_cols * sizeof(*colinfo));
-	if (!colinfo) {
-		ret = -1;
-		goto end;
-	}
-	for (int i = 0; i < res->nr_cols; i++)
-		colinfo[i].bat = NULL;
+	ch->nr_cols = res->nr_cols;
+	ch->colinfo = GDKzalloc(res->nr_cols * sizeof(*ch->colinfo));
+	if (!ch->colinfo)
+		return -1;
 	for (int i = 0; i < res->nr_cols; i++) {
 		bat bat_id = res->cols[i].b;
 		BAT *b = BATdescriptor(bat_id);
 		if (!b) {
-			ret = -1;
-			goto end;
+			bin_chunk_release(ch);
+			return -1;
 		}
-		colinfo[i].bat = b;
+		ch->colinfo[i].bat = b;
 
-		if (BATcount(b) < end_row)
-			end_row = BATcount(b);
+		if (BATcount(b) < ch->count)
+			ch->count = BATcount(b);
 
 		int tpe = BATttype(b);
 		const char *gdk_name = ATOMname(tpe);
 		type_record_t *rec = find_type_rec(gdk_name);
 		if (!rec || !can_dump_binary_column(rec)) {
 			GDKerror("column %d: don't know how to dump data type '%s'", i, gdk_name);
-			ret = -3;
-			goto end;
+			bin_chunk_release(ch);
+			return -3;
 		}
-		colinfo[i].type_rec = rec;
+		ch->colinfo[i].type_rec = rec;
 	}
+	if (res->nr_cols == 0)
+		ch->count = 0;
+	if (offset >= ch->count)
+		ch->offset = ch->end_row = ch->count;	/* nothing left */
+	else if (nr < ch->count - offset)
+		ch->end_row = offset + nr;
+	else
+		ch->end_row = ch->count;
+	return 1;
+}
 
-	// The byte_counting_stream keeps track of the byte offsets
-	countstream = byte_counting_stream(s, &byte_count);
+/* Write the block to s.  The message starts with a plain header line,
+ * followed by the columns and their table of contents, which are
+ * compressed as a whole if the client asked for it.  The offsets in the
+ * table of contents are relative to the start of the message, as if
+ * nothing were compressed. */
+static str
+bin_chunk_dump(struct bin_chunk *ch, stream *s)
+{
+	str msg = MAL_SUCCEED;
+	stream *countstream = NULL, *body = s;
+	buffer *cbuf = NULL;
+	uint64_t byte_count = 0;
+	uint64_t toc_pos = 0;
+	const char *method = ch->compression == BIN_COMPRESS_LZ4 ? " lz4" : ch->compression == BIN_COMPRESS_GZ ? " gz" : "";
 
 	// Make sure the message starts with a & and not with a !
-	mnstr_printf(countstream, "&6 %d %d " BUNFMT " " BUNFMT "\n", res_id, res->nr_cols, end_row - offset, offset);
+	char header[128];
+	int len = snprintf(header, sizeof(header), "&6 %d %d " BUNFMT " " BUNFMT "%s\n", ch->res_id, ch->nr_cols, ch->end_row - ch->offset, ch->offset, method);
+	if (mnstr_write(s, header, 1, len) < 0)
+		return GDKstrdup(mnstr_peek_error(s));
+	byte_count = (uint64_t) len;
+
+	if (ch->compression != BIN_COMPRESS_NONE) {
+		stream *inner;
+
+		if ((cbuf = buffer_create(1 << 16)) == NULL ||
+			(inner = buffer_wstream(cbuf, "exportbin")) == NULL) {
+			buffer_destroy(cbuf);
+			return GDKstrdup(MAL_MALLOC_FAIL);
+		}
+		body = ch->compression == BIN_COMPRESS_LZ4 ? lz4_stream(inner, 1) : gz_stream(inner, 1);
+		if (body == NULL) {
+			mnstr_destroy(inner);
+			buffer_destroy(cbuf);
+			return GDKstrdup(mnstr_peek_error(NULL));
+		}
+	}
 
-	for (int i = 0; i < res->nr_cols; i++) {
+	// The byte_counting_stream keeps track of the byte offsets
+	countstream = byte_counting_stream(body, &byte_count);
+	if (countstream == NULL) {
+		msg = GDKstrdup(MAL_MALLOC_FAIL);
+		goto end;
+	}
+
+	for (int i = 0; i < ch->nr_cols; i++) {
 		align_dump(countstream, byte_count, 32); // 32 looks nice in tcpflow
-		struct bindump_record *info = &colinfo[i];
+		struct bindump_record *info = &ch->colinfo[i];
 		info->start = byte_count;
-		str msg = dump_binary_column(info->type_rec, info->bat, offset, end_row - offset, false, countstream);
-		if (msg != MAL_SUCCEED) {
-			GDKerror("%s", msg);
-			GDKfree(msg);
-			ret = -3;
+		msg = dump_binary_column(info->type_rec, info->bat, ch->offset, ch->end_row - ch->offset, false, countstream);
+		if (msg != MAL_SUCCEED)
 			goto end;
-		}
 		info->length = byte_count - info->start;
 	}
 
@@ -2033,8 +2172,8 @@ mvc_export_bin_chunk(backend *b, stream *s, int res_id, BUN offset, BUN nr)
 
 	align_dump(countstream, byte_count, 32);
 	toc_pos = byte_count;
-	for (int i = 0; i < res->nr_cols; i++) {
-		struct bindump_record *info = &colinfo[i];
+	for (int i = 0; i < ch->nr_cols; i++) {
+		struct bindump_record *info = &ch->colinfo[i];
 		lng start = info->start;
 		lng length = info->length;
 		mnstr_writeLng(countstream, start);
@@ -2042,16 +2181,145 @@ mvc_export_bin_chunk(backend *b, stream *s, int res_id, BUN offset, BUN nr)
 	}
 
 	mnstr_writeLng(countstream, toc_pos);
-	ret = 0;
+
+	if (cbuf) {
+		mnstr_close(body);
+		if (mnstr_errnr(body) != MNSTR_NO__ERROR)
+			msg = GDKstrdup(mnstr_peek_error(body));
+		else if (mnstr_write(s, cbuf->buf, 1, cbuf->pos) < 0)
+			msg = GDKstrdup(mnstr_peek_error(s));
+	}
 
 end:
-	if (colinfo) {
-		for (int i = 0; i < res->nr_cols; i++) {
-			if (colinfo[i].bat)
-				BBPunfix(colinfo[i].bat->batCacheid);
+	mnstr_destroy(countstream);
+	if (cbuf) {
+		mnstr_destroy(body);
+		buffer_destroy(cbuf);
+	}
+	return msg;
+}
+
+static void
+bin_prefetch_worker(void *arg)
+{
+	struct bin_prefetch *pf = arg;
+	stream *s = buffer_wstream(pf->buf, "exportbin");
+
+	if (s == NULL) {
+		pf->err = GDKstrdup(MAL_MALLOC_FAIL);
+		return;
+	}
+	pf->err = bin_chunk_dump(&pf->chunk, s);
+	mnstr_destroy(s);
+}
+
+static void
+bin_prefetch_free(struct bin_prefetch *pf)
+{
+	bin_chunk_release(&pf->chunk);
+	buffer_destroy(pf->buf);
+	if (pf->err)
+		GDKfree(pf->err);
+	GDKfree(pf);
+}
+
+/* start producing the block the client is most likely to ask for next;
+ * failing to do so is not an error, the block is then produced when
+ * it is asked for */
+static void
+bin_prefetch_start(backend *b, int res_id, BUN offset, BUN nr)
+{
+	struct bin_prefetch *pf;
+
+	assert(b->bin_prefetch == NULL);
+	if (GDKnr_threads <= 1 || (pf = GDKzalloc(sizeof(*pf))) == NULL)
+		return;
+	if (bin_chunk_prepare(b, res_id, offset, nr, &pf->chunk) <= 0 ||
+		(pf->buf = buffer_create(1 << 16)) == NULL ||
+		MT_create_thread(&pf->tid, bin_prefetch_worker, pf, MT_THR_JOINABLE, "exportbin") < 0) {
+		GDKclrerr();
+		bin_prefetch_free(pf);
+		return;
+	}
+	b->bin_prefetch = pf;
+}
+
+/* wait for and discard a prefetched block of result set res_id, or of
+ * any result set if res_id is negative */
+void
+mvc_export_bin_prefetch_cancel(backend *b, int res_id)
+{
+	struct bin_prefetch *pf = b->bin_prefetch;
+
+	if (pf == NULL || (res_id >= 0 && pf->chunk.res_id != res_id))
+		return;
+	b->bin_prefetch = NULL;
+	MT_join_thread(pf->tid);
+	bin_prefetch_free(pf);
+}
+
+/* returns -1 if the method is unknown or not available in this build */
+int
+mvc_set_bin_compression(backend *b, const char *method)
+{
+	if (strcmp(method, "none") == 0)
+		b->bin_compression = BIN_COMPRESS_NONE;
+#ifdef HAVE_LIBLZ4
+	else if (strcmp(method, "lz4") == 0)
+		b->bin_compression = BIN_COMPRESS_LZ4;
+#endif
+#ifdef HAVE_LIBZ
+	else if (strcmp(method, "gz") == 0)
+		b->bin_compression = BIN_COMPRESS_GZ;
+#endif
+	else
+		return -1;
+	return 0;
+}
+
+int
+mvc_export_bin_chunk(backend *b, stream *s, int res_id, BUN offset, BUN nr)
+{
+	int ret;
+	struct bin_chunk ch;
+	struct bin_prefetch *pf = b->bin_prefetch;
+
+	if (pf) {
+		b->bin_prefetch = NULL;
+		MT_join_thread(pf->tid);
+		if (pf->chunk.res_id == res_id && pf->chunk.offset == offset &&
+			pf->chunk.nr == nr && pf->chunk.compression == b->bin_compression &&
+			res_tables_find(b->results, res_id) != NULL) {
+			ch = pf->chunk;
+			if (pf->err) {
+				GDKerror("%s", pf->err);
+				ret = -3;
+			} else if (mnstr_write(s, pf->buf->buf, 1, pf->buf->pos) < 0) {
+				ret = -4;
+			} else {
+				ret = 0;
+			}
+			bin_prefetch_free(pf);
+			goto prefetch;
 		}
-		GDKfree(colinfo);
+		bin_prefetch_free(pf);
 	}
-	mnstr_destroy(countstream);
+
+	if ((ret = bin_chunk_prepare(b, res_id, offset, nr, &ch)) <= 0)
+		return ret;
+	ret = 0;
+	str msg = bin_chunk_dump(&ch, s);
+	if (msg != MAL_SUCCEED) {
+		GDKerror("%s", msg);
+		GDKfree(msg);
+		ret = -3;
+	}
+	bin_chunk_release(&ch);
+
+  prefetch:
+	/* a client fetching a result set block by block is likely to ask
+	 * for the next block of the same size */
+	if (ret == 0 && nr != BUN_NONE && ch.end_row < ch.count)
+		bin_prefetch_start(b, res_id, ch.end_row, nr);
 	return ret;
 }
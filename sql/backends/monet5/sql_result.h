@@ -28,6 +28,8 @@ extern int mvc_export_result(backend *b, stream *s, int res_id, bool header, lng
 extern int mvc_export_head(backend *b, stream *s, int res_id, int only_header, int compute_lengths, lng starttime, lng maloptimizer);
 extern int mvc_export_chunk(backend *b, stream *s, int res_id, BUN offset, BUN nr);
 extern int mvc_export_bin_chunk(backend *b, stream *s, int res_id, BUN offset, BUN nr);
+extern void mvc_export_bin_prefetch_cancel(backend *b, int res_id);
+extern int mvc_set_bin_compression(backend *b, const char *method);
 
 extern int mvc_export_prepare(backend *b, stream *s);
 
@@ -35,6 +37,7 @@ extern str mvc_import_table(Client cntxt, BAT ***bats, mvc *c, bstream *s, sql_t
 sql5_export int mvc_result_table(backend *be, oid query_id, int nr_cols, mapi_query_t type);
 
 sql5_export int mvc_result_column(backend *be, const char *tn, const char *name, const char *typename, int digits, int scale, BAT *b);
+extern int mvc_result_column_parts(backend *be, const char *tn, const char *name, const char *typename, int digits, int scale, BAT **parts, int nr_parts);
 extern int mvc_result_value(backend *be, const char *tn, const char *name, const char *typename, int digits, int scale, ptr *p, int mtype);
 
 /*
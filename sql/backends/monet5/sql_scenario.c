@@ -24,6 +24,7 @@
 #include "mal_backend.h"
 #include "sql_scenario.h"
 #include "sql_result.h"
+#include "sql_arrow.h"
 #include "sql_gencode.h"
 #include "sql_optimizer.h"
 #include "sql_assert.h"
@@ -42,6 +43,7 @@
 #include "mal_linker.h"
 #include "mal_scenario.h"
 #include "mal_authorize.h"
+#include "mal_recycle.h"
 #include "mcrypt.h"
 #include "mutils.h"
 #include "bat5.h"
@@ -81,6 +83,7 @@ sql_register(const char *name, const unsigned char *code)
 
 static sql_store SQLstore = NULL;
 int SQLdebug = 0;
+static bool SQLautoparam = false;	/* parameterize the literals of select queries */
 static const char *sqlinit = NULL;
 static MT_Lock sql_contextLock = MT_LOCK_INITIALIZER(sql_contextLock);
 
@@ -273,6 +276,7 @@ SQLexit(Client c)
 	(void) c;		/* not used */
 	MT_lock_set(&sql_contextLock);
 	if (SQLstore) {
+		RECYCLEreset();
 		mvc_exit(SQLstore);
 		SQLstore = NULL;
 	}
@@ -603,6 +607,7 @@ SQLresetClient(Client c)
 		if (m->session->tr->active)
 			other = mvc_rollback(m, 0, NULL, false);
 
+		mvc_export_bin_prefetch_cancel(be, -1);
 		res_tables_destroy(be->results);
 		be->results = NULL;
 
@@ -658,6 +663,7 @@ SQLinit(Client c, const char *initpasswd)
 
 	if (debug_str)
 		SQLdebug = strtol(debug_str, NULL, 10);
+	SQLautoparam = GDKgetenv_istrue("sql_autoparam") || GDKgetenv_isyes("sql_autoparam");
 	if (SQLdebug & 1)
 		GDKtracer_set_component_level("wal", "debug");
 	if (single_user)
@@ -665,6 +671,8 @@ SQLinit(Client c, const char *initpasswd)
 	if (readonly)
 		SQLdebug |= 32;
 
+	/* the recycler drops what it kept of changed columns */
+	store_bat_changed_callback(RECYCLEdrop);
 	if ((SQLstore = mvc_init(SQLdebug, GDKinmemory(0) ? store_mem : store_bat, readonly, single_user, initpasswd)) == NULL) {
 		MT_lock_unset(&sql_contextLock);
 		throw(SQL, "SQLinit", SQLSTATE(42000) "Catalogue initialization failed");
@@ -1225,10 +1233,24 @@ SQLchannelcmd(Client c, backend *be)
 			return MAL_SUCCEED;
 		}
 	}
+	if (strncmp(in->buf + in->pos, "exportarrow ", 12) == 0) {
+		n = sscanf(in->buf + in->pos + 12, "%d %d %d", &v, &off, &len);
+		if (n == 3) {
+			if ((ok = mvc_export_arrow_chunk(be, out, v, off, len < 0 ? BUN_NONE: (BUN) len)) < 0) {
+				msg = createException(SQL, "SQLparser", SQLSTATE(45000) "Result set construction failed: %s", mvc_export_error(be, out, ok));
+				in->pos = in->len;	/* HACK: should use parsed length */
+				sqlcleanup(be, 0);
+				return msg;
+			}
+			in->pos = in->len;	/* HACK: should use parsed length */
+			return MAL_SUCCEED;
+		}
+	}
 	if (strncmp(in->buf + in->pos, "close ", 6) == 0) {
 		res_table *t;
 
 		v = (int) strtol(in->buf + in->pos + 6, NULL, 0);
+		mvc_export_bin_prefetch_cancel(be, v);
 		t = res_tables_find(be->results, v);
 		if (t)
 			be->results = res_tables_remove(be->results, t);
@@ -1281,6 +1303,17 @@ SQLchannelcmd(Client c, backend *be)
 		in->pos = in->len;	/* HACK: should use parsed length */
 		return MAL_SUCCEED;
 	}
+	if (strncmp(in->buf + in->pos, "binary_compression ", 19) == 0) {
+		char method[16];
+
+		if (sscanf(in->buf + in->pos + 19, "%15s", method) != 1 || mvc_set_bin_compression(be, method) < 0) {
+			in->pos = in->len;	/* HACK: should use parsed length */
+			sqlcleanup(be, 0);
+			return createException(SQL, "SQLparser", SQLSTATE(42000) "Unsupported binary result compression");
+		}
+		in->pos = in->len;	/* HACK: should use parsed length */
+		return MAL_SUCCEED;
+	}
 	if (strncmp(in->buf + in->pos, "sizeheader", 10) == 0) { // no underscore
 		v = (int) strtol(in->buf + in->pos + 10, NULL, 10);
 		be->sizeheader = v != 0;
@@ -1332,6 +1365,76 @@ SQLchannelcmd(Client c, backend *be)
 
 #define MAX_QUERY 	(64*1024*1024)
 
+/*
+ * With sql_autoparam set, the literals of a select query are replaced by
+ * parameters (see qc_parameterize).  The parameterized query is prepared
+ * once and kept in the query cache of the client, and the query itself is
+ * turned into an EXEC of that prepared statement with the literals as its
+ * arguments.  The following queries that only differ in their literals
+ * skip the semantic analysis, the relational and MAL optimizers and the
+ * code generation.  If the parameterized query cannot be prepared, the
+ * query is compiled as usual.
+ */
+static void
+SQLparameterize(Client c, backend *be)
+{
+	mvc *m = be->mvc;
+	list *slots = NULL;
+	dlist *values;
+	cq *q;
+
+	if (!(values = qc_parameterize(m, m->sym, &slots))) {
+		m->params = NULL;
+		return;
+	}
+	if (!(q = qc_match(m->qc, m, m->sym, m->params))) {
+		int no_mitosis = be->no_mitosis;
+		sql_rel *r;
+
+		qc_trim(m->qc);
+		m->emode = m_prepare;
+		if ((r = sql_symbol2relation(be, m->sym)) != NULL && !mvc_status(m) &&
+			(q = qc_insert(m->qc, m->sa, r, m->sym, m->params, m->type, c->query, be->no_mitosis, true)) != NULL) {
+			if (backend_dumpproc(be, c, q, r) < 0) {
+				/* keep the allocator, it still holds the query */
+				q->name = NULL;
+				q->sa = NULL;
+				qc_delete(m->qc, q);
+				q = NULL;
+			}
+		}
+		m->emode = m_normal;
+		be->no_mitosis = no_mitosis;
+		if (q == NULL) {
+			m->session->status = 0;
+			m->errstr[0] = '\0';
+			qc_unparameterize(m, slots, values);
+			return;
+		}
+		/* the allocator was passed on to the query cache */
+		if (!(m->sa = sa_create(m->pa))) {
+			m->sa = q->sa;
+			qc_unparameterize(m, slots, values);
+			q->sa = NULL;
+			qc_delete(m->qc, q);
+			return;
+		}
+	}
+
+	dlist *l = dlist_create(m->sa);
+	symbol *nop;
+
+	if (!l || !dlist_append_int(m->sa, l, q->id) || !dlist_append_int(m->sa, l, FALSE) ||
+		!dlist_append_list(m->sa, l, values) ||
+		!(nop = symbol_create_list(m->sa, SQL_NOP, l)) ||
+		!(m->sym = symbol_create_symbol(m->sa, SQL_CALL, nop))) {
+		(void) sql_error(m, 10, SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		return;
+	}
+	m->params = NULL;
+	m->emod |= mod_exec;
+}
+
 static str
 SQLparser_body(Client c, backend *be)
 {
@@ -1420,6 +1523,9 @@ SQLparser_body(Client c, backend *be)
 		sqlcleanup(be, 0);
 		return msg;
 	} else {
+		if (SQLautoparam && m->emode == m_normal && m->emod == mod_none && !m->params &&
+			m->sym->token == SQL_SELECT)
+			SQLparameterize(c, be);
 		sql_rel *r = sql_symbol2relation(be, m->sym);
 
 		if (!r || (err = mvc_status(m) && m->type != Q_TRANS && *m->errstr)) {
@@ -1548,7 +1654,8 @@ SQLparser_body(Client c, backend *be)
 						  m->params,	/* the argument list */
 						  m->type,	/* the type of the statement */
 						  q_copy,
-						  be->no_mitosis);
+						  be->no_mitosis,
+						  false);
 				if (!be->q) {
 					msg = createException(PARSE, "SQLparser", SQLSTATE(HY013) MAL_MALLOC_FAIL);
 					err = 1;
@@ -1803,6 +1803,82 @@ stmt_uselect(backend *be, stmt *op1, stmt *op2, comp_type cmptype, stmt *sub, in
 	return NULL;
 }
 
+/* keep the candidates only when the scalar predicate holds, without touching the column data */
+stmt *
+stmt_prune(backend *be, stmt *cand, stmt *keep)
+{
+	MalBlkPtr mb = be->mb;
+
+	if (cand == NULL || keep == NULL)
+		goto bailout;
+	if (keep->type == st_atom && atom_is_true(keep->op4.aval)) /* a constant guard that holds */
+		return cand;
+
+	InstrPtr q = dump_2(mb, batsqlRef, pruneRef, cand, keep);
+
+	if (q) {
+		stmt *s = stmt_create(be->mvc->sa, st_uselect);
+		if (s == NULL) {
+			goto bailout;
+		}
+
+		s->op1 = cand;
+		s->op2 = keep;
+		s->flag = cmp_equal;
+		s->partition = cand->partition;
+		s->key = cand->key;
+		s->nrcols = cand->nrcols;
+		s->nr = getDestVar(q);
+		s->q = q;
+		s->cand = cand;
+		return s;
+	}
+  bailout:
+	if (be->mvc->sa->eb.enabled)
+		eb_error(&be->mvc->sa->eb, be->mvc->errstr[0] ? be->mvc->errstr : mb->errors ? mb->errors : *GDKerrbuf ? GDKerrbuf : "out of memory", 1000);
+	return NULL;
+}
+
+/* the candidates of col with the k geometries nearest to g, used for ORDER BY ST_Distance(col, g) LIMIT k */
+stmt *
+stmt_knnselect(backend *be, stmt *col, stmt *g, stmt *k, int nils)
+{
+	MalBlkPtr mb = be->mb;
+	InstrPtr q = NULL;
+
+	if (col == NULL || g == NULL || k == NULL || col->nr < 0 || g->nr < 0 || k->nr < 0)
+		goto bailout;
+
+	q = newStmtArgs(mb, rtreeRef, knnselectRef, 6);
+	if (q == NULL)
+		goto bailout;
+	q = pushArgument(mb, q, col->nr);
+	q = pushNilBat(mb, q);
+	q = pushArgument(mb, q, g->nr);
+	q = pushArgument(mb, q, k->nr);
+	q = pushBit(mb, q, nils ? TRUE : FALSE);
+	pushInstruction(mb, q);
+
+	stmt *s = stmt_create(be->mvc->sa, st_uselect);
+	if (s == NULL)
+		goto bailout;
+
+	s->op1 = col;
+	s->op2 = g;
+	s->op3 = k;
+	s->flag = cmp_filter;
+	s->key = 1;
+	s->nrcols = 1;
+	s->nr = getDestVar(q);
+	s->q = q;
+	return s;
+
+  bailout:
+	if (be->mvc->sa->eb.enabled)
+		eb_error(&be->mvc->sa->eb, be->mvc->errstr[0] ? be->mvc->errstr : mb->errors ? mb->errors : *GDKerrbuf ? GDKerrbuf : "out of memory", 1000);
+	return NULL;
+}
+
 /*
 static int
 range_join_convertable(stmt *s, stmt **base, stmt **L, stmt **H)
@@ -193,6 +193,8 @@ extern stmt *stmt_atom_lng_nil(backend *be);
 extern stmt *stmt_bool(backend *be, int b);
 
 extern stmt *stmt_uselect(backend *be, stmt *op1, stmt *op2, comp_type cmptype, stmt *sub, int anti, int is_semantics);
+extern stmt *stmt_prune(backend *be, stmt *cand, stmt *keep);
+extern stmt *stmt_knnselect(backend *be, stmt *col, stmt *g, stmt *k, int nils);
 /* cmp
        0 ==   l <  x <  h
        1 ==   l <  x <= h
@@ -211,7 +211,14 @@ sql_analyze(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 					GDKfree(mn);
 					mx = BATmax(b, NULL);
 					GDKfree(mx);
+
+					/* Most common values and equi-depth histogram, the
+					 * compressed storage types are left out */
+					int res = c->storage_type ? LOG_OK : sql_trans_analyze_histogram(tr, c, b);
 					BBPunfix(b->batCacheid);
+					if (res != LOG_OK)
+						throw(SQL, "sql.analyze", SQLSTATE(42000) "Storing the histogram of column '%s.%s.%s' failed%s", s->base.name, t->base.name, c->base.name,
+							  res == LOG_CONFLICT ? " due to conflict with another transaction" : "");
 				}
 			}
 		}
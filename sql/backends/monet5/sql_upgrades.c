@@ -7293,6 +7293,7 @@ sql_update_default(Client c, mvc *sql, sql_schema *s)
 {
 	char *err = MAL_SUCCEED;
 	sql_subtype tp;
+	res_table *output = NULL;
 
 	sql_find_subtype(&tp, "varchar", 0, 0);
 	if (!sql_bind_func(sql, s->base.name, "vacuum", &tp, &tp, F_PROC, true, true)) {
@@ -7310,6 +7311,75 @@ sql_update_default(Client c, mvc *sql, sql_schema *s)
 			fflush(stdout);
 			err = SQLstatementIntern(c, query, "update", true, false, NULL);
 	}
+	if (err == MAL_SUCCEED && !sql_bind_func(sql, s->base.name, "dataflow_statistics", NULL, NULL, F_UNION, true, true)) {
+		sql->session->status = 0; /* if the function was not found clean the error */
+		sql->errstr[0] = '\0';
+		const char query[] =
+			"create function sys.dataflow_statistics()\n"
+			"returns table(name string, value bigint)\n"
+			"external name sysmon.dataflow;\n"
+			"update sys.functions set system = true where system <> true and schema_id = 2000 and name = 'dataflow_statistics';\n";
+		printf("Running database upgrade commands:\n%s\n", query);
+		fflush(stdout);
+		err = SQLstatementIntern(c, query, "update", true, false, NULL);
+	}
+	if (err == MAL_SUCCEED && !sql_bind_func(sql, s->base.name, "plancache_statistics", NULL, NULL, F_UNION, true, true)) {
+		sql->session->status = 0; /* if the function was not found clean the error */
+		sql->errstr[0] = '\0';
+		const char query[] =
+			"create function sys.plancache_statistics()\n"
+			"returns table(name string, value bigint)\n"
+			"external name sql.plancache;\n"
+			"update sys.functions set system = true where system <> true and schema_id = 2000 and name = 'plancache_statistics';\n";
+		printf("Running database upgrade commands:\n%s\n", query);
+		fflush(stdout);
+		err = SQLstatementIntern(c, query, "update", true, false, NULL);
+	}
+	if (err == MAL_SUCCEED && !sql_bind_func(sql, s->base.name, "recycle_statistics", NULL, NULL, F_UNION, true, true)) {
+		sql->session->status = 0; /* if the function was not found clean the error */
+		sql->errstr[0] = '\0';
+		const char query[] =
+			"create function sys.recycle_statistics()\n"
+			"returns table(name string, value bigint)\n"
+			"external name sysmon.recycle;\n"
+			"update sys.functions set system = true where system <> true and schema_id = 2000 and name = 'recycle_statistics';\n";
+		printf("Running database upgrade commands:\n%s\n", query);
+		fflush(stdout);
+		err = SQLstatementIntern(c, query, "update", true, false, NULL);
+	}
+	if (err == MAL_SUCCEED && !mvc_bind_table(sql, s, "column_histograms")) {
+		sql->session->status = 0; /* if the table was not found clean the error */
+		sql->errstr[0] = '\0';
+		const char query[] =
+			"create table sys.column_histograms(\"column_id\" integer, \"rows\" bigint, \"kind\" varchar(5), \"nr\" integer, \"value\" string, \"fraction\" double, \"distinct\" double);\n"
+			"update sys._tables set system = true where system <> true and schema_id = 2000 and name = 'column_histograms';\n";
+		printf("Running database upgrade commands:\n%s\n", query);
+		fflush(stdout);
+		err = SQLstatementIntern(c, query, "update", true, false, NULL);
+	}
+	if (err == MAL_SUCCEED && (err = SQLstatementIntern(c, "select index_type_id from sys.index_types where index_type_id = 6;\n", "update", true, false, &output)) == MAL_SUCCEED) {
+		BAT *b;
+		if ((b = BBPquickdesc(output->cols[0].b)) && BATcount(b) == 0) {
+			const char query[] =
+				"alter table sys.index_types set read write;\n"
+				"insert into sys.index_types values (6, 'Clustered');\n"
+				"alter table sys.keywords set read write;\n"
+				"insert into sys.keywords values ('CLUSTERED');\n";
+			printf("Running database upgrade commands:\n%s\n", query);
+			fflush(stdout);
+			err = SQLstatementIntern(c, query, "update", true, false, NULL);
+			if (err == MAL_SUCCEED) {
+				const char query2[] =
+					"alter table sys.index_types set read only;\n"
+					"alter table sys.keywords set read only;\n";
+				printf("Running database upgrade commands:\n%s\n", query2);
+				fflush(stdout);
+				err = SQLstatementIntern(c, query2, "update", true, false, NULL);
+			}
+		}
+		res_table_destroy(output);
+		output = NULL;
+	}
 
 	return err;
 }
@@ -545,9 +545,9 @@ CSVprelude(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
 {
 	(void)cntxt; (void)mb; (void)stk; (void)pci;
 
-	fl_register("csv", &csv_relation, &csv_load);
-	fl_register("tsv", &csv_relation, &csv_load);
-	fl_register("psv", &csv_relation, &csv_load);
+	fl_register("csv", &csv_relation, &csv_load, NULL);
+	fl_register("tsv", &csv_relation, &csv_load, NULL);
+	fl_register("psv", &csv_relation, &csv_load, NULL);
 	return MAL_SUCCEED;
 }
 
@@ -0,0 +1,2059 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+/*
+ * Parquet file loader
+ *
+ * A self contained reader for flat Parquet files, registered with the
+ * file loader, so that
+ *
+ *	select * from '/data/lake/part-0001.parquet' where ...
+ *
+ * works without converting the file first.  The footer metadata
+ * (Thrift compact protocol) is decoded here, as are the data pages.
+ * Supported are the plain, dictionary, RLE and delta binary packed
+ * encodings, data pages of version 1 and 2, and uncompressed, snappy
+ * and (if compiled with zlib) gzip compressed column chunks.
+ *
+ * Every column of the file is read by its own parquet.read MAL
+ * instruction.  Columns that the query does not use are removed from
+ * the plan by the dead code optimizer, and the dataflow scheduler
+ * decodes the remaining columns in parallel, straight into the result
+ * BATs.  Simple comparisons between a column and a constant are handed
+ * to the loader by the relational optimizer (see push_select in
+ * rel_file_loader.h); row groups whose min/max statistics show that
+ * they cannot contain a qualifying row are not read at all.
+ */
+
+#include "monetdb_config.h"
+#include "rel_file_loader.h"
+#include "rel_exp.h"
+
+#include "mal_instruction.h"
+#include "mal_interpreter.h"
+#include "mal_builder.h"
+#include "mal_exception.h"
+#include "mal_backend.h"
+#include "sql_types.h"
+#include "rel_bin.h"
+#include "mutils.h"
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#ifdef NATIVE_WIN32
+#define pq_seek _fseeki64
+#define pq_tell _ftelli64
+#else
+#ifdef HAVE_FSEEKO
+#define pq_seek fseeko
+#define pq_tell ftello
+#else
+#define pq_seek fseek
+#define pq_tell ftell
+#endif
+#endif
+
+/* Thrift compact protocol types */
+enum {
+	T_STOP = 0,
+	T_TRUE = 1,
+	T_FALSE = 2,
+	T_BYTE = 3,
+	T_I16 = 4,
+	T_I32 = 5,
+	T_I64 = 6,
+	T_DOUBLE = 7,
+	T_BINARY = 8,
+	T_LIST = 9,
+	T_SET = 10,
+	T_MAP = 11,
+	T_STRUCT = 12,
+};
+
+/* Parquet physical types */
+enum {
+	PT_BOOLEAN = 0,
+	PT_INT32 = 1,
+	PT_INT64 = 2,
+	PT_INT96 = 3,
+	PT_FLOAT = 4,
+	PT_DOUBLE = 5,
+	PT_BYTE_ARRAY = 6,
+	PT_FLBA = 7,
+};
+
+/* logical types, normalized from both the LogicalType union and the
+ * deprecated ConvertedType */
+enum {
+	K_NONE = 0,
+	K_STRING,
+	K_DECIMAL,
+	K_DATE,
+	K_TIME,
+	K_TIMESTAMP,
+	K_INTEGER,
+	K_BSON,
+	K_OTHER,
+};
+
+/* time units */
+enum {
+	U_MILLIS = 1,
+	U_MICROS = 2,
+	U_NANOS = 3,
+};
+
+/* page types */
+enum {
+	P_DATA = 0,
+	P_INDEX = 1,
+	P_DICTIONARY = 2,
+	P_DATA_V2 = 3,
+};
+
+/* encodings */
+enum {
+	E_PLAIN = 0,
+	E_PLAIN_DICTIONARY = 2,
+	E_RLE = 3,
+	E_DELTA_BINARY_PACKED = 5,
+	E_RLE_DICTIONARY = 8,
+};
+
+/* compression codecs */
+enum {
+	C_UNCOMPRESSED = 0,
+	C_SNAPPY = 1,
+	C_GZIP = 2,
+};
+
+typedef struct tbuf {
+	const unsigned char *p, *e;
+	bool err;
+} tbuf;
+
+typedef struct pq_stats {
+	const unsigned char *min, *max;	/* plain encoded, NULL if unknown */
+	uint32_t minlen, maxlen;
+	int64_t null_count;			/* -1 if unknown */
+} pq_stats;
+
+typedef struct pq_chunk {
+	int codec;
+	int64_t data_offset;
+	int64_t dict_offset;		/* 0 if there is no dictionary page */
+	int64_t size;				/* compressed size of all pages */
+	pq_stats stats;
+} pq_chunk;
+
+typedef struct pq_rowgroup {
+	int64_t num_rows;
+	pq_chunk *chunks;
+} pq_rowgroup;
+
+typedef struct pq_column {
+	char *name;
+	int type;					/* physical type */
+	int type_length;
+	int max_def;				/* 1 for optional columns, 0 otherwise */
+	int kind;					/* logical type */
+	int unit;					/* time unit of TIME and TIMESTAMP */
+	bool utc;					/* TIMESTAMP is adjusted to UTC */
+	int bitwidth;				/* INTEGER width */
+	bool is_signed;				/* INTEGER signedness */
+	int precision, scale;		/* DECIMAL */
+} pq_column;
+
+typedef struct pq_file {
+	FILE *fp;
+	int64_t size;
+	unsigned char *footer;
+	int ncols, nrgs;
+	pq_column *cols;
+	pq_rowgroup *rgs;
+} pq_file;
+
+/* private data of the file_loader function, hidden in f->sname */
+typedef struct parquet_t {
+	char sname[1];
+	list *filters;				/* pushed down pq_filter's */
+} parquet_t;
+
+typedef struct pq_filter {
+	int col;
+	comp_type cmp;				/* cmp_gt, cmp_gte, cmp_lt, cmp_lte or cmp_equal */
+	atom *a;
+} pq_filter;
+
+/*
+ * Thrift compact protocol
+ */
+
+static uint64_t
+t_varint(tbuf *b)
+{
+	uint64_t v = 0;
+
+	for (int shift = 0; shift < 64 && b->p < b->e; shift += 7) {
+		unsigned char c = *b->p++;
+		v |= (uint64_t) (c & 0x7F) << shift;
+		if ((c & 0x80) == 0)
+			return v;
+	}
+	b->err = true;
+	return 0;
+}
+
+static int64_t
+t_int(tbuf *b)
+{
+	uint64_t v = t_varint(b);
+	return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+static const unsigned char *
+t_binary(tbuf *b, uint32_t *len)
+{
+	uint64_t l = t_varint(b);
+	const unsigned char *s = b->p;
+
+	if (b->err || l > (uint64_t) (b->e - b->p)) {
+		b->err = true;
+		*len = 0;
+		return NULL;
+	}
+	b->p += l;
+	*len = (uint32_t) l;
+	return s;
+}
+
+/* read a list header, returns the number of elements */
+static uint32_t
+t_list(tbuf *b, int *etype)
+{
+	uint64_t n;
+
+	if (b->p >= b->e) {
+		b->err = true;
+		return 0;
+	}
+	n = *b->p >> 4;
+	*etype = *b->p++ & 0x0F;
+	if (n == 15)
+		n = t_varint(b);
+	/* each element takes at least one byte */
+	if (b->err || n > (uint64_t) (b->e - b->p)) {
+		b->err = true;
+		return 0;
+	}
+	return (uint32_t) n;
+}
+
+/* read the next field header of a struct, returns false at its end */
+static bool
+t_field(tbuf *b, int *fid, int *type)
+{
+	unsigned char c;
+
+	if (b->p >= b->e) {
+		b->err = true;
+		return false;
+	}
+	c = *b->p++;
+	if (c == T_STOP)
+		return false;
+	*type = c & 0x0F;
+	if (c >> 4)
+		*fid += c >> 4;
+	else
+		*fid = (int) t_int(b);
+	return !b->err;
+}
+
+static void
+t_skip(tbuf *b, int type, int depth)
+{
+	uint32_t len;
+	int fid = 0, etype;
+
+	if (depth > 32) {
+		b->err = true;
+		return;
+	}
+	switch (type) {
+	case T_TRUE:
+	case T_FALSE:
+		break;
+	case T_BYTE:
+		if (b->p < b->e)
+			b->p++;
+		else
+			b->err = true;
+		break;
+	case T_I16:
+	case T_I32:
+	case T_I64:
+		(void) t_varint(b);
+		break;
+	case T_DOUBLE:
+		if (b->e - b->p >= 8)
+			b->p += 8;
+		else
+			b->err = true;
+		break;
+	case T_BINARY:
+		(void) t_binary(b, &len);
+		break;
+	case T_LIST:
+	case T_SET:
+		len = t_list(b, &etype);
+		if (etype == T_TRUE || etype == T_FALSE)
+			etype = T_BYTE;		/* booleans in lists take a byte */
+		for (uint32_t i = 0; i < len && !b->err; i++)
+			t_skip(b, etype, depth + 1);
+		break;
+	case T_MAP: {
+		uint64_t n = t_varint(b);
+		int kt, vt;
+
+		if (n == 0 || b->err)
+			break;
+		if (b->p >= b->e || n > (uint64_t) (b->e - b->p)) {
+			b->err = true;
+			break;
+		}
+		kt = *b->p >> 4;
+		vt = *b->p++ & 0x0F;
+		if (kt == T_TRUE || kt == T_FALSE)
+			kt = T_BYTE;
+		if (vt == T_TRUE || vt == T_FALSE)
+			vt = T_BYTE;
+		for (uint64_t i = 0; i < n && !b->err; i++) {
+			t_skip(b, kt, depth + 1);
+			t_skip(b, vt, depth + 1);
+		}
+	}	break;
+	case T_STRUCT:
+		while (t_field(b, &fid, &type))
+			t_skip(b, type, depth + 1);
+		break;
+	default:
+		b->err = true;
+		break;
+	}
+}
+
+/*
+ * File metadata
+ */
+
+/* TimeUnit is a union of empty structs */
+static int
+pq_timeunit(tbuf *b)
+{
+	int fid = 0, type, unit = 0;
+
+	while (t_field(b, &fid, &type)) {
+		if (type == T_STRUCT && fid >= U_MILLIS && fid <= U_NANOS)
+			unit = fid;
+		t_skip(b, type, 1);
+	}
+	return unit;
+}
+
+static void
+pq_logicaltype(tbuf *b, pq_column *c)
+{
+	int fid = 0, type;
+
+	while (t_field(b, &fid, &type)) {
+		int sfid = 0, stype;
+
+		if (type != T_STRUCT) {
+			t_skip(b, type, 1);
+			continue;
+		}
+		switch (fid) {
+		case 1:					/* STRING */
+		case 4:					/* ENUM */
+		case 12:				/* JSON */
+			c->kind = K_STRING;
+			t_skip(b, type, 1);
+			break;
+		case 5:					/* DECIMAL */
+			c->kind = K_DECIMAL;
+			while (t_field(b, &sfid, &stype)) {
+				if (sfid == 1 && stype == T_I32)
+					c->scale = (int) t_int(b);
+				else if (sfid == 2 && stype == T_I32)
+					c->precision = (int) t_int(b);
+				else
+					t_skip(b, stype, 2);
+			}
+			break;
+		case 6:					/* DATE */
+			c->kind = K_DATE;
+			t_skip(b, type, 1);
+			break;
+		case 7:					/* TIME */
+		case 8:					/* TIMESTAMP */
+			c->kind = fid == 7 ? K_TIME : K_TIMESTAMP;
+			while (t_field(b, &sfid, &stype)) {
+				if (sfid == 1 && (stype == T_TRUE || stype == T_FALSE))
+					c->utc = stype == T_TRUE;
+				else if (sfid == 2 && stype == T_STRUCT)
+					c->unit = pq_timeunit(b);
+				else
+					t_skip(b, stype, 2);
+			}
+			break;
+		case 10:				/* INTEGER */
+			c->kind = K_INTEGER;
+			while (t_field(b, &sfid, &stype)) {
+				if (sfid == 1 && stype == T_BYTE && b->p < b->e)
+					c->bitwidth = *b->p++;
+				else if (sfid == 2 && (stype == T_TRUE || stype == T_FALSE))
+					c->is_signed = stype == T_TRUE;
+				else
+					t_skip(b, stype, 2);
+			}
+			break;
+		case 13:				/* BSON */
+			c->kind = K_BSON;
+			t_skip(b, type, 1);
+			break;
+		default:				/* MAP, LIST, UUID, FLOAT16, ... */
+			c->kind = K_OTHER;
+			t_skip(b, type, 1);
+			break;
+		}
+	}
+}
+
+/* map the deprecated ConvertedType onto the logical types */
+static void
+pq_convertedtype(pq_column *c, int converted)
+{
+	switch (converted) {
+	case 0:						/* UTF8 */
+	case 4:						/* ENUM */
+	case 19:					/* JSON */
+		c->kind = K_STRING;
+		break;
+	case 5:						/* DECIMAL */
+		c->kind = K_DECIMAL;
+		break;
+	case 6:						/* DATE */
+		c->kind = K_DATE;
+		break;
+	case 7:						/* TIME_MILLIS */
+	case 8:						/* TIME_MICROS */
+		c->kind = K_TIME;
+		c->unit = converted == 7 ? U_MILLIS : U_MICROS;
+		c->utc = true;
+		break;
+	case 9:						/* TIMESTAMP_MILLIS */
+	case 10:					/* TIMESTAMP_MICROS */
+		c->kind = K_TIMESTAMP;
+		c->unit = converted == 9 ? U_MILLIS : U_MICROS;
+		c->utc = true;
+		break;
+	case 11:					/* UINT_8 .. UINT_64 */
+	case 12:
+	case 13:
+	case 14:
+		c->kind = K_INTEGER;
+		c->bitwidth = 8 << (converted - 11);
+		c->is_signed = false;
+		break;
+	case 15:					/* INT_8 .. INT_64 */
+	case 16:
+	case 17:
+	case 18:
+		c->kind = K_INTEGER;
+		c->bitwidth = 8 << (converted - 15);
+		c->is_signed = true;
+		break;
+	case 20:					/* BSON */
+		c->kind = K_BSON;
+		break;
+	default:					/* MAP, LIST, INTERVAL */
+		c->kind = K_OTHER;
+		break;
+	}
+}
+
+static const char *
+pq_schema(tbuf *b, pq_file *pf)
+{
+	int etype, nchildren = -1;
+	uint32_t n = t_list(b, &etype);
+
+	if (b->err || etype != T_STRUCT || n == 0)
+		return "invalid schema";
+	for (uint32_t i = 0; i < n; i++) {
+		pq_column c = { .type = -1, .is_signed = true };
+		int fid = 0, type, converted = -1, repetition = 0, children = 0;
+		const unsigned char *name = NULL;
+		uint32_t namelen = 0;
+
+		while (t_field(b, &fid, &type)) {
+			if (fid == 1 && type == T_I32)
+				c.type = (int) t_int(b);
+			else if (fid == 2 && type == T_I32)
+				c.type_length = (int) t_int(b);
+			else if (fid == 3 && type == T_I32)
+				repetition = (int) t_int(b);
+			else if (fid == 4 && type == T_BINARY)
+				name = t_binary(b, &namelen);
+			else if (fid == 5 && type == T_I32)
+				children = (int) t_int(b);
+			else if (fid == 6 && type == T_I32)
+				converted = (int) t_int(b);
+			else if (fid == 7 && type == T_I32)
+				c.scale = (int) t_int(b);
+			else if (fid == 8 && type == T_I32)
+				c.precision = (int) t_int(b);
+			else if (fid == 10 && type == T_STRUCT)
+				pq_logicaltype(b, &c);
+			else
+				t_skip(b, type, 1);
+		}
+		if (b->err)
+			return "invalid schema";
+		if (i == 0) {			/* the root */
+			nchildren = children;
+			if (nchildren != (int) n - 1)
+				return "nested columns are not supported";
+			pf->cols = GDKzalloc(nchildren * sizeof(pq_column));
+			if (pf->cols == NULL)
+				return MAL_MALLOC_FAIL;
+			continue;
+		}
+		if (children > 0 || c.type < 0 || repetition == 2)
+			return "nested columns are not supported";
+		if (c.kind == K_NONE && converted >= 0)
+			pq_convertedtype(&c, converted);
+		c.max_def = repetition == 1;
+		if ((c.name = GDKmalloc(namelen + 1)) == NULL)
+			return MAL_MALLOC_FAIL;
+		if (namelen)
+			memcpy(c.name, name, namelen);
+		c.name[namelen] = 0;
+		pf->cols[pf->ncols++] = c;
+	}
+	if (pf->ncols == 0)
+		return "no columns";
+	return NULL;
+}
+
+static void
+pq_statistics(tbuf *b, pq_stats *s, bool legacy)
+{
+	int fid = 0, type;
+	const unsigned char *min = NULL, *max = NULL;
+	uint32_t minlen = 0, maxlen = 0;
+
+	s->null_count = -1;
+	while (t_field(b, &fid, &type)) {
+		if (fid == 1 && type == T_BINARY)
+			max = t_binary(b, &maxlen);
+		else if (fid == 2 && type == T_BINARY)
+			min = t_binary(b, &minlen);
+		else if (fid == 3 && type == T_I64)
+			s->null_count = t_int(b);
+		else if (fid == 5 && type == T_BINARY)
+			s->max = t_binary(b, &s->maxlen);
+		else if (fid == 6 && type == T_BINARY)
+			s->min = t_binary(b, &s->minlen);
+		else
+			t_skip(b, type, 1);
+	}
+	/* the deprecated min and max fields were written with signed
+	 * comparisons, so we only trust them for signed numbers */
+	if (legacy && s->min == NULL && s->max == NULL && min && max) {
+		s->min = min;
+		s->minlen = minlen;
+		s->max = max;
+		s->maxlen = maxlen;
+	}
+}
+
+static const char *
+pq_columnchunk(tbuf *b, pq_file *pf, int col, pq_chunk *ch)
+{
+	const pq_column *c = &pf->cols[col];
+	bool legacy = (c->type == PT_INT32 || c->type == PT_INT64 ||
+				   c->type == PT_FLOAT || c->type == PT_DOUBLE) &&
+		(c->kind != K_INTEGER || c->is_signed);
+	int fid = 0, type;
+	bool seen = false;
+
+	while (t_field(b, &fid, &type)) {
+		if (fid == 1 && type == T_BINARY)
+			return "column chunks in other files are not supported";
+		if (fid == 3 && type == T_STRUCT) {
+			int mfid = 0, mtype;
+
+			seen = true;
+			while (t_field(b, &mfid, &mtype)) {
+				if (mfid == 4 && mtype == T_I32)
+					ch->codec = (int) t_int(b);
+				else if (mfid == 7 && mtype == T_I64)
+					ch->size = t_int(b);
+				else if (mfid == 9 && mtype == T_I64)
+					ch->data_offset = t_int(b);
+				else if (mfid == 11 && mtype == T_I64)
+					ch->dict_offset = t_int(b);
+				else if (mfid == 12 && mtype == T_STRUCT)
+					pq_statistics(b, &ch->stats, legacy);
+				else
+					t_skip(b, mtype, 2);
+			}
+		} else {
+			t_skip(b, type, 1);
+		}
+	}
+	if (b->err || !seen || ch->size < 0 || ch->data_offset < 4 ||
+		ch->data_offset >= pf->size)
+		return "invalid column chunk";
+	return NULL;
+}
+
+static const char *
+pq_rowgroups(tbuf *b, pq_file *pf)
+{
+	int etype;
+	uint32_t n = t_list(b, &etype);
+
+	if (b->err || (n && etype != T_STRUCT))
+		return "invalid row groups";
+	pf->rgs = GDKzalloc(n * sizeof(pq_rowgroup) + 1);
+	if (pf->rgs == NULL)
+		return MAL_MALLOC_FAIL;
+	for (uint32_t i = 0; i < n; i++) {
+		pq_rowgroup *rg = &pf->rgs[i];
+		int fid = 0, type;
+		const char *err;
+
+		pf->nrgs++;
+		rg->chunks = GDKzalloc(pf->ncols * sizeof(pq_chunk));
+		if (rg->chunks == NULL)
+			return MAL_MALLOC_FAIL;
+		while (t_field(b, &fid, &type)) {
+			if (fid == 1 && type == T_LIST) {
+				uint32_t m = t_list(b, &etype);
+
+				if (b->err || etype != T_STRUCT || m != (uint32_t) pf->ncols)
+					return "invalid row group";
+				for (uint32_t j = 0; j < m; j++)
+					if ((err = pq_columnchunk(b, pf, (int) j, &rg->chunks[j])) != NULL)
+						return err;
+			} else if (fid == 3 && type == T_I64) {
+				rg->num_rows = t_int(b);
+			} else {
+				t_skip(b, type, 1);
+			}
+		}
+		if (b->err || rg->num_rows < 0)
+			return "invalid row group";
+	}
+	return NULL;
+}
+
+static void
+pq_close(pq_file *pf)
+{
+	if (pf->fp)
+		fclose(pf->fp);
+	if (pf->cols)
+		for (int i = 0; i < pf->ncols; i++)
+			GDKfree(pf->cols[i].name);
+	GDKfree(pf->cols);
+	if (pf->rgs)
+		for (int i = 0; i < pf->nrgs; i++)
+			GDKfree(pf->rgs[i].chunks);
+	GDKfree(pf->rgs);
+	GDKfree(pf->footer);
+	*pf = (pq_file) { 0 };
+}
+
+/* open a Parquet file and decode its metadata, returns an error
+ * message or NULL */
+static const char *
+pq_open(pq_file *pf, const char *filename)
+{
+	unsigned char tail[8];
+	uint32_t len;
+	int fid = 0, type;
+	bool schema = false;
+	const char *err = NULL;
+	tbuf b;
+
+	*pf = (pq_file) { 0 };
+	if ((pf->fp = MT_fopen(filename, "rb")) == NULL)
+		return RUNTIME_FILE_NOT_FOUND;
+	if (pq_seek(pf->fp, 0, SEEK_END) != 0 || (pf->size = pq_tell(pf->fp)) < 12 ||
+		pq_seek(pf->fp, -8, SEEK_END) != 0 || fread(tail, 1, 8, pf->fp) != 8 ||
+		memcmp(tail + 4, "PAR1", 4) != 0) {
+		pq_close(pf);
+		return "not a Parquet file";
+	}
+	len = tail[0] | (uint32_t) tail[1] << 8 | (uint32_t) tail[2] << 16 | (uint32_t) tail[3] << 24;
+	if ((int64_t) len > pf->size - 12) {
+		pq_close(pf);
+		return "invalid Parquet footer";
+	}
+	if ((pf->footer = GDKmalloc(len)) == NULL) {
+		pq_close(pf);
+		return MAL_MALLOC_FAIL;
+	}
+	if (pq_seek(pf->fp, -8 - (int64_t) len, SEEK_END) != 0 ||
+		fread(pf->footer, 1, len, pf->fp) != len) {
+		pq_close(pf);
+		return "cannot read Parquet footer";
+	}
+	b = (tbuf) { .p = pf->footer, .e = pf->footer + len };
+	while (err == NULL && t_field(&b, &fid, &type)) {
+		if (fid == 2 && type == T_LIST) {
+			err = pq_schema(&b, pf);
+			schema = err == NULL;
+		} else if (fid == 4 && type == T_LIST && schema) {
+			err = pq_rowgroups(&b, pf);
+		} else {
+			t_skip(&b, type, 1);
+		}
+	}
+	if (err == NULL && (b.err || !schema))
+		err = "invalid Parquet footer";
+	if (err)
+		pq_close(pf);
+	return err;
+}
+
+/*
+ * Type mapping
+ */
+
+/* the SQL type of a column, NULL if not supported */
+static const char *
+pq_sqltype(const pq_column *c, unsigned int *digits, unsigned int *scale)
+{
+	*digits = *scale = 0;
+	if (c->kind == K_DECIMAL) {
+		if (c->precision <= 0 || c->scale < 0 || c->scale > c->precision)
+			return NULL;
+#ifdef HAVE_HGE
+		if (c->precision > 38)
+#else
+		if (c->precision > 18)
+#endif
+			return NULL;
+		*digits = (unsigned int) c->precision;
+		*scale = (unsigned int) c->scale;
+		return "decimal";
+	}
+	switch (c->type) {
+	case PT_BOOLEAN:
+		return "boolean";
+	case PT_INT32:
+		if (c->kind == K_DATE)
+			return "date";
+		if (c->kind == K_TIME && c->unit == U_MILLIS) {
+			*digits = 4;
+			return "time";
+		}
+		if (c->kind == K_INTEGER) {
+			if (c->bitwidth == 8)
+				return c->is_signed ? "tinyint" : "smallint";
+			if (c->bitwidth == 16)
+				return c->is_signed ? "smallint" : "int";
+			if (c->bitwidth == 32 && !c->is_signed)
+				return "bigint";
+		}
+		return c->kind == K_NONE || c->kind == K_INTEGER ? "int" : NULL;
+	case PT_INT64:
+		if (c->kind == K_TIMESTAMP) {
+			*digits = c->unit == U_MILLIS ? 4 : 7;
+			return c->utc ? "timestamptz" : "timestamp";
+		}
+		if (c->kind == K_TIME && c->unit != U_MILLIS) {
+			*digits = 7;
+			return "time";
+		}
+		if (c->kind == K_INTEGER && !c->is_signed) {
+#ifdef HAVE_HGE
+			return "hugeint";
+#else
+			return NULL;
+#endif
+		}
+		return c->kind == K_NONE || c->kind == K_INTEGER ? "bigint" : NULL;
+	case PT_INT96:
+		*digits = 7;
+		return "timestamp";
+	case PT_FLOAT:
+		return "real";
+	case PT_DOUBLE:
+		return "double";
+	case PT_BYTE_ARRAY:
+		if (c->kind == K_NONE || c->kind == K_STRING)
+			return "varchar";
+		if (c->kind == K_BSON)
+			return "blob";
+		return NULL;
+	case PT_FLBA:
+		return c->kind == K_NONE ? "blob" : NULL;
+	}
+	return NULL;
+}
+
+/* the storage type of a column, must match the SQL type */
+static int
+pq_storagetype(const pq_column *c)
+{
+	if (c->kind == K_DECIMAL) {
+		if (c->precision <= 2)
+			return TYPE_bte;
+		if (c->precision <= 4)
+			return TYPE_sht;
+		if (c->precision <= 9)
+			return TYPE_int;
+		if (c->precision <= 18)
+			return TYPE_lng;
+#ifdef HAVE_HGE
+		return TYPE_hge;
+#else
+		return TYPE_void;
+#endif
+	}
+	switch (c->type) {
+	case PT_BOOLEAN:
+		return TYPE_bit;
+	case PT_INT32:
+		if (c->kind == K_DATE)
+			return TYPE_date;
+		if (c->kind == K_TIME)
+			return TYPE_daytime;
+		if (c->kind == K_INTEGER) {
+			if (c->bitwidth == 8)
+				return c->is_signed ? TYPE_bte : TYPE_sht;
+			if (c->bitwidth == 16)
+				return c->is_signed ? TYPE_sht : TYPE_int;
+			if (c->bitwidth == 32 && !c->is_signed)
+				return TYPE_lng;
+		}
+		return TYPE_int;
+	case PT_INT64:
+		if (c->kind == K_TIMESTAMP)
+			return TYPE_timestamp;
+		if (c->kind == K_TIME)
+			return TYPE_daytime;
+#ifdef HAVE_HGE
+		if (c->kind == K_INTEGER && !c->is_signed)
+			return TYPE_hge;
+#endif
+		return TYPE_lng;
+	case PT_INT96:
+		return TYPE_timestamp;
+	case PT_FLOAT:
+		return TYPE_flt;
+	case PT_DOUBLE:
+		return TYPE_dbl;
+	case PT_BYTE_ARRAY:
+		return c->kind == K_BSON ? TYPE_blob : TYPE_str;
+	case PT_FLBA:
+		return TYPE_blob;
+	}
+	return TYPE_void;
+}
+
+/* size of a decoded physical value */
+static size_t
+pq_valsize(const pq_column *c)
+{
+	switch (c->type) {
+	case PT_BOOLEAN:
+		return 1;
+	case PT_INT32:
+	case PT_FLOAT:
+		return 4;
+	case PT_INT64:
+	case PT_DOUBLE:
+		return 8;
+	case PT_INT96:
+		return 12;
+	default:					/* pointer and length */
+		return sizeof(const unsigned char *) + sizeof(uint32_t);
+	}
+}
+
+#define UNIX_EPOCH_JD	2440588	/* Julian day of 1970-01-01 */
+
+/* convert one fixed size value v (of length len for byte arrays) to
+ * the storage type tt at dst */
+static void
+pq_convert(const pq_column *c, int tt, const unsigned char *v, uint32_t len, void *dst)
+{
+#ifdef HAVE_HGE
+	hge ival = 0;
+#else
+	lng ival = 0;
+#endif
+
+	switch (c->type) {
+	case PT_BOOLEAN:
+		*(bit *) dst = *v != 0;
+		return;
+	case PT_FLOAT:
+		memcpy(dst, v, sizeof(flt));
+		return;
+	case PT_DOUBLE:
+		memcpy(dst, v, sizeof(dbl));
+		return;
+	case PT_INT96: {
+		lng nanos;
+		int jd;
+
+		memcpy(&nanos, v, sizeof(nanos));
+		memcpy(&jd, v + 8, sizeof(jd));
+		*(timestamp *) dst = timestamp_fromusec((jd - UNIX_EPOCH_JD) * DAY_USEC + nanos / 1000);
+		return;
+	}
+	case PT_INT32: {
+		int32_t i;
+
+		memcpy(&i, v, sizeof(i));
+		if (c->kind == K_INTEGER && !c->is_signed)
+			ival = (uint32_t) i;
+		else
+			ival = i;
+	}	break;
+	case PT_INT64: {
+		int64_t i;
+
+		memcpy(&i, v, sizeof(i));
+		if (c->kind == K_INTEGER && !c->is_signed)
+			ival = (uint64_t) i;
+		else
+			ival = i;
+	}	break;
+	default:
+		/* decimals stored as big endian two's complement */
+		if (len > 0)
+			ival = (signed char) v[0];
+		for (uint32_t i = 1; i < len; i++)
+			ival = ival * 256 + v[i];
+		break;
+	}
+	switch (c->kind) {
+	case K_DATE:
+		*(date *) dst = date_add_day(date_create(1970, 1, 1), (int) ival);
+		return;
+	case K_TIMESTAMP:
+	case K_TIME: {
+		lng usec = (lng) ival;
+
+		if (c->unit == U_MILLIS)
+			usec *= 1000;
+		else if (c->unit == U_NANOS)
+			usec = (usec - (usec < 0 ? 999 : 0)) / 1000;
+		if (c->kind == K_TIME)
+			*(daytime *) dst = daytime_add_usec(daytime_create(0, 0, 0, 0), usec);
+		else
+			*(timestamp *) dst = timestamp_fromusec(usec);
+		return;
+	}
+	default:
+		break;
+	}
+	switch (tt) {
+	case TYPE_bte:
+		*(bte *) dst = (bte) ival;
+		break;
+	case TYPE_sht:
+		*(sht *) dst = (sht) ival;
+		break;
+	case TYPE_int:
+		*(int *) dst = (int) ival;
+		break;
+	case TYPE_lng:
+		*(lng *) dst = (lng) ival;
+		break;
+#ifdef HAVE_HGE
+	case TYPE_hge:
+		*(hge *) dst = ival;
+		break;
+#endif
+	default:
+		assert(0);
+	}
+}
+
+/*
+ * Encodings
+ */
+
+/* extract bw bits starting at bit position pos, bits beyond len bytes
+ * read as zero */
+static inline uint64_t
+pq_bits(const unsigned char *p, size_t len, size_t pos, int bw)
+{
+	uint64_t v = 0;
+	size_t byte = pos >> 3;
+	int shift = (int) (pos & 7), got = 0;
+
+	while (got < bw) {
+		uint64_t c = byte < len ? p[byte] : 0;
+		v |= (c >> shift) << got;
+		got += 8 - shift;
+		shift = 0;
+		byte++;
+	}
+	if (bw < 64)
+		v &= ((uint64_t) 1 << bw) - 1;
+	return v;
+}
+
+/* decode n values of the RLE/bit-packing hybrid encoding */
+static bool
+pq_rle(const unsigned char **pp, const unsigned char *e, int bw, uint32_t *out, size_t n)
+{
+	const unsigned char *p = *pp;
+	int bytes = (bw + 7) / 8;
+	size_t i = 0;
+
+	if (bw > 32)
+		return false;
+	while (i < n) {
+		tbuf b = { .p = p, .e = e };
+		uint64_t h = t_varint(&b);
+
+		if (b.err)
+			return false;
+		p = b.p;
+		if (h & 1) {			/* bit-packed groups of 8 values */
+			size_t cnt = (size_t) (h >> 1) * 8;
+			size_t nbytes = (size_t) (h >> 1) * bw, avail = (size_t) (e - p);
+
+			if (avail > nbytes)
+				avail = nbytes;
+			if (cnt > n - i)
+				cnt = n - i;
+			if (((cnt * bw) + 7) / 8 > avail)
+				return false;
+			for (size_t j = 0; j < cnt; j++)
+				out[i++] = (uint32_t) pq_bits(p, avail, j * bw, bw);
+			p += avail;
+		} else {				/* run of a single value */
+			size_t cnt = (size_t) (h >> 1);
+			uint32_t v = 0;
+
+			if (e - p < bytes)
+				return false;
+			for (int k = 0; k < bytes; k++)
+				v |= (uint32_t) p[k] << (8 * k);
+			p += bytes;
+			if (cnt > n - i)
+				cnt = n - i;
+			for (size_t j = 0; j < cnt; j++)
+				out[i++] = v;
+		}
+	}
+	*pp = p;
+	return true;
+}
+
+/* decode n values of the DELTA_BINARY_PACKED encoding */
+static bool
+pq_delta(const unsigned char *p, const unsigned char *e, int64_t *out, size_t n)
+{
+	tbuf b = { .p = p, .e = e };
+	uint64_t block = t_varint(&b), nmini = t_varint(&b), total = t_varint(&b);
+	int64_t v = t_int(&b);
+	size_t per, i = 0;
+
+	if (b.err || nmini == 0 || block % nmini != 0 || (block / nmini) % 8 != 0 ||
+		total < n)
+		return false;
+	per = (size_t) (block / nmini);
+	if (n > 0)
+		out[i++] = v;
+	while (i < n) {
+		int64_t mindelta = t_int(&b);
+		const unsigned char *widths = b.p;
+
+		if (b.err || (uint64_t) (b.e - b.p) < nmini)
+			return false;
+		b.p += nmini;
+		for (uint64_t m = 0; m < nmini && i < n; m++) {
+			int bw = widths[m];
+			size_t nbytes = per * bw / 8, avail = (size_t) (b.e - b.p);
+
+			if (bw > 64)
+				return false;
+			if (avail > nbytes)
+				avail = nbytes;
+			for (size_t j = 0; j < per && i < n; j++) {
+				uint64_t d = pq_bits(b.p, avail, j * bw, bw);
+				v = (int64_t) ((uint64_t) v + (uint64_t) mindelta + d);
+				out[i++] = v;
+			}
+			b.p += avail;
+		}
+	}
+	return true;
+}
+
+static bool
+pq_snappy(const unsigned char *s, size_t slen, unsigned char *d, size_t dlen)
+{
+	const unsigned char *e = s + slen;
+	unsigned char *p = d, *pe = d + dlen;
+	tbuf b = { .p = s, .e = e };
+
+	if (t_varint(&b) != dlen || b.err)
+		return false;
+	s = b.p;
+	while (s < e) {
+		unsigned char tag = *s++;
+		size_t len, off;
+
+		switch (tag & 3) {
+		case 0:					/* literal */
+			len = tag >> 2;
+			if (len >= 60) {
+				size_t n = len - 59;
+
+				if ((size_t) (e - s) < n)
+					return false;
+				len = 0;
+				for (size_t i = 0; i < n; i++)
+					len |= (size_t) s[i] << (8 * i);
+				s += n;
+			}
+			len++;
+			if ((size_t) (e - s) < len || (size_t) (pe - p) < len)
+				return false;
+			memcpy(p, s, len);
+			p += len;
+			s += len;
+			continue;
+		case 1:
+			if (s >= e)
+				return false;
+			len = ((tag >> 2) & 7) + 4;
+			off = (size_t) (tag >> 5) << 8 | *s++;
+			break;
+		case 2:
+			if (e - s < 2)
+				return false;
+			len = (tag >> 2) + 1;
+			off = s[0] | (size_t) s[1] << 8;
+			s += 2;
+			break;
+		default:
+			if (e - s < 4)
+				return false;
+			len = (tag >> 2) + 1;
+			off = s[0] | (size_t) s[1] << 8 | (size_t) s[2] << 16 | (size_t) s[3] << 24;
+			s += 4;
+			break;
+		}
+		if (off == 0 || off > (size_t) (p - d) || (size_t) (pe - p) < len)
+			return false;
+		/* the copy may overlap with what it produces */
+		for (size_t i = 0; i < len; i++, p++)
+			*p = *(p - off);
+	}
+	return p == pe;
+}
+
+static const char *
+pq_decompress(int codec, const unsigned char *s, size_t slen, unsigned char *d, size_t dlen)
+{
+	switch (codec) {
+	case C_UNCOMPRESSED:
+		if (slen != dlen)
+			return "invalid page";
+		memcpy(d, s, slen);
+		return NULL;
+	case C_SNAPPY:
+		return pq_snappy(s, slen, d, dlen) ? NULL : "invalid snappy compressed page";
+#ifdef HAVE_LIBZ
+	case C_GZIP: {
+		z_stream z = {
+			.next_in = (Bytef *) s,
+			.avail_in = (uInt) slen,
+			.next_out = d,
+			.avail_out = (uInt) dlen,
+		};
+		int ret;
+
+		if (inflateInit2(&z, 15 + 32) != Z_OK)
+			return "cannot initialize gzip decompression";
+		ret = inflate(&z, Z_FINISH);
+		inflateEnd(&z);
+		if (ret != Z_STREAM_END || z.total_out != dlen)
+			return "invalid gzip compressed page";
+		return NULL;
+	}
+#endif
+	default:
+		return "unsupported compression codec";
+	}
+}
+
+/*
+ * Reading column chunks
+ */
+
+typedef struct pq_page {
+	int type;
+	int32_t usize, csize;
+	int32_t num_values;
+	int encoding;
+	int32_t def_len, rep_len;	/* version 2 */
+	bool compressed;			/* version 2 */
+} pq_page;
+
+static bool
+pq_pageheader(tbuf *b, pq_page *pg)
+{
+	int fid = 0, type;
+
+	*pg = (pq_page) { .type = -1, .compressed = true };
+	while (t_field(b, &fid, &type)) {
+		int sfid = 0, stype;
+
+		if (fid == 1 && type == T_I32) {
+			pg->type = (int) t_int(b);
+		} else if (fid == 2 && type == T_I32) {
+			pg->usize = (int32_t) t_int(b);
+		} else if (fid == 3 && type == T_I32) {
+			pg->csize = (int32_t) t_int(b);
+		} else if ((fid == 5 || fid == 7) && type == T_STRUCT) {
+			/* data page and dictionary page headers start alike */
+			while (t_field(b, &sfid, &stype)) {
+				if (sfid == 1 && stype == T_I32)
+					pg->num_values = (int32_t) t_int(b);
+				else if (sfid == 2 && stype == T_I32)
+					pg->encoding = (int) t_int(b);
+				else
+					t_skip(b, stype, 2);
+			}
+		} else if (fid == 8 && type == T_STRUCT) {
+			while (t_field(b, &sfid, &stype)) {
+				if (sfid == 1 && stype == T_I32)
+					pg->num_values = (int32_t) t_int(b);
+				else if (sfid == 4 && stype == T_I32)
+					pg->encoding = (int) t_int(b);
+				else if (sfid == 5 && stype == T_I32)
+					pg->def_len = (int32_t) t_int(b);
+				else if (sfid == 6 && stype == T_I32)
+					pg->rep_len = (int32_t) t_int(b);
+				else if (sfid == 7 && (stype == T_TRUE || stype == T_FALSE))
+					pg->compressed = stype == T_TRUE;
+				else
+					t_skip(b, stype, 2);
+			}
+		} else {
+			t_skip(b, type, 1);
+		}
+	}
+	return !b->err && pg->type >= 0 && pg->usize >= 0 && pg->csize >= 0 &&
+		pg->num_values >= 0 && pg->def_len >= 0 && pg->rep_len >= 0;
+}
+
+typedef struct pq_reader {
+	const pq_column *c;
+	int tt;
+	size_t valsize;
+	unsigned char *page;		/* decompressed page */
+	size_t pagesize;
+	unsigned char *vals;		/* decoded values of a page */
+	size_t valssize;
+	uint32_t *idx;				/* definition levels and dictionary indices */
+	size_t idxsize;
+	int64_t *delta;
+	size_t deltasize;
+	unsigned char *dict;		/* dictionary page and its values */
+	size_t dictsize;
+	unsigned char *dictvals;
+	size_t ndict;
+	char *str;					/* string and blob conversion */
+	size_t strsize;
+} pq_reader;
+
+static void *
+pq_grow(void *pp, size_t *size, size_t need)
+{
+	void **p = pp;
+
+	if (need == 0)
+		need = 1;
+	if (*p == NULL || need > *size) {
+		void *n = GDKrealloc(*p, need);
+		if (n == NULL)
+			return NULL;
+		*p = n;
+		*size = need;
+	}
+	return *p;
+}
+
+static void
+pq_reader_destroy(pq_reader *r)
+{
+	GDKfree(r->page);
+	GDKfree(r->vals);
+	GDKfree(r->idx);
+	GDKfree(r->delta);
+	GDKfree(r->dict);
+	GDKfree(r->dictvals);
+	GDKfree(r->str);
+}
+
+/* decode n plain encoded values */
+static const char *
+pq_plain(const pq_column *c, const unsigned char *p, const unsigned char *e, size_t n, unsigned char *vals)
+{
+	size_t vs = pq_valsize(c);
+
+	switch (c->type) {
+	case PT_BOOLEAN:
+		if ((size_t) (e - p) < (n + 7) / 8)
+			return "page too short";
+		for (size_t i = 0; i < n; i++)
+			vals[i] = (p[i >> 3] >> (i & 7)) & 1;
+		return NULL;
+	case PT_BYTE_ARRAY:
+		for (size_t i = 0; i < n; i++) {
+			uint32_t len;
+
+			if (e - p < 4)
+				return "page too short";
+			len = p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+			p += 4;
+			if ((size_t) (e - p) < len)
+				return "page too short";
+			memcpy(vals + i * vs, &p, sizeof(p));
+			memcpy(vals + i * vs + sizeof(p), &len, sizeof(len));
+			p += len;
+		}
+		return NULL;
+	case PT_FLBA: {
+		uint32_t len = (uint32_t) c->type_length;
+
+		if ((size_t) (e - p) / (len ? len : 1) < n)
+			return "page too short";
+		for (size_t i = 0; i < n; i++, p += len) {
+			memcpy(vals + i * vs, &p, sizeof(p));
+			memcpy(vals + i * vs + sizeof(p), &len, sizeof(len));
+		}
+		return NULL;
+	}
+	default:
+		if ((size_t) (e - p) / vs < n)
+			return "page too short";
+		memcpy(vals, p, n * vs);
+#ifdef WORDS_BIGENDIAN
+		for (size_t i = 0; i < n; i++) {
+			unsigned char *v = vals + i * vs;
+			size_t w = c->type == PT_INT96 ? 8 : vs;
+			for (size_t j = 0; j < w / 2; j++) {
+				unsigned char t = v[j];
+				v[j] = v[w - 1 - j];
+				v[w - 1 - j] = t;
+			}
+			if (c->type == PT_INT96)
+				for (size_t j = 8; j < 10; j++) {
+					unsigned char t = v[j];
+					v[j] = v[19 - j];
+					v[19 - j] = t;
+				}
+		}
+#endif
+		return NULL;
+	}
+}
+
+/* decode the n non-null values of a data page into r->vals */
+static const char *
+pq_values(pq_reader *r, int encoding, const unsigned char *p, const unsigned char *e, size_t n)
+{
+	const pq_column *c = r->c;
+	size_t vs = r->valsize;
+	int bw;
+
+	if (pq_grow(&r->vals, &r->valssize, n * vs) == NULL)
+		return MAL_MALLOC_FAIL;
+	switch (encoding) {
+	case E_PLAIN:
+		return pq_plain(c, p, e, n, r->vals);
+	case E_PLAIN_DICTIONARY:
+	case E_RLE_DICTIONARY:
+		if (r->dictvals == NULL)
+			return "dictionary page missing";
+		if (n == 0)
+			return NULL;
+		if (p >= e)
+			return "page too short";
+		if (pq_grow(&r->idx, &r->idxsize, n * sizeof(uint32_t)) == NULL)
+			return MAL_MALLOC_FAIL;
+		bw = *p++;				/* bit width of the indices */
+		if (!pq_rle(&p, e, bw, r->idx, n))
+			return "invalid dictionary indices";
+		for (size_t i = 0; i < n; i++) {
+			if (r->idx[i] >= r->ndict)
+				return "dictionary index out of range";
+			memcpy(r->vals + i * vs, r->dictvals + r->idx[i] * vs, vs);
+		}
+		return NULL;
+	case E_RLE:
+		if (c->type != PT_BOOLEAN)
+			break;
+		if (e - p < 4)
+			return "page too short";
+		p += 4;					/* length */
+		if (pq_grow(&r->idx, &r->idxsize, n * sizeof(uint32_t)) == NULL)
+			return MAL_MALLOC_FAIL;
+		if (!pq_rle(&p, e, 1, r->idx, n))
+			return "invalid boolean values";
+		for (size_t i = 0; i < n; i++)
+			r->vals[i] = (unsigned char) r->idx[i];
+		return NULL;
+	case E_DELTA_BINARY_PACKED:
+		if (c->type != PT_INT32 && c->type != PT_INT64)
+			break;
+		if (pq_grow(&r->delta, &r->deltasize, n * sizeof(int64_t)) == NULL)
+			return MAL_MALLOC_FAIL;
+		if (!pq_delta(p, e, r->delta, n))
+			return "invalid delta encoded values";
+		for (size_t i = 0; i < n; i++) {
+			if (c->type == PT_INT32) {
+				int32_t v = (int32_t) r->delta[i];
+				memcpy(r->vals + i * vs, &v, sizeof(v));
+			} else {
+				memcpy(r->vals + i * vs, &r->delta[i], sizeof(int64_t));
+			}
+		}
+		return NULL;
+	default:
+		break;
+	}
+	return "unsupported encoding";
+}
+
+/* append n rows of a page to b, def holds the definition levels or is
+ * NULL if all values are present */
+static const char *
+pq_append(pq_reader *r, BAT *b, BUN *pos, const uint32_t *def, size_t n, bool *nils)
+{
+	const pq_column *c = r->c;
+	size_t vs = r->valsize, k = 0;
+	int tt = r->tt;
+
+	if (ATOMvarsized(tt)) {
+		for (size_t i = 0; i < n; i++) {
+			const unsigned char *s;
+			uint32_t len;
+			const void *v;
+
+			if (def && def[i] < (uint32_t) c->max_def) {
+				v = ATOMnilptr(tt);
+				*nils = true;
+			} else {
+				memcpy(&s, r->vals + k * vs, sizeof(s));
+				memcpy(&len, r->vals + k * vs + sizeof(s), sizeof(len));
+				k++;
+				if (tt == TYPE_str) {
+					if (pq_grow(&r->str, &r->strsize, (size_t) len + 1) == NULL)
+						return MAL_MALLOC_FAIL;
+					memcpy(r->str, s, len);
+					r->str[len] = 0;
+					if (strlen(r->str) != len || !checkUTF8(r->str))
+						return "string value not properly encoded UTF-8";
+				} else {
+					blob *bl = pq_grow(&r->str, &r->strsize, offsetof(blob, data) + len);
+					if (bl == NULL)
+						return MAL_MALLOC_FAIL;
+					bl->nitems = len;
+					memcpy(bl->data, s, len);
+				}
+				v = r->str;
+			}
+			if (BUNappend(b, v, false) != GDK_SUCCEED)
+				return GDK_EXCEPTION;
+		}
+		*pos += n;
+		return NULL;
+	}
+	for (size_t i = 0; i < n; i++) {
+		void *dst = Tloc(b, *pos + i);
+
+		if (def && def[i] < (uint32_t) c->max_def) {
+			memcpy(dst, ATOMnilptr(tt), ATOMsize(tt));
+			*nils = true;
+		} else {
+			const unsigned char *v = r->vals + k++ * vs;
+			uint32_t len = 0;
+
+			if (c->type == PT_BYTE_ARRAY || c->type == PT_FLBA) {
+				memcpy(&len, v + sizeof(v), sizeof(len));
+				memcpy(&v, v, sizeof(v));
+				if (len > 16)
+					return "decimal value too large";
+			}
+			pq_convert(c, tt, v, len, dst);
+		}
+	}
+	*pos += n;
+	return NULL;
+}
+
+/* read up to rows rows of column chunk ch and append them to b */
+static const char *
+pq_read_chunk(pq_file *pf, pq_reader *r, const pq_chunk *ch, int64_t rows, BAT *b, BUN *pos, bool *nils)
+{
+	const pq_column *c = r->c;
+	int64_t start = ch->dict_offset > 0 && ch->dict_offset < ch->data_offset ? ch->dict_offset : ch->data_offset;
+	unsigned char *buf;
+	const char *err = NULL;
+	tbuf tb;
+
+	if (ch->size <= 0 || start + ch->size > pf->size)
+		return "invalid column chunk";
+	if ((buf = GDKmalloc((size_t) ch->size)) == NULL)
+		return MAL_MALLOC_FAIL;
+	if (pq_seek(pf->fp, start, SEEK_SET) != 0 ||
+		fread(buf, 1, (size_t) ch->size, pf->fp) != (size_t) ch->size) {
+		GDKfree(buf);
+		return "cannot read column chunk";
+	}
+	GDKfree(r->dictvals);
+	r->dictvals = NULL;
+	tb = (tbuf) { .p = buf, .e = buf + ch->size };
+	while (err == NULL && rows > 0 && tb.p < tb.e) {
+		pq_page pg;
+		const unsigned char *p, *e, *data;
+		size_t n, nvals;
+		uint32_t *def = NULL;
+
+		if (!pq_pageheader(&tb, &pg) || tb.e - tb.p < pg.csize) {
+			err = "invalid page header";
+			break;
+		}
+		data = tb.p;
+		tb.p += pg.csize;
+		n = (size_t) pg.num_values;
+		switch (pg.type) {
+		case P_DICTIONARY:
+			if (pg.encoding != E_PLAIN && pg.encoding != E_PLAIN_DICTIONARY) {
+				err = "unsupported dictionary encoding";
+				break;
+			}
+			GDKfree(r->dictvals);
+			if (pq_grow(&r->dict, &r->dictsize, (size_t) pg.usize) == NULL ||
+				(r->dictvals = GDKmalloc(n * r->valsize + 1)) == NULL) {
+				err = MAL_MALLOC_FAIL;
+				break;
+			}
+			if ((err = pq_decompress(ch->codec, data, (size_t) pg.csize, r->dict, (size_t) pg.usize)) == NULL)
+				err = pq_plain(c, r->dict, r->dict + pg.usize, n, r->dictvals);
+			r->ndict = n;
+			break;
+		case P_DATA:
+			if (pq_grow(&r->page, &r->pagesize, (size_t) pg.usize) == NULL) {
+				err = MAL_MALLOC_FAIL;
+				break;
+			}
+			if ((err = pq_decompress(ch->codec, data, (size_t) pg.csize, r->page, (size_t) pg.usize)) != NULL)
+				break;
+			p = r->page;
+			e = r->page + pg.usize;
+			nvals = n;
+			if (c->max_def > 0) {
+				uint32_t len;
+				const unsigned char *le;
+
+				if (e - p < 4) {
+					err = "page too short";
+					break;
+				}
+				len = p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+				p += 4;
+				if ((size_t) (e - p) < len) {
+					err = "page too short";
+					break;
+				}
+				le = p + len;
+				if ((def = GDKmalloc(n * sizeof(uint32_t) + 1)) == NULL) {
+					err = MAL_MALLOC_FAIL;
+					break;
+				}
+				if (!pq_rle(&p, le, 1, def, n)) {
+					err = "invalid definition levels";
+					break;
+				}
+				p = le;
+				nvals = 0;
+				for (size_t i = 0; i < n; i++)
+					nvals += def[i] == (uint32_t) c->max_def;
+			}
+			err = pq_values(r, pg.encoding, p, e, nvals);
+			break;
+		case P_DATA_V2: {
+			size_t levels = (size_t) pg.def_len + (size_t) pg.rep_len;
+
+			if (levels > (size_t) pg.csize || levels > (size_t) pg.usize) {
+				err = "invalid page header";
+				break;
+			}
+			if (pq_grow(&r->page, &r->pagesize, (size_t) pg.usize) == NULL) {
+				err = MAL_MALLOC_FAIL;
+				break;
+			}
+			/* the levels are never compressed */
+			memcpy(r->page, data, levels);
+			if ((err = pq_decompress(pg.compressed ? ch->codec : C_UNCOMPRESSED,
+									 data + levels, (size_t) pg.csize - levels,
+									 r->page + levels, (size_t) pg.usize - levels)) != NULL)
+				break;
+			p = r->page + pg.rep_len;
+			e = r->page + pg.usize;
+			nvals = n;
+			if (c->max_def > 0) {
+				if ((def = GDKmalloc(n * sizeof(uint32_t) + 1)) == NULL) {
+					err = MAL_MALLOC_FAIL;
+					break;
+				}
+				if (!pq_rle(&p, r->page + levels, 1, def, n)) {
+					err = "invalid definition levels";
+					break;
+				}
+				nvals = 0;
+				for (size_t i = 0; i < n; i++)
+					nvals += def[i] == (uint32_t) c->max_def;
+			}
+			err = pq_values(r, pg.encoding, r->page + levels, e, nvals);
+		}	break;
+		default:				/* index pages */
+			continue;
+		}
+		if (err == NULL && pg.type != P_DICTIONARY) {
+			if ((int64_t) n > rows)
+				n = (size_t) rows;
+			err = pq_append(r, b, pos, def, n, nils);
+			rows -= (int64_t) n;
+		}
+		GDKfree(def);
+	}
+	GDKfree(buf);
+	if (err == NULL && rows > 0)
+		err = "column chunk has fewer values than its row group";
+	return err;
+}
+
+/*
+ * Row group selection
+ */
+
+/* decode a min or max statistic into a value comparable with a */
+static const void *
+pq_stat_value(allocator *sa, const pq_column *c, int tt, const unsigned char *v, uint32_t len, void *buf)
+{
+	if (tt == TYPE_str) {
+		char *s = sa_alloc(sa, (size_t) len + 1);
+		if (s == NULL)
+			return NULL;
+		memcpy(s, v, len);
+		s[len] = 0;
+		return s;
+	}
+	if (ATOMvarsized(tt))
+		return NULL;
+	if (c->type == PT_BYTE_ARRAY || c->type == PT_FLBA) {
+		if (len > 16)
+			return NULL;
+	} else if (len < pq_valsize(c)) {
+		return NULL;
+	}
+	pq_convert(c, tt, v, len, buf);
+	if (ATOMcmp(tt, buf, ATOMnilptr(tt)) == 0)
+		return NULL;			/* e.g. NaN */
+	return buf;
+}
+
+/* returns true if the statistics of row group rg show that no row
+ * satisfies all filters */
+static bool
+pq_skip_rowgroup(mvc *sql, pq_file *pf, int rg, list *filters, list *coltypes)
+{
+	const pq_rowgroup *g = &pf->rgs[rg];
+
+	for (node *n = filters ? filters->h : NULL; n; n = n->next) {
+		pq_filter *f = n->data;
+		const pq_column *c = &pf->cols[f->col];
+		const pq_chunk *ch = &g->chunks[f->col];
+		sql_subtype *t = list_fetch(coltypes, f->col);
+		int tt = t->type->localtype;
+		const void *v = VALptr(&f->a->data), *lo, *hi;
+#ifdef HAVE_HGE
+		hge lbuf, hbuf;
+#else
+		lng lbuf, hbuf;
+#endif
+		int lc, hc;
+
+		if (ch->stats.null_count >= 0 && ch->stats.null_count >= g->num_rows)
+			return true;		/* only nulls, comparisons are never true */
+		if (ch->stats.min == NULL || ch->stats.max == NULL || tt != pq_storagetype(c))
+			continue;
+		lo = pq_stat_value(sql->ta, c, tt, ch->stats.min, ch->stats.minlen, &lbuf);
+		hi = pq_stat_value(sql->ta, c, tt, ch->stats.max, ch->stats.maxlen, &hbuf);
+		if (lo == NULL || hi == NULL)
+			continue;
+		lc = ATOMcmp(tt, v, lo);
+		hc = ATOMcmp(tt, v, hi);
+		switch (f->cmp) {
+		case cmp_equal:
+			if (lc < 0 || hc > 0)
+				return true;
+			break;
+		case cmp_gt:			/* col > v */
+			if (hc >= 0)
+				return true;
+			break;
+		case cmp_gte:
+			if (hc > 0)
+				return true;
+			break;
+		case cmp_lt:			/* col < v */
+			if (lc <= 0)
+				return true;
+			break;
+		case cmp_lte:
+			if (lc < 0)
+				return true;
+			break;
+		default:
+			break;
+		}
+	}
+	return false;
+}
+
+/*
+ * File loader interface
+ */
+
+static str
+parquet_relation(mvc *sql, sql_subfunc *f, char *filename, list *res_exps, char *tname)
+{
+	pq_file pf;
+	const char *err = pq_open(&pf, filename);
+
+	if (err)
+		return (str) err;
+	if (!tname)
+		tname = "parquet";
+	f->tname = tname;
+
+	list *typelist = sa_list(sql->sa);
+	list *nameslist = sa_list(sql->sa);
+	for (int col = 0; col < pf.ncols; col++) {
+		const pq_column *c = &pf.cols[col];
+		unsigned int digits, scale;
+		const char *st = pq_sqltype(c, &digits, &scale);
+		sql_subtype *t = st ? sql_bind_subtype(sql->sa, st, digits, scale) : NULL;
+
+		if (t == NULL || t->type->localtype != pq_storagetype(c)) {
+			str msg = sa_message(sql->ta, "column '%s' has an unsupported type", c->name);
+			pq_close(&pf);
+			return msg;
+		}
+		const char *name = sa_strdup(sql->sa, c->name);
+		append(nameslist, (char *) name);
+		append(typelist, t);
+		sql_exp *ne = exp_column(sql->sa, tname, name, t, CARD_MULTI, 1, 0, 0);
+		set_basecol(ne);
+		ne->alias.label = -(sql->nid++);
+		list_append(res_exps, ne);
+	}
+	pq_close(&pf);
+	f->res = typelist;
+	f->coltypes = typelist;
+	f->colnames = nameslist;
+
+	parquet_t *r = (parquet_t *) sa_zalloc(sql->sa, sizeof(parquet_t));
+	f->sname = (char *) r;		/* pass schema++ */
+	return MAL_SUCCEED;
+}
+
+static int
+parquet_column(list *res_exps, sql_exp *e)
+{
+	int i = 0;
+
+	if (e->type != e_column)
+		return -1;
+	for (node *n = res_exps->h; n; n = n->next, i++) {
+		sql_exp *c = n->data;
+		if (c->alias.label == e->nid)
+			return i;
+	}
+	return -1;
+}
+
+static bool
+parquet_add_filter(mvc *sql, list *filters, int col, comp_type cmp, sql_exp *e)
+{
+	pq_filter *f;
+
+	if (e->type != e_atom || e->l == NULL || ((atom *) e->l)->isnull)
+		return false;
+	if ((f = SA_NEW(sql->sa, pq_filter)) == NULL)
+		return false;
+	*f = (pq_filter) {
+		.col = col,
+		.cmp = cmp,
+		.a = e->l,
+	};
+	append(filters, f);
+	return true;
+}
+
+/* remember the simple comparisons of a selection on top of the file,
+ * so that row groups can be skipped */
+static sql_subfunc *
+parquet_push_select(mvc *sql, sql_subfunc *f, list *res_exps, list *exps)
+{
+	list *filters = sa_list(sql->sa);
+
+	for (node *n = exps->h; n; n = n->next) {
+		sql_exp *e = n->data;
+		int col;
+
+		if (e->type != e_cmp || is_anti(e) || is_semantics(e) ||
+			(col = parquet_column(res_exps, e->l)) < 0)
+			continue;
+		if (e->f) {				/* range */
+			if (is_symmetric(e) || e->flag > 3)
+				continue;
+			parquet_add_filter(sql, filters, col, (e->flag & 1) ? cmp_gte : cmp_gt, e->r);
+			parquet_add_filter(sql, filters, col, (e->flag & 2) ? cmp_lte : cmp_lt, e->f);
+		} else if (e->flag == cmp_gt || e->flag == cmp_gte || e->flag == cmp_lt ||
+				   e->flag == cmp_lte || e->flag == cmp_equal) {
+			parquet_add_filter(sql, filters, col, (comp_type) e->flag, e->r);
+		}
+	}
+
+	/* the function may be shared by copies of the relation, so give
+	 * this one its own copy */
+	parquet_t *r = (parquet_t *) sa_zalloc(sql->sa, sizeof(parquet_t));
+	sql_subfunc *nf = SA_NEW(sql->sa, sql_subfunc);
+	if (r == NULL || nf == NULL)
+		return f;
+	r->filters = filters;
+	*nf = *f;
+	nf->sname = (char *) r;
+	return nf;
+}
+
+static void *
+parquet_load(void *BE, sql_subfunc *f, char *filename, sql_exp *topn)
+{
+	backend *be = (backend *) BE;
+	mvc *sql = be->mvc;
+	MalBlkPtr mb = be->mb;
+	parquet_t *r = (parquet_t *) f->sname;
+	lng limit = -1, rows = 0;
+	bool all = true;
+	char *rowgroups, *p;
+	pq_file pf;
+	const char *err;
+
+	if (topn && topn->type == e_atom && topn->l) {
+		atom *a = topn->l;
+		if (!a->isnull && a->data.vtype == TYPE_lng)
+			limit = a->data.val.lval;
+	}
+	if ((err = pq_open(&pf, filename)) != NULL)
+		return sql_error(sql, 10, SQLSTATE(42000) "parquet: %s", err);
+	/* select the row groups to read */
+	if ((p = rowgroups = sa_alloc(sql->sa, (size_t) pf.nrgs * 12 + 1)) == NULL) {
+		pq_close(&pf);
+		return sql_error(sql, 10, SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	}
+	*p = 0;
+	for (int i = 0; i < pf.nrgs; i++) {
+		if ((limit >= 0 && rows >= limit) ||
+			(r && pq_skip_rowgroup(sql, &pf, i, r->filters, f->coltypes))) {
+			all = false;
+			continue;
+		}
+		p += sprintf(p, "%s%d", p == rowgroups ? "" : ",", i);
+		rows += pf.rgs[i].num_rows;
+	}
+	pq_close(&pf);
+
+	list *l = sa_list(sql->sa);
+	int col = 0;
+	for (node *n = f->coltypes->h; n; n = n->next, col++) {
+		sql_subtype *t = n->data;
+		InstrPtr q = newStmt(mb, "parquet", "read");
+
+		if (q == NULL)
+			return sql_error(sql, 10, SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		setVarType(mb, getArg(q, 0), newBatType(t->type->localtype));
+		q = pushStr(mb, q, filename);
+		q = pushInt(mb, q, col);
+		q = all ? pushNil(mb, q, TYPE_str) : pushStr(mb, q, rowgroups);
+		q = pushLng(mb, q, limit);
+		pushInstruction(mb, q);
+		if (mb->errors)
+			return sql_error(sql, 10, SQLSTATE(HY013) MAL_MALLOC_FAIL);
+		append(l, stmt_blackbox_result(be, q, 0, t));
+	}
+	return stmt_list(be, l);
+}
+
+/*
+ * MAL interface
+ */
+
+static str
+PARQUETread(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	bat *ret = getArgReference_bat(stk, pci, 0);
+	const char *filename = *getArgReference_str(stk, pci, 1);
+	int col = *getArgReference_int(stk, pci, 2);
+	const char *rowgroups = *getArgReference_str(stk, pci, 3);
+	lng limit = *getArgReference_lng(stk, pci, 4);
+	int tt = getBatType(getArgType(mb, pci, 0));
+	pq_reader r = { 0 };
+	const char *err;
+	bool nils = false;
+	BUN pos = 0;
+	BAT *b;
+	pq_file pf;
+	int *rgs;
+	int nrgs = 0;
+	lng total = 0;
+
+	(void) cntxt;
+	if ((err = pq_open(&pf, filename)) != NULL)
+		throw(SQL, "parquet.read", SQLSTATE(42000) "%s", err);
+	if (col < 0 || col >= pf.ncols || pq_storagetype(&pf.cols[col]) != tt) {
+		pq_close(&pf);
+		throw(SQL, "parquet.read", SQLSTATE(42000) "file '%s' has changed", filename);
+	}
+	if ((rgs = GDKmalloc((pf.nrgs + 1) * sizeof(int))) == NULL) {
+		pq_close(&pf);
+		throw(SQL, "parquet.read", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	}
+	if (strNil(rowgroups)) {
+		for (int i = 0; i < pf.nrgs; i++)
+			rgs[nrgs++] = i;
+	} else {
+		for (const char *s = rowgroups; *s; ) {
+			char *e;
+			long i = strtol(s, &e, 10);
+
+			if (e == s || i < 0 || i >= pf.nrgs || nrgs == pf.nrgs) {
+				GDKfree(rgs);
+				pq_close(&pf);
+				throw(SQL, "parquet.read", SQLSTATE(42000) "file '%s' has changed", filename);
+			}
+			rgs[nrgs++] = (int) i;
+			s = *e == ',' ? e + 1 : e;
+		}
+	}
+	for (int i = 0; i < nrgs; i++)
+		total += pf.rgs[rgs[i]].num_rows;
+	if (limit >= 0 && total > limit)
+		total = limit;
+
+	if ((b = COLnew(0, tt, (BUN) total, TRANSIENT)) == NULL) {
+		GDKfree(rgs);
+		pq_close(&pf);
+		throw(SQL, "parquet.read", SQLSTATE(HY013) MAL_MALLOC_FAIL);
+	}
+	r.c = &pf.cols[col];
+	r.tt = tt;
+	r.valsize = pq_valsize(r.c);
+	err = NULL;
+	for (int i = 0; i < nrgs && err == NULL && (lng) pos < total; i++) {
+		int64_t rows = pf.rgs[rgs[i]].num_rows;
+
+		if (rows > total - (lng) pos)
+			rows = total - (lng) pos;
+		err = pq_read_chunk(&pf, &r, &pf.rgs[rgs[i]].chunks[col], rows, b, &pos, &nils);
+	}
+	pq_reader_destroy(&r);
+	GDKfree(rgs);
+	if (err) {
+		str msg = createException(SQL, "parquet.read", SQLSTATE(42000) "column '%s': %s", pf.cols[col].name, err);
+		pq_close(&pf);
+		BBPreclaim(b);
+		return msg;
+	}
+	pq_close(&pf);
+	if (!ATOMvarsized(tt)) {
+		BATsetcount(b, pos);
+		b->tnil = nils;
+		b->tnonil = !nils;
+		b->tsorted = b->trevsorted = b->tkey = pos <= 1;
+		b->tseqbase = oid_nil;
+	}
+	*ret = b->batCacheid;
+	BBPkeepref(b);
+	return MAL_SUCCEED;
+}
+
+static str
+PARQUETprelude(Client cntxt, MalBlkPtr mb, MalStkPtr stk, InstrPtr pci)
+{
+	(void)cntxt; (void)mb; (void)stk; (void)pci;
+
+	fl_register("parquet", &parquet_relation, &parquet_load, &parquet_push_select);
+	return MAL_SUCCEED;
+}
+
+static str
+PARQUETepilogue(void *ret)
+{
+	fl_unregister("parquet");
+	(void)ret;
+	return MAL_SUCCEED;
+}
+
+#include "sql_scenario.h"
+#include "mel.h"
+
+static mel_func parquet_init_funcs[] = {
+	pattern("parquet", "prelude", PARQUETprelude, false, "", noargs),
+	command("parquet", "epilogue", PARQUETepilogue, false, "", noargs),
+	pattern("parquet", "read", PARQUETread, false, "Read column col of the given row groups (nil for all) of a Parquet file, at most nrows rows if nrows >= 0", args(1,5, batargany("",1),arg("filename",str),arg("col",int),arg("rowgroups",str),arg("nrows",lng))),
+{ .imp=NULL }
+};
+
+#include "mal_import.h"
+#ifdef _MSC_VER
+#undef read
+#pragma section(".CRT$XCU",read)
+#endif
+LIB_STARTUP_FUNC(init_parquet_mal)
+{ mal_module("parquet", NULL, parquet_init_funcs); }
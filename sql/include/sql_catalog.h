@@ -552,6 +552,7 @@ typedef enum idx_type {
 	no_idx,			/* no idx, ie no storage */
 	imprints_idx,
 	ordered_idx,
+	clustered_idx,	/* declared physical sort order, no storage */
 	new_idx_types
 } idx_type;
 
@@ -634,6 +635,7 @@ typedef struct sql_column {
 	size_t dcount;
 	void *min;
 	void *max;
+	struct sql_histogram *hist;	/* loaded on first use, see store_histogram.c */
 
 	struct sql_table *t;
 	ATOMIC_PTR_TYPE data;
@@ -739,6 +741,8 @@ typedef struct res_col {
 	char mtype;
 	bool cached;
 	ptr *p;
+	int nr_parts;		/* if > 0, b is not set and the column is given by */
+	bat *parts;			/* the aligned partitions of a mitosis plan */
 } res_col;
 
 typedef struct res_table {
@@ -786,6 +790,7 @@ extern sql_key *sql_trans_find_key(sql_trans *tr, sqlid id);
 extern sql_key *schema_find_key(sql_trans *tr, sql_schema *s, const char *name);
 
 extern sql_idx *find_sql_idx(sql_table *t, const char *kname);
+extern sql_idx *find_clustered_idx(sql_table *t);
 extern sql_idx *sql_trans_find_idx(sql_trans *tr, sqlid id);
 extern sql_idx *schema_find_idx(sql_trans *tr, sql_schema *s, const char *name);
 extern sql_idx *schema_find_idx_id(sql_trans *tr, sql_schema *s, sqlid id);
@@ -52,6 +52,7 @@ INSERT INTO sys.keywords (keyword) VALUES
   ('CHECK'),
   ('CLIENT'),
   ('CLOB'),
+  ('CLUSTERED'),
   ('COALESCE'),
   ('COLUMN'),
   ('COMMENT'),
@@ -446,14 +447,15 @@ CREATE TABLE sys.index_types (
 
 -- Values taken from sql/include/sql_catalog.h see typedef enum
 -- idx_type: hash_idx, join_idx, oph_idx, no_idx, imprints_idx,
--- ordered_idx.
+-- ordered_idx, clustered_idx.
 INSERT INTO sys.index_types (index_type_id, index_type_name) VALUES
   (0, 'Hash'),
   (1, 'Join'),
   (2, 'Order preserving hash'),
   (3, 'No-index'),
   (4, 'Imprint'),
-  (5, 'Ordered');
+  (5, 'Ordered'),
+  (6, 'Clustered');
 
 ALTER TABLE sys.index_types SET READ ONLY;
 GRANT SELECT ON sys.index_types TO PUBLIC;
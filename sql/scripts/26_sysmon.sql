@@ -73,6 +73,30 @@ returns table(
 )
 external name sysmon.user_statistics;
 
+-- statistics of the dataflow scheduler since server start
+create function sys.dataflow_statistics()
+returns table(
+	name string,
+	value bigint
+)
+external name sysmon.dataflow;
+
+-- statistics of the plan cache shared by the prepared statements
+create function sys.plancache_statistics()
+returns table(
+	name string,
+	value bigint
+)
+external name sql.plancache;
+
+-- statistics of the intermediate result recycler
+create function sys.recycle_statistics()
+returns table(
+	name string,
+	value bigint
+)
+external name sysmon.recycle;
+
 create procedure sys.vacuum(sname string, tname string, cname string)
 external name sql.vacuum;
 create procedure sys.vacuum(sname string, tname string, cname string, interval int)
@@ -113,3 +113,15 @@ returns table (
 )
 external name sql."statistics";
 grant execute on function sys."statistics"(varchar(1024),varchar(1024),varchar(1024)) to public;
+
+-- most common values and equi-depth histograms of the columns, maintained
+-- by analyze for the optimizer; not granted to public, it shows data
+create table sys.column_histograms(
+	"column_id" integer,
+	"rows" bigint,
+	"kind" varchar(5),	-- 'null', 'mcv' or 'bound'
+	"nr" integer,
+	"value" string,
+	"fraction" double,	-- of all rows for 'null' and 'mcv', cumulative for 'bound'
+	"distinct" double	-- values since the previous 'bound'
+);
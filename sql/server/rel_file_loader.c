@@ -36,7 +36,7 @@ fl_unregister(char *name)
 }
 
 int
-fl_register(char *name, fl_add_types_fptr add_types, fl_load_fptr load)
+fl_register(char *name, fl_add_types_fptr add_types, fl_load_fptr load, fl_push_select_fptr push_select)
 {
 	file_loader_t *fl = fl_find(name);
 	if (fl) {
@@ -50,6 +50,7 @@ fl_register(char *name, fl_add_types_fptr add_types, fl_load_fptr load)
 			file_loaders[i].name = GDKstrdup(name);
 			file_loaders[i].add_types = add_types;
 			file_loaders[i].load = load;
+			file_loaders[i].push_select = push_select;
 			return 0;
 		}
 	}
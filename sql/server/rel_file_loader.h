@@ -19,14 +19,17 @@
 typedef str (*fl_add_types_fptr)(mvc *sql, sql_subfunc *f, char *filename, list *res_exps, char *name);
 typedef void *(*fl_load_fptr)(void *be, sql_subfunc *f, char *filename, sql_exp *topn); /* use void * as both return type and be
 																			argument are unknown types at this layer */
+/* optional, offers the selection exps on top of the file to the loader, which returns the (possibly new) function to use */
+typedef sql_subfunc *(*fl_push_select_fptr)(mvc *sql, sql_subfunc *f, list *res_exps, list *exps);
 
 typedef struct file_loader_t {
 	char *name;
 	fl_add_types_fptr add_types;
 	fl_load_fptr load;
+	fl_push_select_fptr push_select;
 } file_loader_t;
 
-sql_export int fl_register(char *name, fl_add_types_fptr add_types, fl_load_fptr fl_load);
+sql_export int fl_register(char *name, fl_add_types_fptr add_types, fl_load_fptr fl_load, fl_push_select_fptr push_select);
 sql_export void fl_unregister(char *name);
 extern file_loader_t* fl_find(char *name);
 
@@ -16,6 +16,7 @@
 #include "rel_exp.h"
 #include "rel_select.h"
 #include "rel_rewriter.h"
+#include "rel_file_loader.h"
 
 /* Split_select optimizer splits case statements in select expressions. This is a step needed for cse */
 static void select_split_exps(mvc *sql, list *exps, sql_rel *rel);
@@ -2337,6 +2338,62 @@ popcount64(uint64_t x)
 #undef BUILTIN_USED
 }
 
+/* add the relations and expressions which are not joined yet on top */
+static sql_rel *
+order_joins_finish(visitor *v, sql_rel *top, list *rels, list *sdje, list *exps)
+{
+	unsigned int rsingle;
+
+	if (list_length(rels)) { /* more relations */
+		node *n;
+		for(n=rels->h; n; n = n->next) {
+			sql_rel *nr = n->data;
+
+			if (top) {
+				rsingle = is_single(nr);
+				reset_single(nr);
+				top = rel_crossproduct(v->sql->sa, top, nr, op_join);
+				if (rsingle)
+					set_single(nr);
+			} else
+				top = nr;
+		}
+	}
+	if (list_length(sdje)) {
+		if (list_empty(exps))
+			exps = sdje;
+		else
+			exps = list_merge(exps, sdje, (fdup)NULL);
+	}
+	if (list_length(exps)) { /* more expressions (add selects) */
+		top = rel_select(v->sql->sa, top, NULL);
+		for(node *n=exps->h; n; n = n->next) {
+			sql_exp *e = n->data;
+
+			if (exp_is_join_exp(e) == 0) {
+				sql_rel *nr = NULL;
+				if (is_theta_exp(e->flag)) {
+					nr = rel_push_join(v->sql, top->l, e->l, e->r, e->f, e, 0);
+				} else if (e->flag == cmp_filter || e->flag == cmp_or) {
+					sql_exp *l = exps_find_one_multi_exp(e->l), *r = exps_find_one_multi_exp(e->r);
+					if (l && r)
+						nr = rel_push_join(v->sql, top->l, l, r, NULL, e, 0);
+				}
+				if (!nr)
+					rel_join_add_exp(v->sql->sa, top->l, e);
+			} else
+				rel_select_add_exp(v->sql->sa, top, e);
+		}
+		if (list_empty(top->exps)) { /* empty select */
+			sql_rel *l = top->l;
+			top->l = NULL;
+			rel_destroy(top);
+			top = l;
+		}
+	}
+	return top;
+}
+
 static sql_rel *
 order_joins(visitor *v, list *rels, list *exps)
 {
@@ -2355,10 +2412,9 @@ order_joins(visitor *v, list *rels, list *exps)
 		sql_exp *e = djn->data;
 		list_remove_data(exps, NULL, e);
 	}
-	if (list_length(rels) > 2 && mvc_debug_on(v->sql, 256)) {
-		top =  rel_planner(v->sql, rels, sdje, exps);
-		return top;
-	}
+	/* cost based ordering when the sizes of all relations can be estimated */
+	if (list_length(rels) > 2 && (top = rel_planner(v->sql, rels, sdje, exps)) != NULL)
+		return order_joins_finish(v, top, rels, sdje, exps);
 
 	int nr_exps = list_length(sdje), nr_rels = list_length(rels), ci = 1;
 	if (nr_rels > 64) {
@@ -2541,54 +2597,7 @@ order_joins(visitor *v, list *rels, list *exps)
 			}
 		}
 	}
-	if (list_length(rels)) { /* more relations */
-		node *n;
-		for(n=rels->h; n; n = n->next) {
-			sql_rel *nr = n->data;
-
-			if (top) {
-				rsingle = is_single(nr);
-				reset_single(nr);
-				top = rel_crossproduct(v->sql->sa, top, nr, op_join);
-				if (rsingle)
-					set_single(nr);
-			} else
-				top = nr;
-		}
-	}
-	if (list_length(sdje)) {
-		if (list_empty(exps))
-			exps = sdje;
-		else
-			exps = list_merge(exps, sdje, (fdup)NULL);
-	}
-	if (list_length(exps)) { /* more expressions (add selects) */
-		top = rel_select(v->sql->sa, top, NULL);
-		for(node *n=exps->h; n; n = n->next) {
-			sql_exp *e = n->data;
-
-			if (exp_is_join_exp(e) == 0) {
-				sql_rel *nr = NULL;
-				if (is_theta_exp(e->flag)) {
-					nr = rel_push_join(v->sql, top->l, e->l, e->r, e->f, e, 0);
-				} else if (e->flag == cmp_filter || e->flag == cmp_or) {
-					sql_exp *l = exps_find_one_multi_exp(e->l), *r = exps_find_one_multi_exp(e->r);
-					if (l && r)
-						nr = rel_push_join(v->sql, top->l, l, r, NULL, e, 0);
-				}
-				if (!nr)
-					rel_join_add_exp(v->sql->sa, top->l, e);
-			} else
-				rel_select_add_exp(v->sql->sa, top, e);
-		}
-		if (list_empty(top->exps)) { /* empty select */
-			sql_rel *l = top->l;
-			top->l = NULL;
-			rel_destroy(top);
-			top = l;
-		}
-	}
-	return top;
+	return order_joins_finish(v, top, rels, sdje, exps);
 }
 
 static int
@@ -4315,6 +4324,36 @@ rel_push_func_down(visitor *v, sql_rel *rel)
 	return rel;
 }
 
+/*
+ * Offer the predicates of a selection directly on top of a file to its
+ * loader (e.g. to skip parts of the file using its statistics). The
+ * selection itself stays, the loader may only read less.
+ */
+static sql_rel *
+rel_push_select_to_file_loader(visitor *v, sql_rel *rel)
+{
+	sql_rel *r = rel->l;
+
+	if (is_select(rel->op) && !list_empty(rel->exps) && r && r->op == op_table &&
+		r->flag != TRIGGER_WRAPPER && !rel_is_ref(r) && r->r) {
+		sql_exp *op = r->r;
+		sql_subfunc *f = op->f;
+
+		if (is_func(op->type) && strcmp(f->func->base.name, "file_loader") == 0 && !sql_func_mod(f->func)[0] && !sql_func_imp(f->func)[0]) {
+			list *args = op->l;
+			sql_exp *eexp = list_length(args) >= 2 ? args->h->next->data : NULL;
+
+			if (eexp && is_atom(eexp->type) && eexp->l && ((atom *) eexp->l)->data.vtype == TYPE_str) {
+				file_loader_t *fl = fl_find(((atom *) eexp->l)->data.val.sval);
+
+				if (fl && fl->push_select)
+					op->f = fl->push_select(v->sql, f, r->exps, rel->exps);
+			}
+		}
+	}
+	return rel;
+}
+
 static sql_rel *
 rel_push_func_and_select_down_(visitor *v, sql_rel *rel)
 {
@@ -4322,6 +4361,8 @@ rel_push_func_and_select_down_(visitor *v, sql_rel *rel)
 		rel = rel_push_func_down(v, rel);
 	if (rel)
 		rel = rel_push_select_down(v, rel);
+	if (rel)
+		rel = rel_push_select_to_file_loader(v, rel);
 	return rel;
 }
 
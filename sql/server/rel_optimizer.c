@@ -52,16 +52,83 @@ typedef struct {
 typedef struct {
 	list *cols;
 	list *ranges;
+	list *guards; /* predicates on the partition column with bounds only known at runtime */
+	sql_table *mt;
 	sql_rel *sel;
 } merge_table_prune_info;
 
 static sql_rel *merge_table_prune_and_unionize(visitor *v, sql_rel *mt_rel, merge_table_prune_info *info);
 
+/* Partition guards, ie the runtime predicates have to overlap with the bounds of the partition.
+ * They come first in the select, so a failing guard empties the candidates before any column is read. */
+static list *
+rel_partition_guards(visitor *v, sql_table *pt, merge_table_prune_info *info)
+{
+	mvc *sql = v->sql;
+	sql_table *mt = info->mt;
+	sql_subtype *ct = &mt->part.pcol->type;
+	list *guards = sa_list(sql->sa);
+	sql_part *pd;
+
+	for (pd = partition_find_part(sql->session->tr, pt, NULL); pd && pd->t != mt; pd = partition_find_part(sql->session->tr, pt, pd))
+		;
+	if (!pd)
+		return guards;
+	if (isRangePartitionTable(mt)) {
+		atom *rmin = atom_general_ptr(sql->sa, ct, pd->part.range.minvalue);
+		atom *rmax = atom_general_ptr(sql->sa, ct, pd->part.range.maxvalue);
+
+		if (rmin->isnull && rmax->isnull) { /* either all values or just the NULLs, which never match */
+			if (pd->with_nills == 1)
+				append(guards, exp_atom_bool(sql->sa, 0));
+			return guards;
+		}
+		for (node *n = info->guards->h; n; n = n->next) {
+			sql_exp *e = n->data, *l = NULL, *h = NULL;
+
+			if (e->f) { /* between */
+				l = e->r;
+				h = e->f;
+			} else if (e->flag == cmp_equal) {
+				l = h = e->r;
+			} else if (e->flag == cmp_gt || e->flag == cmp_gte) {
+				l = e->r;
+			} else {
+				h = e->r;
+			}
+			/* the upper limit of the partition is exclusive */
+			if (l && !rmax->isnull)
+				append(guards, exp_compare(sql->sa, exp_copy(sql, l), exp_atom(sql->sa, rmax), cmp_lt));
+			if (h && !rmin->isnull)
+				append(guards, exp_compare(sql->sa, exp_copy(sql, h), exp_atom(sql->sa, rmin), cmp_gte));
+		}
+	} else {
+		for (node *n = info->guards->h; n; n = n->next) {
+			sql_exp *e = n->data;
+			list *vals = sa_list(sql->sa);
+
+			if (e->flag != cmp_equal || e->f)
+				continue;
+			for (node *m = pd->part.values->h; m; m = m->next) {
+				sql_part_value *spv = m->data;
+
+				append(vals, exp_atom(sql->sa, atom_general_ptr(sql->sa, ct, spv->value)));
+			}
+			if (list_empty(vals)) /* just the NULLs */
+				append(guards, exp_atom_bool(sql->sa, 0));
+			else
+				append(guards, exp_in(sql->sa, exp_copy(sql, e->r), vals, cmp_in));
+		}
+	}
+	return guards;
+}
+
 static sql_rel *
 rel_wrap_select_around_mt_child(visitor *v, sql_rel *t, merge_table_prune_info *info)
 {
 	// TODO: it has to be a table (merge table component) add checks
 	sql_table *subt = (sql_table *)t->l;
+	list *guards = info && !list_empty(info->guards) ? rel_partition_guards(v, subt, info) : NULL;
 
 	if (isMergeTable(subt)) {
 		if ((t = merge_table_prune_and_unionize(v, t, info)) == NULL)
@@ -71,6 +138,8 @@ rel_wrap_select_around_mt_child(visitor *v, sql_rel *t, merge_table_prune_info *
 	if (info) {
 		t = rel_select(v->sql->sa, t, NULL);
 		t->exps = exps_copy(v->sql, info->sel->exps);
+		if (!list_empty(guards))
+			t->exps = list_merge(guards, t->exps, NULL);
 		set_processed(t);
 		set_processed(t);
 	}
@@ -462,6 +531,20 @@ merge_table_prune_and_unionize(visitor *v, sql_rel *mt_rel, merge_table_prune_in
 	return nrel;
 }
 
+static bool
+exp_is_partition_column(sql_table *mt, sql_exp *c)
+{
+	return (isRangePartitionTable(mt) || isListPartitionTable(mt)) && isPartitionedByColumnTable(mt) &&
+		c->type == e_column && c->r && strcmp(c->r, mt->part.pcol->base.name) == 0;
+}
+
+/* a parameter or variable, ie a value bound before execution */
+static bool
+exp_is_bound_value(sql_exp *e, sql_subtype *t)
+{
+	return e->type == e_atom && !e->l && !e->f && subtype_cmp(exp_subtype(e), t) == 0;
+}
+
 /* rewrite merge tables into union of base tables */
 static sql_rel *
 rel_merge_table_rewrite_(visitor *v, sql_rel *rel)
@@ -487,6 +570,8 @@ rel_merge_table_rewrite_(visitor *v, sql_rel *rel)
 				*info = (merge_table_prune_info) {
 					.cols = sa_list(v->sql->sa),
 					.ranges = sa_list(v->sql->sa),
+					.guards = sa_list(v->sql->sa),
+					.mt = mt,
 					.sel = sel
 				};
 				for (node *n = sel->exps->h; n; n = n->next) {
@@ -501,6 +586,9 @@ rel_merge_table_rewrite_(visitor *v, sql_rel *rel)
 						atom *lval = exp_flatten(v->sql, v->value_based_opt, l);
 						atom *hval = h ? exp_flatten(v->sql, v->value_based_opt, h) : lval;
 
+						if ((!lval || !hval) && !is_anti(e) && !is_semantics(e) && exp_is_partition_column(mt, c) &&
+							exp_is_bound_value(l, &mt->part.pcol->type) && (!h || exp_is_bound_value(h, &mt->part.pcol->type)))
+							list_append(info->guards, e); /* prune at runtime */
 						if (lval && hval) {
 							range_limit *next = SA_NEW(v->sql->sa, range_limit);
 
@@ -10,114 +10,97 @@
  * Copyright 1997 - July 2008 CWI.
  */
 
+/*
+ * The join planner orders the relations of an inner join graph on the
+ * estimated size of the intermediate results.  The cardinality of every
+ * relation is estimated from the row counts of the base tables and the
+ * selectivity of its selections, which in turn is derived from the column
+ * statistics (number of distinct values, minimum and maximum).  The
+ * selectivity of an equi join is 1/max(distinct left, distinct right).
+ *
+ * All connected subsets of up to DP_MAX_RELS relations are enumerated
+ * bottom up (dynamic programming over the subsets), keeping the cheapest
+ * plan per subset.  The cost of a join is the cost of its inputs plus the
+ * sizes of both inputs and of its result.  Cross products are never
+ * considered, hence disconnected join graphs, larger join graphs and
+ * relations of unknown size are left to the greedy ordering of the caller.
+ */
 #include "monetdb_config.h"
 #include "rel_planner.h"
 #include "rel_rel.h"
 #include "rel_exp.h"
 #include "rel_prop.h"
 #include "rel_rewriter.h"
+#include "rel_statistics.h"
+#include <math.h>
 
-typedef struct memoitem {
-	const char *name;
-	list *rels;
-	list *exps;
-	list *joins;
-	int done;
-	int level;
-	lng count;
-	lng width;
-	dbl cost;
-	void *data;
-} memoitem;
+#define DEFAULT_SEL 0.33	/* selectivity of predicates we cannot estimate */
 
-#define p_pkey 1
-#define p_fkey 2
-#define p_ukey 3
+typedef struct planrel {
+	sql_rel *rel;
+	dbl count;		/* rows of the underlying table(s) */
+	dbl card;		/* estimated rows after the selections */
+} planrel;
 
-typedef struct memojoin {
-	memoitem *l, *r;
-	int rules; 	/* handled rules */
-	int prop; 	/* pkey, fkey, ukey */
-	dbl cost;
-	dbl sel;
+typedef struct planedge {
 	sql_exp *e;
-} memojoin;
-
-static int
-memoitem_key( memoitem *mi )
-{
-	return hash_key(mi->name);
-}
-
-static memoitem*
-memo_find(list *memo, const char *name)
-{
-	int key = hash_key(name);
-	sql_hash_e *he;
-
-	he = memo->ht->buckets[key&(memo->ht->size-1)];
-	for (; he; he = he->chain) {
-		memoitem *mi = he->value;
+	unsigned int rels;	/* bit mask of the joined relations */
+	dbl sel;
+} planedge;
 
-		if (mi->name && strcmp(mi->name, name) == 0)
-			return mi;
-	}
-	return NULL;
-}
+typedef struct planentry {
+	dbl card;		/* estimated size, < 0 if there is no plan */
+	dbl cost;
+	unsigned int l, r;	/* cheapest split, 0 for a single relation */
+} planentry;
 
-static char *
-merge_names( allocator *sa, const char *lname, const char *rname)
+static dbl
+val_getdbl(const ValRecord *v, bool *ok)
 {
-	size_t l = strlen(lname) + strlen(rname) + 2;
-	char *n = SA_NEW_ARRAY(sa, char, l);
-	const char *p = lname;
-	const char *c;
-
-	while ((c = strchr(p, ',')) != NULL) {
-		if (strncmp(p, rname, c - p) > 0) {
-			if (p > lname)
-				snprintf(n, l, "%.*s,%s,%s", (int) (c - lname),
-					 lname, rname, c + 1);
-			else
-				snprintf(n, l, "%s,%s", rname, lname);
-			return n;
-		}
-		p = c + 1;
+	*ok = true;
+	switch (ATOMstorage(v->vtype)) {
+	case TYPE_bte:
+		if (!is_bte_nil(v->val.btval))
+			return v->val.btval;
+		break;
+	case TYPE_sht:
+		if (!is_sht_nil(v->val.shval))
+			return v->val.shval;
+		break;
+	case TYPE_int:
+		if (!is_int_nil(v->val.ival))
+			return v->val.ival;
+		break;
+	case TYPE_lng:
+		if (!is_lng_nil(v->val.lval))
+			return (dbl) v->val.lval;
+		break;
+#ifdef HAVE_HGE
+	case TYPE_hge:
+		if (!is_hge_nil(v->val.hval))
+			return (dbl) v->val.hval;
+		break;
+#endif
+	case TYPE_flt:
+		if (!is_flt_nil(v->val.fval))
+			return v->val.fval;
+		break;
+	case TYPE_dbl:
+		if (!is_dbl_nil(v->val.dval))
+			return v->val.dval;
+		break;
+	default:
+		break;
 	}
-	snprintf(n, l, "%s,%s", lname, rname);
-	return n;
-}
-
-static memoitem *
-memoitem_create( list *memo, allocator *sa, const char *lname, const char *rname, int level)
-{
-	const char *name = lname;
-	memoitem *mi;
-
-	if (level > 1)
-		name = merge_names(sa, lname, rname);
-	if (memo_find(memo, name))
-		return NULL;
-       	mi = SA_NEW(sa, memoitem);
-	mi->name = sa_strdup(sa, name);
-	mi->joins = (rname)?sa_list(sa):NULL;
-	mi->done = (rname)?0:1;
-	mi->level = level;
-	mi->count = 1;
-	mi->cost = 0;
-	mi->width = 8;
-	mi->data = NULL;
-	mi->rels = sa_list(sa);
-	mi->exps = sa_list(sa);
-	list_append(memo, mi);
-	return mi;
+	*ok = false;
+	return 0;
 }
 
 static lng
 rel_getcount(mvc *sql, sql_rel *rel)
 {
 	if (!sql->session->tr)
-		return 0;
+		return -1;
 
 	switch(rel->op) {
 	case op_basetable: {
@@ -127,830 +110,440 @@ rel_getcount(mvc *sql, sql_rel *rel)
 			sqlstore *store = sql->session->tr->store;
 			return (lng)store->storage_api.count_col(sql->session->tr, ol_first_node(t->columns)->data, 0);
 		}
-		return 0;
+		return -1;
 	}
 	case op_select:
 	case op_project:
+	case op_topn:
+	case op_sample:
+	case op_semi:
+	case op_anti:
 		if (rel->l)
 			return rel_getcount(sql, rel->l);
 		return 1;
 	default:
-		return 0;
+		return -1;
 	}
 }
 
-static lng
-rel_getwidth(mvc *sql, sql_rel *rel)
-{
-	if (!sql->session->tr)
-		return 0;
-
-	switch(rel->op) {
-	case op_basetable: {
-		sql_table *t = rel->l;
-
-		if (t && isTable(t))
-			return 4*list_length(rel->exps);
-		return 0;
-	}
-	case op_select:
-		if (rel->l)
-			return rel_getwidth(sql, rel->l);
-		return 1;
-	case op_project:
-		if (rel->l)
-			return 4*list_length(rel->exps);
-		return 1;
-	default:
+/* statistics of the column expression e of relation r, returns the
+ * estimated number of distinct values (0 if unknown) */
+static dbl
+exp_getstats(mvc *sql, sql_rel *r, sql_exp *e, dbl *min, dbl *max, bool *range)
+{
+	sql_column *c;
+	sql_subtype *et = exp_subtype(e);
+	bool nonil = false, unique = false;
+	double unique_est = 0.0;
+	ValRecord vmin, vmax;
+	int ok;
+
+	*range = false;
+	if (e->type == e_convert)
+		e = e->l;
+	if (e->type != e_column || !(c = exp_find_column(r, e, -2)))
 		return 0;
-	}
-}
-
-static lng
-exp_getdcount( mvc *sql, sql_rel *r , sql_exp *e, lng count)
-{
-	switch(e->type) {
-	case e_column: {
-		/* find col */
-		sql_rel *bt = NULL;
-		sql_column *c = name_find_column(r, e->l, e->r, -1, &bt);
-		if (c) {
-			lng dcount = (lng)sql_trans_dist_count(sql->session->tr, c);
-			if (dcount != 0 && dcount < count)
-				return dcount;
+	ok = mvc_col_stats(sql, c, &nonil, &unique, &unique_est, &vmin, &vmax);
+	if ((ok & 3) == 3) {
+		bool lok, hok;
+
+		*min = val_getdbl(&vmin, &lok);
+		*max = val_getdbl(&vmax, &hok);
+		/* only compare in the same domain, adjusting the scale of decimals */
+		if (lok && hok && et && et->type->eclass == c->type.type->eclass) {
+			if (et->scale != c->type.scale) {
+				dbl f = pow(10, (int) et->scale - (int) c->type.scale);
+
+				*min *= f;
+				*max *= f;
+			}
+			*range = *min <= *max;
 		}
-		return count;
 	}
-	case e_cmp:
-		assert(0);
-
-
-	case e_convert:
-		if (e->l)
-			return exp_getdcount(sql, r, e->l, count);
-		/* fall through */
-	case e_func:
-	case e_aggr:
-	case e_atom:
-	case e_psm:
-	 	return count;
-	}
-	return count;
+	if (ok & 1)
+		VALclear(&vmin);
+	if (ok & 2)
+		VALclear(&vmax);
+	if (unique)
+		return (dbl) rel_getcount(sql, r);
+	if (unique_est < 1)
+		unique_est = (dbl) sql_trans_dist_count(sql->session->tr, c);
+	return unique_est;
 }
 
-static int
-exp_getranges( mvc *sql, sql_rel *r , sql_exp *e, void **min, void **max)
+static dbl
+exp_getdcount(mvc *sql, sql_rel *r, sql_exp *e, dbl count)
 {
-	switch(e->type) {
-	case e_column: {
-		/* find col */
-		sql_rel *bt = NULL;
-		sql_column *c = name_find_column(r, e->l, e->r, -1, &bt);
-		if (c)
-			return sql_trans_ranges(sql->session->tr, c, min, max);
-		return 0;
-	}
-	case e_cmp:
-		assert(0);
-
-	case e_convert:
-		if (e->l)
-			return exp_getranges(sql, r, e->l, min, max);
-		/* fall through */
-	case e_func:
-	case e_aggr:
-	case e_atom:
-	case e_psm:
-	 	return 0;
-	}
-	return 0;
-}
+	dbl min, max, dcount;
+	bool range;
 
-static atom *
-exp_getatom( mvc *sql, sql_exp *e, atom *m)
-{
-	if (is_atom(e->type))
-		return exp_value(sql, e);
-	else if (e->type == e_convert)
-		return exp_getatom(sql, e->l, m);
-	else if (e->type == e_func) {
-		sql_subfunc *f = e->f;
-		list *l = e->l;
-		/* handle date + x months */
-		/* TODO add scalar -> value, ie exp->stmt-tree->exec-tree+exec */
-		if (strcmp(f->func->base.name, "sql_add") == 0 && list_length(l) == 2) {
-			atom *l1 = exp_getatom(sql, l->h->data, m);
-			atom *l2 = exp_getatom(sql, l->h->next->data, m);
-			/* data + months */
-			(void)l2;
-			(void)l1;
-			return NULL;
-		}
-	}
-	return m;
+	dcount = exp_getstats(sql, r, e, &min, &max, &range);
+	if (dcount < 1 || dcount > count)
+		return count;
+	return dcount;
 }
 
-static dbl
-exp_getrange_sel( mvc *sql, sql_rel *r, sql_exp *e, void *min, void *max)
+static bool
+exp_getvalue(mvc *sql, sql_exp *e, dbl *v)
 {
-	atom *amin, *amax, *emin, *emax;
-	dbl sel = 1.0;
-	sql_subtype *t = exp_subtype(e->l);
-
-	(void)r;
-	emin = amin = atom_general_ptr(sql->sa, t, min);
-	emax = amax = atom_general_ptr(sql->sa, t, max);
-
-	if (e->f || e->flag == cmp_gt || e->flag == cmp_gte)
-		emin = exp_getatom(sql, e->r, amin);
-	if (e->f || e->flag == cmp_lt || e->flag == cmp_lte)
-		emax = (e->f)?exp_getatom(sql, e->f, amax):
-			exp_getatom(sql, e->r, amax);
-
-	if (!amin || !amax)
-		return 0.1;
-
-	if (!emin || !emax)
-		sel = 0.125;
-	/* 4 case, dbl and lng, date, timestamp */
-	else if (t->type->eclass == EC_DATE) {
-		sel = (emax->data.val.ival-emin->data.val.ival)/(dbl)(amax->data.val.ival-amin->data.val.ival);
-	} else if (t->type->eclass == EC_TIMESTAMP || t->type->eclass == EC_TIMESTAMP_TZ) {
-		sel = (emax->data.val.lval-emin->data.val.lval)/(dbl)(amax->data.val.lval-amin->data.val.lval);
-	} else if (t->type->eclass == EC_FLT) {
-		sel = (emax->data.val.dval-emin->data.val.dval)/(amax->data.val.dval-amin->data.val.dval);
-	} else { /* lng */
-		sel = (emax->data.val.lval-emin->data.val.lval)/(dbl)(amax->data.val.lval-amin->data.val.lval);
-	}
-	return sel;
+	atom *a;
+	bool ok = false;
+
+	if (e->type == e_convert && exp_subtype(e)->type->eclass == exp_subtype(e->l)->type->eclass &&
+		exp_subtype(e)->scale == exp_subtype(e->l)->scale)
+		return exp_getvalue(sql, e->l, v);
+	if (!is_atom(e->type) || !(a = exp_value(sql, e)) || a->isnull)
+		return false;
+	*v = val_getdbl(&a->data, &ok);
+	return ok;
 }
 
+/* fraction of the rows of r selected by the range predicate e */
 static dbl
-rel_exp_selectivity(mvc *sql, sql_rel *r, sql_exp *e, lng count)
+exp_getrange_sel(mvc *sql, sql_rel *r, sql_exp *e)
 {
-	dbl sel = 1.0;
+	dbl min, max, lo, hi;
+	bool range;
 
-	if (!e)
+	(void) exp_getstats(sql, r, e->l, &min, &max, &range);
+	if (!range)
+		return e->f ? DEFAULT_SEL * DEFAULT_SEL : DEFAULT_SEL;
+	if (max == min)
 		return 1.0;
-	switch(e->type) {
-	case e_cmp: {
-		lng dcount = exp_getdcount( sql, r, e->l, count);
-
-		switch (e->flag) {
-		case cmp_equal: {
-			sel = 1.0/dcount;
-			break;
-		}
-		case cmp_notequal:
-			sel = (dcount-1.0)/dcount;
-			break;
-		case cmp_gt:
-		case cmp_gte:
-		case cmp_lt:
-		case cmp_lte: {
-			void *min, *max;
-			if (exp_getranges( sql, r, e->l, &min, &max )) {
-				sel = (dbl)exp_getrange_sel( sql, r, e, min, max);
-			} else {
-				sel = 0.5;
-				if (e->f) /* range */
-					sel = 0.25;
-			}
-		} 	break;
-		case cmp_filter:
-			sel = 0.01;
-			break;
-		case cmp_in:
-		case cmp_notin: {
-			list *l = e->r;
-			sel = (dbl) list_length(l) / dcount;
-			break;
-		}
-		case cmp_or:
-			sel = 0.5;
-			break;
-		default:
-			return 1.0;
-		}
-		break;
-	}
-	default:
-		break;
+	lo = min;
+	hi = max;
+	if (e->f) {
+		if (!exp_getvalue(sql, e->r, &lo) || !exp_getvalue(sql, e->f, &hi))
+			return DEFAULT_SEL * DEFAULT_SEL;
+	} else if (e->flag == cmp_gt || e->flag == cmp_gte) {
+		if (!exp_getvalue(sql, e->r, &lo))
+			return DEFAULT_SEL;
+	} else {
+		if (!exp_getvalue(sql, e->r, &hi))
+			return DEFAULT_SEL;
 	}
-	return sel;
+	lo = MAX(lo, min);
+	hi = MIN(hi, max);
+	if (hi < lo)
+		return 0;
+	return (hi - lo) / (max - min);
 }
 
+static dbl rel_exps_selectivity(mvc *sql, sql_rel *rel, list *exps, dbl count);
+
 static dbl
-rel_join_exp_selectivity(mvc *sql, sql_rel *l, sql_rel *r, sql_exp *e, lng lcount, lng rcount)
+rel_exp_selectivity(mvc *sql, sql_rel *r, sql_exp *e, dbl count)
 {
 	dbl sel = 1.0;
-	lng ldcount, rdcount;
 
-	if (!e)
+	if (!e || e->type != e_cmp)
 		return 1.0;
-	assert(lcount);
-	assert(rcount);
-	ldcount = exp_getdcount(sql, l, e->l, lcount);
-	rdcount = exp_getdcount(sql, r, e->r, rcount);
-	switch(e->type) {
-	case e_cmp:
-		switch (e->flag) {
-		case cmp_equal:
-			sel = (lcount/(dbl)ldcount)*(rcount/(dbl)rdcount);
-			break;
-		case cmp_notequal: {
-			dbl cnt = (lcount/(dbl)ldcount)*(rcount/(dbl)rdcount);
-			sel = (cnt-1)/cnt;
-		}	break;
-		case cmp_gt:
-		case cmp_gte:
-		case cmp_lt:
-		case cmp_lte:
-			/* ugh */
-			sel = 0.5;
-			if (e->f) /* range */
-				sel = 0.2;
-			break;
-		case cmp_filter:
-			sel = 0.1;
-			break;
-		case cmp_in:
-		case cmp_notin: {
-			lng cnt = lcount*rcount;
-			list *l = e->r;
-			sel = (dbl) list_length(l) / cnt;
-			break;
+	if ((sel = rel_hist_selectivity(sql, r, e)) >= 0)
+		return sel;
+	sel = 1.0;
+	switch (e->flag) {
+	case cmp_equal:
+	case cmp_notequal: {
+		sql_exp *c = e->l, *v = e->r;
+		dbl min, max, val, dcount;
+		bool range;
+
+		if (is_atom(c->type)) {
+			c = e->r;
+			v = e->l;
 		}
-		case cmp_or:
-			sel = 0.5;
+		if (!is_atom(v->type)) { /* comparing two columns */
+			sel = DEFAULT_SEL;
 			break;
-		default:
-			return 1.0;
 		}
+		dcount = exp_getstats(sql, r, c, &min, &max, &range);
+		if (dcount < 1 || dcount > count)
+			dcount = count;
+		sel = 1.0 / MAX(dcount, 1);
+		if (range && exp_getvalue(sql, v, &val) && (val < min || val > max))
+			sel = 0;
+		if (e->flag == cmp_notequal)
+			sel = 1.0 - sel;
+	}	break;
+	case cmp_gt:
+	case cmp_gte:
+	case cmp_lt:
+	case cmp_lte:
+		if (!is_atom(((sql_exp*)e->r)->type) || (e->f && !is_atom(((sql_exp*)e->f)->type)))
+			sel = DEFAULT_SEL;
+		else
+			sel = exp_getrange_sel(sql, r, e);
 		break;
-	default:
+	case cmp_in:
+	case cmp_notin: {
+		dbl dcount = exp_getdcount(sql, r, e->l, count);
+
+		sel = MIN((dbl) list_length(e->r) / MAX(dcount, 1), 1.0);
+		if (e->flag == cmp_notin)
+			sel = 1.0 - sel;
+	}	break;
+	case cmp_or: {
+		dbl l = rel_exps_selectivity(sql, r, e->l, count);
+		dbl rs = rel_exps_selectivity(sql, r, e->r, count);
+
+		sel = l + rs - l * rs;
+	}	break;
+	case cmp_filter:
+		sel = 0.1;
 		break;
+	default:
+		return 1.0;
 	}
-	assert(sel >= 0.000001);
+	if (is_anti(e))
+		sel = 1.0 - sel;
 	return sel;
 }
 
-
 static dbl
-rel_exps_selectivity(mvc *sql, sql_rel *rel, list *exps, lng count)
+rel_exps_selectivity(mvc *sql, sql_rel *rel, list *exps, dbl count)
 {
-	node *n;
 	dbl sel = 1.0;
-	if (!exps->h)
-		return 1.0;
-	for(n=exps->h; n; n = n->next) {
-		dbl nsel = rel_exp_selectivity(sql, rel, n->data, count);
 
-		sel *= nsel;
-	}
+	if (!exps)
+		return 1.0;
+	for (node *n = exps->h; n; n = n->next)
+		sel *= rel_exp_selectivity(sql, rel, n->data, count);
 	return sel;
 }
 
-/* need real values, ie
- * point select on pkey -> 1 value -> selectivity count
- */
-
+/* estimated number of rows of a relation, < 0 if unknown */
 static dbl
-rel_getsel(mvc *sql, sql_rel *rel, lng count)
+rel_getcard(mvc *sql, sql_rel *rel, dbl count)
 {
-	if (!sql->session->tr)
-		return 1.0;
-
 	switch(rel->op) {
+	case op_basetable:
+		return count;
 	case op_select:
-		return rel_exps_selectivity(sql, rel, rel->exps, count);
+		if (rel->l)
+			return rel_getcard(sql, rel->l, count) * rel_exps_selectivity(sql, rel, rel->exps, count);
+		return 1;
 	case op_project:
+	case op_topn:
+	case op_sample:
 		if (rel->l)
-			return rel_getsel(sql, rel->l, count);
-		/* fall through */
+			return rel_getcard(sql, rel->l, count);
+		return 1;
+	case op_semi:
+	case op_anti:
+		if (rel->l)
+			return rel_getcard(sql, rel->l, count) * 0.5;
+		return -1;
 	default:
-		return 1.0;
-	}
-}
-
-static list*
-memo_create(mvc *sql, list *rels )
-{
-	int len = list_length(rels);
-	list *memo = sa_list(sql->sa);
-	node *n;
-
-	memo->ht = hash_new(sql->sa, len*len, (fkeyvalue)&memoitem_key);
-	for(n = rels->h; n; n = n->next) {
-		sql_rel *r = n->data;
-		memoitem *mi = memoitem_create(memo, sql->sa, rel_name(r), NULL, 1);
-		dbl sel = 1;
-
-		mi->count = rel_getcount(sql, r);
-		sel = rel_getsel(sql, r, mi->count);
-		mi->count = MAX( (lng) (mi->count*sel), 1);
-		assert(mi->count);
-		mi->width = rel_getwidth(sql, r);
-		mi->cost = (dbl)(mi->count*mi->width);
-		mi->data = r;
-		append(mi->rels, r);
-	}
-	return memo;
-}
-
-static void
-memo_add_exps(list *memo, mvc *sql, list *rels, list *jes)
-{
-	node *n;
-	memoitem *mi;
-
-	for(n = jes->h; n; n = n->next) {
-		sql_exp *e = n->data;
-		if (e->type != e_cmp || !is_complex_exp(e->flag)){
-			sql_rel *l = find_one_rel(rels, e->l);
-			sql_rel *r = find_one_rel(rels, e->r);
-			memojoin *mj = SA_ZNEW(sql->sa, memojoin);
-
-			mj->l = memo_find( memo, rel_name(l));
-			mj->r = memo_find( memo, rel_name(r));
-			mj->rules = 0;
-			mj->cost = 0;
-			mj->e = e;
-			mj->sel = rel_join_exp_selectivity(sql, l, r, e, mj->l->count, mj->r->count);
-
-			mi = memoitem_create(memo, sql->sa, mj->l->name, mj->r->name, 2);
-			mi->width = (rel_getwidth(sql, l) + rel_getwidth(sql, r))/2;
-			mi->data = e;
-			mi->count = (lng)(mj->sel * MIN(mj->l->count, mj->r->count));
-			append(mi->rels, l);
-			append(mi->rels, r);
-			append(mi->exps, e);
-			list_append(mi->joins, mj);
-		}
+		return -1;
 	}
 }
 
 static int
-memoitem_has( memoitem *mi, const char *name)
+rels_find_one(planrel *rels, int nr, sql_exp *e)
 {
-	if (mi->level > 1) {
-		memojoin *mj = mi->joins->h->data;
+	int fnd = -1;
 
-		return (memoitem_has(mj->l, name) ||
-		        memoitem_has(mj->r, name));
-	} else {
-		return strcmp(mi->name, name) == 0;
-	}
-}
-
-static void
-memoitem_add_attr(list *memo, mvc *sql, memoitem *mi, list *rels, list *jes, int level)
-{
-	node *n;
-
-	for( n = jes->h; n; n = n->next) {
-		sql_exp *e = n->data;
-
-		if (e->type != e_cmp || !is_complex_exp(e->flag)){
-			int hasl = 0, hasr = 0;
-			sql_rel *l = find_one_rel(rels, e->l);
-			sql_rel *r = find_one_rel(rels, e->r);
-
-			/* check if exactly one rel is in mi */
-			hasl = memoitem_has(mi, rel_name(l));
-			hasr = memoitem_has(mi, rel_name(r));
-			if (hasl != hasr) {
-				memoitem *nmi;
-				sql_rel *rr = r;
-
-				if (!hasl)
-					rr = l;
-				nmi = memoitem_create(memo, sql->sa, mi->name, rel_name(rr), level);
-				if (nmi) {
-					memojoin *mj = SA_ZNEW(sql->sa, memojoin);
-					lng mincnt = 0;
-
-					list_merge(nmi->rels, mi->rels, (fdup)NULL);
-					append(nmi->rels, rr);
-					append(nmi->exps, e);
-
-					mj->l = mi;
-					mj->r = memo_find( memo, rel_name(rr));
-				       	mincnt = MIN(mj->l->count, mj->r->count);
-					nmi->width = mi->width + mj->r->width;
-					mj->rules = 0;
-					mj->cost = 0;
-					mj->sel = rel_join_exp_selectivity(sql, l, r, e, mj->l->count, mj->r->count);
-					list_append(nmi->joins, mj);
-
-					if (!nmi->count)
-						nmi->count = (lng)(mincnt*mj->sel);
-					nmi->count = MIN((lng) (mincnt*mj->sel), nmi->count);
-					assert(nmi->count >= 0);
-				}
-			}
+	for (int i = 0; i < nr; i++) {
+		if (rel_has_exp(rels[i].rel, e, false) == 0) {
+			if (fnd >= 0)
+				return -1;
+			fnd = i;
 		}
 	}
+	return fnd;
 }
 
-static void
-memo_add_attr(list *memo, mvc *sql, list *rels, list *jes)
+static dbl
+rel_join_exp_selectivity(mvc *sql, planrel *l, planrel *r, sql_exp *e)
 {
-	node *n;
-	int l, len = list_length(rels);
-
-	for(l=2; l<len; l++) {
-		for (n = memo->h; n; n = n->next) {
-			memoitem *mi = n->data;
-
-			if (mi->level == l)
-				memoitem_add_attr( memo, sql, mi, rels, jes, l+1);
-		}
-	}
-}
+	dbl sel = 1.0;
 
-/* Rule 1: Commutativity A join B -> B join A */
-static int
-memoitem_apply_r1(memoitem *mi, allocator *sa)
-{
-	int changes = 0;
-	node *n;
+	switch (e->flag) {
+	case cmp_equal:
+	case cmp_notequal:
+		if (e->flag == cmp_equal && find_prop(e->p, PROP_JOINIDX)) {
+			/* foreign key join, each row of the left finds one key */
+			sel = 1.0 / MAX(r->count, 1);
+		} else {
+			dbl ldcount = MIN(exp_getdcount(sql, l->rel, e->l, l->count), l->card);
+			dbl rdcount = MIN(exp_getdcount(sql, r->rel, e->r, r->count), r->card);
 
-	if (!mi->joins)
-		return 0;
-	for ( n = mi->joins->h; n; n = n->next) {
-		memojoin *mj = n->data;
-
-		if (mj->rules == 0 || mj->rules == 2) {
-			memojoin *mjn = SA_ZNEW(sa, memojoin);
-
-			mjn->l = mj->r;
-			mjn->r = mj->l;
-
-			if (mj->rules)
-				mj->rules = 4;
-			else
-				mj->rules = 1;
-			mjn->rules = 4;
-			mjn->cost = 0;
-			mjn->sel = mj->sel;
-			list_append(mi->joins, mjn);
-			changes ++;
+			sel = 1.0 / MAX(MAX(ldcount, rdcount), 1);
 		}
+		if (e->flag == cmp_notequal)
+			sel = 1.0 - sel;
+		break;
+	case cmp_gt:
+	case cmp_gte:
+	case cmp_lt:
+	case cmp_lte:
+		sel = e->f ? DEFAULT_SEL * DEFAULT_SEL : DEFAULT_SEL;
+		break;
+	case cmp_filter:
+		sel = 0.1;
+		break;
+	default:
+		sel = 0.5;
+		break;
 	}
-	return changes;
+	if (is_anti(e))
+		sel = 1.0 - sel;
+	return sel;
 }
 
-/* Rule 2: Right Associativity (A join B) join C -> A join (B join C) */
-static int
-memoitem_apply_r2(memoitem *mi, allocator *sa, list *memo)
-{
-	int changes = 0;
-	node *n;
-
-	if (!mi->joins || mi->level <= 2)
-		return 0;
-	for ( n = mi->joins->h; n; n = n->next) {
-		memojoin *mj = n->data;
-
-		if (mj->rules <= 1 && mj->l->level >= 2) {
-			node *m;
-
-			for( m = mj->l->joins->h; m; m = m->next) {
-				memoitem *r = NULL;
-				memojoin *mjl = m->data;
-				/* combine mjl->r and mj->r */
-				char *name = merge_names(sa, mjl->r->name, mj->r->name);
-
-				if ((r = memo_find(memo, name))) {
-					memojoin *mjn = SA_ZNEW(sa, memojoin);
-
-					mjn->l = mjl->l;
-					mjn->r = r;
-					mjn->rules = 2;
-					mjn->cost = 0;
-					mjn->sel = 1;
-					list_append(mi->joins, mjn);
-					changes ++;
-				}
-			}
-			if (mj->rules)
-				mj->rules = 4;
-			else
-				mj->rules = 2;
+static sql_rel *
+plan_build(mvc *sql, planrel *rels, planentry *plans, unsigned int set, list *sdje, list *exps)
+{
+	planentry *p = plans + set;
+	sql_rel *top, *l, *r;
+	unsigned int rsingle;
+
+	if (!p->l) {
+		int i = 0;
+
+		while (!(set & (1U << i)))
+			i++;
+		return rels[i].rel;
+	}
+	l = plan_build(sql, rels, plans, p->l, sdje, exps);
+	r = plan_build(sql, rels, plans, p->r, sdje, exps);
+	rsingle = is_single(r);
+	reset_single(r);
+	top = rel_crossproduct(sql->sa, l, r, op_join);
+	if (rsingle)
+		set_single(r);
+
+	/* all join expressions on these relations */
+	for (node *en = sdje->h; en; ) {
+		node *next = en->next;
+		sql_exp *e = en->data;
+
+		if (rel_rebind_exp(sql, top, e)) {
+			rel_join_add_exp(sql->sa, top, e);
+			list_remove_data(sdje, NULL, e);
 		}
+		en = next;
 	}
-	return changes;
-}
-
-/* Rule 4: Exchange (A join B) join (C join D) -> (A join C) join (B join D)
-static int
-memoitem_apply_r4(memoitem *mi, allocator *sa, list *memo)
-{
-	int changes = 0;
-	node *n;
+	for (node *en = exps->h; en; ) {
+		node *next = en->next;
+		sql_exp *e = en->data;
 
-	if (!mi->joins || mi->level <= 2)
-		return 0;
-	for ( n = mi->joins->h; n; n = n->next) {
-		memojoin *mj = n->data;
-
-		if (mj->rules <= 1 && mj->l->level >= 2) {
-			node *m;
-
-			for( m = mj->l->joins->h; m; m = m->next) {
-				memoitem *r = NULL;
-				memojoin *mjl = m->data;
-				char *name = merge_names(sa, mjl->r->name, mj->r->name);
-
-				if ((r = memo_find(memo, name))) {
-					memojoin *mjn = SA_ZNEW(sa, memojoin);
-
-					mjn->l = mjl->l;
-					mjn->r = r;
-					mjn->rules = 2;
-					mjn->cost = 0;
-					list_append(mi->joins, mjn);
-					changes ++;
-				}
-			}
-			if (mj->rules)
-				mj->rules = 4;
-			else
-				mj->rules = 2;
+		if (rel_rebind_exp(sql, top, e)) {
+			rel_join_add_exp(sql->sa, top, e);
+			list_remove_data(exps, NULL, e);
 		}
+		en = next;
 	}
-	return changes;
+	return top;
 }
- * */
 
-static void
-memo_apply_rules(list *memo, allocator *sa, int len)
+/* Order the relations joined by the (distinct) join expressions in sdje.
+ * Returns the join tree, with the relations and the expressions it uses
+ * removed from rels, sdje and exps, or NULL if the relations should be
+ * ordered greedily. */
+sql_rel *
+rel_planner(mvc *sql, list *rels, list *sdje, list *exps)
 {
-	int level;
-	node *n;
-
-	for (level = 2; level<=len; level++) {
-		int gchanges = 1;
+	int nr = list_length(rels), ne = 0, i;
+	unsigned int full, set;
+	planrel *prels;
+	planedge *edges;
+	planentry *plans;
+	sql_rel *top;
 
-		while(gchanges) {
-			gchanges = 0;
-			for ( n = memo->h; n; n = n->next) {
-				int changes = 0;
-				memoitem *mi = n->data;
+	if (nr < 2 || nr > DP_MAX_RELS || list_empty(sdje))
+		return NULL;
+	prels = SA_NEW_ARRAY(sql->ta, planrel, nr);
+	edges = SA_NEW_ARRAY(sql->ta, planedge, list_length(sdje));
+	full = (1U << nr) - 1;
+	plans = SA_NEW_ARRAY(sql->ta, planentry, full + 1);
+	if (!prels || !edges || !plans)
+		return NULL;
 
-				if (!mi->done && mi->level == level) {
-					changes += memoitem_apply_r1(mi, sa);
-					changes += memoitem_apply_r2(mi, sa, memo);
-					//changes += memoitem_apply_r4(mi, sa, memo);
+	i = 0;
+	for (node *n = rels->h; n; n = n->next, i++) {
+		sql_rel *r = n->data;
+		lng count = rel_getcount(sql, r);
+		dbl card;
 
-					if (!changes)
-						mi->done = 1;
-				}
-				gchanges |= changes;
-			}
-		}
+		if (count < 0 || (card = rel_getcard(sql, r, (dbl) count)) < 0)
+			return NULL; /* unknown size */
+		prels[i].rel = r;
+		prels[i].count = (dbl) count;
+		prels[i].card = MAX(card, 1);
 	}
-}
-
-static void
-memo_locate_exps( list *memo )
-{
-	node *n, *m, *o;
-
-	for(n = memo->h; n; n = n->next) {
-		memoitem *mi = n->data;
-		int prop = 0;
-
-		if (mi->level == 2) {
-			sql_exp *e = mi->data;
-
-			if (find_prop(e->p, PROP_HASHIDX))
-				prop = p_pkey;
-			if (find_prop(e->p, PROP_JOINIDX))
-				prop = p_fkey;
-
-			if (prop) {
-				for (m = mi->joins->h; m; m = m->next) {
-					memojoin *mj = m->data;
-					sql_exp *e = mj->e;
-
-					mj->prop = prop;
-					if (prop == p_fkey) {
-						sql_rel *l = mj->l->data, *f = NULL;
-						if (!l)
-							continue;
-						if (e)
-							f = find_one_rel(mi->rels, e->l);
-						if (f != l) /* we dislike swapped pkey/fkey joins */
-							mj->prop = 0;
-					}
+	for (node *n = sdje->h; n; n = n->next) {
+		sql_exp *e = n->data;
+		int l, r, f = -1;
+
+		if (e->type != e_cmp || is_complex_exp(e->flag))
+			continue;
+		l = rels_find_one(prels, nr, e->l);
+		r = rels_find_one(prels, nr, e->r);
+		if (e->f)
+			f = rels_find_one(prels, nr, e->f);
+		if (l < 0 || r < 0 || l == r || (e->f && f < 0))
+			continue;
+		edges[ne].e = e;
+		edges[ne].rels = (1U << l) | (1U << r);
+		if (e->f)
+			edges[ne].rels |= 1U << f;
+		edges[ne].sel = rel_join_exp_selectivity(sql, prels + l, prels + r, e);
+		ne++;
+	}
+
+	for (set = 1; set <= full; set++) {
+		plans[set].card = -1;
+		plans[set].l = plans[set].r = 0;
+	}
+	for (i = 0; i < nr; i++) {
+		plans[1U << i].card = prels[i].card;
+		plans[1U << i].cost = 0;
+	}
+	for (set = 1; set <= full; set++) {
+		unsigned int low = set & (~set + 1);
+
+		if (set == low)
+			continue;
+		/* each split once, the left part holds the lowest relation */
+		for (unsigned int l = (set - 1) & set; l; l = (l - 1) & set) {
+			unsigned int r = set ^ l;
+			bool connected = false;
+			dbl card, cost, sel = 1.0;
+
+			if (!(l & low) || plans[l].card < 0 || plans[r].card < 0)
+				continue;
+			for (int j = 0; j < ne; j++) {
+				unsigned int m = edges[j].rels;
+
+				if ((m & set) == m && (m & l) && (m & r)) {
+					connected = true;
+					sel *= edges[j].sel;
 				}
 			}
-		} else if (mi->level > 2) {
-			/* find exp which isn't in the mj->l/r->exps lists */
-			for( o = mi->exps->h; o; o = o->next) {
-				sql_exp *e = o->data;
-
-				for (m = mi->joins->h; m; m = m->next) {
-					memojoin *mj = m->data;
-
-					if (list_find(mj->l->exps, e, NULL) == NULL &&
-					    list_find(mj->r->exps, e, NULL) == NULL) {
-						if (find_prop(e->p, PROP_HASHIDX))
-							prop = p_pkey;
-						if (find_prop(e->p, PROP_JOINIDX))
-							prop = p_fkey;
-						mj->prop = prop;
-						if (prop == p_fkey) {
-							sql_rel *l = find_one_rel(mi->rels, e->l);
-							sql_rel *f = find_one_rel(mj->l->rels, e->l);
-							if (!l)
-								continue;
-							if (f != l) /* we dislike swapped pkey/fkey joins */
-								mj->prop = 0;
-						}
-					}
+			if (!connected)
+				continue;
+			card = MAX(plans[l].card * plans[r].card * sel, 1);
+			cost = plans[l].cost + plans[r].cost + plans[l].card + plans[r].card + card;
+			if (plans[set].card < 0 || cost < plans[set].cost) {
+				plans[set].card = card;
+				plans[set].cost = cost;
+				/* the larger input on the left */
+				if (plans[l].card >= plans[r].card) {
+					plans[set].l = l;
+					plans[set].r = r;
+				} else {
+					plans[set].l = r;
+					plans[set].r = l;
 				}
 			}
 		}
 	}
-}
-
-static void
-memo_compute_cost(list *memo)
-{
-	node *n, *m;
-
-	for ( n = memo->h; n; n = n->next) {
-		memoitem *mi = n->data;
-
-		if (mi->joins) {
-			lng cnt = 0, width = 1;
-		        dbl cost = 0;
-
-			/* cost minimum of join costs */
-			for ( m = mi->joins->h; m; m = m->next ) {
-				memojoin *mj = m->data;
-
-				lng mincnt = MIN(mj->l->count, mj->r->count);
-				dbl nsel = mj->sel;
-				lng ocnt = MAX((lng) (mincnt*nsel), 1);
-				dbl ncost = 0;
-
-				/* mincnt*mincnt_size_width*hash_const_cost + mincnt * output_width(for now just sum of width) * memaccess const */
-				/* current consts are 1 and 1 */
-				//ncost += ocnt * MIN(mj->l->width, mj->r->width);
-				width = (mj->l->count < mj->r->count)?mj->l->width:mj->r->width;
-				ncost += (mincnt * width * 1 ) + ocnt * (mj->l->width + mj->r->width) * 1;
-				assert(mj->l->cost > 0 && mj->r->cost > 0);
-				ncost += mj->l->cost; /* add cost of left */
-				ncost += mj->r->cost; /* add cost of right */
-
-				width = mj->l->width + mj->r->width;
-				mj->cost = ncost;
-
-				if (cnt == 0)
-					cnt = ocnt;
-				cnt = MIN(cnt,ocnt);
-
-				if (cost == 0)
-					cost = ncost;
-				cost = MIN(cost,ncost);
-			}
-			assert(cnt > 0);
-			mi->count = cnt;
-			mi->cost = cost;
-			mi->width = width;
-		}
-	}
-}
-
-static void
-memojoin_print( memojoin *mj )
-{
-	printf("%s join-%s%d(cost=%f) %s", mj->l->name, mj->prop==p_pkey?"pkey":mj->prop==p_fkey?"fkey":"", mj->rules, mj->cost, mj->r->name);
-}
-
-static void
-memojoins_print( list *joins )
-{
-	node *n;
-
-	if (!joins)
-		return;
-	for(n=joins->h; n; n = n->next) {
-		memojoin *mj = n->data;
-
-		memojoin_print( mj );
-		if (n->next)
-			printf(" | ");
-	}
-}
-
-static void
-memoitem_print( memoitem *mi )
-{
-	printf("# %s(count="LLFMT",width="LLFMT",cost=%f): ", mi->name, mi->count, mi->width, mi->cost);
-	memojoins_print(mi->joins);
-}
-
-static void
-memo_print( list *memo )
-{
-	node *n;
-	int level = 0;
-
-	for(n=memo->h; n; n = n->next) {
-		memoitem *mi = n->data;
-
-		if (mi->level > level){
-			level = mi->level;
-			printf("\n");
-		}
-		memoitem_print( mi );
-		printf("\n");
-	}
-	fflush(stdout);
-}
-
-static memojoin *
-find_cheapest( list *joins )
-{
-	node *n;
-	memojoin *cur = NULL;
-
-	if (!joins)
-		return NULL;
-	cur = joins->h->data;
-	for ( n = joins->h; n; n = n->next) {
-		memojoin *mj = n->data;
-
-		if (cur->cost > mj->cost)
-			cur = mj;
-	}
-	return cur;
-}
-
-static sql_rel *
-memo_select_plan( mvc *sql, list *memo, memoitem *mi, list *sdje, list *exps)
-{
-	if (mi->level >= 2) {
-		memojoin *mj = find_cheapest(mi->joins);
-		sql_rel *top;
-
-		top = rel_crossproduct(sql->sa,
-			memo_select_plan(sql, memo, mj->l, sdje, exps),
-			memo_select_plan(sql, memo, mj->r, sdje, exps),
-			op_join);
-		if (mi->level == 2) {
-			rel_join_add_exp(sql->sa, top, mi->data);
-			list_remove_data(sdje, NULL, mi->data);
-		} else {
-			node *djn;
-
-			/* all other join expressions on these 2 relations */
-			while((djn = list_find(sdje, mi->rels, (fcmp)&exp_joins_rels)) != NULL) {
-				sql_exp *e = djn->data;
-
-				rel_join_add_exp(sql->sa, top, e);
-				list_remove_data(sdje, NULL, e);
-			}
-
-			/* all other join expressions on these 2 relations */
-			while((djn = list_find(exps, mi->rels, (fcmp)&exp_joins_rels)) != NULL) {
-				sql_exp *e = djn->data;
-
-				rel_join_add_exp(sql->sa, top, e);
-				list_remove_data(exps, NULL, e);
-			}
-		}
-		set_processed(top);
-		return top;
-	} else {
-		return mi->data;
-	}
-}
-
-sql_rel *
-rel_planner(mvc *sql, list *rels, list *sdje, list *exps)
-{
-	list *memo = memo_create(sql, rels);
-	memoitem *mi;
-	sql_rel *top;
+	if (plans[full].card < 0)
+		return NULL; /* disconnected join graph */
 
-	/* extend one attribute at a time */
-	memo_add_exps(memo, sql, rels, sdje);
-	memo_add_attr(memo, sql, rels, sdje);
-
-	memo_apply_rules(memo, sql->sa, list_length(rels));
-	memo_locate_exps(memo);
-	memo_compute_cost(memo);
-	//if (0)
-		memo_print(memo);
-	mi = memo->t->data;
-	top = memo_select_plan(sql, memo, mi, sdje, exps);
-	if (list_length(sdje) != 0)
-		list_merge (top->exps, sdje, (fdup)NULL);
+	top = plan_build(sql, prels, plans, full, sdje, exps);
+	for (i = 0; i < nr; i++)
+		list_remove_data(rels, NULL, prels[i].rel);
 	return top;
 }
@@ -16,6 +16,8 @@
 #include "sql_relation.h"
 #include "sql_mvc.h"
 
+#define DP_MAX_RELS 12		/* larger join graphs are ordered greedily */
+
 extern sql_rel * rel_planner(mvc *sql, list *rels, list *djes, list *ojes);
 
 #endif /*_REL_PLANNER_H_ */
@@ -1074,6 +1074,58 @@ create_column(sql_query *query, symbol *s, sql_schema *ss, sql_table *t, int alt
 	return res;
 }
 
+static int
+table_clustered(mvc *sql, dlist *columns, sql_table *t, bool isDeclared, const char *action)
+{
+	sql_idx *i = NULL;
+	char *iname = sa_message(sql->sa, "%s_clustered", t->base.name);
+
+	if (!isTable(t) || isDeclared || isTempSchema(t->s)) {
+		sql_error(sql, 02, SQLSTATE(42000) "%s: CLUSTERED BY is only supported on persistent tables", action);
+		return SQL_ERR;
+	}
+	if (find_clustered_idx(t)) {
+		sql_error(sql, 02, SQLSTATE(42000) "%s: a table can only be clustered once", action);
+		return SQL_ERR;
+	}
+	if (mvc_bind_idx(sql, t->s, iname) || ol_find_name(t->keys, iname) || mvc_bind_key(sql, t->s, iname)) {
+		sql_error(sql, 02, SQLSTATE(42S11) "%s: name '%s' already in use", action, iname);
+		return SQL_ERR;
+	}
+	switch (mvc_create_idx(&i, sql, t, iname, clustered_idx)) {
+		case -1:
+			sql_error(sql, 02, SQLSTATE(HY013) MAL_MALLOC_FAIL);
+			return SQL_ERR;
+		case -2:
+		case -3:
+			sql_error(sql, 02, SQLSTATE(42000) "%s: transaction conflict detected", action);
+			return SQL_ERR;
+		default:
+			break;
+	}
+	for (dnode *n = columns->h; n; n = n->next) {
+		sql_column *c = mvc_bind_column(sql, t, n->data.sval);
+
+		if (!c) {
+			sql_error(sql, ERR_NOTFOUND, SQLSTATE(42S22) "%s: no such column '%s'", action, n->data.sval);
+			return SQL_ERR;
+		}
+		switch (mvc_create_ic(sql, i, c)) {
+			case -1:
+				sql_error(sql, 02, SQLSTATE(HY013) MAL_MALLOC_FAIL);
+				return SQL_ERR;
+			case -2:
+			case -3:
+				sql_error(sql, 02, SQLSTATE(42000) "%s: transaction conflict detected", action);
+				return SQL_ERR;
+			default:
+				break;
+		}
+	}
+	mvc_create_idx_done(sql, i);
+	return SQL_OK;
+}
+
 static int
 table_element(sql_query *query, symbol *s, sql_schema *ss, sql_table *t, int alter, bool isDeclared, const char *action)
 {
@@ -1140,6 +1192,9 @@ table_element(sql_query *query, symbol *s, sql_schema *ss, sql_table *t, int alt
 	case SQL_CONSTRAINT:
 		res = table_constraint(query, s, ss, t);
 		break;
+	case SQL_CLUSTERED:
+		res = table_clustered(sql, s->data.lval, t, isDeclared, action);
+		break;
 	case SQL_COLUMN_OPTIONS:
 	{
 		dnode *n = s->data.lval->h;
@@ -2358,6 +2413,10 @@ rel_create_index(mvc *sql, char *iname, idx_type itype, dlist *qname, dlist *col
 		return sql_error(sql, 02, SQLSTATE(42000) "CREATE INDEX: a key named '%s' already exists, and it would conflict with the index", iname);
 	if (!isTable(t))
 		return sql_error(sql, 02, SQLSTATE(42S02) "CREATE INDEX: cannot create index on %s '%s'", TABLE_TYPE_DESCRIPTION(t->type, t->properties), tname);
+	if (itype == clustered_idx && isTempTable(t))
+		return sql_error(sql, 02, SQLSTATE(42000) "CREATE INDEX: cannot create a clustered index on a temporary table");
+	if (itype == clustered_idx && find_clustered_idx(t))
+		return sql_error(sql, 02, SQLSTATE(42000) "CREATE INDEX: table '%s' is already clustered", tname);
 	nt = dup_sql_table(sql->sa, t);
 
 	if (t->persistence != SQL_DECLARED_TABLE)
@@ -741,6 +741,100 @@ rel_calc_nuniques(mvc *sql, sql_rel *l, list *exps)
 	return lv;
 }
 
+static sql_column *
+hist_column(sql_rel *rel, sql_exp *e)
+{
+	if (e->type == e_convert)
+		e = e->l;
+	if (e->type != e_column)
+		return NULL;
+	return exp_find_column(rel, e, -2);
+}
+
+/* the constant e in the type of column c */
+static ValPtr
+hist_value(mvc *sql, sql_column *c, sql_exp *e)
+{
+	atom *a;
+
+	if (!is_atom(e->type) || !(a = exp_value(sql, e)) || a->isnull)
+		return NULL;
+	if (subtype_cmp(&a->tpe, &c->type) != 0 || a->tpe.scale != c->type.scale) {
+		if (!(a = atom_cast(sql->sa, atom_copy(sql->sa, a), &c->type)))
+			return NULL;
+	}
+	return &a->data;
+}
+
+/* Selectivity of the comparison e of a column of rel with constants from
+ * the histogram collected by ANALYZE, < 0 if there is none */
+dbl
+rel_hist_selectivity(mvc *sql, sql_rel *rel, sql_exp *e)
+{
+	sql_trans *tr = sql->session->tr;
+	sql_exp *l, *r;
+	sql_column *c;
+	ValPtr lo, hi;
+	dbl sel = -1;
+
+	if (!tr || !e || e->type != e_cmp || is_symmetric(e))
+		return -1;
+	l = e->l;
+	r = e->r;
+	switch (e->flag) {
+	case cmp_equal:
+	case cmp_notequal:
+		if (is_atom(l->type)) {
+			l = e->r;
+			r = e->l;
+		}
+		if (!(c = hist_column(rel, l)) || !(lo = hist_value(sql, c, r)))
+			return -1;
+		sel = sql_trans_hist_equal(tr, c, lo);
+		if (sel >= 0 && e->flag == cmp_notequal)
+			sel = 1 - sel;
+		break;
+	case cmp_gt:
+	case cmp_gte:
+	case cmp_lt:
+	case cmp_lte:
+		if (!(c = hist_column(rel, l)) || !(lo = hist_value(sql, c, r)))
+			return -1;
+		if (e->f) {
+			if (!(hi = hist_value(sql, c, e->f)))
+				return -1;
+			sel = sql_trans_hist_range(tr, c, lo, range2lcompare(e->flag) == cmp_gte, hi, range2rcompare(e->flag) == cmp_lte);
+		} else if (e->flag == cmp_gt || e->flag == cmp_gte) {
+			sel = sql_trans_hist_range(tr, c, lo, e->flag == cmp_gte, NULL, false);
+		} else {
+			sel = sql_trans_hist_range(tr, c, NULL, false, lo, e->flag == cmp_lte);
+		}
+		break;
+	case cmp_in:
+	case cmp_notin:
+		if (!(c = hist_column(rel, l)))
+			return -1;
+		sel = 0;
+		for (node *n = ((list *) e->r)->h; n; n = n->next) {
+			dbl s;
+
+			if (!(lo = hist_value(sql, c, n->data)) ||
+				(s = sql_trans_hist_equal(tr, c, lo)) < 0)
+				return -1;
+			sel += s;
+		}
+		sel = MIN(sel, 1.0);
+		if (e->flag == cmp_notin)
+			sel = 1 - sel;
+		break;
+	default:
+		return -1;
+	}
+	if (sel >= 0 && is_anti(e))
+		sel = 1 - sel;
+	return sel;
+}
+
 static sql_rel *
 rel_get_statistics_(visitor *v, sql_rel *rel)
 {
@@ -1045,21 +1139,37 @@ rel_get_statistics_(visitor *v, sql_rel *rel)
 			} else {
 				if (!list_empty(rel->exps) && !is_single(rel)) {
 					BUN cnt = get_rel_count(l), u = 1;
-					for (node *n = rel->exps->h ; n ; n = n->next) {
-						sql_exp *e = n->data, *el = e->l, *er = e->r;
-
-						/* simple expressions first */
-						if (e->type == e_cmp && e->flag == cmp_equal && exp_is_atom(er)) {
-							/* use selectivity */
-							prop *p;
-							if ((p = find_prop(el->p, PROP_NUNIQUES))) {
-								u = (BUN) p->value.dval;
-								break;
+					dbl sel = 1.0;
+					bool hist = false;
+
+					/* predicates on skewed data are estimated from the histograms */
+					for (node *n = rel->exps->h ; n && is_select(rel->op) && cnt != BUN_NONE ; n = n->next) {
+						dbl s = rel_hist_selectivity(v->sql, rel, n->data);
+
+						if (s >= 0) {
+							sel *= s;
+							hist = true;
+						}
+					}
+					if (hist) {
+						set_count_prop(v->sql->sa, rel, cnt == 0 ? 0 : MAX((BUN) (cnt * sel), 1));
+					} else {
+						for (node *n = rel->exps->h ; n ; n = n->next) {
+							sql_exp *e = n->data, *el = e->l, *er = e->r;
+
+							/* simple expressions first */
+							if (e->type == e_cmp && e->flag == cmp_equal && exp_is_atom(er)) {
+								/* use selectivity */
+								prop *p;
+								if ((p = find_prop(el->p, PROP_NUNIQUES))) {
+									u = (BUN) p->value.dval;
+									break;
+								}
 							}
 						}
+						/* u is an *estimate*, so don't set count_prop to 0 unless cnt is 0 */
+						set_count_prop(v->sql->sa, rel, cnt == 0 ? 0 : u == 0 || u > cnt ? 1 : cnt/u);
 					}
-					/* u is an *estimate*, so don't set count_prop to 0 unless cnt is 0 */
-					set_count_prop(v->sql->sa, rel, cnt == 0 ? 0 : u == 0 || u > cnt ? 1 : cnt/u);
 				} else {
 					set_count_prop(v->sql->sa, rel, get_rel_count(l));
 				}
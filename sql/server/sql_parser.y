@@ -686,7 +686,7 @@ int yydebug=1;
 %token  START TRANSACTION READ WRITE ONLY ISOLATION LEVEL
 %token  UNCOMMITTED COMMITTED sqlREPEATABLE SERIALIZABLE DIAGNOSTICS sqlSIZE STORAGE SNAPSHOT
 
-%token <sval> ASYMMETRIC SYMMETRIC ORDER ORDERED BY IMPRINTS
+%token <sval> ASYMMETRIC SYMMETRIC ORDER ORDERED BY IMPRINTS CLUSTERED
 %token <operation> ESCAPE UESCAPE HAVING sqlGROUP ROLLUP CUBE sqlNULL
 %token <operation> GROUPING SETS FROM FOR MATCH
 
@@ -1597,6 +1597,7 @@ opt_index_type:
      UNIQUE		{ $$ = hash_idx; }
  |   ORDERED		{ $$ = ordered_idx; }
  |   IMPRINTS		{ $$ = imprints_idx; }
+ |   CLUSTERED		{ $$ = clustered_idx; }
  |   /* empty */	{ $$ = hash_idx; }
  ;
 
@@ -1898,6 +1899,11 @@ opt_temp:
  |  GLOBAL TEMP		{ $$ = SQL_GLOBAL_TEMP; }
  ;
 
+clustered_by:
+    CLUSTERED BY
+ |  ORDER BY
+ ;
+
 opt_on_commit: /* only for temporary tables */
     /* empty */			 { $$ = CA_COMMIT; }
  |  ON COMMIT sqlDELETE ROWS	 { $$ = CA_DELETE; }
@@ -1907,6 +1913,8 @@ opt_on_commit: /* only for temporary tables */
 
 table_content_source:
     '(' table_element_list ')'	{ $$ = _symbol_create_list( SQL_CREATE_TABLE, $2); }
+ |  '(' table_element_list ')' clustered_by '(' ident_commalist ')'
+	{ $$ = _symbol_create_list( SQL_CREATE_TABLE, append_symbol($2, _symbol_create_list( SQL_CLUSTERED, $6))); }
  |  as_subquery_clause		{ $$ = _symbol_create_list( SQL_SELECT, $1); }
  ;
 
@@ -6002,6 +6010,7 @@ non_reserved_word:
 | CACHE		{ $$ = sa_strdup(SA, "cache"); }
 | CENTURY	{ $$ = sa_strdup(SA, "century"); }
 | CLIENT	{ $$ = sa_strdup(SA, "client"); }
+| CLUSTERED	{ $$ = sa_strdup(SA, "clustered"); }
 | COMMENT	{ $$ = sa_strdup(SA, "comment"); }
 | DATA		{ $$ = sa_strdup(SA, "data"); }
 | DECADE	{ $$ = sa_strdup(SA, "decade"); }
@@ -7196,6 +7205,7 @@ char *token2string(tokens token)
 	SQL(CAST);
 	SQL(CHARSET);
 	SQL(CHECK);
+	SQL(CLUSTERED);
 	SQL(COALESCE);
 	SQL(COLUMN);
 	SQL(COLUMN_GROUP);
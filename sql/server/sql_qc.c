@@ -15,6 +15,7 @@
 #include "sql_qc.h"
 #include "sql_mvc.h"
 #include "sql_atom.h"
+#include "sql_semantic.h"
 #include "rel_exp.h"
 #include "gdk_time.h"
 
@@ -90,8 +91,15 @@ void
 qc_restart(qc *cache)
 {
 	if (cache) {
-		for (cq *q = cache->q; q; q = q->next)
-			cq_restart(cache->clientid, q);
+		for (cq *q = cache->q, *n; q; q = n) {
+			n = q->next;
+			/* the text of a parameterized query doesn't match its parameters,
+			 * so drop it instead of instantiating it again */
+			if (q->autoparam)
+				qc_delete(cache, q);
+			else
+				cq_restart(cache->clientid, q);
+		}
 	}
 }
 
@@ -128,7 +136,7 @@ qc_find(qc *cache, int id)
 }
 
 cq *
-qc_insert(qc *cache, allocator *sa, sql_rel *r, symbol *s, list *params, mapi_query_t type, char *cmd, int no_mitosis)
+qc_insert(qc *cache, allocator *sa, sql_rel *r, symbol *s, list *params, mapi_query_t type, char *cmd, int no_mitosis, bool autoparam)
 {
 	int namelen;
 	sql_func *f = SA_NEW(sa, sql_func);
@@ -137,7 +145,12 @@ qc_insert(qc *cache, allocator *sa, sql_rel *r, symbol *s, list *params, mapi_qu
 
 	if (!n || !f || !cache)
 		return NULL;
-	n->id = cache->id++;
+	/* the parameterized queries get ids below -1 (which means the query
+	 * itself in EXEC), so the ids of the prepared statements of the user
+	 * are not affected by them */
+	int nr = autoparam ? cache->autoid++ : cache->id;
+	n->id = autoparam ? -2 - nr : cache->id++;
+	n->autoparam = autoparam;
 	cache->nr++;
 
 	n->sa = sa;
@@ -147,13 +160,13 @@ qc_insert(qc *cache, allocator *sa, sql_rel *r, symbol *s, list *params, mapi_qu
 	n->next = cache->q;
 	n->type = type;
 	n->count = 1;
-	namelen = 5 + ((n->id+7)>>3) + ((cache->clientid+7)>>3);
+	namelen = 5 + ((nr+7)>>3) + ((cache->clientid+7)>>3);
 	char *name = sa_alloc(sa, namelen);
 	n->no_mitosis = no_mitosis;
 	n->created = timestamp_current();
 	if (!name)
 		return NULL;
-	(void) snprintf(name, namelen, "p%d_%d", n->id, cache->clientid);
+	(void) snprintf(name, namelen, "%c%d_%d", autoparam ? 'a' : 'p', nr, cache->clientid);
 	n->name = name;
 	cache->q = n;
 
@@ -195,3 +208,210 @@ qc_size(qc *cache)
 {
 	return cache ? cache->nr : 0;
 }
+
+/*
+ * Literal parameterization replaces the constants in a select query by
+ * parameters of the same kind (see qc_param_type), so that queries which
+ * only differ in their constants can share the prepared plan of the first
+ * one.  Only the constants in the projection list, the where and the
+ * having clause are replaced.  The constants in the from clause, the group
+ * by and order by clauses (positional references), the limit, offset and
+ * sample, window definitions and boolean constants determine the shape of
+ * the plan, and therefore remain part of the matched query.
+ */
+static void parameterize_symbol(mvc *sql, symbol **sp, dlist *values, list *slots);
+
+static void
+parameterize_list(mvc *sql, dlist *l, dlist *values, list *slots)
+{
+	if (!l)
+		return;
+	for (dnode *n = l->h; n; n = n->next) {
+		if (n->type == type_symbol)
+			parameterize_symbol(sql, &n->data.sym, values, slots);
+		else if (n->type == type_list)
+			parameterize_list(sql, n->data.lval, values, slots);
+	}
+}
+
+static void
+parameterize_symbol(mvc *sql, symbol **sp, dlist *values, list *slots)
+{
+	symbol *s = *sp;
+
+	if (!s)
+		return;
+	switch (s->token) {
+	case SQL_ATOM: {
+		atom *a = ((AtomNode *) s)->a;
+		int nr = sql->params ? list_length(sql->params) : 0;
+
+		if (!a || a->isnull || !a->tpe.type || a->tpe.type->eclass == EC_BIT || a->tpe.type->localtype == TYPE_void)
+			return;
+		sql_subtype t = a->tpe;
+		qc_param_type(&t);
+		sql_add_param(sql, NULL, &t);
+		*sp = symbol_create_int(sql->sa, SQL_PARAMETER, nr);
+		dlist_append_symbol(sql->sa, values, s);
+		list_append(slots, sp);
+		return;
+	}
+	case SQL_SELECT: {
+		SelectNode *sn = (SelectNode *) s;
+
+		parameterize_list(sql, sn->selection, values, slots);
+		parameterize_symbol(sql, &sn->where, values, slots);
+		parameterize_symbol(sql, &sn->having, values, slots);
+		return;
+	}
+	case SQL_RANK:
+	case SQL_WINDOW:
+		return;
+	default:
+		break;
+	}
+	if (s->type == type_list)
+		parameterize_list(sql, s->data.lval, values, slots);
+	else if (s->type == type_symbol)
+		parameterize_symbol(sql, &s->data.sym, values, slots);
+}
+
+/* Replace the constants of query s by parameters, which are added to
+ * sql->params.  Returns the replaced constants, or NULL if there were none.
+ * The replaced positions are kept in *slots for qc_unparameterize. */
+dlist *
+qc_parameterize(mvc *sql, symbol *s, list **slots)
+{
+	dlist *values = dlist_create(sql->sa);
+
+	*slots = sa_list(sql->sa);
+	if (!values || !*slots)
+		return NULL;
+	parameterize_symbol(sql, &s, values, *slots);
+	if (dlist_length(values) == 0)
+		return NULL;
+	return values;
+}
+
+/* put the constants back, eg when the parameterized query didn't compile */
+void
+qc_unparameterize(mvc *sql, list *slots, dlist *values)
+{
+	dnode *d = values->h;
+
+	for (node *n = slots->h; n && d; n = n->next, d = d->next) {
+		symbol **sp = n->data;
+		*sp = d->data.sym;
+	}
+	sql->params = NULL;
+}
+
+/* Can a literal of type v be passed for a parameter of type t? */
+static bool
+param_fits(sql_subtype *t, sql_subtype *v)
+{
+	sql_class c = t->type->eclass;
+
+	if (EC_VARCHAR(c))
+		return EC_VARCHAR(v->type->eclass) && (t->digits == 0 || v->digits <= t->digits);
+	if (c != v->type->eclass)
+		return false;
+	if (c == EC_NUM || c == EC_POS || c == EC_FLT)
+		return v->type->digits <= t->type->digits;
+	if (c == EC_DEC)
+		return v->digits - v->scale <= t->digits - t->scale;
+	return v->type == t->type && v->digits <= t->digits && v->scale <= t->scale;
+}
+
+/* Decimals of another scale are another class, since the scale of the
+ * parameter shows in the results. */
+static bool
+param_class(sql_subtype *t, sql_subtype *v)
+{
+	if (t->type->eclass == EC_DEC)
+		return v->type->eclass == EC_DEC && v->scale == t->scale;
+	return t->type->eclass == v->type->eclass ||
+		(EC_VARCHAR(t->type->eclass) && EC_VARCHAR(v->type->eclass));
+}
+
+/* The parameter type for a literal.  Numbers get the full precision of
+ * their type and strings an unbounded length, so that the literals of the
+ * same kind in the following queries fit in the parameter. */
+void
+qc_param_type(sql_subtype *t)
+{
+	sql_class c = t->type->eclass;
+
+	if (EC_VARCHAR(c))
+		sql_find_subtype(t, "varchar", 0, 0);
+	else if (c == EC_NUM || c == EC_POS || c == EC_FLT)
+		t->digits = t->type->digits;
+}
+
+/*
+ * Find the parameterized query with the same structure and parameters of
+ * the same type classes, that the new literals fit in.  If the structure
+ * and the classes match, but a literal doesn't fit, the parameters are
+ * widened to the super types of both and the old query is dropped, so
+ * that the caller prepares the query for the wider types instead.
+ */
+cq *
+qc_match(qc *cache, mvc *sql, symbol *s, list *params)
+{
+	if (!cache)
+		return NULL;
+	for (cq *q = cache->q; q; q = q->next) {
+		if (!q->autoparam || !q->f->instantiated ||
+			list_length(q->f->ops) != list_length(params) ||
+			symbol_cmp(sql, q->s, s) != 0)
+			continue;
+		node *n, *m;
+		bool fits = true;
+		for (n = q->f->ops->h, m = params->h; n && m; n = n->next, m = m->next) {
+			sql_arg *a = n->data, *b = m->data;
+			if (!param_class(&a->type, &b->type))
+				break;
+			fits &= param_fits(&a->type, &b->type);
+		}
+		if (n != NULL)
+			continue;
+		if (fits) {
+			q->count++;
+			return q;
+		}
+		for (n = q->f->ops->h, m = params->h; n && m; n = n->next, m = m->next) {
+			sql_arg *a = n->data, *b = m->data;
+			sql_subtype super;
+
+			if (!param_fits(&a->type, &b->type) && supertype(&super, &a->type, &b->type)) {
+				qc_param_type(&super);
+				b->type = super;
+			} else
+				b->type = a->type;
+		}
+		qc_delete(cache, q);
+		return NULL;
+	}
+	return NULL;
+}
+
+/* make room for a new parameterized query, keeping at most DEFAULT_CACHESIZE
+ * of them, by dropping the least used one */
+void
+qc_trim(qc *cache)
+{
+	int nr = 0;
+	cq *victim = NULL;
+
+	if (!cache)
+		return;
+	for (cq *q = cache->q; q; q = q->next) {
+		if (q->autoparam) {
+			nr++;
+			if (!victim || q->count <= victim->count)
+				victim = q;
+		}
+	}
+	if (nr >= DEFAULT_CACHESIZE)
+		qc_delete(cache, victim);
+}
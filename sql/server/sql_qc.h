@@ -32,12 +32,14 @@ typedef struct cq {
 	int no_mitosis;		/* run query without mitosis */
 	int count;			/* number of times the query is matched */
 	timestamp created;	/* when the query was created */
+	bool autoparam;		/* created by literal parameterization */
 	sql_func *f;
 } cq;
 
 typedef struct qc {
 	int clientid;
 	int id;
+	int autoid;			/* for the parameterized queries */
 	int nr;
 	cq *q;
 } qc;
@@ -47,8 +49,13 @@ extern void qc_clean(qc *cache);
 extern void qc_restart(qc *cache);
 extern void qc_destroy(qc *cache);
 sql_export cq *qc_find(qc *cache, int id);
-sql_export cq *qc_insert(qc *cache, allocator *sa, sql_rel *r, symbol *s, list *params, mapi_query_t type, char *codedstr, int no_mitosis);
+sql_export cq *qc_insert(qc *cache, allocator *sa, sql_rel *r, symbol *s, list *params, mapi_query_t type, char *codedstr, int no_mitosis, bool autoparam);
 sql_export void qc_delete(qc *cache, cq *q);
 extern int qc_size(qc *cache);
+extern dlist *qc_parameterize(mvc *sql, symbol *s, list **slots);
+extern void qc_unparameterize(mvc *sql, list *slots, dlist *values);
+extern void qc_param_type(sql_subtype *t);
+extern cq *qc_match(qc *cache, mvc *sql, symbol *s, list *params);
+extern void qc_trim(qc *cache);
 
 #endif /*_SQL_QC_H_*/
@@ -236,6 +236,7 @@ scanner_init_keywords(void)
 	failed += keywords_insert("HAVING", HAVING);
 	failed += keywords_insert("ILIKE", ILIKE);
 	failed += keywords_insert("IMPRINTS", IMPRINTS);
+	failed += keywords_insert("CLUSTERED", CLUSTERED);
 	failed += keywords_insert("IN", sqlIN);
 	failed += keywords_insert("INNER", INNER);
 	failed += keywords_insert("INTO", INTO);
@@ -33,6 +33,7 @@ typedef enum tokens {
 	SQL_CAST,
 	SQL_CHARSET,
 	SQL_CHECK,
+	SQL_CLUSTERED,
 	SQL_COALESCE,
 	SQL_COLUMN,
 	SQL_COLUMN_GROUP,
@@ -22,6 +22,21 @@
 #define NOT_TO_BE_LOGGED(t) (isUnloggedTable(t) || isTempTable(t))
 
 static int log_update_col( sql_trans *tr, sql_change *c);
+
+static bat_changed_fptr bat_changed = NULL;
+
+void
+store_bat_changed_callback(bat_changed_fptr f)
+{
+	bat_changed = f;
+}
+
+static inline void
+column_changed(bat bid)
+{
+	if (bat_changed)
+		bat_changed(bid);
+}
 static int log_update_idx( sql_trans *tr, sql_change *c);
 static int log_update_del( sql_trans *tr, sql_change *c);
 static int commit_update_col( sql_trans *tr, sql_change *c, ulng commit_ts, ulng oldest);
@@ -418,8 +433,11 @@ merge_segments(storage *s, sql_trans *tr, sql_change *change, ulng commit_ts, ul
 	segment *cur = s->segs->h, *seg = NULL;
 	for (; cur; cur = ATOMIC_PTR_GET(&cur->next)) {
 		if (cur->ts == tr->tid) {
-			if (!cur->deleted)
+			if (!cur->deleted) {
 				cur->oldts = 0;
+				if (!tr->parent)
+					s->segs->nr_appended += cur->end - cur->start;
+			}
 			cur->ts = commit_ts;
 		}
 		if (!seg) {
@@ -513,6 +531,7 @@ new_segments(sql_trans *tr, size_t cnt)
 
 	if (n) {
 		n->nr_reused = 0;
+		n->nr_appended = 0;
 		n->h = n->t = new_segment(NULL, tr, cnt);
 		if (!n->h) {
 			GDKfree(n);
@@ -1946,8 +1965,10 @@ destroy_delta(sql_delta *b, bool recursive)
 		temp_destroy(b->cs.uibid);
 	if (b->cs.uvbid)
 		temp_destroy(b->cs.uvbid);
-	if (b->cs.bid)
+	if (b->cs.bid) {
+		column_changed(b->cs.bid);
 		temp_destroy(b->cs.bid);
+	}
 	if (b->cs.ebid)
 		temp_destroy(b->cs.ebid);
 	b->cs.bid = b->cs.ebid = b->cs.uibid = b->cs.uvbid = 0;
@@ -2825,6 +2846,8 @@ count_del(sql_trans *tr, sql_table *t, int access)
 		return count_inserts(d->segs->h, tr);
 	if (access == 10) /* special case for counting the number of segments */
 		return count_segs(d->segs->h);
+	if (access == 11) /* special case for counting the committed appends */
+		return d->segs->nr_appended;
 	return count_deletes(d->segs->h, tr);
 }
 
@@ -4116,6 +4139,7 @@ merge_cs( column_storage *cs, const char* caller)
 
 		/* any updates */
 		assert(!isEbat(cur));
+		column_changed(cs->bid);
 		if (BATreplace(cur, ui, uv, true) != GDK_SUCCEED) {
 			bat_destroy(ui);
 			bat_destroy(uv);
@@ -4254,6 +4278,9 @@ commit_update_delta( sql_trans *tr, sql_change *change, sql_table* t, sql_base*
 
 	if (commit_ts)
 		delta->cs.ts = commit_ts;
+	/* the column may have been changed in place */
+	if (!tr->parent)
+		column_changed(delta->cs.bid);
 	if (!commit_ts) { /* rollback */
 		sql_delta *d = change->data, *o = ATOMIC_PTR_GET(data);
 
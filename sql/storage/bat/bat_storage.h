@@ -51,6 +51,7 @@ typedef struct segment {
 typedef struct segments {
 	sql_ref r;
 	ulng nr_reused;
+	ulng nr_appended;	/* rows appended by committed transactions */
 	struct segment *h;
 	struct segment *t;
 } segments;
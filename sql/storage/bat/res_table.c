@@ -102,10 +102,51 @@ res_col_create(sql_trans *tr, res_table *t, const char *tn, const char *name, co
 	return c;
 }
 
+/* A column that consists of the partitions of a mitosis plan, which are
+ * exported one after the other instead of being packed into one BAT. */
+res_col *
+res_col_create_parts(sql_trans *tr, res_table *t, const char *tn, const char *name, const char *typename, int digits, int scale, BAT **parts, int nr_parts)
+{
+	res_col *c = t->cols + t->cur_col;
+
+	if (!sql_find_subtype(&c->type, typename, digits, scale))
+		sql_init_subtype(&c->type, sql_trans_bind_type(tr, NULL, typename), digits, scale);
+	c->tn = _STRDUP(tn);
+	c->name = _STRDUP(name);
+	c->parts = NEW_ARRAY(bat, nr_parts);
+	if (c->tn == NULL || c->name == NULL || c->parts == NULL) {
+		_DELETE(c->tn);
+		_DELETE(c->name);
+		_DELETE(c->parts);
+		return NULL;
+	}
+	c->b = 0;
+	c->p = NULL;
+	c->mtype = parts[0]->ttype;
+	c->cached = false;
+	if (t->cur_col == 0) {
+		t->nr_rows = 0;
+		for (int i = 0; i < nr_parts; i++)
+			t->nr_rows += BATcount(parts[i]);
+	}
+	for (int i = 0; i < nr_parts; i++) {
+		c->parts[i] = parts[i]->batCacheid;
+		bat_incref(c->parts[i]);
+	}
+	c->nr_parts = nr_parts;
+	t->cur_col++;
+	assert(t->cur_col <= t->nr_cols);
+	return c;
+}
+
 static void
 res_col_destroy(res_col *c)
 {
-	if (c->b && !c->cached) {
+	if (c->nr_parts) {
+		for (int i = 0; i < c->nr_parts; i++)
+			bat_decref(c->parts[i]);
+		_DELETE(c->parts);
+	} else if (c->b && !c->cached) {
 		bat_decref(c->b);
 	} else if (c->b) {
 		bat_destroy((BAT*)c->p);
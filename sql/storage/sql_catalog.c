@@ -182,6 +182,19 @@ find_sql_idx(sql_table *t, const char *iname)
 	return NULL;
 }
 
+sql_idx *
+find_clustered_idx(sql_table *t)
+{
+	if (t->idxs)
+		for (node *n = ol_first_node(t->idxs); n; n = n->next) {
+			sql_idx *i = n->data;
+
+			if (i->type == clustered_idx)
+				return i;
+		}
+	return NULL;
+}
+
 sql_idx *
 sql_trans_find_idx(sql_trans *tr, sqlid id)
 {
@@ -337,6 +337,7 @@ typedef struct logger_functions {
 
 extern res_table *res_table_create(sql_trans *tr, int res_id, oid query_id, int nr_cols, mapi_query_t querytype, res_table *next);
 extern res_col *res_col_create(sql_trans *tr, res_table *t, const char *tn, const char *name, const char *typename, int digits, int scale, bool isbat, char mtype, void *v, bool cache);
+extern res_col *res_col_create_parts(sql_trans *tr, res_table *t, const char *tn, const char *name, const char *typename, int digits, int scale, BAT **parts, int nr_parts);
 
 extern void res_table_destroy(res_table *t);
 
@@ -345,6 +346,9 @@ sql_export void res_tables_destroy(res_table *results);
 extern res_table *res_tables_find(res_table *results, int res_id);
 
 extern struct sqlstore *store_init(int debug, store_type store, int readonly, int singleuser);
+/* called for the BAT of a persistent column that is changed in place or destroyed */
+typedef void (*bat_changed_fptr)(bat bid);
+extern void store_bat_changed_callback(bat_changed_fptr f);
 extern void store_exit(struct sqlstore *store);
 
 extern void store_suspend_log(struct sqlstore *store);
@@ -419,6 +423,10 @@ extern int sql_trans_is_duplicate_eliminated(sql_trans *tr, sql_column *col);
 extern int sql_trans_col_stats(sql_trans *tr, sql_column *col, bool *nonil, bool *unique, double *unique_est, ValPtr min, ValPtr max);
 extern size_t sql_trans_dist_count(sql_trans *tr, sql_column *col);
 extern int sql_trans_ranges(sql_trans *tr, sql_column *col, void **min, void **max);
+extern int sql_trans_analyze_histogram(sql_trans *tr, sql_column *col, BAT *b);
+extern void sql_trans_append_histogram(sql_trans *tr, sql_column *col, BAT *ins);
+extern dbl sql_trans_hist_equal(sql_trans *tr, sql_column *col, const ValRecord *v);
+extern dbl sql_trans_hist_range(sql_trans *tr, sql_column *col, const ValRecord *lo, bool loincl, const ValRecord *hi, bool hiincl);
 
 extern void column_destroy(struct sqlstore *store, sql_column *c);
 extern void idx_destroy(struct sqlstore *store, sql_idx * i);
@@ -501,6 +509,7 @@ typedef struct sqlstore {
 	ATOMIC_TYPE transaction;/* transaction id counter */
 	ATOMIC_TYPE function_counter;/* function counter used during function instantiation */
 	ATOMIC_TYPE oldest;
+	ATOMIC_TYPE checkpoints;	/* number of checkpoints applied by the store manager */
 	ulng oldest_pending;
 	bool readonly;			/* store is readonly */
 	int8_t singleuser;		/* store is for a single user only (==1 enable, ==2 single user session running) */
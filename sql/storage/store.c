@@ -15,6 +15,8 @@
 #include "sql_storage.h"
 #include "store_dependency.h"
 #include "store_sequence.h"
+#include "store_histogram.h"
+#include "store_cluster.h"
 #include "mutils.h"
 
 #include "bat/bat_utils.h"
@@ -212,6 +214,7 @@ column_destroy(sqlstore *store, sql_column *c)
 	ATOMIC_PTR_DESTROY(&c->data);
 	_DELETE(c->min);
 	_DELETE(c->max);
+	histogram_destroy(c->hist);
 	_DELETE(c->def);
 	_DELETE(c->storage_type);
 	_DELETE(c->base.name);
@@ -2230,6 +2233,7 @@ store_init(int debug, store_type store_tpe, int readonly, int singleuser)
 		.lastactive = ATOMIC_VAR_INIT(0),
 		.function_counter = ATOMIC_VAR_INIT(0),
 		.oldest = ATOMIC_VAR_INIT(0),
+		.checkpoints = ATOMIC_VAR_INIT(0),
 		.sa = pa,
 	};
 
@@ -2447,6 +2451,7 @@ void
 store_manager(sqlstore *store)
 {
 	MT_thread_setworking("sleeping");
+	store_cluster_start(store);
 
 	// In the main loop we always hold the lock except when sleeping or doing cleanups
 	MT_lock_set(&store->flush);
@@ -2500,6 +2505,7 @@ store_manager(sqlstore *store)
 			if (!GDKexiting())
 				GDKfatal("write-ahead logging failure");
 		}
+		ATOMIC_INC(&store->checkpoints);
 
 		if (GDKexiting())
 			break;
@@ -2509,6 +2515,7 @@ store_manager(sqlstore *store)
 
 	// End of loop, end of lock
 	MT_lock_unset(&store->flush);
+	store_cluster_stop(store);
 }
 
 void
@@ -4622,6 +4629,8 @@ sys_drop_column(sql_trans *tr, sql_column *col, int drop_action)
 		return res;
 	if ((res = sql_trans_drop_any_comment(tr, col->base.id)))
 		return res;
+	if ((res = sql_trans_drop_histogram(tr, col)))
+		return res;
 	if ((res = sql_trans_drop_obj_priv(tr, col->base.id)))
 		return res;
 	if ((res = sys_drop_default_object(tr, col, drop_action)))
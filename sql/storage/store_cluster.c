@@ -0,0 +1,470 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+/*
+ * Clustered tables.
+ *
+ * A table created with CLUSTERED BY (or ORDER BY) has a clustered_idx
+ * naming its sort key.  The index has no storage: appends land in
+ * insertion order behind the part of the table that is already in key
+ * order.  After the store manager applied a checkpoint, a background
+ * task merges this unsorted tail into the sorted main part of each
+ * clustered table that grew, and rewrites the table in a transaction of
+ * its own.  The rewritten columns are physically sorted, so the kernel
+ * sees the leading key column as tsorted again and selections and joins
+ * on it can use binary search and merge joins.
+ *
+ * The main part is the longest prefix of the live rows that is in key
+ * order, so nothing needs to be remembered over a restart.  Only the
+ * number of committed appends of each table at its last reorganization
+ * is kept in memory, to skip the tables that did not grow.
+ *
+ * The whole table is rewritten, also the part before the first row out
+ * of order: the kernel only knows a column is sorted when it was written
+ * in order, and leaving that part in place would leave the deleted rows
+ * of the tail in between.  To bound the cost, a table is only reorganized
+ * once its tail is at least 1/CLUSTER_RATIO of the main part, so that an
+ * appended row accounts for at most CLUSTER_RATIO + 1 rewritten rows.
+ * Smaller tails wait for more appends.  Updates of the key columns are
+ * put in order by the next reorganization after an append.  Tables
+ * whose keys are referenced by foreign keys are left alone, as the join
+ * indices of the referencing tables point at row positions.
+ */
+#include "monetdb_config.h"
+#include "store_cluster.h"
+
+typedef struct cluster_seen {
+	sqlid id;
+	BUN appended;		/* committed appends once the table was in order */
+} cluster_seen;
+
+typedef struct cluster_state {
+	sqlstore *store;
+	ATOMIC_BASE_TYPE checkpoint;	/* last checkpoint handled */
+	int nseen;
+	cluster_seen *seen;
+} cluster_state;
+
+#define cluster_table_ok(t) \
+	(isTable(t) && isGlobal(t) && !isTempTable(t) && !(t)->system)
+
+static bool
+cluster_keys_ok(sql_trans *tr, sql_table *t)
+{
+	for (node *n = ol_first_node(t->columns); n; n = n->next) {
+		sql_column *c = n->data;
+
+		if (c->storage_type)	/* compressed columns are read only */
+			return false;
+	}
+	if (t->keys)
+		for (node *n = ol_first_node(t->keys); n; n = n->next) {
+			sql_key *k = n->data;
+
+			if (sql_trans_get_dependency_type(tr, k->base.id, FKEY_DEPENDENCY) > 0)
+				return false;
+		}
+	return true;
+}
+
+static BAT *
+cluster_values(BAT *b, BAT *ui, BAT *uv, BAT *cands)
+{
+	BAT *bn, *r;
+
+	if (BATcount(ui) == 0)
+		return BATproject(cands, b);
+	if ((bn = COLcopy(b, b->ttype, true, TRANSIENT)) == NULL)
+		return NULL;
+	if (BATreplace(bn, ui, uv, true) != GDK_SUCCEED) {
+		BBPreclaim(bn);
+		return NULL;
+	}
+	r = BATproject(cands, bn);
+	BBPreclaim(bn);
+	return r;
+}
+
+/* the live values of a column, with the committed updates applied */
+static BAT *
+cluster_col(sql_trans *tr, sql_column *c, BAT *cands)
+{
+	sqlstore *store = tr->store;
+	BAT *b, *ui = NULL, *uv = NULL, *bn = NULL;
+
+	if ((b = store->storage_api.bind_col(tr, c, RDONLY)) == NULL)
+		return NULL;
+	if (store->storage_api.bind_updates(tr, c, &ui, &uv) == LOG_OK) {
+		bn = cluster_values(b, ui, uv, cands);
+		BBPreclaim(ui);
+		BBPreclaim(uv);
+	}
+	BBPreclaim(b);
+	return bn;
+}
+
+static BAT *
+cluster_idx(sql_trans *tr, sql_idx *i, BAT *cands)
+{
+	sqlstore *store = tr->store;
+	BAT *b, *ui = NULL, *uv = NULL, *bn = NULL;
+
+	if ((b = store->storage_api.bind_idx(tr, i, RDONLY)) == NULL)
+		return NULL;
+	if (store->storage_api.bind_updates_idx(tr, i, &ui, &uv) == LOG_OK) {
+		bn = cluster_values(b, ui, uv, cands);
+		BBPreclaim(ui);
+		BBPreclaim(uv);
+	}
+	BBPreclaim(b);
+	return bn;
+}
+
+#define idx_has_storage(i) \
+	(idx_has_column((i)->type) && !(hash_index((i)->type) && list_length((i)->columns) <= 1))
+
+static int
+cluster_cmp(BATiter *ki, int nkeys, BUN p, BUN q)
+{
+	for (int k = 0; k < nkeys; k++) {
+		int tpe = ATOMtype(ki[k].type);
+		int c = ATOMcmp(tpe, BUNtail(ki[k], p), BUNtail(ki[k], q));
+
+		if (c)
+			return c;
+	}
+	return 0;
+}
+
+/* The order of the rows: the sorted main part [0,m) merged with the
+ * tail [m,n) sorted on the key columns, the most significant first. */
+static BAT *
+cluster_merge(BAT **keys, BATiter *ki, int nkeys, BUN m, BUN n)
+{
+	BAT *o = NULL, *g = NULL, *perm;
+
+	for (int k = 0; k < nkeys; k++) {
+		BAT *s = BATslice(keys[k], m, n), *no = NULL, *ng = NULL;
+		gdk_return rc = GDK_FAIL;
+
+		if (s)
+			rc = BATsort(NULL, &no, k < nkeys - 1 ? &ng : NULL, s, o, g, false, false, true);
+		BBPreclaim(s);
+		BBPreclaim(o);
+		BBPreclaim(g);
+		o = no;
+		g = ng;
+		if (rc != GDK_SUCCEED) {
+			BBPreclaim(o);
+			BBPreclaim(g);
+			return NULL;
+		}
+	}
+	assert(g == NULL);
+	if ((perm = COLnew(0, TYPE_oid, n, TRANSIENT)) == NULL) {
+		BBPreclaim(o);
+		return NULL;
+	}
+
+	oid *restrict dst = Tloc(perm, 0);
+	BUN i = 0, j = 0, nt = n - m, p = 0;
+
+	while (i < m && j < nt) {
+		oid t = BUNtoid(o, j);
+
+		if (cluster_cmp(ki, nkeys, i, t) <= 0) {
+			dst[p++] = i++;
+		} else {
+			dst[p++] = t;
+			j++;
+		}
+	}
+	while (i < m)
+		dst[p++] = i++;
+	while (j < nt)
+		dst[p++] = BUNtoid(o, j++);
+	BBPreclaim(o);
+	BATsetcount(perm, n);
+	perm->tsorted = perm->trevsorted = false;
+	perm->tkey = true;
+	perm->tnil = false;
+	perm->tnonil = true;
+	return perm;
+}
+
+/* Replace the rows of t by their values in the order of perm. */
+static int
+cluster_rewrite(sql_trans *tr, sql_table *t, BAT *cands, BAT *perm)
+{
+	sqlstore *store = tr->store;
+	sql_kc *lead = find_clustered_idx(t)->columns->h->data;
+	int ncols = ol_length(t->columns), nidxs = t->idxs ? ol_length(t->idxs) : 0, k = 0, res = LOG_ERR;
+	BAT **vals = GDKzalloc(sizeof(BAT *) * (ncols + nidxs)), *offsets = NULL;
+	BUN n = BATcount(perm), offset = 0, cleared;
+
+	if (vals == NULL)
+		return LOG_ERR;
+	/* put everything in order before the table is cleared */
+	for (node *nd = ol_first_node(t->columns); nd; nd = nd->next, k++) {
+		BAT *b = cluster_col(tr, nd->data, cands);
+
+		if (b == NULL)
+			goto bailout;
+		vals[k] = BATproject(perm, b);
+		BBPreclaim(b);
+		if (vals[k] == NULL)
+			goto bailout;
+		/* the projection doesn't know, but the appended column keeps it */
+		if (nd->data == lead->c)
+			(void) BATordered(vals[k]);
+	}
+	if (t->idxs)
+		for (node *nd = ol_first_node(t->idxs); nd; nd = nd->next, k++) {
+			sql_idx *i = nd->data;
+			BAT *b;
+
+			if (!idx_has_storage(i))
+				continue;
+			if ((b = cluster_idx(tr, i, cands)) == NULL)
+				goto bailout;
+			vals[k] = BATproject(perm, b);
+			BBPreclaim(b);
+			if (vals[k] == NULL)
+				goto bailout;
+		}
+
+	if ((cleared = store->storage_api.clear_table(tr, t)) >= BUN_NONE - 1) {
+		res = cleared == BUN_NONE - 1 ? LOG_CONFLICT : LOG_ERR;
+		goto bailout;
+	}
+	if ((res = store->storage_api.claim_tab(tr, t, n, &offset, &offsets)) != LOG_OK)
+		goto bailout;
+	k = 0;
+	for (node *nd = ol_first_node(t->columns); nd; nd = nd->next, k++)
+		if ((res = store->storage_api.append_col(tr, nd->data, offset, offsets, vals[k], n, true, vals[k]->ttype)) != LOG_OK)
+			goto bailout;
+	if (t->idxs)
+		for (node *nd = ol_first_node(t->idxs); nd; nd = nd->next, k++)
+			if (vals[k] && (res = store->storage_api.append_idx(tr, nd->data, offset, offsets, vals[k], n, true, vals[k]->ttype)) != LOG_OK)
+				goto bailout;
+
+  bailout:
+	BBPreclaim(offsets);
+	for (k = 0; k < ncols + nidxs; k++)
+		BBPreclaim(vals[k]);
+	GDKfree(vals);
+	return res;
+}
+
+/* Merge the unsorted tail of clustered table t into its sorted main part.
+ * When the table is rewritten, *appended is set to the number of committed
+ * appends it will have: the rewrite clears the table, so its rows are the
+ * only appends of the new storage.  Returns LOG_OK, LOG_ERR or
+ * LOG_CONFLICT. */
+int
+sql_trans_cluster_table(sql_trans *tr, sql_table *t, BUN *appended)
+{
+	sqlstore *store = tr->store;
+	sql_idx *ci = find_clustered_idx(t);
+	BAT *cands, **keys = NULL, *perm = NULL;
+	BATiter *ki = NULL;
+	int nkeys = 0, k = 0, res = LOG_ERR;
+	BUN n, m;
+
+	if (!ci || !cluster_table_ok(t) || !cluster_keys_ok(tr, t))
+		return LOG_OK;
+	if ((cands = store->storage_api.bind_cands(tr, t, 1, 0)) == NULL)
+		return LOG_ERR;
+	n = BATcount(cands);
+	nkeys = list_length(ci->columns);
+	if ((keys = GDKzalloc(sizeof(BAT *) * nkeys)) == NULL ||
+		(ki = GDKmalloc(sizeof(BATiter) * nkeys)) == NULL)
+		goto bailout;
+	for (node *nd = ci->columns->h; nd; nd = nd->next, k++) {
+		sql_kc *kc = nd->data;
+
+		if ((keys[k] = cluster_col(tr, kc->c, cands)) == NULL)
+			goto bailout;
+		ki[k] = bat_iterator(keys[k]);
+	}
+
+	/* the main part is the sorted prefix left by the previous reorganization */
+	for (m = 1; m < n && cluster_cmp(ki, nkeys, m - 1, m) <= 0; m++)
+		;
+	if (m >= n || (n - m) * CLUSTER_RATIO < m) {
+		res = LOG_OK;
+		goto bailout;
+	}
+	if ((perm = cluster_merge(keys, ki, nkeys, m, n)) == NULL)
+		goto bailout;
+	TRC_DEBUG(SQL_STORE, "Clustering %s.%s: " BUNFMT " rows, " BUNFMT " in order\n", t->s->base.name, t->base.name, n, m);
+	if ((res = cluster_rewrite(tr, t, cands, perm)) == LOG_OK && appended)
+		*appended = n;
+
+  bailout:
+	while (k > 0) {
+		k--;
+		bat_iterator_end(&ki[k]);
+		BBPreclaim(keys[k]);
+	}
+	GDKfree(ki);
+	GDKfree(keys);
+	BBPreclaim(perm);
+	BBPreclaim(cands);
+	return res;
+}
+
+static BUN
+cluster_seen_appended(cluster_state *cs, sqlid id)
+{
+	for (int i = 0; i < cs->nseen; i++)
+		if (cs->seen[i].id == id)
+			return cs->seen[i].appended;
+	return BUN_NONE;
+}
+
+/* Reorganize the clustered tables that grew since they were last in
+ * order.  Each table is done in its own transaction; on a conflict the
+ * table is tried again after the next checkpoint. */
+static gdk_return
+cluster_pass(cluster_state *cs)
+{
+	sqlstore *store = cs->store;
+	allocator *sa = NULL;
+	sql_session *session = NULL;
+	cluster_seen *seen = NULL;
+	BUN *grown = NULL;
+	int nseen = 0, maxseen = 0;
+	gdk_return ret = GDK_FAIL;
+
+	if ((sa = sa_create(NULL)) == NULL)
+		return GDK_FAIL;
+	if ((session = sql_session_create(store, sa, 0)) == NULL)
+		goto bailout;
+	if (sql_trans_begin(session) < 0)
+		goto bailout;
+
+	sql_trans *tr = session->tr;
+	struct os_iter si;
+	os_iterator(&si, tr->cat->schemas, tr, NULL);
+	for (sql_base *b = oi_next(&si); b; b = oi_next(&si)) {
+		sql_schema *s = (sql_schema *) b;
+		struct os_iter ti;
+
+		os_iterator(&ti, s->tables, tr, NULL);
+		for (sql_base *tb = oi_next(&ti); tb; tb = oi_next(&ti)) {
+			sql_table *t = (sql_table *) tb;
+
+			if (!cluster_table_ok(t) || !find_clustered_idx(t))
+				continue;
+			if (nseen == maxseen) {
+				cluster_seen *nsn;
+				BUN *ngr;
+
+				maxseen = maxseen ? maxseen * 2 : 8;
+				if ((nsn = GDKrealloc(seen, sizeof(cluster_seen) * maxseen)) == NULL) {
+					sql_trans_end(session, SQL_ERR);
+					goto bailout;
+				}
+				seen = nsn;
+				if ((ngr = GDKrealloc(grown, sizeof(BUN) * maxseen)) == NULL) {
+					sql_trans_end(session, SQL_ERR);
+					goto bailout;
+				}
+				grown = ngr;
+			}
+			seen[nseen].id = t->base.id;
+			seen[nseen].appended = cluster_seen_appended(cs, t->base.id);
+			grown[nseen] = store->storage_api.count_del(tr, t, 11);
+			nseen++;
+		}
+	}
+	sql_trans_end(session, SQL_OK);
+
+	for (int i = 0; i < nseen && !GDKexiting(); i++) {
+		BUN appended = grown[i];
+		int res;
+
+		if (seen[i].appended == grown[i])
+			continue;
+		if (sql_trans_begin(session) < 0)
+			break;
+		sql_table *t = sql_trans_find_table(session->tr, seen[i].id);
+		res = t ? sql_trans_cluster_table(session->tr, t, &appended) : LOG_OK;
+		if (res == LOG_OK) {
+			if (sql_trans_end(session, SQL_OK) == SQL_OK)
+				seen[i].appended = appended;
+		} else {
+			sql_trans_end(session, SQL_ERR);
+			if (res == LOG_ERR)
+				TRC_ERROR(SQL_STORE, "Failed to cluster table %d: %s\n", seen[i].id, GDKerrbuf);
+			GDKclrerr();
+		}
+	}
+	GDKfree(cs->seen);
+	cs->seen = seen;
+	cs->nseen = nseen;
+	seen = NULL;
+	ret = GDK_SUCCEED;
+
+  bailout:
+	GDKfree(seen);
+	GDKfree(grown);
+	if (session)
+		sql_session_destroy(session);
+	sa_destroy(sa);
+	return ret;
+}
+
+static gdk_return
+cluster_callback(int argc, void *argv[])
+{
+	cluster_state *cs = argv[0];
+	ATOMIC_BASE_TYPE checkpoint = ATOMIC_GET(&cs->store->checkpoints);
+
+	(void) argc;
+	if (checkpoint == cs->checkpoint || GDKexiting())
+		return GDK_SUCCEED;
+	cs->checkpoint = checkpoint;
+	return cluster_pass(cs);
+}
+
+static gdk_return
+cluster_callback_args_free(int argc, void *argv[])
+{
+	cluster_state *cs = argv[0];
+
+	(void) argc;
+	GDKfree(cs->seen);
+	GDKfree(cs);
+	return GDK_SUCCEED;
+}
+
+void
+store_cluster_start(sqlstore *store)
+{
+	cluster_state *cs;
+
+	if (store->readonly || (cs = GDKzalloc(sizeof(cluster_state))) == NULL)
+		return;
+	cs->store = store;
+	void *argv[1] = {cs};
+	if (gdk_add_callback("clustered_tables", cluster_callback, 1, argv, CLUSTER_INTERVAL) != GDK_SUCCEED)
+		GDKfree(cs);
+}
+
+void
+store_cluster_stop(sqlstore *store)
+{
+	(void) store;
+	(void) gdk_remove_callback("clustered_tables", cluster_callback_args_free);
+}
@@ -0,0 +1,25 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+#ifndef STORE_CLUSTER_H
+#define STORE_CLUSTER_H
+
+#include "sql_storage.h"
+
+#define CLUSTER_INTERVAL 1		/* seconds between checks for a new checkpoint */
+#define CLUSTER_RATIO 8			/* sorted part per row of the tail that is worth a rewrite */
+
+extern int sql_trans_cluster_table(sql_trans *tr, sql_table *t, BUN *appended);
+extern void store_cluster_start(sqlstore *store);
+extern void store_cluster_stop(sqlstore *store);
+
+#endif /* STORE_CLUSTER_H */
@@ -0,0 +1,710 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+/*
+ * Value distributions of columns, collected by ANALYZE.
+ *
+ * The most common values of a column are kept with the fraction of the
+ * rows they occupy.  The other values are summarized by an equi-depth
+ * histogram: the bucket bounds with the cumulative fraction of these
+ * other values up to and including each bound.  Large columns are
+ * sampled.  The distributions are stored in sys.column_histograms and
+ * loaded into the sql_column on first use by the optimizers, under the
+ * column lock.  Large appends merge a sample of the new rows into the
+ * loaded distribution; the stored one is only replaced by the next
+ * ANALYZE.
+ */
+#include "monetdb_config.h"
+#include "store_histogram.h"
+#include "sql_storage.h"
+#include <math.h>
+
+typedef struct sql_histogram {
+	int tpe;
+	lng rows;			/* rows described, 0 if there is no histogram */
+	dbl nulls;			/* fraction of nil values */
+	int nmcv;			/* most common values, in value order */
+	ValRecord *mcv;
+	dbl *mcvfrac;		/* fraction of all rows */
+	int nbounds;		/* equi-depth bucket bounds */
+	ValRecord *bounds;
+	dbl *boundfrac;		/* cumulative fraction of the other values */
+	dbl *bounddist;		/* distinct values after the previous bound */
+} sql_histogram;
+
+typedef struct histpoint {
+	const void *v;
+	dbl w;				/* number of rows with this value */
+	dbl d;				/* number of distinct values it stands for */
+	bool value;			/* an actual value, not the bound of an older bucket */
+} histpoint;
+
+#define hist_column_ok(c) \
+	(isTable((c)->t) && isGlobal((c)->t) && !isTempTable((c)->t) && !(c)->t->system)
+
+static bool
+hist_type_ok(int tpe)
+{
+	switch (ATOMstorage(tpe)) {
+	case TYPE_bte:
+	case TYPE_sht:
+	case TYPE_int:
+	case TYPE_lng:
+#ifdef HAVE_HGE
+	case TYPE_hge:
+#endif
+	case TYPE_flt:
+	case TYPE_dbl:
+	case TYPE_str:
+		return ATOMlinear(tpe);
+	default:
+		return false;
+	}
+}
+
+static MT_Lock *
+hist_lock(sql_trans *tr, sql_column *c)
+{
+	sqlstore *store = tr->store;
+	return &store->column_locks[c->base.id&(NR_COLUMN_LOCKS-1)];
+}
+
+void
+histogram_destroy(sql_histogram *h)
+{
+	if (!h)
+		return;
+	for (int i = 0; i < h->nmcv; i++)
+		VALclear(&h->mcv[i]);
+	for (int i = 0; i < h->nbounds; i++)
+		VALclear(&h->bounds[i]);
+	GDKfree(h->mcv);
+	GDKfree(h->mcvfrac);
+	GDKfree(h->bounds);
+	GDKfree(h->boundfrac);
+	GDKfree(h->bounddist);
+	GDKfree(h);
+}
+
+static sql_histogram *
+hist_create(int tpe, int nmcv, int nbounds)
+{
+	sql_histogram *h = GDKzalloc(sizeof(sql_histogram));
+
+	if (!h)
+		return NULL;
+	h->tpe = tpe;
+	if ((nmcv && (!(h->mcv = GDKzalloc(nmcv * sizeof(ValRecord))) ||
+				  !(h->mcvfrac = GDKzalloc(nmcv * sizeof(dbl))))) ||
+		(nbounds && (!(h->bounds = GDKzalloc(nbounds * sizeof(ValRecord))) ||
+					 !(h->boundfrac = GDKzalloc(nbounds * sizeof(dbl))) ||
+					 !(h->bounddist = GDKzalloc(nbounds * sizeof(dbl)))))) {
+		histogram_destroy(h);
+		return NULL;
+	}
+	return h;
+}
+
+/* Summarize the weighted values p (in value order, each value once) and
+ * the weight of the nils.  Values with at least minw rows and twice the
+ * average number of rows per distinct value become most common values,
+ * all of them if there are only a few distinct values. */
+static sql_histogram *
+hist_build(int tpe, histpoint *p, BUN n, dbl nulls, dbl minw)
+{
+	dbl total = nulls, dist = 0, hw = 0;
+	BUN nvalues = 0;
+	int nmcv = 0, nb = 0;
+	bool *mcv = NULL;
+	sql_histogram *h;
+
+	for (BUN i = 0; i < n; i++) {
+		total += p[i].w;
+		dist += p[i].d;
+		nvalues += p[i].value;
+	}
+	if (n && !(mcv = GDKzalloc(n * sizeof(bool))))
+		return NULL;
+	if (nvalues == n && n <= HIST_MCV) {
+		for (BUN i = 0; i < n; i++)
+			mcv[i] = true;
+		nmcv = (int) n;
+	} else if (nvalues) {
+		dbl avg = (total - nulls) / dist;
+
+		for (; nmcv < HIST_MCV; nmcv++) {
+			BUN m = BUN_NONE;
+
+			for (BUN i = 0; i < n; i++)
+				if (p[i].value && !mcv[i] && p[i].w >= minw && p[i].w >= 2 * avg &&
+					(m == BUN_NONE || p[i].w > p[m].w))
+					m = i;
+			if (m == BUN_NONE)
+				break;
+			mcv[m] = true;
+		}
+	}
+	for (BUN i = 0; i < n; i++)
+		if (!mcv[i])
+			hw += p[i].w;
+
+	if (!(h = hist_create(tpe, nmcv, hw > 0 ? HIST_BUCKETS + 2 : 0))) {
+		GDKfree(mcv);
+		return NULL;
+	}
+	h->rows = (lng) (total + 0.5);
+	h->nulls = total > 0 ? nulls / total : 0;
+	nmcv = 0;
+	if (hw > 0) {
+		dbl cum = 0, dist = 0, step = hw / HIST_BUCKETS, next = step;
+		BUN last = n;
+
+		while (last > 0 && mcv[last - 1])
+			last--;
+		for (BUN i = 0; i < n; i++) {
+			if (mcv[i])
+				continue;
+			cum += p[i].w;
+			dist += p[i].d;
+			if (nb == 0 || cum >= next * (1 - 1e-9) || i == last - 1) {
+				if (!VALinit(&h->bounds[nb], tpe, p[i].v))
+					goto bailout;
+				h->bounddist[nb] = dist;
+				h->boundfrac[nb++] = i == last - 1 ? 1.0 : cum / hw;
+				dist = 0;
+				while (next <= cum * (1 + 1e-9))
+					next += step;
+			}
+		}
+	}
+	h->nbounds = nb;
+	for (BUN i = 0; i < n; i++) {
+		if (!mcv[i])
+			continue;
+		if (!VALinit(&h->mcv[nmcv], tpe, p[i].v))
+			goto bailout;
+		h->mcvfrac[nmcv++] = p[i].w / total;
+	}
+	h->nmcv = nmcv;
+	GDKfree(mcv);
+	return h;
+  bailout:
+	h->nbounds = nb;
+	h->nmcv = nmcv;
+	histogram_destroy(h);
+	GDKfree(mcv);
+	return NULL;
+}
+
+/* the sorted values of b, sampled if b is large; scale is the number of
+ * rows each value stands for */
+static BAT *
+hist_sample(BAT *b, dbl *scale)
+{
+	BAT *s, *v = b, *r;
+
+	*scale = 1;
+	if (BATcount(b) > HIST_SAMPLE) {
+		if (!(s = BATsample(b, HIST_SAMPLE)))
+			return NULL;
+		v = BATproject(s, b);
+		BBPreclaim(s);
+		if (!v)
+			return NULL;
+		*scale = (dbl) BATcount(b) / BATcount(v);
+	}
+	if (BATsort(&r, NULL, NULL, v, NULL, NULL, false, false, false) != GDK_SUCCEED)
+		r = NULL;
+	if (v != b)
+		BBPreclaim(v);
+	return r;
+}
+
+/* The distinct values of the sorted BAT b, which has to stay alive while
+ * the points are in use.  A value seen once in a sample stands for
+ * sqrt(scale) distinct values of the column (the GEE estimator). */
+static histpoint *
+hist_points(BAT *b, dbl scale, BUN *n, dbl *nulls)
+{
+	BATiter bi = bat_iterator(b);
+	const void *nil = ATOMnilptr(b->ttype);
+	histpoint *p = GDKmalloc(MAX(BATcount(b), 1) * sizeof(histpoint));
+	BUN k = 0;
+
+	*nulls = 0;
+	if (p) {
+		for (BUN i = 0; i < bi.count; i++) {
+			const void *v = BUNtail(bi, i);
+
+			if (ATOMcmp(b->ttype, v, nil) == 0)
+				*nulls += scale;
+			else if (k > 0 && ATOMcmp(b->ttype, v, p[k - 1].v) == 0)
+				p[k - 1].w += scale;
+			else
+				p[k++] = (histpoint) { .v = v, .w = scale, .value = true };
+		}
+		for (BUN i = 0; i < k; i++)
+			p[i].d = p[i].w < 1.5 * scale ? sqrt(scale) : 1;
+	}
+	bat_iterator_end(&bi);
+	*n = k;
+	return p;
+}
+
+/* merge two value ordered point lists, adding up the weights of equal values */
+static histpoint *
+hist_merge(int tpe, histpoint *a, BUN na, histpoint *b, BUN nb, BUN *n)
+{
+	histpoint *p = GDKmalloc(MAX(na + nb, 1) * sizeof(histpoint));
+	BUN i = 0, j = 0, k = 0;
+
+	if (!p)
+		return NULL;
+	while (i < na || j < nb) {
+		int c = i == na ? 1 : j == nb ? -1 : ATOMcmp(tpe, a[i].v, b[j].v);
+
+		if (c < 0) {
+			p[k++] = a[i++];
+		} else if (c > 0) {
+			p[k++] = b[j++];
+		} else {
+			p[k] = a[i++];
+			p[k].w += b[j].w;
+			p[k].d = MAX(p[k].d, b[j].d);
+			p[k++].value |= b[j++].value;
+		}
+	}
+	*n = k;
+	return p;
+}
+
+/* the histogram as weighted points, the rows of a bucket at its upper bound */
+static histpoint *
+hist_as_points(sql_histogram *h, BUN *n)
+{
+	histpoint *m = GDKmalloc(MAX(h->nmcv, 1) * sizeof(histpoint));
+	histpoint *b = GDKmalloc(MAX(h->nbounds, 1) * sizeof(histpoint));
+	histpoint *p = NULL;
+	dbl hw = 1 - h->nulls;
+
+	if (m && b) {
+		for (int i = 0; i < h->nmcv; i++) {
+			m[i] = (histpoint) { .v = VALptr(&h->mcv[i]), .w = h->mcvfrac[i] * h->rows, .d = 1, .value = true };
+			hw -= h->mcvfrac[i];
+		}
+		hw = MAX(hw, 0) * h->rows;
+		for (int i = 0; i < h->nbounds; i++)
+			b[i] = (histpoint) { .v = VALptr(&h->bounds[i]),
+				.w = (h->boundfrac[i] - (i ? h->boundfrac[i - 1] : 0)) * hw, .d = h->bounddist[i] };
+		p = hist_merge(h->tpe, m, h->nmcv, b, h->nbounds, n);
+	}
+	GDKfree(m);
+	GDKfree(b);
+	return p;
+}
+
+static char *
+hist_tostr(int tpe, const ValRecord *v)
+{
+	if (ATOMstorage(tpe) == TYPE_str)
+		return GDKstrdup(v->val.sval);
+	return ATOMformat(tpe, VALptr(v));
+}
+
+static bool
+hist_fromstr(int tpe, const char *s, ValRecord *v)
+{
+	void *p = NULL;
+	size_t len = 0;
+	bool ok;
+
+	if (strNil(s))
+		return false;
+	if (ATOMstorage(tpe) == TYPE_str)
+		return VALinit(v, tpe, s) != NULL;
+	ok = ATOMfromstr(tpe, &p, &len, s, true) > 0 && VALinit(v, tpe, p) != NULL;
+	GDKfree(p);
+	return ok;
+}
+
+int
+sql_trans_drop_histogram(sql_trans *tr, sql_column *c)
+{
+	sqlstore *store = tr->store;
+	sql_table *hists;
+	rids *rs;
+	int res = LOG_OK;
+
+	if (!hist_column_ok(c))
+		return LOG_OK;
+	hists = find_sql_table(tr, find_sql_schema(tr, "sys"), "column_histograms");
+	if (!hists) /* for example during upgrades */
+		return LOG_OK;
+	rs = store->table_api.rids_select(tr, find_sql_column(hists, "column_id"), &c->base.id, &c->base.id, NULL);
+	if (!rs)
+		return LOG_ERR;
+	for (oid rid = store->table_api.rids_next(rs); !is_oid_nil(rid) && res == LOG_OK; rid = store->table_api.rids_next(rs))
+		res = store->table_api.table_delete(tr, hists, rid);
+	store->table_api.rids_destroy(rs);
+	return res;
+}
+
+static int
+hist_store(sql_trans *tr, sql_column *c, sql_histogram *h)
+{
+	sqlstore *store = tr->store;
+	sql_table *hists = find_sql_table(tr, find_sql_schema(tr, "sys"), "column_histograms");
+	int res, nr = 0;
+	dbl one = 1;
+
+	if (!hists)
+		return LOG_OK;
+	if ((res = sql_trans_drop_histogram(tr, c)) != LOG_OK)
+		return res;
+	res = store->table_api.table_insert(tr, hists, &c->base.id, &h->rows, &(const char *){"null"}, &nr, &(const char *){str_nil}, &h->nulls, &dbl_nil);
+	for (int i = 0; i < h->nmcv && res == LOG_OK; i++) {
+		char *s = hist_tostr(h->tpe, &h->mcv[i]);
+
+		if (!s)
+			return LOG_ERR;
+		res = store->table_api.table_insert(tr, hists, &c->base.id, &h->rows, &(const char *){"mcv"}, &i, &s, &h->mcvfrac[i], &one);
+		GDKfree(s);
+	}
+	for (int i = 0; i < h->nbounds && res == LOG_OK; i++) {
+		char *s = hist_tostr(h->tpe, &h->bounds[i]);
+
+		if (!s)
+			return LOG_ERR;
+		res = store->table_api.table_insert(tr, hists, &c->base.id, &h->rows, &(const char *){"bound"}, &i, &s, &h->boundfrac[i], &h->bounddist[i]);
+		GDKfree(s);
+	}
+	return res;
+}
+
+/* the stored histogram of c, or an empty one if there is none */
+static sql_histogram *
+hist_load(sql_trans *tr, sql_column *c)
+{
+	sqlstore *store = tr->store;
+	sql_table *hists = find_sql_table(tr, find_sql_schema(tr, "sys"), "column_histograms");
+	int tpe = c->type.type->localtype;
+	sql_histogram *h;
+	rids *rs;
+
+	if (!hists || !hist_type_ok(tpe))
+		return hist_create(tpe, 0, 0);
+	if (!(h = hist_create(tpe, HIST_MCV, HIST_BUCKETS + 2)))
+		return NULL;
+	rs = store->table_api.rids_select(tr, find_sql_column(hists, "column_id"), &c->base.id, &c->base.id, NULL);
+	if (!rs) {
+		histogram_destroy(h);
+		return NULL;
+	}
+	sql_column *kind_col = find_sql_column(hists, "kind"), *value_col = find_sql_column(hists, "value");
+	sql_column *nr_col = find_sql_column(hists, "nr"), *fraction_col = find_sql_column(hists, "fraction");
+	sql_column *distinct_col = find_sql_column(hists, "distinct");
+	lng rows = 0;
+	bool ok = true;
+	for (oid rid = store->table_api.rids_next(rs); !is_oid_nil(rid) && ok; rid = store->table_api.rids_next(rs)) {
+		int nr = store->table_api.column_find_int(tr, nr_col, rid);
+		dbl *f = store->table_api.column_find_value(tr, fraction_col, rid);
+		ptr cbat;
+		const char *kind = store->table_api.column_find_string_start(tr, kind_col, rid, &cbat);
+		char k = kind ? kind[0] : 0;
+
+		store->table_api.column_find_string_end(cbat);
+		if (!f || is_dbl_nil(*f)) {
+			GDKfree(f);
+			continue;
+		}
+		if (k == 'n') {
+			h->nulls = *f;
+			rows = store->table_api.column_find_lng(tr, find_sql_column(hists, "rows"), rid);
+		} else if ((k == 'm' && nr >= 0 && nr < HIST_MCV && h->mcv[nr].vtype == 0) ||
+				   (k == 'b' && nr >= 0 && nr < HIST_BUCKETS + 2 && h->bounds[nr].vtype == 0)) {
+			const char *v = store->table_api.column_find_string_start(tr, value_col, rid, &cbat);
+
+			if (k == 'm') {
+				ok = hist_fromstr(tpe, v, &h->mcv[nr]);
+				h->mcvfrac[nr] = *f;
+				h->nmcv = MAX(h->nmcv, nr + 1);
+			} else {
+				dbl *d = store->table_api.column_find_value(tr, distinct_col, rid);
+
+				ok = hist_fromstr(tpe, v, &h->bounds[nr]) && d && !is_dbl_nil(*d);
+				h->boundfrac[nr] = *f;
+				h->bounddist[nr] = d ? MAX(*d, 1) : 1;
+				GDKfree(d);
+				h->nbounds = MAX(h->nbounds, nr + 1);
+			}
+			store->table_api.column_find_string_end(cbat);
+		}
+		GDKfree(f);
+	}
+	store->table_api.rids_destroy(rs);
+	/* a histogram with holes, e.g. from a failed conversion, is useless */
+	for (int i = 0; i < h->nmcv && ok; i++)
+		ok = h->mcv[i].vtype == tpe;
+	for (int i = 0; i < h->nbounds && ok; i++)
+		ok = h->bounds[i].vtype == tpe;
+	if (!ok || is_lng_nil(rows) || rows <= 0) {
+		histogram_destroy(h);
+		return hist_create(tpe, 0, 0);
+	}
+	h->rows = rows;
+	return h;
+}
+
+/* load the histogram of c if that wasn't done yet */
+static bool
+hist_ensure(sql_trans *tr, sql_column *c)
+{
+	MT_Lock *l = hist_lock(tr, c);
+	sql_histogram *h;
+	bool loaded;
+
+	MT_lock_set(l);
+	loaded = c->hist != NULL;
+	MT_lock_unset(l);
+	if (loaded)
+		return true;
+	/* the store is read outside of the lock */
+	if (!(h = hist_load(tr, c)))
+		return false;
+	MT_lock_set(l);
+	if (!c->hist) {
+		c->hist = h;
+		h = NULL;
+	}
+	MT_lock_unset(l);
+	histogram_destroy(h);
+	return true;
+}
+
+static void
+hist_install(sql_trans *tr, sql_column *c, sql_histogram *h)
+{
+	MT_Lock *l = hist_lock(tr, c);
+	sql_histogram *o;
+
+	MT_lock_set(l);
+	o = c->hist;
+	c->hist = h;
+	MT_lock_unset(l);
+	histogram_destroy(o);
+}
+
+int
+sql_trans_analyze_histogram(sql_trans *tr, sql_column *c, BAT *b)
+{
+	histpoint *p;
+	BAT *s;
+	BUN n;
+	dbl scale, nulls;
+	sql_histogram *h = NULL;
+	int res;
+
+	if (!hist_column_ok(c) || !hist_type_ok(b->ttype) || b->ttype != c->type.type->localtype)
+		return LOG_OK;
+	if (!(s = hist_sample(b, &scale)))
+		return LOG_ERR;
+	if ((p = hist_points(s, scale, &n, &nulls)) != NULL)
+		h = hist_build(b->ttype, p, n, nulls, 2 * scale);
+	GDKfree(p);
+	BBPreclaim(s);
+	if (!h)
+		return LOG_ERR;
+	h->rows = (lng) BATcount(b);
+	if ((res = hist_store(tr, c, h)) != LOG_OK) {
+		histogram_destroy(h);
+		return res;
+	}
+	hist_install(tr, c, h);
+	return LOG_OK;
+}
+
+void
+sql_trans_append_histogram(sql_trans *tr, sql_column *c, BAT *ins)
+{
+	MT_Lock *l = hist_lock(tr, c);
+	histpoint *o = NULL, *p = NULL, *m = NULL;
+	BUN no, np, nm;
+	dbl scale, nulls;
+	sql_histogram *h = NULL;
+	BAT *s;
+
+	if (BATcount(ins) < HIST_APPEND_MIN || !hist_column_ok(c) || !hist_type_ok(ins->ttype) ||
+		ins->ttype != c->type.type->localtype || !hist_ensure(tr, c))
+		return;
+	MT_lock_set(l);
+	bool empty = c->hist->rows == 0;
+	MT_lock_unset(l);
+	if (empty || !(s = hist_sample(ins, &scale)))
+		return;
+	if (!(p = hist_points(s, scale, &np, &nulls))) {
+		BBPreclaim(s);
+		return;
+	}
+	MT_lock_set(l);
+	if ((o = hist_as_points(c->hist, &no)) != NULL &&
+		(m = hist_merge(ins->ttype, o, no, p, np, &nm)) != NULL &&
+		(h = hist_build(ins->ttype, m, nm, nulls + c->hist->nulls * c->hist->rows, 2 * scale)) != NULL) {
+		histogram_destroy(c->hist);
+		c->hist = h;
+	}
+	MT_lock_unset(l);
+	GDKfree(o);
+	GDKfree(p);
+	GDKfree(m);
+	BBPreclaim(s);
+}
+
+static dbl
+hist_getdbl(int tpe, const void *v, bool *ok)
+{
+	*ok = true;
+	switch (ATOMstorage(tpe)) {
+	case TYPE_bte:
+		return *(const bte *) v;
+	case TYPE_sht:
+		return *(const sht *) v;
+	case TYPE_int:
+		return *(const int *) v;
+	case TYPE_lng:
+		return (dbl) *(const lng *) v;
+#ifdef HAVE_HGE
+	case TYPE_hge:
+		return (dbl) *(const hge *) v;
+#endif
+	case TYPE_flt:
+		return *(const flt *) v;
+	case TYPE_dbl:
+		return *(const dbl *) v;
+	default:
+		*ok = false;
+		return 0;
+	}
+}
+
+/* fraction of all rows with a value below v, or at most v if incl */
+static dbl
+hist_below(sql_histogram *h, const void *v, bool incl)
+{
+	dbl f = 0, hw = 1 - h->nulls, bf;
+	int lo, hi, c;
+
+	for (int i = 0; i < h->nmcv; i++) {
+		hw -= h->mcvfrac[i];
+		c = ATOMcmp(h->tpe, VALptr(&h->mcv[i]), v);
+		if (c < 0 || (c == 0 && incl))
+			f += h->mcvfrac[i];
+	}
+	if (h->nbounds == 0 || hw <= 0)
+		return f;
+	c = ATOMcmp(h->tpe, v, VALptr(&h->bounds[0]));
+	if (c < 0 || (c == 0 && !incl))
+		return f;
+	if (ATOMcmp(h->tpe, v, VALptr(&h->bounds[h->nbounds - 1])) >= 0)
+		return f + hw;
+	/* binary search the bucket with bounds[lo] <= v < bounds[hi] */
+	lo = 0;
+	hi = h->nbounds - 1;
+	while (hi - lo > 1) {
+		int mid = (lo + hi) / 2;
+
+		if (ATOMcmp(h->tpe, VALptr(&h->bounds[mid]), v) <= 0)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	bf = h->boundfrac[lo];
+	if (ATOMcmp(h->tpe, v, VALptr(&h->bounds[lo])) > 0) {
+		bool lok, hok, vok;
+		dbl l = hist_getdbl(h->tpe, VALptr(&h->bounds[lo]), &lok);
+		dbl u = hist_getdbl(h->tpe, VALptr(&h->bounds[hi]), &hok);
+		dbl x = hist_getdbl(h->tpe, v, &vok);
+		dbl pos = lok && hok && vok && u > l ? (x - l) / (u - l) : 0.5;
+
+		bf += (h->boundfrac[hi] - bf) * pos;
+	}
+	return f + hw * bf;
+}
+
+/* Fraction of the rows of c equal to v, < 0 if there is no histogram */
+dbl
+sql_trans_hist_equal(sql_trans *tr, sql_column *c, const ValRecord *v)
+{
+	MT_Lock *l = hist_lock(tr, c);
+	sql_histogram *h;
+	dbl sel = -1;
+
+	if (!hist_column_ok(c) || !hist_ensure(tr, c))
+		return -1;
+	MT_lock_set(l);
+	h = c->hist;
+	if (h->rows > 0 && v->vtype == h->tpe) {
+		const void *p = VALptr(v);
+		dbl hw = 1 - h->nulls;
+		int lo = 0, hi = h->nbounds - 1;
+
+		for (int i = 0; i < h->nmcv && sel < 0; i++) {
+			if (ATOMcmp(h->tpe, VALptr(&h->mcv[i]), p) == 0)
+				sel = h->mcvfrac[i];
+			hw -= h->mcvfrac[i];
+		}
+		if (sel >= 0) {
+			/* a most common value */
+		} else if (h->nbounds == 0 || hw <= 0 ||
+			ATOMcmp(h->tpe, p, VALptr(&h->bounds[0])) < 0 ||
+			ATOMcmp(h->tpe, p, VALptr(&h->bounds[hi])) > 0) {
+			sel = 0;
+		} else if (ATOMcmp(h->tpe, p, VALptr(&h->bounds[0])) == 0) {
+			sel = hw * h->boundfrac[0] / h->bounddist[0];
+		} else {
+			/* binary search the bucket with bounds[lo] < v <= bounds[hi] */
+			while (hi - lo > 1) {
+				int mid = (lo + hi) / 2;
+
+				if (ATOMcmp(h->tpe, VALptr(&h->bounds[mid]), p) < 0)
+					lo = mid;
+				else
+					hi = mid;
+			}
+			sel = hw * (h->boundfrac[hi] - h->boundfrac[hi - 1]) / h->bounddist[hi];
+		}
+	}
+	MT_lock_unset(l);
+	return sel;
+}
+
+/* Fraction of the rows of c between lo and hi, where a NULL bound is
+ * unbounded, < 0 if there is no histogram. */
+dbl
+sql_trans_hist_range(sql_trans *tr, sql_column *c, const ValRecord *lo, bool loincl, const ValRecord *hi, bool hiincl)
+{
+	MT_Lock *l = hist_lock(tr, c);
+	sql_histogram *h;
+	dbl sel = -1;
+
+	if (!hist_column_ok(c) || !hist_ensure(tr, c))
+		return -1;
+	MT_lock_set(l);
+	h = c->hist;
+	if (h->rows > 0 && (!lo || lo->vtype == h->tpe) && (!hi || hi->vtype == h->tpe)) {
+		dbl u = hi ? hist_below(h, VALptr(hi), hiincl) : 1 - h->nulls;
+		dbl b = lo ? hist_below(h, VALptr(lo), !loincl) : 0;
+
+		sel = MAX(u - b, 0);
+	}
+	MT_lock_unset(l);
+	return sel;
+}
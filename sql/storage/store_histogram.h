@@ -0,0 +1,26 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2024 MonetDB Foundation;
+ * Copyright August 2008 - 2023 MonetDB B.V.;
+ * Copyright 1997 - July 2008 CWI.
+ */
+
+#ifndef STORE_HIST_H
+#define STORE_HIST_H
+
+#include "sql_catalog.h"
+
+#define HIST_SAMPLE 30000		/* larger columns are sampled */
+#define HIST_MCV 10				/* most common values kept per column */
+#define HIST_BUCKETS 64			/* equi-depth buckets over the other values */
+#define HIST_APPEND_MIN 10000	/* smaller appends don't refresh the histogram */
+
+extern void histogram_destroy(struct sql_histogram *h);
+extern int sql_trans_drop_histogram(sql_trans *tr, sql_column *c);
+
+#endif /* STORE_HIST_H */
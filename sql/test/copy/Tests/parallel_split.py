@@ -0,0 +1,79 @@
+import os, sys, tempfile, pymonetdb
+try:
+    from MonetDBtesting import process
+except ImportError:
+    import process
+
+# COPY INTO splits buffers of at least 256 KiB into records with parallel
+# scanners, which cut the buffer at arbitrary offsets.  The quoted fields
+# here span several lines and hold field separators, escaped quotes and
+# escaped backslashes, and they make up most of the input, so that the
+# cuts fall inside them.  A record with a missing field after the parallel
+# part must be reported on the line it starts on, counting the newlines
+# inside the quoted fields.  (Conversion errors report the record number.)
+
+NROWS = 10000
+
+def value(i):
+    # about 150 bytes, with a newline every 20 or so
+    parts = [f'r{i} p{j} |x\\"y\\\\z' for j in range(8)]
+    return '\n'.join(parts)
+
+def quoted(v):
+    return '"' + v.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+with tempfile.TemporaryDirectory() as farm_dir:
+    os.mkdir(os.path.join(farm_dir, 'db1'))
+    good = os.path.join(farm_dir, 'good.csv')
+    bad = os.path.join(farm_dir, 'bad.csv')
+    lines = [f'{i}|{quoted(value(i))}|{i % 7}\n' for i in range(NROWS)]
+    data = ''.join(lines)
+    if len(data) < 1024 * 1024:
+        sys.stderr.write(f'expected at least 1 MiB of input, got {len(data)} bytes\n')
+    with open(good, 'w') as f:
+        f.write(data)
+    # the line of the bad record, counting the newlines in the fields
+    badline = data.count('\n') + 1
+    with open(bad, 'w') as f:
+        f.write(data)
+        f.write(f'{NROWS}|"x"\n')
+        f.write(lines[0])
+
+    with process.server(args=['--set', 'gdk_nr_threads=4'],
+                        mapiport='0', dbname='db1',
+                        dbfarm=os.path.join(farm_dir, 'db1'),
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        cur.execute('CREATE TABLE cp (i INT, s VARCHAR(200), j INT)')
+
+        cur.execute(f"COPY INTO cp FROM '{good}' USING DELIMITERS '|', E'\\n', '\"'")
+        if cur.rowcount != NROWS:
+            sys.stderr.write(f'expected {NROWS} rows to be loaded, got {cur.rowcount}\n')
+        cur.execute('SELECT i, s, j FROM cp ORDER BY i')
+        res = cur.fetchall()
+        expected = [(i, value(i), i % 7) for i in range(NROWS)]
+        if res != expected:
+            for r, e in zip(res, expected):
+                if r != e:
+                    sys.stderr.write(f'expected {e}, got {r}\n')
+                    break
+            else:
+                sys.stderr.write(f'expected {len(expected)} rows, got {len(res)}\n')
+
+        try:
+            cur.execute(f"COPY INTO cp FROM '{bad}' USING DELIMITERS '|', E'\\n', '\"'")
+            sys.stderr.write('expected the COPY INTO of the bad record to fail\n')
+        except pymonetdb.DatabaseError as e:
+            if f'line {badline}:' not in str(e):
+                sys.stderr.write(f'expected an error on line {badline}, got: {e}\n')
+
+        cur.execute('SELECT count(*) FROM cp')
+        if cur.fetchall() != [(NROWS,)]:
+            sys.stderr.write('expected the failed COPY INTO to add no rows\n')
+
+        cur.execute('DROP TABLE cp')
+        cur.close()
+        conn.close()
+        s.communicate()
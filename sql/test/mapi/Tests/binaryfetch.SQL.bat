@@ -0,0 +1,3 @@
+@echo off
+
+binaryfetch.exe %HOST% %MAPIPORT% sql
@@ -0,0 +1,3 @@
+#!/bin/sh
+
+binaryfetch $HOST $MAPIPORT sql
@@ -0,0 +1,87 @@
+import os, sys, tempfile, pymonetdb
+try:
+    from MonetDBtesting import process
+except ImportError:
+    import process
+
+# When a query ran before, mitosis sizes the partitions on the time the
+# previous run took: a cheap query on a large table gets fewer pieces than
+# its size warrants, an expensive query on a small table more.  With
+# mito_feedback=0 the pieces only depend on the size of the table.
+#
+# The pieces depend on the number of threads: at most
+# MAX_PARTS2THREADS_RATIO (4) times as many, so the threads are set here
+# instead of taken from the cores of the host.  Mtest starts the server
+# with --forcemito, which gives every query at least a piece per thread,
+# so that is switched off.
+
+THREADS = 4
+CHEAP = 'SELECT count(*) FROM mfbig WHERE i > 5'
+EXPENSIVE = "SELECT count(*) FROM mfsmall WHERE md5(CAST(i AS VARCHAR(10))) LIKE '%abc%'"
+
+def noforcemito(cur):
+    cur.execute("SELECT val FROM sys.debugflags() WHERE flag = 'forcemito'")
+    if cur.fetchall()[0][0]:
+        cur.execute("SELECT sys.debug('forcemito')")
+
+def pieces(cur, query):
+    # the plan binds the column once per piece
+    cur.execute('TRACE ' + query)
+    cur.execute("SELECT count(*) FROM sys.tracelog() WHERE stmt LIKE '%sql.bind(%'")
+    return cur.fetchall()[0][0]
+
+def load(cur):
+    cur.execute('CREATE TABLE mfbig (i INT)')
+    cur.execute('INSERT INTO mfbig SELECT value FROM generate_series(0, 2000000)')
+    cur.execute('CREATE TABLE mfsmall (i INT)')
+    cur.execute('INSERT INTO mfsmall SELECT value FROM generate_series(0, 300000)')
+
+with tempfile.TemporaryDirectory() as farm_dir:
+    os.mkdir(os.path.join(farm_dir, 'db1'))
+    with process.server(args=['--set', f'gdk_nr_threads={THREADS}'],
+                        mapiport='0', dbname='db1',
+                        dbfarm=os.path.join(farm_dir, 'db1'),
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        noforcemito(cur)
+        load(cur)
+
+        first = pieces(cur, CHEAP)
+        pieces(cur, CHEAP)
+        last = pieces(cur, CHEAP)
+        if not last < first:
+            sys.stderr.write(f'cheap query: expected fewer than {first} pieces after it ran, got {last}\n')
+
+        first = pieces(cur, EXPENSIVE)
+        last = pieces(cur, EXPENSIVE)
+        if not last > first:
+            sys.stderr.write(f'expensive query: expected more than {first} pieces after it ran, got {last}\n')
+        if last > 4 * THREADS:
+            sys.stderr.write(f'expensive query: expected at most {4 * THREADS} pieces, got {last}\n')
+
+        cur.close()
+        conn.close()
+        s.communicate()
+
+    with process.server(args=['--set', f'gdk_nr_threads={THREADS}', '--set', 'mito_feedback=0'],
+                        mapiport='0', dbname='db1',
+                        dbfarm=os.path.join(farm_dir, 'db1'),
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        noforcemito(cur)
+
+        for query in (CHEAP, EXPENSIVE):
+            first = pieces(cur, query)
+            last = pieces(cur, query)
+            if last != first:
+                sys.stderr.write(f'{query}: expected {first} pieces without feedback, got {last}\n')
+
+        cur.execute('DROP TABLE mfbig')
+        cur.execute('DROP TABLE mfsmall')
+        cur.close()
+        conn.close()
+        s.communicate()
@@ -0,0 +1,63 @@
+import os, sys, tempfile, pymonetdb
+try:
+    from MonetDBtesting import process
+except ImportError:
+    import process
+
+# A partitioned result that is only exported is not packed: the result set
+# takes the partitions of its columns (sql.resultSetParts).  When the whole
+# result fits in the first reply it is exported from the partitions, else
+# the columns are packed when the result set is made.  Either way the
+# output must be the same as without mitosis.  mclient asks for 1000 rows
+# in the first reply.
+
+QUERIES = [
+    # some partitions are empty
+    'SELECT i, s, d FROM rp WHERE i < 10',
+    # exported from the partitions
+    'SELECT i, s, d FROM rp WHERE i % 5 = 0',
+    # more rows than fit in the first reply
+    'SELECT i, s, d FROM rp WHERE i % 2 = 0',
+    # no rows at all
+    'SELECT i, s, d FROM rp WHERE i < 0',
+]
+
+def run(port, optimizer):
+    sql = f"SET optimizer = '{optimizer}';\n" + ''.join(q + ';\n' for q in QUERIES)
+    with process.client('sql', port=port, dbname='db1', format='csv', echo=False,
+                        stdin=process.PIPE, stdout=process.PIPE,
+                        stderr=process.PIPE) as c:
+        out, err = c.communicate(sql)
+    if err:
+        sys.stderr.write(err)
+    return out
+
+with tempfile.TemporaryDirectory() as farm_dir:
+    os.mkdir(os.path.join(farm_dir, 'db1'))
+    with process.server(args=['--set', 'mito_parts=4'],
+                        mapiport='0', dbname='db1',
+                        dbfarm=os.path.join(farm_dir, 'db1'),
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        cur.execute('CREATE TABLE rp (i INT, s VARCHAR(10), d DECIMAL(8,2))')
+        cur.execute("INSERT INTO rp SELECT value, CASE WHEN value % 7 = 0 THEN NULL ELSE 'v' || value END, value / 4.0 FROM generate_series(0, 3000)")
+
+        for q in QUERIES:
+            cur.execute('EXPLAIN ' + q)
+            plan = '\n'.join(r[0] for r in cur.fetchall())
+            if 'sql.resultSetParts' not in plan or 'mat.pack' in plan:
+                sys.stderr.write(f'{q}: expected the partitions to go to sql.resultSetParts, got:\n{plan}\n')
+
+        parts = run(s.dbport, 'default_pipe')
+        packed = run(s.dbport, 'sequential_pipe')
+        if parts != packed:
+            sys.stderr.write(f'expected the same output as without mitosis, got:\n{parts}\ninstead of:\n{packed}\n')
+        if parts.count('\n') != 10 + 600 + 1500 + 0:
+            sys.stderr.write(f'expected 2110 rows, got {parts.count(chr(10))}\n')
+
+        cur.execute('DROP TABLE rp')
+        cur.close()
+        conn.close()
+        s.communicate()
@@ -0,0 +1,65 @@
+import os, sys, tempfile, pymonetdb
+try:
+    from MonetDBtesting import process
+except ImportError:
+    import process
+
+# With sql_autoparam, queries that only differ in their literals share a
+# parameterized plan.  Literals of the same kind share it even when they
+# need a wider type than the first one, in which case the plan is made
+# again for the wider type.  The parameterized plans are not prepared
+# statements of the user: they don't show in sys.prepared_statements and
+# don't use up the statement ids.
+
+def check(cur, query, expected):
+    cur.execute(query)
+    res = cur.fetchall()
+    if res != expected:
+        sys.stderr.write(f'{query}: expected {expected}, got {res}\n')
+
+with tempfile.TemporaryDirectory() as farm_dir:
+    os.mkdir(os.path.join(farm_dir, 'db1'))
+    with process.server(args=['--set', 'sql_autoparam=yes'],
+                        mapiport='0', dbname='db1',
+                        dbfarm=os.path.join(farm_dir, 'db1'),
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        cur.execute("CREATE TABLE ap (i INT, s VARCHAR(20))")
+        cur.execute("INSERT INTO ap VALUES (1, 'a'), (2, 'bb'), (300, 'ccc'), (100000, 'dddd')")
+
+        # tinyint, smallint, int and bigint literals, then a tinyint again
+        check(cur, "SELECT i FROM ap WHERE i > 1 ORDER BY i", [(2,), (300,), (100000,)])
+        check(cur, "SELECT i FROM ap WHERE i > 200 ORDER BY i", [(300,), (100000,)])
+        check(cur, "SELECT i FROM ap WHERE i > 99999 ORDER BY i", [(100000,)])
+        check(cur, "SELECT i FROM ap WHERE i > 3000000000 ORDER BY i", [])
+        check(cur, "SELECT i FROM ap WHERE i > 2 ORDER BY i", [(300,), (100000,)])
+        # strings of different lengths
+        check(cur, "SELECT s FROM ap WHERE s = 'bb'", [('bb',)])
+        check(cur, "SELECT s FROM ap WHERE s = 'dddd'", [('dddd',)])
+        check(cur, "SELECT s FROM ap WHERE s = 'e'", [])
+        # decimals of another scale get their own plan
+        check(cur, "SELECT CAST(1.5 + i AS VARCHAR(10)) FROM ap WHERE i < 2", [('2.5',)])
+        check(cur, "SELECT CAST(1.25 + i AS VARCHAR(10)) FROM ap WHERE i < 2", [('2.25',)])
+        check(cur, "SELECT CAST(123.5 + i AS VARCHAR(10)) FROM ap WHERE i < 2", [('124.5',)])
+
+        # the widened plan replaced the narrower ones, and it was reused
+        # (the count goes up both when a query is matched and when it is run)
+        cur.execute("SELECT query, count FROM sys.querycache() ORDER BY query")
+        res = [(q.rstrip('\n;'), c) for q, c in cur.fetchall()]
+        expected = [('select cast(1.25 + i as varchar(10)) from ap where i < 2', 2),
+                    ('select cast(123.5 + i as varchar(10)) from ap where i < 2', 2),
+                    ('select i from ap where i > 3000000000 order by i', 4),
+                    ("select s from ap where s = 'bb'", 6)]
+        if res != expected:
+            sys.stderr.write(f'query cache: expected {expected}, got {res}\n')
+
+        check(cur, "SELECT count(*) FROM sys.prepared_statements", [(0,)])
+        cur.execute("PREPARE SELECT i FROM ap WHERE i = ?")
+        check(cur, "SELECT statementid FROM sys.prepared_statements", [(0,)])
+        check(cur, "EXEC 0(300)", [(300,)])
+
+        cur.close()
+        conn.close()
+        s.communicate()
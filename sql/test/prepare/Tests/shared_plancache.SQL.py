@@ -0,0 +1,65 @@
+###
+# Check that the optimized plan of a prepared statement is shared with the
+#   other sessions, but not when it uses a temporary table, and that
+#   committed DDL invalidates the shared plans
+#   (statement ids count from 0 in every session)
+###
+from MonetDBtesting.sqltest import SQLTestCase
+
+def stats(tc):
+    tc.execute('select name, value from sys.plancache_statistics();').assertSucceeded()
+    return dict(tc.test_results[-1].data)
+
+def delta(tc, before, expected):
+    after = stats(tc)
+    res = {k: after[k] - before[k] for k in expected}
+    if res != expected:
+        raise SystemExit(f'expected plan cache changes {expected}, got {res}')
+    return after
+
+with SQLTestCase() as tc1:
+    tc1.connect(username="monetdb", password="monetdb")
+    tc1.execute('create table pct (i int, s varchar(10));').assertSucceeded()
+    tc1.execute("insert into pct values (1, 'one'), (2, 'two'), (3, 'three');").assertSucceeded()
+    tc1.execute('create global temporary table pcgt (i int) on commit preserve rows;').assertSucceeded()
+
+    with SQLTestCase() as tc2:
+        tc2.connect(username="monetdb", password="monetdb")
+        st = stats(tc1)
+
+        # the first session optimizes the plan and shares it
+        tc1.execute('prepare select s from pct where i > ? order by i;').assertSucceeded()
+        tc1.execute('exec 0(1);').assertSucceeded().assertDataResultMatch([('two',), ('three',)])
+        st = delta(tc1, st, {'inserts': 1, 'hits': 0})
+
+        # the second session gets it, also with other white space
+        tc2.execute('prepare select s\n  from pct   where i > ? order by i;').assertSucceeded()
+        tc2.execute('exec 0(2);').assertSucceeded().assertDataResultMatch([('three',)])
+        st = delta(tc1, st, {'inserts': 0, 'hits': 1})
+
+        # committed DDL invalidates the shared plans
+        tc1.execute('alter table pct add column j int;').assertSucceeded()
+        tc2.execute('prepare select s from pct where i > ? order by i;').assertSucceeded()
+        tc2.execute('exec 1(0);').assertSucceeded().assertDataResultMatch([('one',), ('two',), ('three',)])
+        after = stats(tc1)
+        if after['invalidations'] <= st['invalidations'] or after['hits'] != st['hits'] or after['inserts'] != st['inserts'] + 1:
+            raise SystemExit(f'expected the plan to be invalidated and made again, got {after} after {st}')
+
+        # and the new plan is shared again
+        st = after
+        tc1.execute('prepare select s from pct where i > ? order by i;').assertSucceeded()
+        tc1.execute('exec 1(2);').assertSucceeded().assertDataResultMatch([('three',)])
+        st = delta(tc1, st, {'inserts': 0, 'hits': 1})
+
+        # the contents of a temporary table are private to the session
+        st = stats(tc1)
+        tc1.execute('prepare select count(*) from tmp.pcgt where i > ?;').assertSucceeded()
+        tc2.execute('prepare select count(*) from tmp.pcgt where i > ?;').assertSucceeded()
+        st = delta(tc1, st, {'inserts': 0, 'hits': 0})
+        tc1.execute('insert into tmp.pcgt values (10), (11);').assertSucceeded()
+        tc2.execute('insert into tmp.pcgt values (20);').assertSucceeded()
+        tc1.execute('exec 2(0);').assertSucceeded().assertDataResultMatch([(2,)])
+        tc2.execute('exec 2(0);').assertSucceeded().assertDataResultMatch([(1,)])
+
+    tc1.execute('drop table tmp.pcgt;').assertSucceeded()
+    tc1.execute('drop table pct;').assertSucceeded()
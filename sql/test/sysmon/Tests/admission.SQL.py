@@ -0,0 +1,103 @@
+###
+# Check that a query is queued while the sessions of its user hold more
+#   memory than the max_memory of the user and another query is running,
+#   that it runs once the running query has finished, and that the footprint
+#   of a finished query only counts its own memory, not the result sets that
+#   its session still holds, and that a queued query still honours its
+#   query timeout
+###
+
+import pymonetdb
+import os
+import threading
+import time
+
+db = os.environ["TSTDB"]
+pt = int(os.environ["MAPIPORT"])
+SLEEP_TIME = 3000               # milliseconds
+HOLD = "select * from generate_series(cast(0 as bigint), 1500000)"
+
+def connect(user):
+    return pymonetdb.connect(database=db, port=pt, username=user,
+                             password=user, autocommit=True)
+
+def run(dbh, query, res):
+    try:
+        cur = dbh.cursor()
+        cur.execute(query)
+        res.append(cur.fetchall() if cur.description else None)
+    except pymonetdb.exceptions.Error as e:
+        res.append(e)
+
+def check(what, res, expected_res):
+    if res != expected_res:
+        print(what)
+        print("result:\n" + str(res))
+        print("expected:\n" + str(expected_res))
+
+mstdbh = pymonetdb.connect(database=db, port=pt, username="monetdb",
+                           password="monetdb", autocommit=True)
+mstcur = mstdbh.cursor()
+mstcur.execute("create procedure admission_sleep(i int) external name alarm.sleep")
+mstcur.execute("create user admu with password 'admu' name 'admu' schema sys max_memory 20000000")
+mstcur.execute("grant execute on procedure admission_sleep to admu")
+
+# two sessions that each keep a 12MB result set open, 24MB together
+dbh1 = connect("admu")
+dbh2 = connect("admu")
+dbh3 = connect("admu")
+hold1 = dbh1.cursor()
+hold1.execute(HOLD)
+hold2 = dbh2.cursor()
+hold2.execute(HOLD)
+
+# a query that was admitted before the budget of the user was exhausted
+sleeper = []
+t1 = threading.Thread(target=run, args=(dbh1, f"call admission_sleep({SLEEP_TIME})", sleeper))
+t1.start()
+time.sleep(1)
+queued = []
+t2 = threading.Thread(target=run, args=(dbh3, "select 42", queued))
+t2.start()
+time.sleep(1)
+
+mstcur.execute("select status, query from sys.queue('admu') where query like 'select 42%' or query like 'call admission_sleep%' order by query")
+check("queue while queued", mstcur.fetchall(),
+      [("running", f"call admission_sleep({SLEEP_TIME})\n;"),
+       ("queued", "select 42\n;")])
+check("queued query not yet done", queued, [])
+
+t1.join()
+t2.join(timeout=10)
+check("sleeper", sleeper, [None])
+check("queued query", queued, [[(42,)]])
+
+# the session of the sleep query held 12MB, the query itself next to nothing
+mstcur.execute("select status, footprint < 4 from sys.queue('admu') where query like 'call admission_sleep%'")
+check("footprint", mstcur.fetchall(), [("finished", True)])
+
+# a queued query gives up when its query timeout is reached, it does not
+# wait for the running query to finish
+dbh3.cursor().execute("call sys.setquerytimeout(1)")
+sleeper = []
+t1 = threading.Thread(target=run, args=(dbh1, f"call admission_sleep({SLEEP_TIME})", sleeper))
+t1.start()
+time.sleep(1)
+timedout = []
+start = time.time()
+run(dbh3, "select 43", timedout)
+waited = time.time() - start
+t1.join()
+check("sleeper", sleeper, [None])
+check("timed out query", [type(r).__name__ for r in timedout], ["OperationalError"])
+check("timeout message", ["Query aborted due to timeout" in str(r) for r in timedout], [True])
+check("timed out before the running query finished", waited < SLEEP_TIME / 1000 - 0.5, True)
+
+hold1.close()
+hold2.close()
+dbh1.close()
+dbh2.close()
+dbh3.close()
+mstcur.execute("drop user admu")
+mstcur.execute("drop procedure admission_sleep")
+mstdbh.close()
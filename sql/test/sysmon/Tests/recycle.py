@@ -0,0 +1,97 @@
+import os, sys, tempfile, pymonetdb
+try:
+    from MonetDBtesting import process
+except ImportError:
+    import process
+
+# With recycle_memory, a repeated selection on an unchanged column reuses
+# the kept result, also from another session, and a committed change of
+# the column drops what was kept of it, so that the next run sees the new
+# data.  The columns must be persistent, hence the restart after loading.
+
+def check(cur, query, expected):
+    cur.execute(query)
+    res = cur.fetchall()
+    if res != expected:
+        sys.stderr.write(f'{query}: expected {expected}, got {res}\n')
+
+def stats(cur):
+    cur.execute('SELECT name, value FROM sys.recycle_statistics()')
+    return dict(cur.fetchall())
+
+def delta(cur, before, expected):
+    after = stats(cur)
+    res = {k: after[k] - before[k] for k in expected}
+    for k in expected:
+        if (expected[k] == 0) != (res[k] == 0):
+            sys.stderr.write(f'expected recycler changes {expected}, got {res}\n')
+            break
+    return after
+
+QUERY = 'SELECT count(*) FROM rt WHERE i BETWEEN 100000 AND 599999'
+
+with tempfile.TemporaryDirectory() as farm_dir:
+    os.mkdir(os.path.join(farm_dir, 'db1'))
+    with process.server(mapiport='0', dbname='db1',
+                        dbfarm=os.path.join(farm_dir, 'db1'),
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        # a permutation of 0 .. 1000000, so that the selection is not cheap
+        cur.execute('CREATE TABLE rt (i INT)')
+        cur.execute('INSERT INTO rt SELECT CAST(value * 7919 % 1000001 AS INT) FROM generate_series(0, 1000001)')
+        cur.close()
+        conn.close()
+        s.communicate()
+
+    with process.server(args=['--set', 'recycle_memory=64'],
+                        mapiport='0', dbname='db1',
+                        dbfarm=os.path.join(farm_dir, 'db1'),
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn1 = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        conn2 = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur1 = conn1.cursor()
+        cur2 = conn2.cursor()
+        # one selection per query, not one per piece of the table
+        cur1.execute("SET optimizer = 'sequential_pipe'")
+        cur2.execute("SET optimizer = 'sequential_pipe'")
+
+        # the first run keeps the selection, the second one reuses it
+        st = stats(cur1)
+        check(cur1, QUERY, [(500000,)])
+        st = delta(cur1, st, {'admitted': 1})
+        check(cur1, QUERY, [(500000,)])
+        st = delta(cur1, st, {'hits': 1, 'admitted': 0})
+        # also in another session
+        check(cur2, QUERY, [(500000,)])
+        st = delta(cur1, st, {'hits': 1, 'admitted': 0})
+
+        # a committed update drops the kept result
+        cur2.execute('UPDATE rt SET i = -1 WHERE i < 200000')
+        cur2.execute('SELECT count(*) FROM rt')
+        check(cur1, QUERY, [(400000,)])
+        st = delta(cur1, st, {'invalidated': 1, 'admitted': 1})
+        check(cur2, QUERY, [(400000,)])
+        st = delta(cur1, st, {'hits': 1})
+
+        # an append makes the column longer, so the kept result no longer
+        # matches
+        cur1.execute('INSERT INTO rt VALUES (100000), (200000)')
+        check(cur2, QUERY, [(400002,)])
+        st = delta(cur1, st, {'hits': 0, 'admitted': 1})
+
+        # plans that modify tables don't keep their selections
+        cur1.execute('CREATE TABLE rt2 (i INT)')
+        st = stats(cur1)
+        cur1.execute('INSERT INTO rt2 SELECT i FROM rt WHERE i BETWEEN 300000 AND 799999')
+        st = delta(cur1, st, {'admitted': 0, 'hits': 0})
+
+        cur1.execute('DROP TABLE rt2')
+        cur1.execute('DROP TABLE rt')
+        cur1.close()
+        cur2.close()
+        conn1.close()
+        conn2.close()
+        s.communicate()
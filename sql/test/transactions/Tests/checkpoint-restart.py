@@ -0,0 +1,80 @@
+import os, re, sys, tempfile, time, pymonetdb
+try:
+    from MonetDBtesting import process
+except ImportError:
+    import process
+
+# A checkpoint of a transaction that changed many bats saves their heaps
+# with several threads, in chunks of SYNC_CHUNK bats, and syncs them
+# together.  After a crash right after the checkpoint the data must be
+# as committed.  Mtest starts the server with --forcemito, so the store
+# manager checkpoints within milliseconds; the number of bats that were
+# saved is taken from the performance trace (--debug=4096).
+
+NTABLES = 160
+NROWS = 500
+COLS = '(i INT, b BIGINT, d DOUBLE, s VARCHAR(20), t TINYINT, m DECIMAL(10,2), dt DATE, u BOOLEAN)'
+
+def check(cur, upd):
+    cur.execute(' UNION ALL '.join(f'SELECT {t}, count(*), sum(i), sum(b), count(DISTINCT s), count(u) FROM cr{t}' for t in range(NTABLES)))
+    for t, cnt, si, sb, cs, cu in cur.fetchall():
+        exp = (NROWS, NROWS * (NROWS - 1) // 2 + (upd * NROWS if t % 2 == 0 else 0),
+               t * NROWS + NROWS * (NROWS - 1) // 2, NROWS, NROWS)
+        if (cnt, si, sb, cs, cu) != exp:
+            sys.stderr.write(f'table cr{t}: expected {exp}, got {(cnt, si, sb, cs, cu)}\n')
+
+def saved(out):
+    # the bats saved in all chunks, and the most threads used for a chunk
+    res = [(int(n), int(t)) for n, t in re.findall(r'saved (\d+) bats using (\d+) threads', out)]
+    return sum(n for n, t in res), max((t for n, t in res), default=0)
+
+def crash(farm, setup, change, nbats):
+    with process.server(args=['--set', 'gdk_nr_threads=4', '--debug=4096'],
+                        mapiport='0', dbname='db1', dbfarm=farm,
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        setup(cur)
+        cur.close()
+        conn.close()
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=False)
+        cur = conn.cursor()
+        change(cur)
+        conn.commit()
+        cur.close()
+        # give the store manager the time to checkpoint
+        time.sleep(2)
+        s.kill()
+        out, err = s.communicate()
+        n, threads = saved(out)
+        if n < nbats or threads < 2:
+            sys.stderr.write(f'expected at least {nbats} bats saved by several threads, got {n} by at most {threads}\n')
+
+def create(cur):
+    for t in range(NTABLES):
+        cur.execute(f'CREATE TABLE cr{t} {COLS}')
+
+def insert(cur):
+    for t in range(NTABLES):
+        cur.execute(f'INSERT INTO cr{t} SELECT value, value + {t}, value / 4.0e0, \'s\' || value, value % 100, value / 8.0, date \'2000-01-01\' + value * interval \'1\' day, value % 2 = 0 FROM generate_series(0, {NROWS})')
+
+def update(cur):
+    for t in range(0, NTABLES, 2):
+        cur.execute(f'UPDATE cr{t} SET i = i + 1')
+
+with tempfile.TemporaryDirectory() as farm_dir:
+    farm = os.path.join(farm_dir, 'db1')
+    os.mkdir(farm)
+    crash(farm, create, insert, NTABLES * 8)
+    crash(farm, lambda cur: check(cur, 0), update, NTABLES // 2)
+
+    with process.server(mapiport='0', dbname='db1', dbfarm=farm,
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        check(cur, 1)
+        cur.close()
+        conn.close()
+        s.communicate()
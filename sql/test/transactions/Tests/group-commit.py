@@ -0,0 +1,73 @@
+import os, re, signal, sys, tempfile, threading, time, pymonetdb
+try:
+    from MonetDBtesting import process
+except ImportError:
+    import process
+
+# Concurrent autocommit transactions must be made durable by fewer log
+# syncs than there are commits when the syncing committer waits for the
+# others (wal_commit_delay), and none of them may get lost.
+
+NTHREADS = 8
+NINSERTS = 25
+
+def inserter(port, t, errors):
+    try:
+        conn = pymonetdb.connect(port=port, database='db1', autocommit=True)
+        cur = conn.cursor()
+        for i in range(NINSERTS):
+            cur.execute(f'INSERT INTO gc VALUES ({t}, {i})')
+        cur.close()
+        conn.close()
+    except Exception as e:
+        errors.append(str(e))
+
+with tempfile.TemporaryDirectory() as farm_dir:
+    os.mkdir(os.path.join(farm_dir, 'db1'))
+    with process.server(args=['--set', 'wal_commit_delay=20000'],
+                        mapiport='0', dbname='db1',
+                        dbfarm=os.path.join(farm_dir, 'db1'),
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        cur.execute('CREATE TABLE gc (t INT, i INT)')
+        errors = []
+        threads = [threading.Thread(target=inserter, args=(s.dbport, t, errors)) for t in range(NTHREADS)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        for e in errors:
+            sys.stderr.write(f'insert failed: {e}\n')
+        # the server prints the group commit counters on SIGUSR1
+        os.kill(s.pid, signal.SIGUSR1)
+        time.sleep(2)
+        cur.close()
+        conn.close()
+        out, err = s.communicate()
+        m = re.search(r'group commit: (\d+) transactions in (\d+) log syncs, largest group (\d+)', out)
+        if m is None:
+            sys.stderr.write('no group commit information printed\n')
+        else:
+            commits, syncs, largest = (int(x) for x in m.groups())
+            if commits < NTHREADS * NINSERTS:
+                sys.stderr.write(f'expected at least {NTHREADS * NINSERTS} commits, got {commits}\n')
+            if syncs >= commits:
+                sys.stderr.write(f'expected fewer log syncs than commits, got {syncs} syncs for {commits} commits\n')
+            if largest < 2:
+                sys.stderr.write(f'expected a group of at least 2 commits, largest was {largest}\n')
+
+    with process.server(mapiport='0', dbname='db1',
+                        dbfarm=os.path.join(farm_dir, 'db1'),
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        cur.execute('SELECT count(*), count(DISTINCT t), count(DISTINCT i) FROM gc')
+        res = cur.fetchall()
+        if res != [(NTHREADS * NINSERTS, NTHREADS, NINSERTS)]:
+            sys.stderr.write(f'expected {[(NTHREADS * NINSERTS, NTHREADS, NINSERTS)]}, got {res}\n')
+        cur.close()
+        conn.close()
+        s.communicate()
@@ -0,0 +1,69 @@
+import os, sys, tempfile, pymonetdb
+try:
+    from MonetDBtesting import process
+except ImportError:
+    import process
+
+# A transaction with more than 1<<17 rows of changes to several bats is
+# replayed from the write-ahead log by multiple threads after a crash
+# (REPLAY_PARALLEL_MIN in gdk_logger.c); all of its changes, and none of
+# the uncommitted ones, must be there after the restart.  With
+# --forcemito large transactions are written to the bats at commit
+# instead of replayed, so that is switched off.
+
+NROWS = 50000
+
+def noforcemito(cur):
+    cur.execute("SELECT val FROM sys.debugflags() WHERE flag = 'forcemito'")
+    if cur.fetchall()[0][0]:
+        cur.execute("SELECT sys.debug('forcemito')")
+
+with tempfile.TemporaryDirectory() as farm_dir:
+    os.mkdir(os.path.join(farm_dir, 'db1'))
+    with process.server(args=['--set', 'gdk_nr_threads=4'],
+                        mapiport='0', dbname='db1',
+                        dbfarm=os.path.join(farm_dir, 'db1'),
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        noforcemito(cur)
+        cur.execute('CREATE TABLE wr1 (i INT, b BIGINT, d DOUBLE, s VARCHAR(20))')
+        cur.execute('CREATE TABLE wr2 (i INT, t TINYINT)')
+        cur.execute('INSERT INTO wr2 SELECT value, value % 100 FROM generate_series(0, 1000)')
+        cur.close()
+        conn.close()
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=False)
+        cur = conn.cursor()
+        cur.execute(f'INSERT INTO wr1 SELECT value, value * 3, value / 4.0e0, \'s\' || value FROM generate_series(0, {NROWS})')
+        cur.execute(f'INSERT INTO wr2 SELECT value, value % 50 FROM generate_series(1000, {NROWS})')
+        cur.execute('UPDATE wr2 SET t = t + 1 WHERE i < 1000')
+        cur.execute('DELETE FROM wr2 WHERE i % 10 = 3')
+        conn.commit()
+        # not committed, so not replayed
+        cur.execute('INSERT INTO wr1 VALUES (-1, -1, -1, \'lost\')')
+        cur.close()
+        s.kill()
+        s.communicate()
+
+    with process.server(args=['--set', 'gdk_nr_threads=4'],
+                        mapiport='0', dbname='db1',
+                        dbfarm=os.path.join(farm_dir, 'db1'),
+                        stdin=process.PIPE,
+                        stdout=process.PIPE, stderr=process.PIPE) as s:
+        conn = pymonetdb.connect(port=s.dbport, database='db1', autocommit=True)
+        cur = conn.cursor()
+        cur.execute('SELECT count(*), sum(i), sum(b), sum(d), count(DISTINCT s), min(i) FROM wr1')
+        res = cur.fetchall()
+        exp = [(NROWS, NROWS * (NROWS - 1) // 2, 3 * NROWS * (NROWS - 1) // 2, NROWS * (NROWS - 1) / 8, NROWS, 0)]
+        if res != exp:
+            sys.stderr.write(f'expected {exp}, got {res}\n')
+        cur.execute('SELECT count(*), sum(i), sum(t) FROM wr2')
+        res = cur.fetchall()
+        rows = [i for i in range(NROWS) if i % 10 != 3]
+        exp = [(len(rows), sum(rows), sum(i % 100 + 1 if i < 1000 else i % 50 for i in rows))]
+        if res != exp:
+            sys.stderr.write(f'expected {exp}, got {res}\n')
+        cur.close()
+        conn.close()
+        s.communicate()
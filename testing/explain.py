@@ -51,3 +51,27 @@ def function_with_more_than_one_result_bat(tab):
     for key,val in histo.items():
         nhisto.append((key, str(val)))
     return sorted(nhisto)
+
+# Returns the tables whose columns the MAL plan reads
+def bound_tables(tab):
+    tables = set()
+    for row in tab:
+        if row[0].find('usec') < 0:
+            g = re.match(r'^[^#].*\ssql\.(?:tid|bind)\([^,]*, "[^"]*":str, "([^"]*)":str', row[0])
+            if g:
+                tables.add(g.group(1))
+    return [(t,) for t in sorted(tables)]
+
+# Returns the select functions the MAL plan calls
+def select_functions(tab):
+    funcs = set()
+    for row in tab:
+        if row[0].find('usec') < 0:
+            g = re.match(r'^[^#].*\s([a-zA-Z_][a-zA-Z_0-9]*\.[a-zA-Z_0-9]*select)\(.*;', row[0])
+            if g:
+                funcs.add(g.group(1))
+    return [(f,) for f in sorted(funcs)]
+
+# Returns the number of cross products in a PLAN
+def crossproducts(tab):
+    return [(str(sum(row[0].count('crossproduct') for row in tab)),)]
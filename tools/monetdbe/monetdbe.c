@@ -36,6 +36,7 @@
 #include "remote.h"
 #include "sql.h"
 #include "sql_result.h"
+#include "sql_arrow.h"
 #include "mutils.h"
 
 #define UNUSED(x) (void)(x)
@@ -1386,7 +1387,7 @@ monetdbe_prepare_cb(void* context, char* tblname, columnar_result* results, size
 	}
 
 	rel = rel_project(sa, NULL, rets);
-	be->q = qc_insert(be->mvc->qc, sa, rel, NULL, args, be->mvc->type, NULL, be->no_mitosis);
+	be->q = qc_insert(be->mvc->qc, sa, rel, NULL, args, be->mvc->type, NULL, be->no_mitosis, false);
 	*prepare_id = be->q->id;
 
 	/*
@@ -2897,6 +2898,25 @@ cleanup:
 	return mdbe->msg;
 }
 
+char*
+monetdbe_result_fetch_arrow(monetdbe_result* mres, struct ArrowSchema *schema, struct ArrowArray *array)
+{
+	mvc* m;
+	monetdbe_result_internal* result = (monetdbe_result_internal*) mres;
+	monetdbe_database_internal *mdbe = result->mdbe;
+
+	if ((mdbe->msg = validate_database_handle(mdbe, "monetdbe.monetdbe_result_fetch_arrow")) != MAL_SUCCEED)
+		return mdbe->msg;
+	if ((mdbe->msg = getSQLContext(mdbe->c, NULL, &m, NULL)) != MAL_SUCCEED)
+		return mdbe->msg;
+	if (!schema || !array) {
+		set_error(mdbe, createException(MAL, "monetdbe.monetdbe_result_fetch_arrow", "Parameter schema or array is NULL"));
+		return mdbe->msg;
+	}
+	mdbe->msg = mvc_export_arrow_array(result->monetdbe_resultset, schema, array);
+	return mdbe->msg;
+}
+
 static void
 data_from_date(date d, monetdbe_data_date *ptr)
 {
@@ -157,6 +157,50 @@ DEFAULT_STRUCT_DEFINITION(monetdbe_data_time, time);
 DEFAULT_STRUCT_DEFINITION(monetdbe_data_timestamp, timestamp);
 // UUID, INET, XML ?
 
+/* The Arrow C data interface, as defined (and meant to be copied) by
+ * https://arrow.apache.org/docs/format/CDataInterface.html */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+	/* Array type description */
+	const char *format;
+	const char *name;
+	const char *metadata;
+	int64_t flags;
+	int64_t n_children;
+	struct ArrowSchema **children;
+	struct ArrowSchema *dictionary;
+
+	/* Release callback */
+	void (*release)(struct ArrowSchema *);
+	/* Opaque producer-specific data */
+	void *private_data;
+};
+
+struct ArrowArray {
+	/* Array data description */
+	int64_t length;
+	int64_t null_count;
+	int64_t offset;
+	int64_t n_buffers;
+	int64_t n_children;
+	const void **buffers;
+	struct ArrowArray **children;
+	struct ArrowArray *dictionary;
+
+	/* Release callback */
+	void (*release)(struct ArrowArray *);
+	/* Opaque producer-specific data */
+	void *private_data;
+};
+
+#endif /* ARROW_C_DATA_INTERFACE */
+
 monetdbe_export const char *monetdbe_version(void);
 
 monetdbe_export int   monetdbe_open(monetdbe_database *db, char *url, monetdbe_options *opts);
@@ -171,6 +215,9 @@ monetdbe_export int   monetdbe_in_transaction(monetdbe_database dbhdl);
 
 monetdbe_export char* monetdbe_query(monetdbe_database dbhdl, char* query, monetdbe_result** result, monetdbe_cnt* affected_rows);
 monetdbe_export char* monetdbe_result_fetch(monetdbe_result *mres, monetdbe_column** res, size_t column_index);
+/* the whole result as an Arrow struct array; fixed width columns share
+ * the server memory, so release both before closing the database */
+monetdbe_export char* monetdbe_result_fetch_arrow(monetdbe_result *mres, struct ArrowSchema *schema, struct ArrowArray *array);
 monetdbe_export char* monetdbe_cleanup_result(monetdbe_database dbhdl, monetdbe_result* result);
 
 monetdbe_export char* monetdbe_prepare(monetdbe_database dbhdl, char *query, monetdbe_statement **stmt, monetdbe_result** result);
@@ -370,6 +370,7 @@ main(int argc, char **av)
 	modules[mods++] = "netcdf";
 #endif
 	modules[mods++] = "csv";
+	modules[mods++] = "parquet";
 #ifdef HAVE_SHP
 	modules[mods++] = "shp";
 #endif